@@ -97,6 +97,22 @@ def main():
     test(build_dir, "test_server", "test_client")
     test(build_dir, "test_server_async_socket", "test_client_async_socket")
     test(build_dir, "test_server_ixwebsocket", "test_client_ixwebsocket")
+    test(build_dir, "test_server_nativewebsocket", "test_client_nativewebsocket")
+    test(build_dir, "test_server_tls", "test_client_tls")
+    test(build_dir, "test_server_nativewebsocket_tls", "test_client_nativewebsocket_tls")
+    test(build_dir, "test_server_compression", "test_client_compression")
+    test(build_dir, "test_server_message", "test_client_message")
+    test(build_dir, "test_server_rpc", "test_client_rpc")
+    test(build_dir, "test_server_unix", "test_client_unix")
+    test(build_dir, "test_server_ipv6", "test_client_ipv6")
+    test(build_dir, "test_server_multicast", "test_client_multicast")
+    test(build_dir, "test_server_shm", "test_client_shm")
+    test(build_dir, "test_server_listenergroup", "test_client_listenergroup")
+    test(build_dir, "test_server_connectionpool", "test_client_connectionpool")
+    test(build_dir, "test_server_threadpercore", "test_client_threadpercore")
+    test(build_dir, "test_server_socketoptions", "test_client_socketoptions")
+    test(build_dir, "test_server_timeout", "test_client_timeout")
+    test(build_dir, "test_server_ratelimit", "test_client_ratelimit")
 
 if __name__ == "__main__":
     main()
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <netsocket/defines.hpp> // for NETSOCKET_API
+#include <netsocket/result.hpp> // for netsocket::Result
+#include <netsocket/netsocket.hpp> // for netsocket::Socket
+
+#include <common/defines.hpp>
+
+#include <functional>
+#include <thread>
+#include <atomic>
+
+namespace netsocket
+{
+	// Runs a task, e.g. by posting it to a thread pool; an empty executor runs the task on the calling thread
+	using TaskExecutor = std::function<void(std::function<void()> task)>;
+
+	// Accepts connections on its own thread and delivers each of them to a callback as soon as it arrives.
+	// Pending connections are accepted in batches (accept4 with SOCK_NONBLOCK | SOCK_CLOEXEC on Linux),
+	// so a burst of connections costs one wakeup rather than one per connection.
+	class NETSOCKET_API Acceptor
+	{
+	public:
+		using OnAcceptCallback = std::function<void(Socket socket)>;
+
+		// Maximum number of connections accepted per wakeup
+		static constexpr u32 DefaultBatchSize = 64;
+
+	private:
+		// Listening socket, must outlive this Acceptor
+		Socket& m_socket;
+		std::thread m_thread;
+		std::atomic<bool> m_isRunning;
+		OnAcceptCallback m_onAcceptCallback;
+		TaskExecutor m_executor;
+		u32 m_batchSize;
+
+		void run();
+		void dispatch(Socket socket);
+
+	public:
+		// 'listeningSocket' must already be listening
+		Acceptor(Socket& listeningSocket);
+		Acceptor(Acceptor&) = delete;
+		Acceptor(Acceptor&&) = delete;
+		~Acceptor();
+
+		// Starts the accept thread, 'callback' is invoked (through 'executor' if given, otherwise on the accept thread) for every accepted socket.
+		// The accepted sockets are non-blocking, their send() and receive() still block until completion.
+		Result start(const OnAcceptCallback& callback, const TaskExecutor& executor = { }, u32 batchSize = DefaultBatchSize);
+		// Stops and joins the accept thread, connections which are still pending stay in the listening socket's backlog
+		void stop();
+		bool isRunning() const noexcept { return m_isRunning; }
+	};
+}
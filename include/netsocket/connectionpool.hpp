@@ -0,0 +1,134 @@
+#pragma once
+
+#include <common/defines.hpp>
+
+#include <netsocket/defines.hpp>
+#include <netsocket/result.hpp>
+#include <netsocket/netsocket.hpp>
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace netsocket
+{
+	class TlsContext;
+
+	struct ConnectionPoolOptions
+	{
+		// Idle connections kept per endpoint, a connection released beyond that is closed
+		u32 maxIdlePerEndpoint = 8;
+		// Milliseconds since connecting after which a connection is closed rather than reused (e.g. to follow DNS changes), 0 for no limit
+		u32 maxLifetime = 0;
+		// Milliseconds an idle connection may wait before it is closed rather than reused (servers drop idle connections), 0 for no limit
+		u32 maxIdleTime = 60000;
+		// On checkout, an idle connection must not be readable: readable means the peer has closed it (or sent something unexpected)
+		bool isHealthCheckEnabled = true;
+		// New connections race the endpoint's IPv6 and IPv4 addresses, see Socket::ConnectHappyEyeballs()
+		HappyEyeballsOptions connectOptions;
+		// New connections perform the TLS handshake with this context (the host is the server name), its session cache then
+		// also shortens the handshake of the connections opened later
+		std::shared_ptr<TlsContext> tlsContext;
+		// Called on every new connection once connected (and after the TLS handshake), e.g. to set socket options.
+		// The connection is dropped unless it returns Result::Success
+		std::function<Result(Socket& socket)> onConnect;
+	};
+
+	struct ConnectionPoolStats
+	{
+		// Connections opened, including those opened by prewarm()
+		u64 connectedCount = 0;
+		// Checkouts served by an idle connection
+		u64 reusedCount = 0;
+		// Idle connections closed on checkout because they were too old or failed the health check
+		u64 expiredCount = 0;
+		u64 unhealthyCount = 0;
+	};
+
+	class ConnectionPool;
+
+	// A connection checked out of a ConnectionPool, which gets it back when this object is destroyed. Release it only between requests:
+	// the next user expects the connection at a message boundary (and with the same TLS and compression state)
+	class NETSOCKET_API PooledConnection
+	{
+		friend class ConnectionPool;
+
+	private:
+		ConnectionPool* m_pool;
+		std::string m_endpoint;
+		Socket m_socket;
+		std::chrono::steady_clock::time_point m_connectTime;
+
+		PooledConnection(ConnectionPool& pool, const std::string& endpoint, Socket socket, std::chrono::steady_clock::time_point connectTime);
+
+	public:
+		PooledConnection(PooledConnection&& connection);
+		PooledConnection& operator=(PooledConnection&& connection);
+		PooledConnection(PooledConnection&) = delete;
+		~PooledConnection();
+
+		Socket& getSocket() noexcept { return m_socket; }
+		Socket* operator->() noexcept { return &m_socket; }
+		Socket& operator*() noexcept { return m_socket; }
+
+		// Returns the connection to the pool now (a disconnected one is closed instead)
+		void release();
+		// Closes the connection instead of returning it, e.g. after a protocol error left it in an unknown state
+		void discard();
+		// Takes the connection out of the pool for good, e.g. to hand it over to an AsyncSocket
+		Socket detach();
+	};
+
+	// Keeps connections to each endpoint (host and port) open between requests, so that a request doesn't pay the TCP
+	// (and TLS) handshake. Thread safe; the pool must outlive the connections checked out of it
+	class NETSOCKET_API ConnectionPool
+	{
+		friend class PooledConnection;
+
+	private:
+		struct IdleConnection
+		{
+			Socket socket;
+			std::chrono::steady_clock::time_point connectTime;
+			std::chrono::steady_clock::time_point idleTime;
+		};
+
+		ConnectionPoolOptions m_options;
+		// By endpoint, the most recently released connection last (it is reused first, its peer is the least likely to have dropped it)
+		std::unordered_map<std::string, std::deque<IdleConnection>> m_idleConnections;
+		ConnectionPoolStats m_stats;
+		mutable std::mutex m_mutex;
+
+		static std::string GetEndpoint(const std::string_view host, const std::string_view port);
+		std::optional<Socket> connect(const std::string_view host, const std::string_view port);
+		bool isExpired(std::chrono::steady_clock::time_point connectTime, std::chrono::steady_clock::time_point now) const;
+		// Returns a released connection to the idle connections of its endpoint
+		void release(const std::string& endpoint, Socket socket, std::chrono::steady_clock::time_point connectTime);
+
+	public:
+		ConnectionPool(const ConnectionPoolOptions& options = { });
+		ConnectionPool(ConnectionPool&) = delete;
+		ConnectionPool(ConnectionPool&&) = delete;
+		// Closes the idle connections
+		~ConnectionPool();
+
+		const ConnectionPoolOptions& getOptions() const noexcept { return m_options; }
+
+		// An idle connection to host:port which passes the checks, otherwise a new one. Empty if connecting fails
+		std::optional<PooledConnection> checkout(const std::string_view host, const std::string_view port);
+		// Opens connections to host:port until 'count' of them (at most ConnectionPoolOptions::maxIdlePerEndpoint) are idle,
+		// e.g. at startup, so that the first requests don't connect. Returns the number of idle connections to host:port
+		u32 prewarm(const std::string_view host, const std::string_view port, u32 count);
+
+		u32 getIdleCount(const std::string_view host, const std::string_view port) const;
+		// Closes all the idle connections
+		void clear();
+		ConnectionPoolStats getStats() const;
+	};
+}
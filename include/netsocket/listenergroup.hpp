@@ -0,0 +1,76 @@
+#pragma once
+
+#include <netsocket/defines.hpp> // for NETSOCKET_API
+#include <netsocket/result.hpp> // for netsocket::Result
+#include <netsocket/netsocket.hpp> // for netsocket::Socket
+#include <netsocket/acceptor.hpp> // for netsocket::Acceptor::DefaultBatchSize
+
+#include <common/defines.hpp>
+
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace netsocket
+{
+	struct ListenerGroupOptions
+	{
+		// Listening sockets, each with its own thread. 0 is one per core
+		u32 shardCount = 0;
+		IPAddressFamily ipAddressFamily = IPAddressFamily::IPv4;
+		// Hands every connection to the shard of the CPU which received it (see Socket::attachReusePortCpuSteering()),
+		// rather than by a hash of the addresses. Pair it with isPinnedToCores so that the shard also runs there
+		bool isCpuSteeringEnabled = false;
+		// Pins the thread of shard i to core i (modulo the number of cores)
+		bool isPinnedToCores = false;
+		// Maximum number of connections accepted per wakeup, see Socket::acceptMany()
+		u32 batchSize = Acceptor::DefaultBatchSize;
+		// Applied to the listening sockets and again to every accepted socket
+		SocketOptions socketOptions;
+	};
+
+	// Several listening sockets bound to the same address with SO_REUSEPORT, each accepting on its own thread: the kernel spreads
+	// the connections over them, so that a connection storm doesn't queue up behind a single accept loop.
+	// A shard serves the connections it accepted on its own thread (or hands them over to others from its callback).
+	// SO_REUSEPORT is Linux only, elsewhere the group has a single shard.
+	class NETSOCKET_API ListenerGroup
+	{
+	public:
+		// Called on the thread of the shard which accepted the connection
+		using OnAcceptCallback = std::function<void(Socket socket, u32 shardIndex)>;
+
+	private:
+		struct Shard
+		{
+			Socket socket;
+			std::thread thread;
+		};
+
+		ListenerGroupOptions m_options;
+		std::vector<std::unique_ptr<Shard>> m_shards;
+		OnAcceptCallback m_onAcceptCallback;
+		std::atomic<bool> m_isRunning;
+
+		void run(u32 shardIndex);
+
+	public:
+		ListenerGroup(const ListenerGroupOptions& options = { });
+		ListenerGroup(ListenerGroup&) = delete;
+		ListenerGroup(ListenerGroup&&) = delete;
+		~ListenerGroup();
+
+		// Creates the shards, binds them all to the address and listens
+		Result listen(const std::string_view ipAddress, const std::string_view portNumber);
+		// Starts the thread of every shard, the accepted sockets are non-blocking (their send() and receive() still block until completion)
+		Result start(const OnAcceptCallback& callback);
+		// Stops and joins the shard threads, once the callbacks running have returned
+		void stop();
+		bool isRunning() const noexcept { return m_isRunning; }
+
+		u32 getShardCount() const noexcept { return static_cast<u32>(m_shards.size()); }
+		Socket& getShardSocket(u32 shardIndex) { return m_shards[shardIndex]->socket; }
+	};
+}
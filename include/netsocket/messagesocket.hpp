@@ -0,0 +1,89 @@
+#pragma once
+
+#include <common/defines.hpp>
+
+#include <netsocket/defines.hpp>
+#include <netsocket/result.hpp>
+#include <netsocket/netsocket.hpp>
+
+#include <vector>
+#include <optional>
+
+namespace netsocket
+{
+	// Encoding of the message length in front of every message
+	enum class MessageHeader
+	{
+		// Fixed size, little-endian (the same bytes as Socket::send<u32>() on the supported platforms)
+		U16,
+		U32,
+		U64,
+		// LEB128: 7 bits per byte, the high bit set on every byte but the last. 1 byte up to 127, 2 bytes up to 16383, at most 10 bytes
+		VarInt
+	};
+
+	struct MessageFramingOptions
+	{
+		MessageHeader header = MessageHeader::U32;
+		// Larger messages are refused by sendMessage() and receiveMessage(), also bounded by what the header can encode
+		u32 maxMessageSize = 16 * 1024 * 1024;
+		// Size of the read-ahead buffer, which lets a single receive pick up several small messages.
+		// Message data at least as large is received directly into the destination
+		u32 readAheadSize = 64 * 1024;
+	};
+
+	// Length-prefixed messages over a connected Socket (plain, TLS or compressed).
+	// Sending and receiving can happen on two different threads, but not two sends or two receives at once.
+	// Once receiving has failed (disconnection, message too large) the stream can't be resynchronized, close the socket.
+	class NETSOCKET_API MessageSocket
+	{
+	public:
+		static constexpr u32 MaxHeaderSize = 10;
+		// Most buffers sendMessageVectored() takes, the header goes in front of them
+		static constexpr u32 MaxVectoredBufferCount = 15;
+
+	private:
+		Socket& m_socket;
+		MessageFramingOptions m_options;
+		std::vector<u8> m_readAhead;
+		// [m_readBegin, m_readEnd) of m_readAhead has been received but not consumed yet
+		u32 m_readBegin;
+		u32 m_readEnd;
+		// Data bytes of the current message not received yet, see receiveMessageSize()
+		u32 m_remainingDataSize;
+
+		// Receives more bytes into the read-ahead buffer, keeping the unconsumed ones
+		bool fillReadAhead();
+		std::optional<u64> receiveHeader();
+
+	public:
+		// 'socket' must outlive this object
+		MessageSocket(Socket& socket, const MessageFramingOptions& options = { });
+		MessageSocket(MessageSocket&) = delete;
+		MessageSocket(MessageSocket&&) = default;
+
+		const MessageFramingOptions& getOptions() const noexcept { return m_options; }
+		Socket& getSocket() noexcept { return m_socket; }
+
+		// Largest message size the header can encode, capped by the maximum message size
+		u32 getMaxMessageSize() const noexcept;
+		// Writes the header of a 'size' bytes message to 'header' (at least MaxHeaderSize bytes), returns its length
+		u32 encodeHeader(u32 size, u8* header) const noexcept;
+
+		// Sends the header and the data with one vectored write, Result::Failed if the message is too large
+		Result sendMessage(const u8* bytes, u32 size);
+		// One message made of the buffers one after the other (e.g. a protocol header and a payload), still one write.
+		// Result::Failed if there are more than MaxVectoredBufferCount buffers
+		Result sendMessageVectored(const SocketBuffer* buffers, u32 count);
+		// Receives the next message into 'message' (resized to its size)
+		Result receiveMessage(std::vector<u8>& message);
+
+		// The same in two steps, to receive into a caller's buffer: the size of the next message, or an empty optional
+		// if the socket has been disconnected or the message is too large, then exactly that many bytes of data
+		std::optional<u32> receiveMessageSize();
+		Result receiveMessageData(u8* bytes, u32 size);
+
+		// Bytes already received but not consumed, waitReadable() on the socket doesn't see them
+		u32 getBufferedSize() const noexcept { return m_readEnd - m_readBegin; }
+	};
+}
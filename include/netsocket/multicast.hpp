@@ -0,0 +1,82 @@
+#pragma once
+
+#include <common/defines.hpp>
+
+#include <netsocket/defines.hpp>
+#include <netsocket/result.hpp>
+#include <netsocket/netsocket.hpp>
+
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace netsocket
+{
+	struct MulticastOptions
+	{
+		// Interface to send from or to receive on, see Socket::joinMulticastGroup(): an IPv4 address of the interface for an IPv4 group,
+		// its name or index for an IPv6 group. Empty lets the routing table pick
+		std::string networkInterface;
+		// Publisher: routers the datagrams may cross, 1 keeps them in the local network
+		u8 ttl = 1;
+		// Publisher: whether subscribers on the same host receive the datagrams
+		bool isLoopbackEnabled = true;
+		// Subscriber: most datagrams taken by one receiveBatch()
+		u32 batchSize = 64;
+		// Subscriber: larger datagrams are truncated. The default fits an Ethernet frame with the IPv4 and UDP headers
+		u32 maxDatagramSize = 1472;
+	};
+
+	// Sends datagrams to a multicast group: one send reaches every subscriber, instead of one send per receiver with unicast.
+	// UDP gives no delivery or ordering guarantee, the application numbers its datagrams if it needs to detect gaps
+	class NETSOCKET_API MulticastPublisher
+	{
+	private:
+		Socket m_socket;
+
+	public:
+		// 'group' is an IPv4 (224.0.0.0/4) or IPv6 (ff00::/8) multicast address, the socket's family follows it
+		MulticastPublisher(const std::string_view group, const std::string_view port, const MulticastOptions& options = { });
+		MulticastPublisher(MulticastPublisher&) = delete;
+		MulticastPublisher(MulticastPublisher&&) = default;
+
+		bool isValid() const noexcept { return m_socket.isValid(); }
+		Socket& getSocket() noexcept { return m_socket; }
+
+		// One datagram
+		Result publish(const u8* bytes, u32 size);
+		// One datagram per buffer, with as few system calls as possible (see Socket::sendDatagrams())
+		Result publishBatch(const SocketBuffer* datagrams, u32 count);
+	};
+
+	// Receives the datagrams sent to one or more multicast groups on a port, in batches
+	class NETSOCKET_API MulticastSubscriber
+	{
+	private:
+		Socket m_socket;
+		MulticastOptions m_options;
+		// batchSize datagrams of maxDatagramSize bytes
+		std::vector<u8> m_buffer;
+		std::vector<SocketDatagram> m_datagrams;
+
+	public:
+		// Binds to 'port' and joins 'group'. Several subscribers on the same host can share the port, each receives every datagram.
+		// Unicast datagrams sent to the port are received as well
+		MulticastSubscriber(const std::string_view group, const std::string_view port, const MulticastOptions& options = { });
+		MulticastSubscriber(MulticastSubscriber&) = delete;
+		MulticastSubscriber(MulticastSubscriber&&) = default;
+
+		bool isValid() const noexcept { return m_socket.isValid(); }
+		Socket& getSocket() noexcept { return m_socket; }
+
+		// Further groups of the same family, received on the same port. Closing the socket leaves all of them
+		Result join(const std::string_view group);
+		Result leave(const std::string_view group);
+
+		// Waits up to 'timeout' milliseconds (-1 forever) for datagrams and returns those received, at most MulticastOptions::batchSize.
+		// Empty if the timeout elapsed, an empty optional on error. The datagrams stay valid until the next call
+		std::optional<std::span<const SocketDatagram>> receiveBatch(s32 timeout = -1);
+	};
+}
@@ -0,0 +1,298 @@
+#pragma once
+
+#include <common/defines.hpp>
+
+#include <netsocket/defines.hpp>
+#include <netsocket/result.hpp>
+#include <netsocket/netsocket.hpp> // for netsocket::Socket
+#include <netsocket/websocketcommon.hpp> // for netsocket::WebSocketCompressionOptions
+#include <netsocket/websocketframe.hpp> // for netsocket::WebSocketOpcode
+#include <netsocket/acceptor.hpp> // for netsocket::Acceptor
+
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <chrono>
+#include <span>
+#include <atomic>
+#include <string>
+
+namespace netsocket
+{
+	class DeflateStream;
+	class InflateStream;
+
+	class NativeWebSocket;
+	using NativeWebSocketBroadcastResult = BasicWebSocketBroadcastResult<NativeWebSocket>;
+
+	// RFC 6455 WebSocket implemented directly over netsocket::Socket.
+	// It has the same public interface as netsocket::WebSocket (ixwebsocket backend) so that both can be swapped,
+	// but it doesn't run any threads of its own: frames are read (and pings/close frames answered) by the thread calling receive(),
+	// and sends are written to the socket by the calling thread.
+	class NETSOCKET_API NativeWebSocket
+	{
+		using OnDisconnectCallback = std::function<void(NativeWebSocket&)>;
+		using OnAcceptCallback = std::function<void(std::unique_ptr<NativeWebSocket> socket)>;
+		using OnSendBufferHighCallback = std::function<void(NativeWebSocket&, u64 bufferedAmount)>;
+		using OnSendBufferDrainCallback = std::function<void(NativeWebSocket&)>;
+
+		// Parameters agreed upon in the opening handshake (permessage-deflate)
+		struct DeflateParameters
+		{
+			bool isEnabled = false;
+			bool isServerNoContextTakeover = false;
+			bool isClientNoContextTakeover = false;
+			u8 serverMaxWindowBits = 15;
+			u8 clientMaxWindowBits = 15;
+		};
+
+	private:
+		Socket m_socket;
+		std::atomic<bool> m_isConnected;
+		bool m_isServer;
+		// True if this socket is a client socket and on the server machine
+		bool m_isServerOwnedClient;
+		bool m_isCloseSent;
+
+		std::mutex m_sendMutex;
+		std::vector<u8> m_sendBuffer;
+		std::vector<u8> m_compressBuffer;
+		// Source of the masking keys and of Sec-WebSocket-Key, created by the first client handshake
+		struct RandomGenerator;
+		std::unique_ptr<RandomGenerator> m_randomGenerator;
+
+		std::mutex m_receiveMutex;
+		// Read-ahead buffer, bytes [m_readBegin, m_readEnd) are yet to be consumed
+		std::vector<u8> m_readBuffer;
+		u32 m_readBegin;
+		u32 m_readEnd;
+		// Reassembled (and decompressed) incoming message
+		std::vector<u8> m_message;
+		std::vector<u8> m_inflateBuffer;
+		bool m_hasMessage;
+		u64 m_maxMessageSize;
+		// Limit on the TLS and opening handshakes, 0 if there is none
+		std::chrono::milliseconds m_handshakeTimeout;
+
+		// State of the incoming message being read with receiveChunk()
+		struct ReceiveStream
+		{
+			bool isActive = false;
+			bool isCompressed = false;
+			// The deflate trailer has been handed to the inflater, only the pending output remains
+			bool isTrailerFed = false;
+			// Header of the current frame and how much of its payload is still in the socket
+			WebSocketFrameHeader header;
+			u64 frameRemaining = 0;
+			// Consumed part of m_streamInput
+			u32 inputBegin = 0;
+		};
+		ReceiveStream m_receiveStream;
+		// Compressed bytes read from the socket and not inflated yet, bounded by a fixed size
+		std::vector<u8> m_streamInput;
+
+		// A message is being sent with sendChunk(), whole messages can't be sent until it is finished
+		bool m_isSendingChunks;
+		bool m_isSendChunksCompressed;
+
+		WebSocketCompressionOptions m_compressionOptions;
+		// TLS configuration of the last connect(), and the context of the connection (or of the accepted connections), nullptr without TLS
+		WebSocketTlsOptions m_tlsOptions;
+		std::shared_ptr<TlsContext> m_tlsContext;
+		DeflateParameters m_deflateParameters;
+		std::unique_ptr<DeflateStream> m_deflateStream;
+		std::unique_ptr<InflateStream> m_inflateStream;
+		// Reset the deflate/inflate sliding windows after every message
+		bool m_isDeflateNoContextTakeover;
+		bool m_isInflateNoContextTakeover;
+
+		// Connected clients accepted by a server socket, shared between the server socket and the accepted sockets
+		struct ClientRegistry;
+		std::shared_ptr<ClientRegistry> m_clientRegistry;
+		// Accept thread of a server socket, only after setOnAccept()
+		std::unique_ptr<Acceptor> m_acceptor;
+
+		OnDisconnectCallback m_onDisconnectCallback;
+
+		// Kept for interface parity with netsocket::WebSocket, frames are written to the kernel synchronously
+		u64 m_sendHighWatermark;
+		u64 m_sendLowWatermark;
+		OnSendBufferHighCallback m_onSendBufferHighCallback;
+		OnSendBufferDrainCallback m_onSendBufferDrainCallback;
+
+		// Performs the TLS handshake (if 'tlsContext' isn't nullptr) and the opening handshake over a freshly accepted socket
+		// and registers it with the server, nullptr if a handshake fails
+		static std::unique_ptr<NativeWebSocket> CreateAcceptedSocket(Socket socket, const WebSocketCompressionOptions& compressionOptions, u64 maxMessageSize,
+																		std::chrono::milliseconds handshakeTimeout, const std::shared_ptr<ClientRegistry>& clientRegistry,
+																		const std::shared_ptr<TlsContext>& tlsContext);
+
+		void callOnDisconnect();
+		void markDisconnected();
+		void unregisterFromServer();
+		Result generateRandom(u8* bytes, u32 size);
+
+		// Opening handshake, the peer's header must have arrived by 'deadline'
+		Result performClientHandshake(const std::string_view host, const std::string_view port, std::chrono::steady_clock::time_point deadline);
+		Result performServerHandshake(std::chrono::steady_clock::time_point deadline);
+		std::optional<std::string> readHttpHeader(std::chrono::steady_clock::time_point deadline);
+		void setupCompression();
+
+		// Read-ahead buffer management
+		Result fillReadBuffer(u32 minSize);
+		Result readExact(u8* bytes, u64 size);
+		Result readFrameHeader(WebSocketFrameHeader& header);
+		// Answers the control frames in the way (Ping, Close) and returns the header of the next data frame
+		Result readDataFrameHeader(WebSocketFrameHeader& header);
+		Result handleControlFrame(const WebSocketFrameHeader& header);
+		Result readMessage();
+		Result failConnection(WebSocketCloseCode code);
+		// Sends a Close frame with 'payload' (unless one has been sent already) and closes the socket.
+		// Both happen with m_sendMutex locked, so no send is in progress on the socket as it goes away.
+		Result closeConnection(const u8* payload, u32 size);
+
+		// Must be called with m_sendMutex locked.
+		// The functions below check isConnected() once they have locked it, as the socket is only closed with it locked.
+		Result sendFrameLocked(WebSocketOpcode opcode, bool isFinal, bool isCompressed, const u8* payload, u64 size);
+		Result sendControlFrame(WebSocketOpcode opcode, const u8* payload, u32 size);
+		Result sendMessage(WebSocketOpcode opcode, const u8* bytes, u32 size);
+		// Writes an already encoded frame (header + payload), used by broadcast()
+		Result sendEncodedFrame(const u8* bytes, u64 size);
+		// Must be called with m_clientRegistry->mutex locked, which keeps the clients from being torn down while sending to them,
+		// 'clients' must all be registered with this server socket
+		NativeWebSocketBroadcastResult broadcastLocked(const u8* bytes, u32 size, std::span<NativeWebSocket* const> clients);
+
+	public:
+		NativeWebSocket();
+		NativeWebSocket(NativeWebSocket&) = delete;
+		NativeWebSocket(NativeWebSocket&&) = delete;
+		~NativeWebSocket();
+		bool isConnected() const noexcept { return m_isConnected && isValid(); }
+		bool isValid() const noexcept { return m_socket.isValid(); }
+		Result listen();
+		// Blocks until a client has connected and completed the opening handshake,
+		// connections which fail the handshake (or don't complete it within the handshake timeout) are dropped. Returns nullptr if the server socket fails.
+		std::unique_ptr<NativeWebSocket> accept();
+		// Returns nullptr right away if no connection is pending, otherwise accepts it and performs the opening handshake
+		// (which waits up to the handshake timeout for the client's request), nullptr if the handshake fails
+		std::unique_ptr<NativeWebSocket> tryAccept();
+		// Starts an accept thread which accepts connections in batches and delivers them to 'callback' once their opening handshake is done.
+		// The handshake runs on the executor along with the callback (on the accept thread if no executor is given),
+		// so slow clients only hold up the accept thread when there is no executor. An empty callback stops the accept thread.
+		void setOnAccept(const OnAcceptCallback& callback, const TaskExecutor& executor = { });
+		// With TLS enabled, the accepted connections perform the TLS handshake before the opening handshake
+		Result bind(const std::string_view ipAddress, const std::string_view portNumber, const WebSocketCompressionOptions& compressionOptions = { },
+					const WebSocketTlsOptions& tlsOptions = { });
+		Result connect(const std::string_view ipAddress, const std::string_view port, const WebSocketCompressionOptions& compressionOptions = { },
+					const WebSocketTlsOptions& tlsOptions = { });
+		Result close();
+
+		bool isTls() const noexcept { return m_tlsContext != nullptr; }
+		// True if the TLS handshake of this connection resumed a previous session
+		bool isTlsSessionResumed() const noexcept { return m_socket.isTlsSessionResumed(); }
+
+		Result send(const u8* bytes, u32 size);
+		Result receive(u8* bytes, u32 size);
+
+		// Streaming: a message of any size goes through a fixed amount of memory.
+		// Sends the next part of a message as one WebSocket frame, the message ends with the chunk where isFinal is true.
+		// Other messages can't be sent in between, control frames (ping, close) can.
+		Result sendChunk(const u8* bytes, u32 size, bool isFinal);
+		// Receives the next part of the incoming message as it arrives, at most 'size' bytes.
+		// Uncompressed payloads are received directly into 'bytes', compressed ones are inflated through a small fixed buffer,
+		// so the maximum message size doesn't apply. Returns an empty optional if the connection is lost.
+		std::optional<WebSocketChunk> receiveChunk(u8* bytes, u32 size);
+
+		// Sends a Ping control frame (at most 125 bytes of payload), the Pong is consumed by receive()
+		Result ping(const u8* bytes = NULL, u32 size = 0);
+
+		// Incoming messages larger than this fail the connection with 1009 (Message Too Big), 64 MB by default
+		void setMaxMessageSize(u64 size) noexcept { m_maxMessageSize = size; }
+		u64 getMaxMessageSize() const noexcept { return m_maxMessageSize; }
+		// Limit on the TLS and opening handshakes of connect(), or of every connection accepted by this server socket, 10 s by default, 0 disables it.
+		// A peer which hasn't completed them in time is dropped, so a client which connects and stays silent doesn't hold up accept().
+		// Like the maximum message size, setOnAccept() keeps the value it was started with.
+		void setHandshakeTimeout(std::chrono::milliseconds timeout) noexcept { m_handshakeTimeout = timeout; }
+		std::chrono::milliseconds getHandshakeTimeout() const noexcept { return m_handshakeTimeout; }
+
+		const WebSocketCompressionOptions& getCompressionOptions() const noexcept { return m_compressionOptions; }
+
+		// Sends the same message to every client accepted by this server socket which is still connected.
+		// The frame is encoded (and compressed) once and the same bytes are written to every client,
+		// except for clients whose negotiated compression keeps a sliding window across messages (those are encoded individually).
+		NativeWebSocketBroadcastResult broadcast(const u8* bytes, u32 size);
+		// Same as above, but only to the given subset of clients accepted by this server socket,
+		// clients which aren't registered with it (anymore, e.g. closed) are reported as Result::SocketError
+		NativeWebSocketBroadcastResult broadcast(const u8* bytes, u32 size, std::span<NativeWebSocket* const> clients);
+		// Number of accepted clients which are registered with this server socket
+		u32 getClientCount() const;
+
+		// Frames are written to the kernel by send() itself, so there is never anything left to flush
+		Result finish(std::chrono::milliseconds timeout = std::chrono::milliseconds::max());
+		u64 getBufferedAmount() const { return 0; }
+		void setSendBufferWatermarks(u64 highWatermark, u64 lowWatermark);
+		u64 getSendHighWatermark() const noexcept { return m_sendHighWatermark; }
+		u64 getSendLowWatermark() const noexcept { return m_sendLowWatermark; }
+		void setOnSendBufferHigh(const OnSendBufferHighCallback& callback);
+		void setOnSendBufferDrain(const OnSendBufferDrainCallback& callback);
+
+		void setOnDisconnect(const OnDisconnectCallback& callback);
+		void setOnDisconnect(void (*onDisconnect)(NativeWebSocket& socket, void* userData), void* userData)
+		{
+			setOnDisconnect([userData, onDisconnect](NativeWebSocket& socket) { onDisconnect(socket, userData); });
+		}
+
+		template<typename T>
+		bool sendNonEnum(const T& value)
+		{
+			return send(reinterpret_cast<const u8*>(&value), sizeof(value)) == Result::Success;
+		}
+
+		template<typename EnumClassType>
+		bool sendEnum(const EnumClassType& value)
+		{
+			auto intValue = com::EnumClassToInt<EnumClassType>(value);
+			return send<decltype(intValue)>(intValue);
+		}
+
+		template<typename T>
+		bool send(const T& value)
+		{
+			if constexpr (std::is_enum<T>::value)
+				return sendEnum<T>(value);
+			else
+				return sendNonEnum<T>(value);
+		}
+
+		template<typename T>
+		std::optional<T> receiveNonEnum()
+		{
+			T value;
+			auto result = receive(reinterpret_cast<u8*>(&value), sizeof(value));
+			if(result == Result::Success)
+				return { value };
+			else
+				return { };
+		}
+
+		template<typename EnumClassType>
+		std::optional<EnumClassType> receiveEnum()
+		{
+			using IntType = typename std::underlying_type<EnumClassType>::type;
+			auto intValue = receive<IntType>();
+			if(intValue)
+				return { com::IntToEnumClass<EnumClassType>(*intValue) };
+			else
+				return { };
+		}
+
+		template<typename T>
+		std::optional<T> receive()
+		{
+			if constexpr (std::is_enum<T>::value)
+				return receiveEnum<T>();
+			else
+				return receiveNonEnum<T>();
+		}
+	};
+}
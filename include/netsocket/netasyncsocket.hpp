@@ -2,6 +2,7 @@
 
 #include <netsocket/defines.hpp> // for NETSOCKET_API
 #include <netsocket/netsocket.hpp> // for netsocket::Socket
+#include <netsocket/messagesocket.hpp> // for netsocket::MessageSocket
 #include <netsocket/assert.hpp> // for netsocket_assert()
 
 #include <common/defines.hpp> // for com::OptionalReference
@@ -131,7 +132,10 @@ namespace netsocket
 			enum class Type
 			{
 				Send,
-				Receive
+				Receive,
+				// Through the MessageSocket, see AsyncSocket::setMessageFraming()
+				SendMessage,
+				ReceiveMessage
 			};
 			typedef void (*ReceiveCallbackHandler)(const u8* bytes, u32 size, void* userData);
 	
@@ -146,6 +150,7 @@ namespace netsocket
 		public:
 			Transxn(const u8* data, u32 dataSize, Type type);
 			Transxn(ReceiveCallbackHandler receiveHandler, void* userData, BinaryFormatter& receiveFormatter, Type type);
+			Transxn(ReceiveCallbackHandler receiveHandler, void* userData, Type type);
 			Transxn(Transxn&& transxn);
 			Transxn& operator=(Transxn&& transxn) = delete;
 			Transxn(Transxn&) = delete;
@@ -156,11 +161,13 @@ namespace netsocket
 			u8* getBufferPtr();
 			u32 getBufferSize();
 	
-			bool doit(Socket& socket);
+			bool doit(Socket& socket, MessageSocket* messageSocket);
 		};
 	
 	private:
 		Socket m_socket;
+		// Set by setMessageFraming()
+		std::unique_ptr<MessageSocket> m_messageSocket;
 		std::unique_ptr<std::thread> m_thread;
 		std::deque<Transxn> m_transxnQueue;
 		std::condition_variable m_dataAvailableCV;
@@ -169,9 +176,16 @@ namespace netsocket
 		std::atomic<bool> m_isCanSendOrReceive;
 		std::atomic<bool> m_isStopThread;
 		std::atomic<bool> m_isTransactionError;
+		// Transactions in m_transxnQueue, read without the lock while busy polling
+		std::atomic<u32> m_queuedTransxnCount;
+		// Microseconds, see setBusyPoll()
+		std::atomic<u32> m_busyPollSpinTime;
 		bool m_isValid;
 			
 		void threadHandler();
+		// Busy polling: spins until 'condition' holds or the spin time is over, before the caller sleeps on a condition variable
+		template<typename Condition>
+		void spinUntil(Condition condition);
 		
 	public:
 		// Constructing AsyncSocket using Socket
@@ -194,12 +208,31 @@ namespace netsocket
 		std::optional<AsyncSocket> accept();
 		Result bind(const std::string_view ipAddress, const std::string_view port);
 		Result connect(const std::string_view ipAddress, const std::string_view port);
+		// Performs the TLS handshake over the connected socket (see Socket::startTls()), call it before queueing any send or receive
+		Result startTls(const std::shared_ptr<TlsContext>& context, const std::string_view serverName = { });
+		// Compressed stream mode (see Socket::startCompression()), call it before queueing any send or receive.
+		// finish() flushes what SocketCompressionOptions::FlushPolicy::PerBatch holds back
+		Result startCompression(const SocketCompressionOptions& options = { });
+		SocketCompressionStats getCompressionStats() const { return m_socket.getCompressionStats(); }
+		// Enables sendMessage() and receiveMessage(), call it before queueing any of them
+		Result setMessageFraming(const MessageFramingOptions& options = { });
+		// Busy-poll mode (see Socket::setBusyPoll()), and the transaction thread spins for the next transaction (finish() for the last one
+		// to complete) before sleeping on its condition variable. Call it before queueing any send or receive
+		Result setBusyPoll(const BusyPollOptions& options);
+		// The queued sends go out at the limited rate (see Socket::setSendRateLimit()), the caller never waits for it.
+		// Call it first before queueing any send, then at any time from any thread
+		Result setSendRateLimit(const RateLimit& limit);
+		RateLimit getSendRateLimit() const { return m_socket.getSendRateLimit(); }
 		Result finish();
 		Result close();
 		// Call to this function is asynchronous, i.e. it returns immediately
 		void send(const u8* bytes, u32 size);
 		// Call to this function is asynchronous, i.e. it returns immediately
 		void receive(Transxn::ReceiveCallbackHandler receiveHandler, void* userData, BinaryFormatter& receiveFormatter);
+		// Same as send() and receive(), one length-prefixed message at a time (see MessageSocket). Asynchronous too,
+		// the handler gets the message, or NULL if receiving failed
+		void sendMessage(const u8* bytes, u32 size);
+		void receiveMessage(Transxn::ReceiveCallbackHandler receiveHandler, void* userData);
 
 		Socket& getSocket() { return m_socket; }
 		bool isCanSendOrReceive() const { return m_isCanSendOrReceive; }
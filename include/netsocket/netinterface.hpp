@@ -27,7 +27,37 @@ namespace netsocket
 		decltype(auto) begin() const { return parts.cbegin(); }
 		decltype(auto) end() const { return parts.cend(); }
 	};
+
+	struct NETSOCKET_API IPv6Address
+	{
+		std::array<u8, 16> parts;
+		// Interface index, which link-local addresses (fe80::/10) need to be reachable, 0 otherwise
+		u32 scopeId = 0;
+
+		IPv6Address() = default;
+		// e.g. "2001:db8::1", "::ffff:192.168.1.1" or "fe80::1%eth0" (scope by interface name or index)
+		IPv6Address(const std::string_view str);
+
+		u8& operator[](u32 index) noexcept { return parts[index]; }
+		const u8& operator[](u32 index) const noexcept { return parts[index]; }
+
+		bool isLoopback() const noexcept;
+		bool isLinkLocal() const noexcept;
+		// ::ffff:a.b.c.d, how a dual-stack socket sees IPv4 peers
+		bool isIPv4Mapped() const noexcept;
+		IPv4Address getMappedIPv4Address() const noexcept;
+
+		// Compressed form (RFC 5952), with the "%scope" suffix if the scope isn't 0
+		std::string str() const;
+
+		decltype(auto) begin() { return parts.begin(); }
+		decltype(auto) end() { return parts.end(); }
+		decltype(auto) begin() const { return parts.cbegin(); }
+		decltype(auto) end() const { return parts.cend(); }
+	};
+
 	NETSOCKET_API std::vector<std::pair<std::string, IPv4Address>> GetInterfaceIPv4Addresses();
+	NETSOCKET_API std::vector<std::pair<std::string, IPv6Address>> GetInterfaceIPv6Addresses();
 	NETSOCKET_API std::string TrySelectingPhysicalInterfaceIPAddress(const std::vector<std::pair<std::string, IPv4Address>>& ipAddresses, std::string_view prefix = "");
 	NETSOCKET_API std::string GetIPv4Address(std::string_view prefix = "");
 }
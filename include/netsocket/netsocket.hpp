@@ -2,10 +2,16 @@
 
 #include <netsocket/defines.hpp>
 #include <netsocket/result.hpp> // for netsocket::Result enum
+#include <netsocket/tokenbucket.hpp> // for netsocket::TokenBucket
 #include <common/platform.h>
 #include <common/defines.hpp>
 #include <optional>
 #include <functional>
+#include <vector>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <limits>
 
 #ifdef PLATFORM_WINDOWS
 #	include <winsock2.h>
@@ -16,20 +22,24 @@ namespace netsocket
 	enum class IPAddressFamily : int
 	{
 		IPv4, /*AF_INET*/
-		IPv6  /*AF_INET6*/
+		IPv6, /*AF_INET6*/
+		Unix  /*AF_UNIX, local to the host, see Socket::bindUnix()*/
 	};
 
 	enum class SocketType : int
 	{
 		Stream,
-		Raw
+		Raw,
+		Datagram
 	};
 
 	enum class IPProtocol : int
 	{
 		TCP,
 		UDP,
-		RM
+		RM,
+		// The family's only protocol, Unix domain sockets always use it
+		Default
 	};
 
 	#ifdef PLATFORM_WINDOWS
@@ -40,6 +50,135 @@ namespace netsocket
 		#define NETSOCKET_INVALID_SOCKET_HANDLE -1 // invalid file descriptor
 	#endif // PLATFORM_LINUX
 
+	class TlsContext;
+	class TlsConnection;
+
+	// One of the buffers of Socket::sendVectored()
+	struct SocketBuffer
+	{
+		const u8* bytes;
+		u32 size;
+	};
+
+	// One of the datagrams of Socket::receiveDatagrams(): the caller sets the buffer, the call sets 'size'
+	struct SocketDatagram
+	{
+		u8* bytes;
+		u32 capacity;
+		u32 size;
+		// The datagram was larger than 'capacity', the rest of it is lost
+		bool isTruncated;
+	};
+
+	// See Socket::ConnectHappyEyeballs()
+	struct HappyEyeballsOptions
+	{
+		// Milliseconds before the next address is tried while the previous attempts are still pending (RFC 8305 recommends 250, at least 100)
+		u32 connectionAttemptDelay = 250;
+		// Overall limit in milliseconds, 0 leaves it to the system's connect timeout
+		u32 timeout = 30000;
+	};
+
+	// Tuning of a socket, see Socket::setOptions(). Options left empty keep the system's defaults, or whatever was set before
+	struct SocketOptions
+	{
+		// SO_SNDBUF and SO_RCVBUF in bytes. Set them before connect() or listen(): the TCP window scale is negotiated with the SYN.
+		// Linux caps them to net.core.wmem_max and net.core.rmem_max and reports twice the size (its bookkeeping overhead is included)
+		std::optional<u32> sendBufferSize;
+		std::optional<u32> receiveBufferSize;
+		// TCP_NODELAY, see Socket::setTCPNoDelay()
+		std::optional<bool> isNoDelay;
+		// Linux: TCP_QUICKACK acknowledges right away instead of delaying the ACKs. The kernel falls back to delayed ACKs on its own,
+		// set it again after receiving to keep it
+		std::optional<bool> isQuickAck;
+		// Linux: TCP_CORK holds back partial segments until uncorked (or for 200 ms at most), e.g. around a header and a body sent separately
+		std::optional<bool> isCorked;
+		// SO_KEEPALIVE, then the idle time before the first probe and the time between probes (in seconds) and the number of
+		// unanswered probes before the connection is dropped (TCP_KEEPIDLE, TCP_KEEPINTVL, TCP_KEEPCNT)
+		std::optional<bool> isKeepAliveEnabled;
+		std::optional<u32> keepAliveIdleTime;
+		std::optional<u32> keepAliveInterval;
+		std::optional<u32> keepAliveProbeCount;
+		// Linux: SO_BUSY_POLL, microseconds a blocking receive busy-polls the device queue before sleeping.
+		// Raising it above net.core.busy_read requires CAP_NET_ADMIN
+		std::optional<u32> busyPollTime;
+		// Linux: TCP_NOTSENT_LOWAT, bytes not yet sent above which the socket isn't writable, keeps the send queue (and its latency) short
+		std::optional<u32> notSentLowWatermark;
+		// Linux: SO_PRIORITY, 0 to 6 (7 and above require CAP_NET_ADMIN), picks the queue of the outgoing packets
+		std::optional<u32> priority;
+		// Pending connections listen() allows, SOMAXCONN by default
+		std::optional<u32> listenBacklog;
+		// Linux: SO_MAX_PACING_RATE, bytes per second. TCP spreads its segments over time instead of sending them in bursts
+		// (UDP only with the fq queueing discipline), 0 lifts the limit. Can be changed at any time, see also Socket::setSendRateLimit()
+		std::optional<u64> maxPacingRate;
+
+		// Request/response traffic: no Nagle's algorithm, no delayed ACKs, a short send queue and high priority
+		static SocketOptions LowLatency()
+		{
+			SocketOptions options;
+			options.isNoDelay = true;
+			options.isQuickAck = true;
+			options.notSentLowWatermark = 16 * 1024;
+			options.priority = 6;
+			return options;
+		}
+		// Bulk transfers: large buffers (up to the system's limits) so that the window covers the bandwidth-delay product, full segments
+		// and a long backlog for bursts of connections
+		static SocketOptions HighThroughput()
+		{
+			SocketOptions options;
+			options.sendBufferSize = 4 * 1024 * 1024;
+			options.receiveBufferSize = 4 * 1024 * 1024;
+			options.isNoDelay = false;
+			options.listenBacklog = 4096;
+			return options;
+		}
+	};
+
+	// See Socket::setBusyPoll()
+	struct BusyPollOptions
+	{
+		// Microseconds receive() keeps retrying the non-blocking socket before it sleeps in poll(), 0 disables busy polling.
+		// Ignored on a single core host, where spinning only keeps the peer from running
+		u32 spinTime = 200;
+		// Linux: SO_BUSY_POLL (see SocketOptions::busyPollTime), each retry then also polls the device queue. 0 leaves the socket's setting.
+		// Raising it above net.core.busy_read requires CAP_NET_ADMIN, setBusyPoll() goes on without it
+		u32 kernelBusyPollTime = 50;
+	};
+
+	// See Socket::startCompression()
+	struct SocketCompressionOptions
+	{
+		enum class FlushPolicy
+		{
+			// Every send() is flushed, the peer can decompress it as soon as it arrives
+			PerMessage,
+			// send() only feeds the compressor, which compresses better across small messages. The compressed bytes are flushed
+			// once 'batchSize' bytes have been sent since the last flush, on flush(), before receive() waits and on close()
+			PerBatch
+		};
+
+		// zlib compression level, 0 (none) to 9 (smallest), -1 is zlib's default (6)
+		s32 level = -1;
+		// Base two logarithm of the compressor's sliding window (9 to 15) and zlib's memory level (1 to 9)
+		u8 windowBits = 15;
+		u8 memLevel = 8;
+		// Preset dictionary: byte strings likely to occur in the data (e.g. JSON keys), the most frequent ones last.
+		// The peer must use the same one
+		std::vector<u8> dictionary;
+		FlushPolicy flushPolicy = FlushPolicy::PerMessage;
+		u32 batchSize = 64 * 1024;
+	};
+
+	struct SocketCompressionStats
+	{
+		// Bytes passed to send() and handed out by receive(), and their compressed size on the wire
+		u64 sentBytes = 0;
+		u64 sentCompressedBytes = 0;
+		u64 receivedBytes = 0;
+		u64 receivedCompressedBytes = 0;
+	};
+
 	class NETSOCKET_API Socket
 	{
 		using OnDisconnectCallback = std::function<void(Socket&)>;
@@ -50,6 +189,21 @@ namespace netsocket
 		int m_ipProtocol;
 		bool m_isConnected;
 		bool m_isValid;
+		// 0 is SOMAXCONN, see SocketOptions::listenBacklog
+		u32 m_listenBacklog;
+		// Microseconds, 0 if busy polling is disabled, see setBusyPoll()
+		u32 m_busyPollSpinTime;
+		// Milliseconds, -1 if sending waits for as long as it takes, see setSendTimeout()
+		s32 m_sendTimeout;
+		// Milliseconds, -1 if receiving waits for as long as it takes, see setReceiveTimeout()
+		s32 m_receiveTimeout;
+		// Set once startTls() has succeeded, send() and receive() then go through it
+		std::unique_ptr<TlsConnection> m_tls;
+		// Set once startCompression() has succeeded, deflates on top of the above
+		struct CompressionState;
+		std::unique_ptr<CompressionState> m_compression;
+		// Set once setSendRateLimit() has been called
+		std::unique_ptr<TokenBucket> m_sendRateLimiter;
 
 		OnDisconnectCallback m_onDisconnectCallback;
 
@@ -66,6 +220,22 @@ namespace netsocket
 		}
 
 		void callOnDisconnect();
+		// Replaces the handle with a fresh socket of the same kind, as one whose connect() failed can't portably be connected again.
+		// The options changed on the previous one and the non-blocking mode are carried over
+		Result reopen();
+		// Waits until recv() has something (data, the end of the stream or an error) after it would have blocked, busy polling first if enabled.
+		// False once the receive timeout elapses, see setReceiveTimeout()
+		bool waitReceivable();
+
+		// send(), receive() and receiveSome() underneath the compression layer
+		Result sendStream(const u8* bytes, u32 size);
+		// Waits for the rate limiter, returns how many of 'size' bytes can be sent now (all of them for a datagram)
+		u64 acquireSendAllowance(u64 size);
+		Result sendStreamVectored(const SocketBuffer* buffers, u32 count);
+		Result receiveStream(u8* bytes, u32 size);
+		std::optional<u32> receiveSomeStream(u8* bytes, u32 size);
+		Result sendCompressed(const SocketBuffer* buffers, u32 count);
+		std::optional<u32> receiveSomeCompressed(u8* bytes, u32 size);
 
 	public:
 
@@ -81,17 +251,11 @@ namespace netsocket
 			return s;
 		}
 
-		Socket()
-		{
-			m_socket = NETSOCKET_INVALID_SOCKET_HANDLE;
-			m_ipaFamily = 0;
-			m_socketType = 0;
-			m_ipProtocol = 0;
-			m_isConnected = false;
-			m_isValid = false;
-		}
+		Socket();
 
 		Socket(SocketType socketType, IPAddressFamily ipAddressFamily, IPProtocol ipProtocol);
+		// Applies 'options' right away, so that they are in place before bind(), connect() or listen() (see setOptions())
+		Socket(SocketType socketType, IPAddressFamily ipAddressFamily, IPProtocol ipProtocol, const SocketOptions& options);
 		
 		// Movable
 		Socket(Socket&& socket);
@@ -104,17 +268,157 @@ namespace netsocket
 
 		bool isConnected() const noexcept { return m_isConnected && isValid(); }
 		bool isValid() const noexcept { return m_isValid; }
+		// The underlying socket, e.g. to poll many sockets at once (see Server). Bytes buffered by TLS or compression don't show up there,
+		// waitReadable(0) sees them
+		SocketHandle getHandle() const noexcept { return m_socket; }
+		// Also puts the socket in non-blocking mode, accept() still blocks until a connection arrives
 		Result listen();
-		std::optional<Socket> accept();
+		// Blocks until a connection arrives. The accepted sockets inherit most options of the listening socket, 'options' are applied on top
+		// (as far as possible, errors are ignored)
+		std::optional<Socket> accept(const SocketOptions& options = { });
+		// Returns immediately, an empty optional if no connection is pending
+		std::optional<Socket> tryAccept(const SocketOptions& options = { });
+		// Accepts up to 'maxCount' pending connections without blocking and appends them to 'sockets'.
+		// The accepted sockets are non-blocking and close-on-exec (accept4 on Linux), send() and receive() still wait for them.
+		// Returns the number of sockets accepted
+		u32 acceptMany(std::vector<Socket>& sockets, u32 maxCount, const SocketOptions& options = { });
 		Result bind(const std::string_view ipAddress, const std::string_view portNumber);
+		// Tries every address 'ipAddress' resolves to in the socket's family, in order, until one connects.
+		// Each address after the first one is tried on a fresh socket with the same options (and local address if bound), so getHandle() may change
 		Result connect(const std::string_view ipAddress, const std::string_view port);
+		// Dual-stack connect (RFC 8305 Happy Eyeballs): resolves 'host' to its IPv6 and IPv4 addresses, then starts a connection attempt
+		// every HappyEyeballsOptions::connectionAttemptDelay milliseconds (right away once an attempt fails), alternating the families,
+		// and keeps the first one to connect. A peer with broken IPv6 then costs one attempt delay instead of a connect timeout.
+		// The socket is blocking, of the family which won
+		static std::optional<Socket> ConnectHappyEyeballs(const std::string_view host, const std::string_view port, const HappyEyeballsOptions& options = { });
+		// Same with several hosts (names or addresses of the same service), all of their addresses race
+		static std::optional<Socket> ConnectHappyEyeballs(const std::vector<std::string>& hosts, const std::string_view port, const HappyEyeballsOptions& options = { });
+		// IPAddressFamily::Unix only: a file system path, or on Linux an abstract name when it starts with '@' (no file, gone with the last socket).
+		// Binding fails if the path exists, remove stale socket files first. A bound datagram socket can receive right away
+		Result bindUnix(const std::string_view path);
+		Result connectUnix(const std::string_view path);
 		Result close();
+		// Shuts down the receiving side: a receive blocked on another thread returns as if the peer had closed the connection, sending still works
+		Result shutdownReceive();
 
 		Result send(const u8* bytes, u32 size);
+		// Sends the buffers one after the other as if they were contiguous, with as few writes as possible: one sendmsg()/WSASend() for a plain socket
+		// (or with kernel TLS), up to 16 KiB per record with TLS, a single flush with compression
+		Result sendVectored(const SocketBuffer* buffers, u32 count);
 		Result receive(u8* bytes, u32 size);
+		// Receives whatever is available, at least 1 byte and at most 'size' bytes (blocks if nothing is available yet)
+		// Returns the number of bytes received, or an empty optional if the socket has been disconnected
+		std::optional<u32> receiveSome(u8* bytes, u32 size);
+		// Sends 'size' bytes of the file at 'filePath' from 'offset' on (up to the end of the file by default).
+		// On Linux the kernel copies the file to the socket with sendfile(), with TLS too if it encrypts the records (see TlsContext::setKernelOffload()),
+		// otherwise the file is read and sent in chunks. Returns Result::Failed if the file can't be read
+		Result sendFile(const std::string& filePath, u64 offset = 0, u64 size = std::numeric_limits<u64>::max());
+
+		// Waits until the socket is readable (or has a pending connection), timeout is in milliseconds, -1 waits forever
+		// Returns false if the timeout elapsed or the socket is in error
+		bool waitReadable(s32 timeout = -1);
+		// Waits until the socket is writable, timeout is in milliseconds, -1 waits forever
+		bool waitWritable(s32 timeout = -1);
+
+		// send() and receive() keep their blocking semantics on a non-blocking socket, they wait for it to become ready
+		Result setNonBlocking(bool isNonBlocking);
 
 		// Disables the Nagle's algorithm, which helps reducing the latency in transmitting small packets
 		void setTCPNoDelay();
+		// Applies the options which are set, e.g. SocketOptions::LowLatency(). All of them are tried, returns Result::Failed if one of them
+		// isn't supported on this platform, Result::SocketError if the system refused one
+		Result setOptions(const SocketOptions& options);
+		// Effective values as reported by the system, options which don't apply to the socket (or the platform) are left empty
+		SocketOptions getOptions() const;
+		// Busy-poll receive mode: when nothing has arrived yet, receive() and receiveSome() spin on the (now non-blocking) socket
+		// for up to BusyPollOptions::spinTime before sleeping, which saves the wakeup latency at the cost of a busy core.
+		// Plain and compressed sockets only, a TLS socket keeps waiting in poll()
+		Result setBusyPoll(const BusyPollOptions& options);
+		bool isBusyPollEnabled() const noexcept { return m_busyPollSpinTime > 0; }
+		// Longest time send() waits for room in the send buffer (e.g. a peer which stopped reading), in milliseconds, -1 waits forever.
+		// Makes the socket non-blocking, send() then fails once it elapses and the socket is disconnected (part of the data may have been sent)
+		Result setSendTimeout(s32 timeout);
+		s32 getSendTimeout() const noexcept { return m_sendTimeout; }
+		// Longest time receive() and receiveSome() wait for incoming bytes (e.g. a silent peer), in milliseconds, -1 waits forever.
+		// Makes the socket non-blocking, a receive then fails once it elapses and the socket is disconnected (part of the data may have been received)
+		Result setReceiveTimeout(s32 timeout);
+		s32 getReceiveTimeout() const noexcept { return m_receiveTimeout; }
+		// Token bucket in front of every send: stream sends go out in pieces of up to RateLimit::burstSize bytes at RateLimit::rate,
+		// datagrams wait until they fit. Any protocol or platform, unlike the kernel pacing of SocketOptions::maxPacingRate.
+		// The first call must come before sending, later ones can come from any thread while another one sends (e.g. to make
+		// a bulk transfer yield to latency-sensitive traffic). RateLimit::rate 0 lifts the limit
+		Result setSendRateLimit(const RateLimit& limit);
+		// No limit (RateLimit::rate 0) if setSendRateLimit() hasn't been called
+		RateLimit getSendRateLimit() const;
+
+		// Linux, before bind(): lets several sockets bind the same address and port (SO_REUSEPORT), the kernel then spreads the incoming
+		// connections (or datagrams) over them. See ListenerGroup
+		Result setReusePort(bool isEnabled);
+		// Linux, once bound: the socket's SO_REUSEPORT group picks the socket by the CPU which received the connection, modulo 'groupSize',
+		// instead of by a hash of the addresses (a classic BPF program attached with SO_ATTACH_REUSEPORT_CBPF)
+		Result attachReusePortCpuSteering(u32 groupSize);
+
+		// IPv6 sockets only, before bind(): false makes a dual-stack socket, which bound to "::" also accepts IPv4 connections
+		// (their peers show up as ::ffff:a.b.c.d). The default is true on Windows and the net.ipv6.bindv6only sysctl on Linux
+		Result setIPv6Only(bool isIPv6Only);
+		// Numeric address of the connected peer, empty if it can't be retrieved
+		std::string getPeerAddress() const;
+		IPAddressFamily getIPAddressFamily() const noexcept;
+
+		// Datagram sockets, connected (send) or bound (receive): every buffer is a datagram of its own, sent with one sendmmsg() per 64 datagrams on Linux
+		Result sendDatagrams(const SocketBuffer* datagrams, u32 count);
+		// Waits up to 'timeout' milliseconds (-1 forever) for a datagram, then takes up to 'count' of those already queued, with one recvmmsg() on Linux.
+		// Returns the number of datagrams received, 0 if the timeout elapsed, or an empty optional on error
+		std::optional<u32> receiveDatagrams(SocketDatagram* datagrams, u32 count, s32 timeout = -1);
+
+		// UDP multicast, IPv4 or IPv6 group (e.g. "239.1.2.3" or "ff15::1234") matching the socket's family.
+		// 'networkInterface' selects the interface: one of its IPv4 addresses (see GetInterfaceIPv4Addresses()) for an IPv4 socket,
+		// its name or index (see GetInterfaceIPv6Addresses()) for an IPv6 socket. Empty lets the routing table pick.
+		// A socket bound to its port (any address) then receives the group's datagrams, but not those of groups only other sockets joined
+		Result joinMulticastGroup(const std::string_view group, const std::string_view networkInterface = { });
+		Result leaveMulticastGroup(const std::string_view group, const std::string_view networkInterface = { });
+		// Interface the multicast datagrams are sent from
+		Result setMulticastInterface(const std::string_view networkInterface);
+		// Number of routers the multicast datagrams may cross (hop limit), 1 by default keeps them in the local network
+		Result setMulticastTTL(u8 ttl);
+		// Whether the sending host's own members of the group receive the datagrams, enabled by default
+		Result setMulticastLoopback(bool isEnabled);
+
+		// Linux, Unix domain sockets only: passes open file descriptors (SCM_RIGHTS) along with one byte of data,
+		// the peer gets duplicates which stay valid once the sender closes its own
+		static constexpr u32 MaxPassedDescriptorCount = 64;
+		Result sendFileDescriptors(const int* descriptors, u32 count);
+		// Appends the received descriptors (close-on-exec) to 'descriptors'
+		Result receiveFileDescriptors(std::vector<int>& descriptors);
+		// Hands a socket over to the peer process, e.g. an accepted connection, close this process' copy afterwards.
+		// TLS and compression state can't be passed along
+		Result sendSocket(const Socket& socket);
+		std::optional<Socket> receiveSocket();
+
+		// Two connected Unix domain sockets (socketpair()), e.g. to pass to a child process
+		static std::optional<std::pair<Socket, Socket>> CreateUnixPair(SocketType socketType = SocketType::Stream);
+
+		// Performs the TLS handshake over this connected socket, as a client or a server depending on the role of 'context'.
+		// 'serverName' (client only) goes in the SNI extension, is checked against the server's certificate (if the context has trusted certificates)
+		// and, along with the port, identifies the server in the context's session cache so that the next connection can resume the session.
+		// From then on send() and receive() encrypt and decrypt, and close() sends close_notify. The socket is made non-blocking.
+		// 'timeout' bounds the whole handshake in milliseconds, -1 waits for as long as the peer takes.
+		Result startTls(const std::shared_ptr<TlsContext>& context, const std::string_view serverName = { }, s32 timeout = -1);
+		bool isTls() const noexcept { return m_tls != nullptr; }
+		// True if the TLS handshake resumed a cached session instead of performing a full handshake
+		bool isTlsSessionResumed() const noexcept;
+		// nullptr if startTls() hasn't succeeded
+		TlsConnection* getTlsConnection() noexcept { return m_tls.get(); }
+
+		// Compressed stream mode: from then on send() deflates and receive() inflates, with one zlib context per direction which keeps
+		// its sliding window for the lifetime of the connection. Both peers must start it at the same point of the stream (after startTls(),
+		// which then encrypts the compressed bytes). sendFile() reads the file and sends it through the compressor
+		Result startCompression(const SocketCompressionOptions& options = { });
+		bool isCompressed() const noexcept { return m_compression != nullptr; }
+		// Sends what FlushPolicy::PerBatch holds back in the compressor, does nothing otherwise
+		Result flush();
+		// All zeros if startCompression() hasn't succeeded
+		SocketCompressionStats getCompressionStats() const;
 
 		void setOnDisconnect(const OnDisconnectCallback& callback);
 		void setOnDisconnect(void (*onDisconnect)(Socket& socket, void* userData), void* userData)
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <common/defines.hpp>
+
+#include <netsocket/defines.hpp>
+#include <netsocket/result.hpp>
+#include <netsocket/netsocket.hpp>
+#include <netsocket/messagesocket.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace netsocket
+{
+	enum class RpcStatus : u8
+	{
+		Success,
+		// The handler answered with RpcChannel::Responder::fail(), the data is its error
+		Error,
+		// The peer has no handler for the method
+		UnknownMethod,
+		// Reported locally: no response within the call's timeout, or the channel stopped (or got disconnected) first
+		Timeout,
+		Disconnected
+	};
+
+	struct RpcOptions
+	{
+		MessageFramingOptions framing;
+		// Default timeout of call() in milliseconds, 0 waits forever
+		u32 defaultTimeout = 30000;
+	};
+
+	struct RpcResult
+	{
+		RpcStatus status;
+		std::vector<u8> data;
+	};
+
+	// Request/response calls multiplexed over one connected Socket: every frame carries a request ID, so any number of calls
+	// can be in flight at once and the responses can come back in any order. Both ends can call and serve.
+	// A receiving thread dispatches the requests to their handlers and the responses to their callers, a second thread expires the timeouts.
+	// The socket must not be used otherwise while the channel is running (with an AsyncSocket, don't queue transactions on it).
+	class NETSOCKET_API RpcChannel
+	{
+	public:
+		// Called on the receiving thread (or the timeout thread), 'bytes' is only valid during the call
+		using ResponseHandler = std::function<void(RpcStatus status, const u8* bytes, u32 size)>;
+
+		// Answers one request, from any thread and at any time. Copyable, the channel must outlive it
+		class NETSOCKET_API Responder
+		{
+		private:
+			RpcChannel* m_channel;
+			u32 m_method;
+			u64 m_requestId;
+
+		public:
+			Responder(RpcChannel* channel, u32 method, u64 requestId) noexcept : m_channel(channel), m_method(method), m_requestId(requestId) { }
+
+			u64 getRequestId() const noexcept { return m_requestId; }
+			Result respond(const u8* bytes, u32 size) const;
+			Result fail(const u8* bytes, u32 size) const;
+		};
+
+		// Called on the receiving thread, which doesn't receive anything else meanwhile: long running handlers should hand the
+		// Responder over to another thread. A handler must not wait for a call on the same channel.
+		using RequestHandler = std::function<void(const u8* bytes, u32 size, Responder responder)>;
+
+		enum class FrameKind : u8
+		{
+			Request,
+			Response
+		};
+		// kind (u8), status (u8), method (u32), request ID (u64), little-endian, then the payload
+		static constexpr u32 FrameHeaderSize = 14;
+
+	private:
+		struct PendingCall
+		{
+			ResponseHandler handler;
+			// std::chrono::steady_clock::time_point::max() if the call doesn't time out
+			std::chrono::steady_clock::time_point deadline;
+		};
+
+		// The pending calls are spread over several maps by request ID, so that concurrent callers rarely contend
+		struct PendingShard
+		{
+			std::mutex mutex;
+			std::unordered_map<u64, PendingCall> calls;
+		};
+		static constexpr u32 ShardCount = 16;
+
+		Socket& m_socket;
+		MessageSocket m_messageSocket;
+		RpcOptions m_options;
+		std::unordered_map<u32, RequestHandler> m_requestHandlers;
+		std::array<PendingShard, ShardCount> m_pendingShards;
+		std::atomic<u64> m_nextRequestId;
+		std::atomic<u32> m_pendingCount;
+		// Frames are sent from the callers' and the responders' threads
+		std::mutex m_sendMutex;
+		// Deadlines of the pending calls, earliest first
+		std::set<std::pair<std::chrono::steady_clock::time_point, u64>> m_deadlines;
+		std::mutex m_deadlineMutex;
+		std::condition_variable m_deadlineCV;
+		std::unique_ptr<std::thread> m_receiveThread;
+		std::unique_ptr<std::thread> m_timeoutThread;
+		std::atomic<bool> m_isRunning;
+		std::atomic<bool> m_isStopping;
+		// Set (under m_deadlineMutex) once the receiving thread has left its loop
+		bool m_isReceiveThreadDone;
+
+		PendingShard& getShard(u64 requestId) noexcept { return m_pendingShards[requestId % ShardCount]; }
+		// Removes the call from the pending calls, an empty optional if it has completed already
+		std::optional<PendingCall> takePendingCall(u64 requestId);
+		Result sendFrame(FrameKind kind, RpcStatus status, u32 method, u64 requestId, const u8* bytes, u32 size);
+		void dispatchFrame(const std::vector<u8>& frame);
+		void receiveThreadHandler();
+		void timeoutThreadHandler();
+		void failPendingCalls(RpcStatus status);
+
+	public:
+		// 'socket' must be connected and outlive the channel
+		RpcChannel(Socket& socket, const RpcOptions& options = { });
+		RpcChannel(RpcChannel&) = delete;
+		RpcChannel(RpcChannel&&) = delete;
+		// Stops the channel
+		~RpcChannel();
+
+		// Handler of 'method' when the peer calls it, set them before start()
+		void setRequestHandler(u32 method, const RequestHandler& handler);
+		// Starts the receiving and timeout threads
+		Result start();
+		// Stops the threads (within ~100 ms) and completes the pending calls with RpcStatus::Disconnected. The socket stays open,
+		// unless the peer has stalled in the middle of a frame: its receiving side is then shut down to stop waiting (see Socket::shutdownReceive()).
+		// From a handler (which runs on one of the channel's threads) it only stops the channel, the threads are joined by the next stop()
+		// on another thread, at the latest by the destructor
+		void stop();
+		// False once stopped or disconnected
+		bool isRunning() const noexcept { return m_isRunning; }
+
+		// Sends the request and returns without waiting, 'handler' gets the response, or a local status (exactly once).
+		// 'timeout' in milliseconds, 0 waits forever, empty uses RpcOptions::defaultTimeout
+		Result call(u32 method, const u8* bytes, u32 size, const ResponseHandler& handler, std::optional<u32> timeout = { });
+		// Same, but waits for the response
+		RpcResult callAndWait(u32 method, const u8* bytes, u32 size, std::optional<u32> timeout = { });
+
+		u32 getPendingCallCount() const noexcept { return m_pendingCount; }
+	};
+}
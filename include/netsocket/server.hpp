@@ -0,0 +1,233 @@
+#pragma once
+
+#include <netsocket/defines.hpp> // for NETSOCKET_API
+#include <netsocket/result.hpp> // for netsocket::Result
+#include <netsocket/netsocket.hpp> // for netsocket::Socket
+#include <netsocket/acceptor.hpp> // for netsocket::Acceptor
+#include <netsocket/timerwheel.hpp> // for netsocket::TimerWheel
+
+#include <common/defines.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace netsocket
+{
+	class ServerShard;
+	class ServerConnection;
+
+	// Return type of the connection handler coroutines, see Server::start()
+	class NETSOCKET_API ServerTask
+	{
+	public:
+		struct promise_type
+		{
+			ServerTask get_return_object() noexcept { return ServerTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+			// The shard starts the handler once the connection is registered, and destroys it once it has returned
+			std::suspend_always initial_suspend() noexcept { return { }; }
+			std::suspend_always final_suspend() noexcept { return { }; }
+			void return_void() noexcept { }
+			void unhandled_exception() noexcept { std::terminate(); }
+		};
+
+	private:
+		std::coroutine_handle<promise_type> m_handle;
+
+	public:
+		ServerTask(std::coroutine_handle<promise_type> handle) noexcept : m_handle(handle) { }
+		ServerTask(ServerTask&& task) noexcept : m_handle(task.m_handle) { task.m_handle = { }; }
+		ServerTask& operator=(ServerTask&& task) noexcept;
+		ServerTask(ServerTask&) = delete;
+		~ServerTask();
+
+		std::coroutine_handle<promise_type> getHandle() const noexcept { return m_handle; }
+	};
+
+	// A connection served by one shard of a Server, for its whole lifetime: every handler call and resumption happens on the shard's thread
+	class NETSOCKET_API ServerConnection
+	{
+		friend class ServerShard;
+
+	public:
+		// What a handler waits for
+		class NETSOCKET_API Awaiter
+		{
+			friend class ServerConnection;
+
+		protected:
+			ServerConnection& m_connection;
+			// True if the connection failed, was closed, timed out or the server cancelled the wait
+			bool m_isFailed;
+
+			// Makes progress without blocking, true once done (or failed)
+			virtual bool progress() = 0;
+
+		public:
+			Awaiter(ServerConnection& connection) noexcept : m_connection(connection), m_isFailed(false) { }
+			virtual ~Awaiter() = default;
+
+			bool await_ready() { return progress(); }
+			void await_suspend(std::coroutine_handle<> handle) noexcept;
+		};
+
+		// co_await: true once the connection is readable, false if it is closed, timed out or the server is stopping
+		class NETSOCKET_API ReadableAwaiter : public Awaiter
+		{
+		protected:
+			bool progress() override;
+
+		public:
+			using Awaiter::Awaiter;
+			bool await_resume() const noexcept { return !m_isFailed; }
+		};
+
+		// co_await: the number of bytes received (all of them with receive(), at least one with receiveSome()),
+		// an empty optional if the connection is closed, timed out or the server is stopping
+		class NETSOCKET_API ReceiveAwaiter : public Awaiter
+		{
+		private:
+			u8* m_bytes;
+			u32 m_size;
+			u32 m_receivedSize;
+			bool m_isExact;
+
+		protected:
+			bool progress() override;
+
+		public:
+			ReceiveAwaiter(ServerConnection& connection, u8* bytes, u32 size, bool isExact) noexcept;
+			std::optional<u32> await_resume() const noexcept;
+		};
+
+	private:
+		Socket m_socket;
+		u32 m_shardIndex;
+		// The shard's
+		TimerWheel& m_timerWheel;
+		// The handler's pending wait, if any
+		Awaiter* m_awaiter;
+		std::coroutine_handle<> m_waitingHandle;
+		// Milliseconds, 0 if disabled
+		u32 m_idleTimeout;
+		u32 m_readTimeout;
+		TimerWheel::TimerId m_idleTimer;
+		TimerWheel::TimerId m_readTimer;
+		// When data was last received or sent: activity doesn't touch the idle timer, which checks it once it expires
+		std::chrono::steady_clock::time_point m_lastActivityTime;
+		// Set by the shard when poll() reported an event (which can be a hang up, not only data)
+		bool m_isPollReady;
+		bool m_isCancelled;
+		bool m_isTimedOut;
+
+		// Consumes the readiness reported by poll() or checks for it without blocking
+		bool takeReadable();
+		void touch() noexcept { m_lastActivityTime = std::chrono::steady_clock::now(); }
+		bool isFailed() const noexcept { return m_isCancelled || m_isTimedOut || !m_socket.isConnected(); }
+		// Resumes the handler if its pending wait is done
+		void resumeIfDone();
+		void armIdleTimer(u32 delay);
+		void onIdleTimer();
+		void timeOut();
+
+	public:
+		ServerConnection(Socket socket, u32 shardIndex, TimerWheel& timerWheel) noexcept;
+		ServerConnection(ServerConnection&) = delete;
+		ServerConnection(ServerConnection&&) = delete;
+		~ServerConnection();
+
+		Socket& getSocket() noexcept { return m_socket; }
+		u32 getShardIndex() const noexcept { return m_shardIndex; }
+		// The server is stopping and its grace period is over, pending and further waits fail
+		bool isCancelled() const noexcept { return m_isCancelled; }
+		// The idle or read timeout elapsed, pending and further waits fail: the handler should close the connection
+		bool isTimedOut() const noexcept { return m_isTimedOut; }
+
+		// Times the connection out once nothing has been received or sent for 'timeout' milliseconds, 0 disables it.
+		// Activity only costs a clock read: the timer is re-armed when it expires after some, instead of on every message
+		void setIdleTimeout(u32 timeout);
+		// Times the connection out if a wait (readable(), receive(), receiveSome()) isn't done within 'timeout' milliseconds, 0 disables it
+		void setReadTimeout(u32 timeout) noexcept { m_readTimeout = timeout; }
+		// Fails (and disconnects) a send() which can't hand its data over to the system within 'timeout' milliseconds, 0 disables it.
+		// See Socket::setSendTimeout()
+		Result setWriteTimeout(u32 timeout);
+		// The shard's timers, e.g. for application level keepalives. Callbacks run on the shard's thread
+		TimerWheel& getTimerWheel() noexcept { return m_timerWheel; }
+
+		ReadableAwaiter readable() noexcept { return ReadableAwaiter(*this); }
+		ReceiveAwaiter receive(u8* bytes, u32 size) noexcept { return ReceiveAwaiter(*this, bytes, size, true); }
+		ReceiveAwaiter receiveSome(u8* bytes, u32 size) noexcept { return ReceiveAwaiter(*this, bytes, size, false); }
+		// Sending doesn't suspend, it only waits (holding up the shard) if the socket's send buffer is full
+		Result send(const u8* bytes, u32 size) { touch(); return m_socket.send(bytes, size); }
+		Result close() { return m_socket.close(); }
+	};
+
+	struct ServerOptions
+	{
+		// Shards, each one an event loop on its own thread. 0 is one per core
+		u32 shardCount = 0;
+		// Pins the thread of shard i to core i (modulo the number of cores), so that a connection stays on one core
+		bool isPinnedToCores = true;
+		// Linux: every shard listens on its own SO_REUSEPORT socket and the kernel spreads the connections.
+		// Otherwise an acceptor thread deals the connections out to the shards in turn
+		bool isReusePortEnabled = false;
+		IPAddressFamily ipAddressFamily = IPAddressFamily::IPv4;
+		// Maximum number of connections accepted per wakeup, see Socket::acceptMany()
+		u32 batchSize = Acceptor::DefaultBatchSize;
+		// Applied to the listening sockets and again to every accepted socket, e.g. SocketOptions::LowLatency()
+		SocketOptions socketOptions;
+		// Resolution of the shards' timers (connection timeouts), in milliseconds
+		u32 timerTickDuration = TimerWheel::DefaultTickDuration;
+	};
+
+	// Thread-per-core server: a fixed set of shards, each running an event loop (poll()) on its own thread, optionally pinned to a core.
+	// Every accepted connection is given to one shard and stays there, so its state stays in that core's cache and needs no locking.
+	// Handlers must not block: they wait through the ServerConnection awaiters (coroutines) or get called when there is data (callbacks)
+	class NETSOCKET_API Server
+	{
+	public:
+		// Coroutine serving one connection from accept to close, the connection is closed once it returns
+		using ConnectionHandler = std::function<ServerTask(ServerConnection& connection)>;
+		// Called whenever the connection is readable, it receives what is available (receiveSome() doesn't block then).
+		// The connection is dropped once the callback closes it or the peer disconnects
+		using OnReadableCallback = std::function<void(ServerConnection& connection)>;
+
+	private:
+		ServerOptions m_options;
+		Socket m_listeningSocket;
+		std::unique_ptr<Acceptor> m_acceptor;
+		std::vector<std::unique_ptr<ServerShard>> m_shards;
+		std::atomic<u32> m_nextShardIndex;
+		ConnectionHandler m_connectionHandler;
+		OnReadableCallback m_onReadableCallback;
+		bool m_isRunning;
+
+		void dispatch(Socket socket);
+
+	public:
+		Server(const ServerOptions& options = { });
+		Server(Server&) = delete;
+		Server(Server&&) = delete;
+		// Stops without grace period
+		~Server();
+
+		// Creates the shards, binds and listens
+		Result listen(const std::string_view ipAddress, const std::string_view portNumber);
+		// Starts the shards (and the acceptor), 'handler' is started on the shard's thread for every accepted connection
+		Result start(const ConnectionHandler& handler);
+		Result startCallbacks(const OnReadableCallback& callback);
+		// Stops accepting, lets the connections finish on their own for up to 'gracePeriod' milliseconds, then cancels the waits
+		// of those left (they see a closed connection), destroys them and joins the shards
+		void stop(u32 gracePeriod = 5000);
+		bool isRunning() const noexcept { return m_isRunning; }
+
+		u32 getShardCount() const noexcept { return static_cast<u32>(m_shards.size()); }
+		// Connections being served, over all shards
+		u32 getConnectionCount() const;
+	};
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <common/defines.hpp>
+
+#include <netsocket/defines.hpp>
+#include <netsocket/result.hpp>
+#include <netsocket/netsocket.hpp> // for netsocket::Socket
+
+#include <optional>
+#include <limits>
+#include <utility>
+#include <atomic>
+
+namespace netsocket
+{
+	struct SharedMemorySocketOptions
+	{
+		// Bytes of the ring of each direction, rounded up to a power of two. Larger sends go through in several pieces
+		u32 capacity = 1024 * 1024;
+		// Times an empty (receive) or full (send) ring is checked again before the thread sleeps on a futex.
+		// 0 sleeps right away, NeverSleep busy-waits (lowest latency, but a core stays busy while waiting). Ignored on a single core host
+		u32 spinCount = 4000;
+		static constexpr u32 NeverSleep = std::numeric_limits<u32>::max();
+	};
+
+	struct SharedMemorySegment;
+	struct SharedMemoryRing;
+
+	// Byte stream between two processes (or threads) of the same host through shared memory: a single-producer single-consumer ring
+	// per direction in a memfd segment, with futex wakeups. Sending and receiving copy the data once and make no system call
+	// unless the other side is asleep. Same send()/receive() surface as Socket, so that code written against one can use the other.
+	// One thread may send while another one receives, but not two sends or two receives at once. Linux only.
+	// close() may run while the other threads are in a call, but the object must outlive their calls.
+	class NETSOCKET_API SharedMemorySocket
+	{
+	private:
+		int m_descriptor;
+		void* m_mapping;
+		u64 m_mappingSize;
+		SharedMemorySegment* m_segment;
+		SharedMemoryRing* m_sendRing;
+		SharedMemoryRing* m_receiveRing;
+		u8* m_sendData;
+		u8* m_receiveData;
+		u32 m_capacity;
+		u32 m_spinCount;
+		// Calls in flight on each side, close() waits for them to return before unmapping the segment.
+		// On separate cache lines so that the sending and the receiving threads don't contend for one
+		alignas(64) mutable std::atomic<u32> m_sendCallCount;
+		alignas(64) mutable std::atomic<u32> m_receiveCallCount;
+		std::atomic<bool> m_isClosing;
+
+		// Maps the segment (and initializes it if 'isCreator'), which also picks the ring this side sends on
+		bool map(int descriptor, bool isCreator, u32 spinCount);
+		// Waits until the receive ring holds data or the peer has closed, false if 'timeout' (milliseconds, -1 forever) elapsed
+		bool waitForData(s32 timeout);
+		// Waits until the send ring has room, false if the peer has closed
+		bool waitForSpace();
+
+	public:
+		// Invalid, see Create() and Open()
+		SharedMemorySocket();
+		SharedMemorySocket(SharedMemorySocket&& socket);
+		SharedMemorySocket& operator=(SharedMemorySocket&& socket);
+		SharedMemorySocket(SharedMemorySocket&) = delete;
+		~SharedMemorySocket();
+
+		// Creates the segment, hand getDescriptor() to the peer process which then calls Open()
+		static std::optional<SharedMemorySocket> Create(const SharedMemorySocketOptions& options = { });
+		// Maps a segment created by Create() in another process, takes ownership of 'descriptor'. Only 'spinCount' is taken from 'options'
+		static std::optional<SharedMemorySocket> Open(int descriptor, const SharedMemorySocketOptions& options = { });
+		// Both ends, e.g. for two threads
+		static std::optional<std::pair<SharedMemorySocket, SharedMemorySocket>> CreatePair(const SharedMemorySocketOptions& options = { });
+		// Over a connected Unix domain socket (see Socket::connectUnix()): Connect() creates the segment and passes it to the peer,
+		// which calls Accept(). The Unix socket is no longer needed afterwards
+		static std::optional<SharedMemorySocket> Connect(Socket& unixSocket, const SharedMemorySocketOptions& options = { });
+		static std::optional<SharedMemorySocket> Accept(Socket& unixSocket, const SharedMemorySocketOptions& options = { });
+
+		bool isValid() const noexcept { return m_mapping != nullptr; }
+		// False once either side has closed (what the peer sent before closing can still be received)
+		bool isConnected() const noexcept;
+		int getDescriptor() const noexcept { return m_descriptor; }
+		// Bytes of the ring of each direction
+		u32 getCapacity() const noexcept;
+
+		// Tells the peer (its pending and next receives fail once the ring is empty, its sends fail) and unmaps the segment.
+		// The calls other threads have in flight on this socket fail, and the segment is unmapped once they have returned
+		Result close();
+
+		// Blocks until all the bytes are in the ring, Result::SocketError if the connection is closed
+		Result send(const u8* bytes, u32 size);
+		Result receive(u8* bytes, u32 size);
+		// Receives whatever is available, at least 1 byte and at most 'size' bytes (blocks if nothing is available yet)
+		// Returns the number of bytes received, or an empty optional if the connection is closed and nothing is left
+		std::optional<u32> receiveSome(u8* bytes, u32 size);
+		// Waits until there is something to receive, timeout is in milliseconds, -1 waits forever
+		// Returns false if the timeout elapsed or the connection is closed and nothing is left
+		bool waitReadable(s32 timeout = -1);
+
+		template<typename T>
+		bool sendNonEnum(const T& value)
+		{
+			return send(reinterpret_cast<const u8*>(&value), sizeof(value)) == Result::Success;
+		}
+
+		template<typename EnumClassType>
+		bool sendEnum(const EnumClassType& value)
+		{
+			auto intValue = com::EnumClassToInt<EnumClassType>(value);
+			return send<decltype(intValue)>(intValue);
+		}
+
+		template<typename T>
+		bool send(const T& value)
+		{
+			if constexpr (std::is_enum<T>::value)
+				return sendEnum<T>(value);
+			else
+				return sendNonEnum<T>(value);
+		}
+
+		template<typename T>
+		std::optional<T> receiveNonEnum()
+		{
+			T value;
+			auto result = receive(reinterpret_cast<u8*>(&value), sizeof(value));
+			if(result == Result::Success)
+				return { value };
+			else
+				return { };
+		}
+
+		template<typename EnumClassType>
+		std::optional<EnumClassType> receiveEnum()
+		{
+			using IntType = typename std::underlying_type<EnumClassType>::type;
+			auto intValue = receive<IntType>();
+			if(intValue)
+				return { com::IntToEnumClass<EnumClassType>(*intValue) };
+			else
+				return { };
+		}
+
+		template<typename T>
+		std::optional<T> receive()
+		{
+			if constexpr (std::is_enum<T>::value)
+				return receiveEnum<T>();
+			else
+				return receiveNonEnum<T>();
+		}
+	};
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <netsocket/defines.hpp> // for NETSOCKET_API
+
+#include <common/defines.hpp>
+
+#include <array>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace netsocket
+{
+	// Hierarchical timer wheel (4 levels of 256 slots, as in the Linux kernel's classic timers): scheduling, cancelling and rescheduling
+	// a timer are O(1) whatever the number of armed timers, and advancing costs O(1) per tick plus the timers which expire (or move down
+	// a level, once per level at most). Timers fire with the resolution of a tick, never early.
+	// Not thread safe: it belongs to the thread which advances it (e.g. a Server shard), callbacks run there, from advance()
+	class NETSOCKET_API TimerWheel
+	{
+	public:
+		// Generation in the upper 32 bits, so that the identifier of a timer which has fired or been cancelled stays invalid
+		using TimerId = u64;
+		using Callback = std::function<void()>;
+
+		static constexpr TimerId InvalidTimerId = 0;
+		static constexpr u32 DefaultTickDuration = 10;
+
+	private:
+		static constexpr u32 SlotBits = 8;
+		static constexpr u32 SlotCount = 1u << SlotBits;
+		static constexpr u32 LevelCount = 4;
+		static constexpr u32 InvalidIndex = U32_MAX;
+		// Timers being fired by advance() live in this extra slot, so that a callback can still cancel them
+		static constexpr u32 FiringSlot = SlotCount * LevelCount;
+
+		struct Timer
+		{
+			Callback callback;
+			// In ticks
+			u64 expiry;
+			u32 interval;
+			u32 generation;
+			// Intrusive list of the slot
+			u32 previous;
+			u32 next;
+			// InvalidIndex if the timer isn't armed
+			u32 slot;
+		};
+
+		// Stable addresses, callbacks can schedule timers while another one is being fired
+		std::deque<Timer> m_timers;
+		std::vector<u32> m_freeTimers;
+		std::array<u32, SlotCount * LevelCount + 1> m_slots;
+		// Non-empty slots of the first level, finds the next expiry without scanning
+		std::array<u64, SlotCount / 64> m_occupiedSlots;
+		std::chrono::steady_clock::time_point m_startTime;
+		u64 m_currentTick;
+		u32 m_tickDuration;
+		u32 m_timerCount;
+
+		u32 allocate();
+		void release(u32 index);
+		void link(u32 index, u32 slot);
+		void unlink(u32 index);
+		// Puts an armed timer in the slot of its expiry
+		void insert(u32 index);
+		// Moves the timers of a slot of an upper level down to where they now belong
+		void cascade(u32 level);
+		u32 fire();
+		u32 getTimerIndex(TimerId id) const noexcept;
+		TimerId schedule(u32 delay, u32 interval, Callback&& callback);
+
+	public:
+		// 'tickDuration' is the resolution in milliseconds: the longest delay is 2^32 ticks
+		TimerWheel(u32 tickDuration = DefaultTickDuration);
+		TimerWheel(TimerWheel&) = delete;
+		TimerWheel(TimerWheel&&) = delete;
+
+		// Calls 'callback' once, 'delay' milliseconds from now (rounded up to the next tick)
+		TimerId schedule(u32 delay, Callback callback);
+		// Calls 'callback' every 'interval' milliseconds until the timer is cancelled
+		TimerId scheduleRepeating(u32 interval, Callback callback);
+		// Returns false if the timer has already fired (one-shot) or been cancelled. A callback may cancel any timer, its own too
+		bool cancel(TimerId id);
+		// Moves the expiry of an armed timer to 'delay' milliseconds from now, e.g. an idle timeout on activity
+		bool reschedule(TimerId id, u32 delay);
+		bool isScheduled(TimerId id) const noexcept { return getTimerIndex(id) != InvalidIndex; }
+
+		// Fires the timers which expired up to now, returns how many fired
+		u32 advance();
+		u32 advance(std::chrono::steady_clock::time_point now);
+		// Milliseconds until the next timer may expire (a poll() timeout), -1 if none is armed
+		s32 getTimeout() const;
+
+		u32 getTimerCount() const noexcept { return m_timerCount; }
+		u32 getTickDuration() const noexcept { return m_tickDuration; }
+		// Ticks advanced since construction
+		u64 getCurrentTick() const noexcept { return m_currentTick; }
+	};
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <common/defines.hpp>
+
+#include <netsocket/defines.hpp>
+#include <netsocket/result.hpp>
+#include <netsocket/netsocket.hpp> // for netsocket::SocketHandle
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+struct mbedtls_ssl_context;
+struct mbedtls_ssl_session;
+
+namespace netsocket
+{
+	enum class TlsRole
+	{
+		Client,
+		Server
+	};
+
+	struct TlsSessionCacheOptions
+	{
+		// Server: number of sessions kept for session ID resumption, client: number of servers whose last session is remembered.
+		// 0 disables the cache
+		u32 maxEntries = 1000;
+		// How long a session can be resumed for (also the lifetime of the session tickets), in seconds
+		u32 timeout = 86400;
+		// Server: issues session tickets (RFC 5077), which resume without any state kept on the server. Client: accepts them
+		bool isTicketsEnabled = true;
+
+		// Every connection performs a full handshake
+		static TlsSessionCacheOptions Disabled() noexcept { return { 0, 0, false }; }
+	};
+
+	struct TlsContextState;
+	struct TlsKeyMaterial;
+	class TlsConnection;
+
+	// Configuration shared by the TLS connections of a client or a server: credentials, random number generator and session cache.
+	// Set it up before the first connection, it can then be shared by sockets on any number of threads.
+	class NETSOCKET_API TlsContext
+	{
+		friend class TlsConnection;
+
+	private:
+		std::unique_ptr<TlsContextState> m_state;
+		TlsRole m_role;
+		TlsSessionCacheOptions m_cacheOptions;
+		bool m_isKernelOffloadEnabled;
+		bool m_isInsecureSkipVerify;
+		bool m_isValid;
+
+		// Client session cache, keyed by server name and port
+		std::shared_ptr<mbedtls_ssl_session> findSession(const std::string& key);
+		void rememberSession(const std::string& key, std::shared_ptr<mbedtls_ssl_session> session);
+		void forgetSession(const std::string& key);
+		// Client: loads the system's CA bundle before the first connection, unless trusted certificates have been set
+		void loadDefaultTrustedCertificates();
+
+	public:
+		TlsContext(TlsRole role, const TlsSessionCacheOptions& cacheOptions = { });
+		TlsContext(TlsContext&) = delete;
+		TlsContext(TlsContext&&) = delete;
+		~TlsContext();
+
+		bool isValid() const noexcept { return m_isValid; }
+		TlsRole getRole() const noexcept { return m_role; }
+		const TlsSessionCacheOptions& getSessionCacheOptions() const noexcept { return m_cacheOptions; }
+
+		// Certificate chain (leaf first) and its private key, PEM or DER. Required for a server, a client only needs one if the server asks for it
+		Result setCertificate(std::string_view certificateChain, std::string_view privateKey, std::string_view privateKeyPassword = { });
+		Result loadCertificate(const std::string& certificateChainPath, const std::string& privateKeyPath, const std::string& privateKeyPassword = { });
+		// Certificates the peer's certificate must chain up to. A client always verifies the server's certificate (and the server name
+		// passed to Socket::startTls()), against the system's CA bundle until these are set: the file named by SSL_CERT_FILE, or the usual locations.
+		// A server requires a client certificate once these are set, without any it doesn't authenticate the clients.
+		Result setTrustedCertificates(std::string_view certificates);
+		Result loadTrustedCertificates(const std::string& path);
+		// Cipher suites to offer (client) or accept (server), in order of preference: mbedtls names separated by ':', ',' or spaces,
+		// e.g. "TLS-ECDHE-ECDSA-WITH-AES-128-GCM-SHA256:TLS-ECDHE-ECDSA-WITH-CHACHA20-POLY1305-SHA256". Fails if a name is unknown
+		Result setCipherSuites(std::string_view names);
+
+		// Drops the cached sessions, the following connections perform a full handshake
+		void clearSessionCache();
+
+		// Linux only: once the handshake is done, hands the record keys over to the kernel (kTLS), which then encrypts and decrypts
+		// the records itself, so that sending doesn't copy through the record layer and Socket::sendFile() can use sendfile().
+		// Only TLS 1.2 with AES-GCM or ChaCha20-Poly1305 can be offloaded, other connections (or all of them if the kernel has no tls module)
+		// keep the user-space record layer, which is why enabling it also caps the context at TLS 1.2 (mbedtls 3 negotiates TLS 1.3 otherwise).
+		// Set it before the first connection.
+		Result setKernelOffload(bool isEnabled);
+		bool isKernelOffloadEnabled() const noexcept { return m_isKernelOffloadEnabled; }
+
+		// Client only: connects without verifying the server's certificate, anyone on the path can then impersonate the server.
+		// Meant for tests, set it before the first connection.
+		void setInsecureSkipVerify(bool isSkipped);
+		bool isInsecureSkipVerify() const noexcept { return m_isInsecureSkipVerify; }
+	};
+
+	// TLS over a connected socket, owned by netsocket::Socket once startTls() has succeeded.
+	// The I/O callbacks never block: they report would-block as WantRead/WantWrite and the Socket waits for the socket,
+	// so one thread can receive while another one sends (calls into mbedtls are serialized by m_mutex).
+	class NETSOCKET_API TlsConnection
+	{
+	public:
+		// Returned by handshake(), send() and receive() when they have to wait for the socket.
+		// Note that receiving can require writing and the other way around
+		static constexpr int WantRead = -2;
+		static constexpr int WantWrite = -3;
+
+	private:
+		std::shared_ptr<TlsContext> m_context;
+		std::unique_ptr<mbedtls_ssl_context> m_ssl;
+		// Handed to the I/O callbacks, the address stays the same when the owning Socket is moved
+		SocketHandle m_socket;
+		std::mutex m_mutex;
+		// Client: key of this server in the session cache (server name and port), empty if the cache is disabled
+		std::string m_sessionKey;
+		// Client: the cached session offered to the server
+		std::shared_ptr<mbedtls_ssl_session> m_offeredSession;
+		// Secrets captured during the handshake for the kernel offload, wiped once it is done
+		std::unique_ptr<TlsKeyMaterial> m_keyMaterial;
+		bool m_isHandshakeDone;
+		bool m_isSessionResumed;
+		// The kernel encrypts what is sent and/or decrypts what is received, mbedtls no longer sees those records
+		bool m_isKernelTx;
+		bool m_isKernelRx;
+		bool m_isValid;
+
+		void enableKernelOffload();
+
+	public:
+		// 'serverName' (client only) is sent in the SNI extension and checked against the server's certificate
+		TlsConnection(const std::shared_ptr<TlsContext>& context, SocketHandle socket, std::string_view serverName);
+		TlsConnection(TlsConnection&) = delete;
+		TlsConnection(TlsConnection&&) = delete;
+		~TlsConnection();
+
+		bool isValid() const noexcept { return m_isValid; }
+		bool isHandshakeDone() const noexcept { return m_isHandshakeDone; }
+		// True if the handshake resumed a cached session (session ID or ticket) instead of performing a full handshake
+		bool isSessionResumed() const noexcept { return m_isSessionResumed; }
+		// See TlsContext::setKernelOffload(), the receive side can be offloaded without the send side (but not the other way around)
+		bool isKernelTxOffloaded() const noexcept { return m_isKernelTx; }
+		bool isKernelRxOffloaded() const noexcept { return m_isKernelRx; }
+
+		// Advances the handshake, returns 0 once it is complete, WantRead/WantWrite or -1 if it failed
+		int handshake();
+		// Same contract as ::send() and ::recv(): number of bytes transferred, 0 if the peer closed the connection (receive only),
+		// -1 on error, except that would-block is reported as WantRead/WantWrite
+		int send(const u8* bytes, u32 size);
+		int receive(u8* bytes, u32 size);
+		// Decrypted bytes waiting in the record layer, poll() on the socket doesn't see them
+		u32 getPendingSize();
+		// Sends the close_notify alert, doesn't wait if the socket isn't writable
+		void closeNotify();
+
+		// e.g. "TLSv1.2"
+		std::string_view getVersion() const;
+		// e.g. "TLS-ECDHE-ECDSA-WITH-AES-256-GCM-SHA384"
+		std::string_view getCipherSuite() const;
+	};
+}
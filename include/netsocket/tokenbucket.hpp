@@ -0,0 +1,57 @@
+#pragma once
+
+#include <netsocket/defines.hpp> // for NETSOCKET_API
+
+#include <common/defines.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+namespace netsocket
+{
+	// See Socket::setSendRateLimit()
+	struct RateLimit
+	{
+		// Bytes per second, 0 is unlimited
+		u64 rate = 0;
+		// Bytes which can go out back to back after a pause, and the largest piece a stream send is cut into.
+		// 0 is 10 ms worth of 'rate' (at least 1500 bytes, a packet)
+		u64 burstSize = 0;
+	};
+
+	// Token bucket: tokens (bytes) accumulate at RateLimit::rate up to RateLimit::burstSize, sending takes them and waits for them
+	// when there aren't enough. Thread safe: the limit can be changed while a sender waits, which then waits according to the new one
+	class NETSOCKET_API TokenBucket
+	{
+	private:
+		std::mutex m_mutex;
+		// Notified when the limit changes
+		std::condition_variable m_limitCV;
+		u64 m_rate;
+		u64 m_burstSize;
+		// Negative after a datagram larger than the burst size, which leaves a debt
+		double m_tokens;
+		std::chrono::steady_clock::time_point m_refillTime;
+
+		void refill(std::chrono::steady_clock::time_point now) noexcept;
+		// Waits until the bucket holds 'size' tokens (or is full, if it can't hold that many) or the limit is lifted, false if it is unlimited
+		bool waitFor(std::unique_lock<std::mutex>& lock, u64 size);
+
+	public:
+		TokenBucket(const RateLimit& limit = { });
+		TokenBucket(TokenBucket&) = delete;
+		TokenBucket(TokenBucket&&) = delete;
+
+		void setLimit(const RateLimit& limit);
+		RateLimit getLimit();
+		bool isLimited();
+
+		// Stream: waits until part of 'size' bytes can be sent, returns how many (up to the burst size)
+		u64 acquire(u64 size);
+		// Datagram: waits until 'size' bytes can be sent at once. One larger than the burst size waits for a full bucket
+		void acquireAll(u64 size);
+		// Same as acquireAll() if it wouldn't wait, false otherwise
+		bool tryAcquireAll(u64 size);
+	};
+}
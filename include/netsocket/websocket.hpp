@@ -1,10 +1,11 @@
 #pragma once
 
 #include <common/defines.h>
-#include <common/ProducerConsumerBuffer.hpp> // thread safe producer consumer buffer
 
 #include <netsocket/defines.hpp>
 #include <netsocket/result.hpp>
+#include <netsocket/websocketcommon.hpp> // for netsocket::WebSocketCompressionOptions
+#include <netsocket/acceptor.hpp> // for netsocket::TaskExecutor
 
 #include <ixwebsocket/IXWebSocketServer.h>
 
@@ -12,13 +13,22 @@
 #include <vector>
 #include <condition_variable>
 #include <memory>
+#include <deque>
 #include <functional>
+#include <chrono>
+#include <span>
 
 namespace netsocket
 {
+	class WebSocket;
+	using WebSocketBroadcastResult = BasicWebSocketBroadcastResult<WebSocket>;
+
 	class NETSOCKET_API WebSocket
 	{
 		using OnDisconnectCallback = std::function<void(WebSocket&)>;
+		using OnAcceptCallback = std::function<void(std::unique_ptr<WebSocket> socket)>;
+		using OnSendBufferHighCallback = std::function<void(WebSocket&, u64 bufferedAmount)>;
+		using OnSendBufferDrainCallback = std::function<void(WebSocket&)>;
 		template<typename T>
 		using Deleter = void (*)(T*);
 		template<typename T>
@@ -26,22 +36,48 @@ namespace netsocket
 	private:
 		UniquePtr<ix::WebSocketServer> m_serverSocket;
 		UniquePtr<ix::WebSocket> m_clientSocket;
-		std::unique_ptr<com::ProducerConsumerBuffer<std::unique_ptr<WebSocket>>> m_acceptedSockets;
+		// Accepted connections waiting for accept() or tryAccept(), they go to m_onAcceptCallback instead once it is set
+		std::mutex m_acceptMutex;
+		std::condition_variable m_acceptCV;
+		std::deque<std::unique_ptr<WebSocket>> m_acceptedSockets;
+		OnAcceptCallback m_onAcceptCallback;
+		TaskExecutor m_acceptExecutor;
+		// Connected clients accepted by a server socket, shared between the server socket and the accepted sockets
+		struct ClientRegistry;
+		std::shared_ptr<ClientRegistry> m_clientRegistry;
 		
 		std::atomic<bool> m_isConnected;
 		std::atomic<bool> m_isError;
 
 		std::mutex m_receiveMutex;
 		std::condition_variable m_receiveCV;
-		bool m_hasReceiveData;
-		std::vector<u8> m_receiveBuffer;
+		// Messages received by the ixwebsocket thread and not consumed yet, m_receiveOffset bytes of the front one
+		// have already been returned by receiveChunk()
+		std::deque<std::vector<u8>> m_receiveQueue;
+		u32 m_receiveOffset;
+		// The connection is closed once this many messages are pending, the ixwebsocket thread never waits for them to be consumed
+		u32 m_maxReceiveQueueSize;
+
+		// Chunks passed to sendChunk() until the final one, ixwebsocket can only send whole messages
+		std::vector<u8> m_sendChunkBuffer;
 
 		OnDisconnectCallback m_onDisconnectCallback;
 
+		WebSocketCompressionOptions m_compressionOptions;
+		bool m_isTls;
+
+		// Backpressure state for the outbound (send) buffer, 0 high watermark means unbounded
+		u64 m_sendHighWatermark;
+		u64 m_sendLowWatermark;
+		OnSendBufferHighCallback m_onSendBufferHighCallback;
+		OnSendBufferDrainCallback m_onSendBufferDrainCallback;
+
 		// True if this socket is a client socket and on the server machine
 		bool m_isServerOwnedClient;
 
 		static std::unique_ptr<WebSocket> CreateAcceptedSocket(ix::WebSocket& webSocket);
+		static void DeliverAcceptedSocket(std::unique_ptr<WebSocket> socket, const OnAcceptCallback& callback, const TaskExecutor& executor);
+		void onAccepted(std::unique_ptr<WebSocket> socket);
 
 		template<typename T>
 		static void DefaultDeleter(T* v) { delete v; }
@@ -58,22 +94,95 @@ namespace netsocket
 
 		void callOnDisconnect();
 
+		// Applies the send buffer watermarks for a message of 'size' bytes, blocking until the buffer drains
+		Result applyBackpressure(u32 size);
+		// Returns Result::Failed (along with the buffered amount) if a message of 'size' bytes would grow the send buffer beyond the high watermark
+		Result checkSendHighWatermark(u32 size, u64& bufferedAmount) const;
+		void callOnSendBufferHigh(u64 bufferedAmount);
+		Result sendData(const ix::IXWebSocketSendData& data);
+		void unregisterFromServer();
+		// Must be called with m_clientRegistry->mutex locked, which keeps the clients from being torn down while sending to them,
+		// 'clients' must all be registered with this server socket.
+		// The clients skipped for being above their high watermark are added to 'highClients' with their buffered amount:
+		// their OnSendBufferHigh callbacks are invoked once the mutex is released, as closing the client locks it.
+		WebSocketBroadcastResult broadcastLocked(const u8* bytes, u32 size, std::span<WebSocket* const> clients,
+													std::vector<std::pair<WebSocket*, u64>>& highClients);
+
+		// Blocks until the buffered amount drops to 'threshold' bytes or less, or the timeout elapses
+		Result waitForBufferedAmount(u64 threshold, std::chrono::milliseconds timeout);
+
 	public:
 		WebSocket();
 		~WebSocket();
 		bool isConnected() const noexcept { return m_isConnected && isValid(); }
 		bool isValid() const noexcept { return m_serverSocket || m_clientSocket; }
 		Result listen();
+		// Blocks until a client connects
 		std::unique_ptr<WebSocket> accept();
-		Result bind(const std::string_view ipAddress, const std::string_view portNumber);
-		Result connect(const std::string_view ipAddress, const std::string_view port);
+		// Returns immediately, nullptr if no client is waiting to be accepted
+		std::unique_ptr<WebSocket> tryAccept();
+		// Delivers every accepted client to 'callback' (including those already waiting), accept() and tryAccept() get nothing afterwards.
+		// Without an executor the callback runs on the ixwebsocket thread of the new connection, which also delivers its messages,
+		// so it must not block on receive(); pass an executor (e.g. a thread pool) for handlers that do.
+		void setOnAccept(const OnAcceptCallback& callback, const TaskExecutor& executor = { });
+		// NOTE: with the ixwebsocket backend only isEnabled, windowBits and isContextTakeover are negotiated,
+		// ixwebsocket compresses every message with zlib's default level
+		// NOTE: ixwebsocket loads the TLS credentials from files and has no session resumption, WebSocketTlsOptions::context and serverName are not supported.
+		// The client checks the server's certificate against the address passed to connect().
+		Result bind(const std::string_view ipAddress, const std::string_view portNumber, const WebSocketCompressionOptions& compressionOptions = { },
+					const WebSocketTlsOptions& tlsOptions = { });
+		Result connect(const std::string_view ipAddress, const std::string_view port, const WebSocketCompressionOptions& compressionOptions = { },
+					const WebSocketTlsOptions& tlsOptions = { });
 		Result close();
 
+		bool isTls() const noexcept { return m_isTls; }
+		// Always false, see connect()
+		bool isTlsSessionResumed() const noexcept { return false; }
+
+		const WebSocketCompressionOptions& getCompressionOptions() const noexcept { return m_compressionOptions; }
+
 		Result send(const u8* bytes, u32 size);
 		Result receive(u8* bytes, u32 size);
 
+		// Streaming, see netsocket::NativeWebSocket for the details.
+		// NOTE: ixwebsocket only exchanges whole messages: sendChunk() accumulates the chunks and sends the message with the final one,
+		// and receiveChunk() hands out pieces of the message once it has been fully received.
+		// Use netsocket::NativeWebSocket for memory bounded by the chunk size.
+		Result sendChunk(const u8* bytes, u32 size, bool isFinal);
+		std::optional<WebSocketChunk> receiveChunk(u8* bytes, u32 size);
+
+		// Bounds the number of received messages waiting for receive() or receiveChunk().
+		// The messages are copied out of ixwebsocket, so that its thread is never blocked by the application;
+		// if the application falls behind and the queue is full, the connection is closed (with code 1008) rather than dropping messages.
+		void setMaxReceiveQueueSize(u32 maxMessageCount);
+		u32 getMaxReceiveQueueSize() const noexcept { return m_maxReceiveQueueSize; }
+
+		// Sends the same message to every client accepted by this server socket which is still connected.
+		// The payload is shared by all the clients, it isn't copied per client.
+		// A client whose send buffer is above its high watermark is skipped (reported as Result::Failed) rather than blocking the others,
+		// its OnSendBufferHigh callback is invoked after the clients have been released, so it may close the client.
+		WebSocketBroadcastResult broadcast(const u8* bytes, u32 size);
+		// Same as above, but only to the given subset of clients accepted by this server socket,
+		// clients which aren't registered with it (anymore, e.g. closed) are reported as Result::SocketError
+		WebSocketBroadcastResult broadcast(const u8* bytes, u32 size, std::span<WebSocket* const> clients);
+		// Number of accepted clients which are registered with this server socket
+		u32 getClientCount() const;
+
 		// Flushses the internal send buffer or returns an error if the send fails or timed out
-		Result finish();
+		// Returns only after all the queued bytes have been handed over to the kernel
+		Result finish(std::chrono::milliseconds timeout = std::chrono::milliseconds::max());
+
+		// Returns the number of bytes queued in the internal send buffer which are yet to be written to the kernel
+		u64 getBufferedAmount() const;
+
+		// Bounds the internal send buffer: once a send() would grow it beyond 'highWatermark' bytes,
+		// the OnSendBufferHigh callback is invoked and send() blocks until it drains to 'lowWatermark' bytes.
+		// Passing 0 as highWatermark disables the backpressure (default)
+		void setSendBufferWatermarks(u64 highWatermark, u64 lowWatermark);
+		u64 getSendHighWatermark() const noexcept { return m_sendHighWatermark; }
+		u64 getSendLowWatermark() const noexcept { return m_sendLowWatermark; }
+		void setOnSendBufferHigh(const OnSendBufferHighCallback& callback);
+		void setOnSendBufferDrain(const OnSendBufferDrainCallback& callback);
 
 		void setOnDisconnect(const OnDisconnectCallback& callback);
 		void setOnDisconnect(void (*onDisconnect)(WebSocket& socket, void* userData), void* userData)
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <common/defines.h>
+
+#include <netsocket/defines.hpp>
+#include <netsocket/result.hpp>
+
+#include <vector>
+#include <utility>
+#include <string>
+#include <memory>
+
+// Types shared by netsocket::WebSocket (ixwebsocket backend) and netsocket::NativeWebSocket
+
+namespace netsocket
+{
+	class TlsContext;
+
+	// permessage-deflate (RFC 7692) configuration of a WebSocket connection
+	struct NETSOCKET_API WebSocketCompressionOptions
+	{
+		bool isEnabled = false;
+		// zlib compression level, 0 (fastest) to 9 (smallest), -1 selects zlib's default (6)
+		s32 level = -1;
+		// Base 2 logarithm of the LZ77 sliding window size, 8 to 15
+		u8 windowBits = 15;
+		// If false, the sliding window is reset after every message (saves memory per connection, compresses worse)
+		bool isContextTakeover = true;
+		// Messages smaller than this (in bytes) are sent uncompressed
+		u32 minMessageSize = 0;
+
+		static WebSocketCompressionOptions Disabled() { return { }; }
+		static WebSocketCompressionOptions Enabled(s32 level = -1, u32 minMessageSize = 0)
+		{
+			WebSocketCompressionOptions options;
+			options.isEnabled = true;
+			options.level = level;
+			options.minMessageSize = minMessageSize;
+			return options;
+		}
+	};
+
+	// TLS (wss://) configuration of a WebSocket connection
+	struct NETSOCKET_API WebSocketTlsOptions
+	{
+		bool isEnabled = false;
+		// PEM files: certificate chain (leaf first) and its private key, required for a server
+		std::string certificateFile;
+		std::string privateKeyFile;
+		// Certificates the peer's certificate must chain up to. A client verifies the server against the system's CA bundle if empty,
+		// a server requires a client certificate only if it is set
+		std::string caFile;
+		// Client only: connects without verifying the server's certificate, anyone on the path can then impersonate the server. Meant for tests
+		bool isInsecureSkipVerify = false;
+		// Cipher suites in order of preference separated by ':', library defaults if empty.
+		// mbedtls names for NativeWebSocket (see TlsContext::setCipherSuites()), ixwebsocket takes them in the format of the TLS library it is built with
+		std::string cipherSuites;
+		// NativeWebSocket client only: the name sent in SNI and checked against the server's certificate, the address passed to connect() if empty
+		std::string serverName;
+		// NativeWebSocket only: used instead of the files and cipher suites above. Clients sharing a context resume each other's sessions
+		// (without one, a NativeWebSocket keeps the context it creates, so that it resumes the session when it reconnects).
+		// ixwebsocket doesn't support session resumption.
+		std::shared_ptr<TlsContext> context;
+
+		static WebSocketTlsOptions Disabled() { return { }; }
+		static WebSocketTlsOptions Enabled(std::shared_ptr<TlsContext> context)
+		{
+			WebSocketTlsOptions options;
+			options.isEnabled = true;
+			options.context = std::move(context);
+			return options;
+		}
+	};
+
+	// A piece of an incoming message, as returned by receiveChunk()
+	struct WebSocketChunk
+	{
+		// Number of bytes written into the caller's buffer, may be 0 for the last chunk
+		u32 size = 0;
+		// True if this chunk ends the message, the next receiveChunk() starts a new message
+		bool isFinal = false;
+	};
+
+	// Outcome of a broadcast() call over a WebSocket server
+	template<typename WebSocketType>
+	struct BasicWebSocketBroadcastResult
+	{
+		// Number of clients the message has been queued to
+		u32 deliveredCount = 0;
+		// Clients the message couldn't be delivered to, along with the reason
+		std::vector<std::pair<WebSocketType*, Result>> failures;
+
+		bool isSuccess() const noexcept { return failures.empty(); }
+	};
+}
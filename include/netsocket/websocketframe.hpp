@@ -0,0 +1,70 @@
+#pragma once
+
+#include <common/defines.h>
+
+#include <netsocket/defines.hpp>
+
+#include <optional>
+
+// RFC 6455 frame layout helpers, used by netsocket::NativeWebSocket
+
+namespace netsocket
+{
+	enum class WebSocketOpcode : u8
+	{
+		Continuation = 0x0,
+		Text = 0x1,
+		Binary = 0x2,
+		Close = 0x8,
+		Ping = 0x9,
+		Pong = 0xA
+	};
+
+	static constexpr bool IsWebSocketControlOpcode(WebSocketOpcode opcode) noexcept { return (static_cast<u8>(opcode) & 0x8) != 0; }
+
+	// Status codes carried in the payload of a Close frame
+	enum class WebSocketCloseCode : u16
+	{
+		Normal = 1000,
+		GoingAway = 1001,
+		ProtocolError = 1002,
+		UnsupportedData = 1003,
+		InvalidPayload = 1007,
+		MessageTooBig = 1009
+	};
+
+	struct NETSOCKET_API WebSocketFrameHeader
+	{
+		// Largest possible encoded header: 2 bytes + 8 bytes extended payload length + 4 bytes masking key
+		static constexpr u32 MaxSize = 14;
+		// Control frames can't carry more than this
+		static constexpr u32 MaxControlPayloadSize = 125;
+
+		bool isFinal = true;
+		// RSV1 bit, set on the first frame of a permessage-deflate compressed message
+		bool isCompressed = false;
+		WebSocketOpcode opcode = WebSocketOpcode::Binary;
+		bool isMasked = false;
+		// Masking key, the 4 bytes in the order they appear on the wire (loaded with std::memcpy)
+		u32 maskKey = 0;
+		u64 payloadLength = 0;
+
+		// Returns the size of the encoded header given its second byte (mask bit and the 7-bit payload length)
+		static constexpr u32 GetEncodedSize(u8 secondByte) noexcept
+		{
+			const u8 length7 = secondByte & 0x7F;
+			return 2 + ((length7 == 126) ? 2 : ((length7 == 127) ? 8 : 0)) + (((secondByte & 0x80) != 0) ? 4 : 0);
+		}
+
+		// Writes the header into 'bytes' (must have room for MaxSize bytes), returns the number of bytes written
+		u32 encode(u8* bytes) const noexcept;
+		// Returns the number of bytes the header occupies, 0 if 'size' bytes are not enough to decode it yet,
+		// or an empty optional if the header is malformed
+		std::optional<u32> decode(const u8* bytes, u32 size) noexcept;
+	};
+
+	// XORs 'size' bytes of 'source' with the masking key and writes them into 'destination' (which may be the same as 'source').
+	// 'offset' is the position of source[0] within the frame payload, so a payload can be (un)masked in pieces.
+	// Uses AVX2 (selected at runtime), SSE2 or NEON when available.
+	NETSOCKET_API void MaskWebSocketPayload(u8* destination, const u8* source, u64 size, u32 maskKey, u64 offset = 0) noexcept;
+}
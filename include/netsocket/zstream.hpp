@@ -0,0 +1,85 @@
+#pragma once
+
+#include <common/defines.h>
+
+#include <netsocket/defines.hpp>
+
+#include <vector>
+#include <memory>
+#include <limits>
+#include <optional>
+#include <utility>
+
+struct z_stream_s;
+
+namespace netsocket
+{
+	// RAII wrapper over a zlib deflate context which keeps its state (sliding window) across calls
+	class NETSOCKET_API DeflateStream
+	{
+	public:
+		enum class Flush
+		{
+			// Let zlib buffer the input, output is produced as it fills up its internal buffers
+			None,
+			// Flush all pending output on a byte boundary, ends with the 00 00 FF FF marker
+			Sync,
+			// Same as Sync, but also resets the dictionary so that decompression can restart from here
+			Full,
+			// Completes the stream (only useful for one-shot compression)
+			Finish
+		};
+
+	private:
+		std::unique_ptr<z_stream_s> m_stream;
+		std::vector<u8> m_dictionary;
+		bool m_isValid;
+
+	public:
+		// 'level' is zlib's compression level (-1 to 9), 'windowBits' is 9 to 15,
+		// 'isRaw' omits the zlib header and trailer (as required by permessage-deflate)
+		DeflateStream(s32 level, s32 windowBits, bool isRaw, s32 memLevel = 8);
+		DeflateStream(DeflateStream&& stream);
+		DeflateStream& operator=(DeflateStream&& stream) = delete;
+		DeflateStream(DeflateStream&) = delete;
+		~DeflateStream();
+
+		bool isValid() const noexcept { return m_isValid; }
+
+		// Compresses 'size' bytes and appends the compressed bytes to 'output'
+		bool compress(const u8* bytes, u32 size, Flush flush, std::vector<u8>& output);
+		// Preset dictionary, it is reapplied on every reset()
+		bool setDictionary(const u8* bytes, u32 size);
+		// Drops the sliding window, the next compress() starts a fresh block
+		void reset();
+	};
+
+	// RAII wrapper over a zlib inflate context which keeps its state (sliding window) across calls
+	class NETSOCKET_API InflateStream
+	{
+	private:
+		std::unique_ptr<z_stream_s> m_stream;
+		std::vector<u8> m_dictionary;
+		bool m_isRaw;
+		bool m_isValid;
+
+	public:
+		InflateStream(s32 windowBits, bool isRaw);
+		InflateStream(InflateStream&& stream);
+		InflateStream& operator=(InflateStream&& stream) = delete;
+		InflateStream(InflateStream&) = delete;
+		~InflateStream();
+
+		bool isValid() const noexcept { return m_isValid; }
+
+		// Decompresses 'size' bytes and appends the decompressed bytes to 'output'
+		// Fails if the data is corrupt or more than 'maxOutputSize' bytes would be produced
+		bool decompress(const u8* bytes, u32 size, std::vector<u8>& output, u64 maxOutputSize = std::numeric_limits<u64>::max());
+		// Decompresses as much of 'size' bytes as fits into the 'outputSize' bytes at 'output', for bounded memory streaming.
+		// Returns the number of input bytes consumed and output bytes produced, or an empty optional if the data is corrupt
+		std::optional<std::pair<u32, u32>> decompressPartial(const u8* bytes, u32 size, u8* output, u32 outputSize);
+		// Preset dictionary, it must be the same as the one used by the DeflateStream on the other end
+		bool setDictionary(const u8* bytes, u32 size);
+		void reset();
+	};
+}
@@ -0,0 +1,71 @@
+#include <netsocket/acceptor.hpp>
+#include <netsocket/assert.hpp>
+
+#include <memory> // for std::make_shared
+#include <vector>
+
+namespace netsocket
+{
+	// The accept thread wakes up at least this often (in milliseconds) to notice stop()
+	static constexpr s32 gAcceptPollInterval = 100;
+
+	Acceptor::Acceptor(Socket& listeningSocket) : m_socket(listeningSocket), m_isRunning(false), m_batchSize(DefaultBatchSize)
+	{
+	}
+
+	Acceptor::~Acceptor()
+	{
+		stop();
+	}
+
+	Result Acceptor::start(const OnAcceptCallback& callback, const TaskExecutor& executor, u32 batchSize)
+	{
+		netsocket_assert(!m_isRunning && "Acceptor is already running, call stop() first");
+		netsocket_assert(callback && (batchSize > 0));
+		if(!m_socket.isValid())
+			return Result::SocketError;
+		m_onAcceptCallback = callback;
+		m_executor = executor;
+		m_batchSize = batchSize;
+		m_isRunning = true;
+		m_thread = std::thread(&Acceptor::run, this);
+		return Result::Success;
+	}
+
+	void Acceptor::stop()
+	{
+		m_isRunning = false;
+		if(m_thread.joinable())
+			m_thread.join();
+	}
+
+	void Acceptor::dispatch(Socket socket)
+	{
+		if(!m_executor)
+		{
+			m_onAcceptCallback(std::move(socket));
+			return;
+		}
+		// std::function must be copyable, so the (move-only) socket is carried in a shared_ptr
+		auto sharedSocket = std::make_shared<Socket>(std::move(socket));
+		m_executor([callback = m_onAcceptCallback, sharedSocket]()
+		{
+			callback(std::move(*sharedSocket));
+		});
+	}
+
+	void Acceptor::run()
+	{
+		std::vector<Socket> sockets;
+		sockets.reserve(m_batchSize);
+		while(m_isRunning && m_socket.isValid())
+		{
+			if(!m_socket.waitReadable(gAcceptPollInterval))
+				continue;
+			m_socket.acceptMany(sockets, m_batchSize);
+			for(Socket& socket : sockets)
+				dispatch(std::move(socket));
+			sockets.clear();
+		}
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <netsocket/netsocket.hpp> // for netsocket::SocketCompressionOptions
+
+#include <common/defines.hpp>
+
+#include <string>
+#include <string_view>
+
+// Telemetry-like JSON records shared by the compression demos, both ends generate the same ones to check the data.
+// Keys and most values repeat from record to record, which is what the compressor's sliding window and the preset dictionary exploit.
+static std::string CreateTelemetryRecord(u32 index)
+{
+	static constexpr std::string_view gHostNames[] = { "edge-fra-01", "edge-fra-02", "edge-ams-01", "core-iad-03" };
+	std::string record = "{\"timestamp\":";
+	record += std::to_string(1760000000000ull + index * 250ull);
+	record += ",\"host\":\"";
+	record += gHostNames[index % 4];
+	record += "\",\"metric\":\"link.throughput\",\"unit\":\"bytes_per_second\",\"value\":";
+	record += std::to_string((index * 7919u) % 1000000u);
+	record += ",\"tags\":{\"region\":\"eu-central\",\"tier\":\"backbone\",\"status\":\"";
+	record += ((index % 17) == 0) ? "degraded" : "ok";
+	record += "\"}}";
+	return record;
+}
+
+// Same on both ends, the most frequent strings last (they are the cheapest to reference)
+static netsocket::SocketCompressionOptions CreateTelemetryCompressionOptions(netsocket::SocketCompressionOptions::FlushPolicy flushPolicy)
+{
+	static constexpr std::string_view gDictionary = "\"status\":\"degraded\"\"tier\":\"backbone\",\"region\":\"eu-central\",\"tags\":{"
+													"\"unit\":\"bytes_per_second\",\"value\":\"metric\":\"link.throughput\","
+													"\"host\":\"edge-fra-0\"}}{\"timestamp\":";
+	netsocket::SocketCompressionOptions options;
+	options.level = 6;
+	options.dictionary.assign(gDictionary.begin(), gDictionary.end());
+	options.flushPolicy = flushPolicy;
+	return options;
+}
@@ -0,0 +1,204 @@
+#include <netsocket/connectionpool.hpp>
+#include <netsocket/tls.hpp>
+#include <netsocket/assert.hpp>
+
+#include <algorithm> // for std::min
+#include <vector>
+
+namespace netsocket
+{
+	using Clock = std::chrono::steady_clock;
+
+	PooledConnection::PooledConnection(ConnectionPool& pool, const std::string& endpoint, Socket socket, Clock::time_point connectTime) :
+																					m_pool(&pool),
+																					m_endpoint(endpoint),
+																					m_socket(std::move(socket)),
+																					m_connectTime(connectTime)
+	{
+	}
+
+	PooledConnection::PooledConnection(PooledConnection&& connection) : m_pool(connection.m_pool),
+																		m_endpoint(std::move(connection.m_endpoint)),
+																		m_socket(std::move(connection.m_socket)),
+																		m_connectTime(connection.m_connectTime)
+	{
+		connection.m_pool = nullptr;
+	}
+
+	PooledConnection& PooledConnection::operator=(PooledConnection&& connection)
+	{
+		if(this == &connection)
+			return *this;
+		release();
+		m_pool = connection.m_pool;
+		m_endpoint = std::move(connection.m_endpoint);
+		m_socket = std::move(connection.m_socket);
+		m_connectTime = connection.m_connectTime;
+		connection.m_pool = nullptr;
+		return *this;
+	}
+
+	PooledConnection::~PooledConnection()
+	{
+		release();
+	}
+
+	void PooledConnection::release()
+	{
+		if(m_pool == nullptr)
+			return;
+		m_pool->release(m_endpoint, std::move(m_socket), m_connectTime);
+		m_pool = nullptr;
+	}
+
+	void PooledConnection::discard()
+	{
+		if(m_socket.isValid())
+			m_socket.close();
+		m_pool = nullptr;
+	}
+
+	Socket PooledConnection::detach()
+	{
+		m_pool = nullptr;
+		return std::move(m_socket);
+	}
+
+	ConnectionPool::ConnectionPool(const ConnectionPoolOptions& options) : m_options(options)
+	{
+	}
+
+	ConnectionPool::~ConnectionPool()
+	{
+		clear();
+	}
+
+	std::string ConnectionPool::GetEndpoint(const std::string_view host, const std::string_view port)
+	{
+		std::string endpoint { host };
+		endpoint.push_back('\n');
+		endpoint.append(port);
+		return endpoint;
+	}
+
+	bool ConnectionPool::isExpired(Clock::time_point connectTime, Clock::time_point now) const
+	{
+		return (m_options.maxLifetime != 0) && ((now - connectTime) >= std::chrono::milliseconds(m_options.maxLifetime));
+	}
+
+	std::optional<Socket> ConnectionPool::connect(const std::string_view host, const std::string_view port)
+	{
+		std::optional<Socket> socket = Socket::ConnectHappyEyeballs(host, port, m_options.connectOptions);
+		if(!socket)
+			return { };
+		if((m_options.tlsContext != nullptr) && (socket->startTls(m_options.tlsContext, host) != Result::Success))
+			return { };
+		if(m_options.onConnect && (m_options.onConnect(*socket) != Result::Success))
+			return { };
+		std::lock_guard<std::mutex> lock(m_mutex);
+		++m_stats.connectedCount;
+		return socket;
+	}
+
+	std::optional<PooledConnection> ConnectionPool::checkout(const std::string_view host, const std::string_view port)
+	{
+		const std::string endpoint = GetEndpoint(host, port);
+		// Closed outside the lock, closing can send (TLS close_notify)
+		std::vector<Socket> droppedSockets;
+		std::optional<PooledConnection> connection;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto it = m_idleConnections.find(endpoint);
+			const Clock::time_point now = Clock::now();
+			while((it != m_idleConnections.end()) && !it->second.empty() && !connection)
+			{
+				IdleConnection idleConnection = std::move(it->second.back());
+				it->second.pop_back();
+				if(isExpired(idleConnection.connectTime, now)
+					|| ((m_options.maxIdleTime != 0) && ((now - idleConnection.idleTime) >= std::chrono::milliseconds(m_options.maxIdleTime))))
+				{
+					++m_stats.expiredCount;
+					droppedSockets.push_back(std::move(idleConnection.socket));
+					continue;
+				}
+				// Nothing is expected on an idle connection: readable means it has been closed by the peer
+				if(!idleConnection.socket.isConnected() || (m_options.isHealthCheckEnabled && idleConnection.socket.waitReadable(0)))
+				{
+					++m_stats.unhealthyCount;
+					droppedSockets.push_back(std::move(idleConnection.socket));
+					continue;
+				}
+				++m_stats.reusedCount;
+				connection = PooledConnection(*this, endpoint, std::move(idleConnection.socket), idleConnection.connectTime);
+			}
+		}
+		for(Socket& socket : droppedSockets)
+			if(socket.isValid())
+				socket.close();
+		if(connection)
+			return connection;
+
+		std::optional<Socket> socket = connect(host, port);
+		if(!socket)
+			return { };
+		return { PooledConnection(*this, endpoint, std::move(*socket), Clock::now()) };
+	}
+
+	u32 ConnectionPool::prewarm(const std::string_view host, const std::string_view port, u32 count)
+	{
+		const std::string endpoint = GetEndpoint(host, port);
+		count = std::min(count, m_options.maxIdlePerEndpoint);
+		u32 idleCount = getIdleCount(host, port);
+		for(; idleCount < count; ++idleCount)
+		{
+			std::optional<Socket> socket = connect(host, port);
+			if(!socket)
+				break;
+			release(endpoint, std::move(*socket), Clock::now());
+		}
+		return getIdleCount(host, port);
+	}
+
+	void ConnectionPool::release(const std::string& endpoint, Socket socket, Clock::time_point connectTime)
+	{
+		const Clock::time_point now = Clock::now();
+		if(socket.isConnected() && !isExpired(connectTime, now))
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			std::deque<IdleConnection>& idleConnections = m_idleConnections[endpoint];
+			if(idleConnections.size() < m_options.maxIdlePerEndpoint)
+			{
+				idleConnections.push_back({ std::move(socket), connectTime, now });
+				return;
+			}
+		}
+		if(socket.isValid())
+			socket.close();
+	}
+
+	u32 ConnectionPool::getIdleCount(const std::string_view host, const std::string_view port) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_idleConnections.find(GetEndpoint(host, port));
+		return (it == m_idleConnections.end()) ? 0 : static_cast<u32>(it->second.size());
+	}
+
+	void ConnectionPool::clear()
+	{
+		std::unordered_map<std::string, std::deque<IdleConnection>> idleConnections;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			idleConnections.swap(m_idleConnections);
+		}
+		for(auto& [endpoint, connections] : idleConnections)
+			for(IdleConnection& connection : connections)
+				if(connection.socket.isValid())
+					connection.socket.close();
+	}
+
+	ConnectionPoolStats ConnectionPool::getStats() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_stats;
+	}
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <common/defines.hpp>
+
+// Requests of the connection pool demo: the server answers a u32 with twice its value, except for these
+static constexpr u32 gPoolCloseRequest = 0;
+static constexpr u32 gPoolShutdownRequest = 0xFFFFFFFF;
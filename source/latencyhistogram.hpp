@@ -0,0 +1,84 @@
+#pragma once
+
+#include <common/defines.hpp>
+
+#include <algorithm> // for std::min, std::max
+#include <bit> // for std::bit_width
+#include <cmath> // for std::ceil
+#include <limits>
+#include <vector>
+
+// Shared by the latency benchmarks: histogram of the HDR kind, relative error below 0.1% from 1 ns to hours, in constant memory
+// Log-linear buckets: values below 2 * SubBucketCount have their own bucket, above that every power of two is split into SubBucketCount buckets
+class LatencyHistogram
+{
+private:
+	static constexpr u32 SubBucketBits = 10;
+	static constexpr u32 SubBucketCount = 1u << SubBucketBits;
+	static constexpr u32 BucketCount = (65 - SubBucketBits) * SubBucketCount;
+
+	std::vector<u64> m_counts;
+	u64 m_count;
+	u64 m_min;
+	u64 m_max;
+	double m_sum;
+
+	static u32 getIndex(u64 value) noexcept
+	{
+		if(value < (2 * SubBucketCount))
+			return static_cast<u32>(value);
+		const u32 shift = static_cast<u32>(std::bit_width(value)) - 1 - SubBucketBits;
+		return (shift + 1) * SubBucketCount + static_cast<u32>((value >> shift) - SubBucketCount);
+	}
+
+	// Highest value of the bucket
+	static u64 getValue(u32 index) noexcept
+	{
+		if(index < (2 * SubBucketCount))
+			return index;
+		const u32 shift = index / SubBucketCount - 1;
+		return ((u64((index % SubBucketCount) + SubBucketCount + 1)) << shift) - 1;
+	}
+
+public:
+	LatencyHistogram() : m_counts(BucketCount, 0), m_count(0), m_min(std::numeric_limits<u64>::max()), m_max(0), m_sum(0) { }
+
+	void record(u64 value) noexcept
+	{
+		++m_counts[getIndex(value)];
+		++m_count;
+		m_min = std::min(m_min, value);
+		m_max = std::max(m_max, value);
+		m_sum += static_cast<double>(value);
+	}
+
+	void merge(const LatencyHistogram& histogram) noexcept
+	{
+		for(u32 i = 0; i < BucketCount; ++i)
+			m_counts[i] += histogram.m_counts[i];
+		m_count += histogram.m_count;
+		m_min = std::min(m_min, histogram.m_min);
+		m_max = std::max(m_max, histogram.m_max);
+		m_sum += histogram.m_sum;
+	}
+
+	u64 getCount() const noexcept { return m_count; }
+	u64 getMax() const noexcept { return m_max; }
+	double getMean() const noexcept { return (m_count == 0) ? 0 : (m_sum / m_count); }
+
+	// 'percentile' is in [0, 100]
+	u64 getValueAtPercentile(double percentile) const noexcept
+	{
+		if(m_count == 0)
+			return 0;
+		const u64 rank = std::max<u64>(static_cast<u64>(std::ceil(percentile / 100 * m_count)), 1);
+		u64 count = 0;
+		for(u32 i = 0; i < BucketCount; ++i)
+		{
+			count += m_counts[i];
+			if(count >= rank)
+				return std::min(getValue(i), m_max);
+		}
+		return m_max;
+	}
+};
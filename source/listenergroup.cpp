@@ -0,0 +1,119 @@
+#include <netsocket/listenergroup.hpp>
+#include <netsocket/assert.hpp>
+
+#include <common/platform.h>
+
+#ifdef PLATFORM_LINUX
+#	include <pthread.h> // for pthread_setaffinity_np
+#	include <sched.h> // for cpu_set_t
+#endif
+
+#include <algorithm> // for std::max
+
+namespace netsocket
+{
+	// The shard threads wake up at least this often (in milliseconds) to notice stop()
+	static constexpr s32 gAcceptPollInterval = 100;
+
+	static u32 GetCoreCount()
+	{
+		return std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	ListenerGroup::ListenerGroup(const ListenerGroupOptions& options) : m_options(options), m_isRunning(false)
+	{
+	}
+
+	ListenerGroup::~ListenerGroup()
+	{
+		stop();
+	}
+
+	Result ListenerGroup::listen(const std::string_view ipAddress, const std::string_view portNumber)
+	{
+		netsocket_assert(!m_isRunning && m_shards.empty() && "ListenerGroup is already listening");
+#ifdef PLATFORM_LINUX
+		const u32 shardCount = (m_options.shardCount == 0) ? GetCoreCount() : m_options.shardCount;
+#else
+		const u32 shardCount = 1;
+#endif
+		for(u32 i = 0; i < shardCount; ++i)
+		{
+			auto shard = std::make_unique<Shard>();
+			shard->socket = Socket(SocketType::Stream, m_options.ipAddressFamily, IPProtocol::TCP, m_options.socketOptions);
+			if(!shard->socket.isValid())
+			{
+				m_shards.clear();
+				return Result::SocketError;
+			}
+			Result result = (shardCount > 1) ? shard->socket.setReusePort(true) : Result::Success;
+			if(result == Result::Success)
+				result = shard->socket.bind(ipAddress, portNumber);
+			if(result == Result::Success)
+				result = shard->socket.listen();
+			if(result != Result::Success)
+			{
+				m_shards.clear();
+				return result;
+			}
+			m_shards.push_back(std::move(shard));
+		}
+		// The program applies to the whole group, whichever socket it is attached to
+		if(m_options.isCpuSteeringEnabled && (shardCount > 1))
+		{
+			Result result = m_shards[0]->socket.attachReusePortCpuSteering(shardCount);
+			if(result != Result::Success)
+			{
+				m_shards.clear();
+				return result;
+			}
+		}
+		return Result::Success;
+	}
+
+	Result ListenerGroup::start(const OnAcceptCallback& callback)
+	{
+		netsocket_assert(!m_isRunning && "ListenerGroup is already running, call stop() first");
+		netsocket_assert(callback && (m_options.batchSize > 0));
+		if(m_shards.empty())
+			return Result::Failed;
+		m_onAcceptCallback = callback;
+		m_isRunning = true;
+		for(u32 i = 0; i < m_shards.size(); ++i)
+			m_shards[i]->thread = std::thread(&ListenerGroup::run, this, i);
+		return Result::Success;
+	}
+
+	void ListenerGroup::stop()
+	{
+		m_isRunning = false;
+		for(auto& shard : m_shards)
+			if(shard->thread.joinable())
+				shard->thread.join();
+	}
+
+	void ListenerGroup::run(u32 shardIndex)
+	{
+#ifdef PLATFORM_LINUX
+		if(m_options.isPinnedToCores)
+		{
+			cpu_set_t cpuSet;
+			CPU_ZERO(&cpuSet);
+			CPU_SET(shardIndex % GetCoreCount(), &cpuSet);
+			pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+		}
+#endif
+		Socket& listeningSocket = m_shards[shardIndex]->socket;
+		std::vector<Socket> sockets;
+		sockets.reserve(m_options.batchSize);
+		while(m_isRunning && listeningSocket.isValid())
+		{
+			if(!listeningSocket.waitReadable(gAcceptPollInterval))
+				continue;
+			listeningSocket.acceptMany(sockets, m_options.batchSize, m_options.socketOptions);
+			for(Socket& socket : sockets)
+				m_onAcceptCallback(std::move(socket), shardIndex);
+			sockets.clear();
+		}
+	}
+}
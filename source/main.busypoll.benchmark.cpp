@@ -0,0 +1,166 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/netasyncsocket.hpp>
+#include <netsocket/assert.hpp>
+
+#include "latencyhistogram.hpp"
+
+#include <chrono>
+#include <cstdlib> // for std::strtoul
+#include <cstring> // for std::memcpy
+#include <thread>
+
+// Ping-pong latency over loopback: a message goes back and forth between the client and an echo server (a thread of this process),
+// with the receiving side sleeping until the message arrives (poll() for Socket, a condition variable for AsyncSocket's transaction thread)
+// versus busy polling (see Socket::setBusyPoll()). Busy polling needs a core per spinning thread, on a single core host it is disabled.
+// Usage: busy_poll_benchmark [round trips per mode, 20000 by default] [spin time in microseconds, 200 by default]
+
+static constexpr std::string_view gIPAddress = "127.0.0.1";
+static constexpr std::string_view gPortNumber = "8002";
+static constexpr u32 gDefaultRoundTripCount = 20000;
+static constexpr u32 gDefaultSpinTime = 200;
+// Payload of every message, after its u32 length
+static constexpr u32 gPayloadSize = 64;
+static constexpr u32 gWarmupCount = 1000;
+
+struct BenchmarkMode
+{
+	std::string_view name;
+	bool isAsync;
+	bool isBusyPoll;
+};
+
+static netsocket::Socket CreateTcpSocket()
+{
+	netsocket::SocketOptions options;
+	options.isNoDelay = true;
+	return netsocket::Socket(netsocket::SocketType::Stream, netsocket::IPAddressFamily::IPv4, netsocket::IPProtocol::TCP, options);
+}
+
+// Echoes the length-prefixed messages of one connection until the client closes it
+static void RunEchoServer(netsocket::Socket& listeningSocket, const netsocket::BusyPollOptions& busyPollOptions)
+{
+	std::optional<netsocket::Socket> socket = listeningSocket.accept();
+	netsocket_assert(socket.has_value());
+	socket->setTCPNoDelay();
+	netsocket::Result result = socket->setBusyPoll(busyPollOptions);
+	netsocket_assert(result == netsocket::Result::Success);
+	u8 message[sizeof(u32) + gPayloadSize];
+	while(socket->receive(message, sizeof(message)) == netsocket::Result::Success)
+	{
+		result = socket->send(message, sizeof(message));
+		netsocket_assert(result == netsocket::Result::Success);
+	}
+}
+
+static void CreateMessage(u8* message)
+{
+	const u32 size = gPayloadSize;
+	std::memcpy(message, &size, sizeof(size));
+	for(u32 i = 0; i < gPayloadSize; ++i)
+		message[sizeof(u32) + i] = static_cast<u8>(i);
+}
+
+// Round trip times in nanoseconds, the warmup round trips aren't included
+static LatencyHistogram RunSocketClient(const netsocket::BusyPollOptions& busyPollOptions, u32 roundTripCount)
+{
+	netsocket::Socket socket = CreateTcpSocket();
+	netsocket::Result result = socket.connect(gIPAddress, gPortNumber);
+	netsocket_assert(result == netsocket::Result::Success);
+	result = socket.setBusyPoll(busyPollOptions);
+	netsocket_assert(result == netsocket::Result::Success);
+
+	u8 message[sizeof(u32) + gPayloadSize];
+	u8 echo[sizeof(message)];
+	CreateMessage(message);
+	LatencyHistogram times;
+	for(u32 i = 0; i < (gWarmupCount + roundTripCount); ++i)
+	{
+		auto start = std::chrono::steady_clock::now();
+		result = socket.send(message, sizeof(message));
+		netsocket_assert(result == netsocket::Result::Success);
+		result = socket.receive(echo, sizeof(echo));
+		netsocket_assert(result == netsocket::Result::Success);
+		if(i >= gWarmupCount)
+			times.record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+	}
+	socket.close();
+	return times;
+}
+
+static LatencyHistogram RunAsyncSocketClient(const netsocket::BusyPollOptions& busyPollOptions, u32 roundTripCount)
+{
+	netsocket::AsyncSocket socket(CreateTcpSocket());
+	netsocket::Result result = socket.connect(gIPAddress, gPortNumber);
+	netsocket_assert(result == netsocket::Result::Success);
+	result = socket.setBusyPoll(busyPollOptions);
+	netsocket_assert(result == netsocket::Result::Success);
+
+	netsocket::AsyncSocket::BinaryFormatter formatter;
+	formatter.add(netsocket::AsyncSocket::BinaryFormatter::Type::LengthU32);
+	formatter.add(netsocket::AsyncSocket::BinaryFormatter::Type::Data);
+	u8 message[sizeof(u32) + gPayloadSize];
+	CreateMessage(message);
+	LatencyHistogram times;
+	for(u32 i = 0; i < (gWarmupCount + roundTripCount); ++i)
+	{
+		auto start = std::chrono::steady_clock::now();
+		socket.send(message, sizeof(message));
+		socket.receive([](const u8* bytes, u32 size, void*)
+		{
+			netsocket_assert((bytes != NULL) && (size == (sizeof(u32) + gPayloadSize)));
+		}, NULL, formatter);
+		result = socket.finish();
+		netsocket_assert(result == netsocket::Result::Success);
+		if(i >= gWarmupCount)
+			times.record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+	}
+	socket.close();
+	return times;
+}
+
+static void RunBenchmarkMode(netsocket::Socket& listeningSocket, const BenchmarkMode& mode, u32 roundTripCount, u32 spinTime)
+{
+	netsocket::BusyPollOptions busyPollOptions;
+	busyPollOptions.spinTime = mode.isBusyPoll ? spinTime : 0;
+	busyPollOptions.kernelBusyPollTime = mode.isBusyPoll ? busyPollOptions.kernelBusyPollTime : 0;
+
+	std::thread serverThread(RunEchoServer, std::ref(listeningSocket), busyPollOptions);
+	LatencyHistogram times = mode.isAsync ? RunAsyncSocketClient(busyPollOptions, roundTripCount) : RunSocketClient(busyPollOptions, roundTripCount);
+	serverThread.join();
+
+	auto percentile = [&times](double p) { return times.getValueAtPercentile(p) / 1000.0; };
+	spdlog::info("{:<28} mean {:>8.2f} us, p50 {:>8.2f} us, p99 {:>8.2f} us, p99.9 {:>8.2f} us", mode.name,
+					times.getMean() / 1000.0, percentile(50), percentile(99), percentile(99.9));
+}
+
+int main(int argc, const char* argv[])
+{
+	const u32 roundTripCount = (argc > 1) ? static_cast<u32>(std::strtoul(argv[1], NULL, 10)) : gDefaultRoundTripCount;
+	const u32 spinTime = (argc > 2) ? static_cast<u32>(std::strtoul(argv[2], NULL, 10)) : gDefaultSpinTime;
+	netsocket_assert(roundTripCount > 0);
+	spdlog::info("Busy poll benchmark, {} round trips of {} bytes per mode over {}:{}, spin time {} us, {} cores", roundTripCount,
+					sizeof(u32) + gPayloadSize, gIPAddress, gPortNumber, spinTime, std::thread::hardware_concurrency());
+	if(std::thread::hardware_concurrency() == 1)
+		spdlog::warn("Single core host: busy polling is disabled, both modes sleep");
+
+	netsocket::Socket listeningSocket = CreateTcpSocket();
+	netsocket::Result result = listeningSocket.bind(gIPAddress, gPortNumber);
+	netsocket_assert(result == netsocket::Result::Success);
+	result = listeningSocket.listen();
+	netsocket_assert(result == netsocket::Result::Success);
+
+	const BenchmarkMode modes[] =
+	{
+		{ "Socket, blocking", false, false },
+		{ "Socket, busy poll", false, true },
+		{ "AsyncSocket, blocking", true, false },
+		{ "AsyncSocket, busy poll", true, true }
+	};
+	for(const BenchmarkMode& mode : modes)
+		RunBenchmarkMode(listeningSocket, mode, roundTripCount, spinTime);
+	return 0;
+}
@@ -0,0 +1,79 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+#include "compressiontestdata.hpp"
+
+#include <string>
+#include <vector>
+
+static constexpr std::string_view gPortNumber = "8000";
+static constexpr u32 gRecordCount = 10000;
+static constexpr netsocket::SocketCompressionOptions::FlushPolicy gFlushPolicies[] =
+{
+	netsocket::SocketCompressionOptions::FlushPolicy::PerMessage,
+	netsocket::SocketCompressionOptions::FlushPolicy::PerBatch
+};
+
+int main()
+{
+	spdlog::info("NetSocket compression client");
+
+	std::vector<std::pair<std::string, netsocket::IPv4Address>> ipAddresses = netsocket::GetInterfaceIPv4Addresses();
+	std::string ipAddress = netsocket::TrySelectingPhysicalInterfaceIPAddress(ipAddresses, "192.168.1.1");
+	spdlog::info("Selected IP address: {}", ipAddress);
+
+	for(netsocket::SocketCompressionOptions::FlushPolicy flushPolicy : gFlushPolicies)
+	{
+		netsocket::Socket mySocket(netsocket::SocketType::Stream,
+									netsocket::IPAddressFamily::IPv4,
+									netsocket::IPProtocol::TCP);
+
+		spdlog::info("Connecting to {}:{}", ipAddress, gPortNumber);
+		netsocket::Result result = mySocket.connect(ipAddress, gPortNumber);
+		netsocket_assert((result == netsocket::Result::Success) && "Failed to connect");
+
+		result = mySocket.startCompression(CreateTelemetryCompressionOptions(flushPolicy));
+		netsocket_assert((result == netsocket::Result::Success) && "Failed to start the compression");
+
+		bool isSent = mySocket.send<u32>(gRecordCount);
+		netsocket_assert(isSent);
+		for(u32 i = 0; i < gRecordCount; ++i)
+		{
+			const std::string record = CreateTelemetryRecord(i);
+			isSent = mySocket.send<u32>(static_cast<u32>(record.size()));
+			netsocket_assert(isSent);
+			result = mySocket.send(reinterpret_cast<const u8*>(record.data()), static_cast<u32>(record.size()));
+			netsocket_assert(result == netsocket::Result::Success);
+		}
+
+		// Receiving flushes what the batch policy still holds back
+		std::optional<u32> replySize = mySocket.receive<u32>();
+		netsocket_assert(replySize.has_value());
+		std::vector<char> reply(*replySize);
+		result = mySocket.receive(reinterpret_cast<u8*>(reply.data()), *replySize);
+		netsocket_assert(result == netsocket::Result::Success);
+		std::string expectedReply;
+		for(u32 i = 0; i < gRecordCount; ++i)
+			expectedReply += CreateTelemetryRecord(i);
+		netsocket_assert((std::string_view { reply.data(), reply.size() } == expectedReply) && "Reply is corrupted");
+
+		netsocket::SocketCompressionStats stats = mySocket.getCompressionStats();
+		spdlog::info("{}: sent {} bytes as {} bytes ({:.1f}x), received {} bytes as {} bytes ({:.1f}x)",
+						(flushPolicy == netsocket::SocketCompressionOptions::FlushPolicy::PerMessage) ? "flush per message" : "flush per batch",
+						stats.sentBytes, stats.sentCompressedBytes, static_cast<double>(stats.sentBytes) / stats.sentCompressedBytes,
+						stats.receivedBytes, stats.receivedCompressedBytes, static_cast<double>(stats.receivedBytes) / stats.receivedCompressedBytes);
+
+		isSent = mySocket.send<u8>(1);
+		netsocket_assert(isSent);
+		result = mySocket.close();
+		netsocket_assert(result == netsocket::Result::Success);
+		spdlog::info("Connection closed successfully");
+	}
+
+	return 0;
+}
@@ -0,0 +1,82 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+#include "compressiontestdata.hpp"
+
+#include <string>
+#include <vector>
+
+static constexpr std::string_view gPortNumber = "8000";
+// The first connection flushes every record, the second one flushes in batches
+static constexpr netsocket::SocketCompressionOptions::FlushPolicy gFlushPolicies[] =
+{
+	netsocket::SocketCompressionOptions::FlushPolicy::PerMessage,
+	netsocket::SocketCompressionOptions::FlushPolicy::PerBatch
+};
+
+int main()
+{
+	spdlog::info("NetSocket compression server");
+
+	std::vector<std::pair<std::string, netsocket::IPv4Address>> ipAddresses = netsocket::GetInterfaceIPv4Addresses();
+	std::string ipAddress = netsocket::TrySelectingPhysicalInterfaceIPAddress(ipAddresses, "192.168.1.1");
+	spdlog::info("Selected IP address: {}", ipAddress);
+
+	netsocket::Socket mySocket(netsocket::SocketType::Stream,
+								netsocket::IPAddressFamily::IPv4,
+								netsocket::IPProtocol::TCP);
+
+	netsocket::Result result = mySocket.bind(ipAddress, gPortNumber);
+	netsocket_assert(result == netsocket::Result::Success);
+
+	spdlog::info("Listening on {}:{}", ipAddress, gPortNumber);
+	result = mySocket.listen();
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to listen");
+
+	for(netsocket::SocketCompressionOptions::FlushPolicy flushPolicy : gFlushPolicies)
+	{
+		spdlog::info("Waiting to accept connection");
+		std::optional<netsocket::Socket> clientSocket = mySocket.accept();
+		netsocket_assert(clientSocket.has_value() && "Failed to accept connection");
+
+		result = clientSocket->startCompression(CreateTelemetryCompressionOptions(flushPolicy));
+		netsocket_assert((result == netsocket::Result::Success) && "Failed to start the compression");
+
+		std::optional<u32> recordCount = clientSocket->receive<u32>();
+		netsocket_assert(recordCount.has_value());
+		std::vector<char> record;
+		for(u32 i = 0; i < *recordCount; ++i)
+		{
+			std::optional<u32> recordSize = clientSocket->receive<u32>();
+			netsocket_assert(recordSize.has_value());
+			record.resize(*recordSize);
+			result = clientSocket->receive(reinterpret_cast<u8*>(record.data()), *recordSize);
+			netsocket_assert(result == netsocket::Result::Success);
+			netsocket_assert((std::string_view { record.data(), record.size() } == CreateTelemetryRecord(i)) && "Record is corrupted");
+		}
+		netsocket::SocketCompressionStats stats = clientSocket->getCompressionStats();
+		spdlog::info("Received {} records, {} bytes, {} bytes compressed", *recordCount, stats.receivedBytes, stats.receivedCompressedBytes);
+
+		// The other direction, acknowledges with the records back in one message
+		std::string reply;
+		for(u32 i = 0; i < *recordCount; ++i)
+			reply += CreateTelemetryRecord(i);
+		bool isSent = clientSocket->send<u32>(static_cast<u32>(reply.size()));
+		netsocket_assert(isSent);
+		result = clientSocket->send(reinterpret_cast<const u8*>(reply.data()), static_cast<u32>(reply.size()));
+		netsocket_assert(result == netsocket::Result::Success);
+
+		std::optional<u8> ack = clientSocket->receive<u8>();
+		netsocket_assert(ack.has_value() && (*ack == 1));
+		result = clientSocket->close();
+		netsocket_assert(result == netsocket::Result::Success);
+		spdlog::info("Connection closed successfully");
+	}
+
+	return 0;
+}
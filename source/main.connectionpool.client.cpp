@@ -0,0 +1,112 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/connectionpool.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+#include "connectionpooltestconfig.hpp"
+
+#include <algorithm> // for std::sort
+#include <chrono>
+#include <thread>
+#include <vector>
+
+static constexpr std::string_view gPortNumber = "8000";
+static constexpr u32 gPrewarmCount = 4;
+static constexpr u32 gRequestCount = 200;
+
+static u32 SendRequest(netsocket::Socket& socket, u32 request)
+{
+	bool isSent = socket.send<u32>(request);
+	netsocket_assert(isSent);
+	std::optional<u32> response = socket.receive<u32>();
+	netsocket_assert(response.has_value() && (*response == (request * 2)));
+	return *response;
+}
+
+static double GetMedian(std::vector<double>& values)
+{
+	std::sort(values.begin(), values.end());
+	return values[values.size() / 2];
+}
+
+int main()
+{
+	spdlog::info("NetSocket connection pool client");
+
+	std::vector<std::pair<std::string, netsocket::IPv4Address>> ipAddresses = netsocket::GetInterfaceIPv4Addresses();
+	std::string ipAddress = netsocket::TrySelectingPhysicalInterfaceIPAddress(ipAddresses, "192.168.1.1");
+	spdlog::info("Selected IP address: {}", ipAddress);
+
+	netsocket::ConnectionPoolOptions options;
+	options.onConnect = [](netsocket::Socket& socket)
+	{
+		socket.setTCPNoDelay();
+		return netsocket::Result::Success;
+	};
+	netsocket::ConnectionPool pool(options);
+	u32 idleCount = pool.prewarm(ipAddress, gPortNumber, gPrewarmCount);
+	netsocket_assert((idleCount == gPrewarmCount) && "Failed to pre-warm the pool");
+	spdlog::info("Pre-warmed {} connections to {}:{}", idleCount, ipAddress, gPortNumber);
+
+	// A connection per request, as without the pool
+	std::vector<double> latencies;
+	for(u32 i = 1; i <= gRequestCount; ++i)
+	{
+		auto start = std::chrono::steady_clock::now();
+		netsocket::Socket socket(netsocket::SocketType::Stream, netsocket::IPAddressFamily::IPv4, netsocket::IPProtocol::TCP);
+		netsocket::Result result = socket.connect(ipAddress, gPortNumber);
+		netsocket_assert(result == netsocket::Result::Success);
+		socket.setTCPNoDelay();
+		SendRequest(socket, i);
+		latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+		socket.close();
+	}
+	spdlog::info("Connection per request: p50 {:.1f} us", GetMedian(latencies));
+
+	latencies.clear();
+	for(u32 i = 1; i <= gRequestCount; ++i)
+	{
+		auto start = std::chrono::steady_clock::now();
+		std::optional<netsocket::PooledConnection> connection = pool.checkout(ipAddress, gPortNumber);
+		netsocket_assert(connection.has_value() && "Failed to check out a connection");
+		SendRequest(connection->getSocket(), i);
+		latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+	}
+	spdlog::info("Pooled connection: p50 {:.1f} us", GetMedian(latencies));
+	netsocket::ConnectionPoolStats stats = pool.getStats();
+	netsocket_assert((stats.connectedCount == gPrewarmCount) && (stats.reusedCount == gRequestCount) && "Every request should reuse a connection");
+
+	// The server closes this connection once released, the health check must notice on the next checkout
+	{
+		std::optional<netsocket::PooledConnection> connection = pool.checkout(ipAddress, gPortNumber);
+		netsocket_assert(connection.has_value());
+		SendRequest(connection->getSocket(), gPoolCloseRequest);
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	{
+		std::optional<netsocket::PooledConnection> connection = pool.checkout(ipAddress, gPortNumber);
+		netsocket_assert(connection.has_value());
+		SendRequest(connection->getSocket(), 1);
+	}
+	stats = pool.getStats();
+	netsocket_assert((stats.unhealthyCount == 1) && "The connection closed by the server should have been dropped");
+	netsocket_assert(pool.getIdleCount(ipAddress, gPortNumber) == (gPrewarmCount - 1));
+	spdlog::info("Dropped the connection closed by the server: {} connected, {} reused, {} unhealthy", stats.connectedCount,
+					stats.reusedCount, stats.unhealthyCount);
+
+	{
+		std::optional<netsocket::PooledConnection> connection = pool.checkout(ipAddress, gPortNumber);
+		netsocket_assert(connection.has_value());
+		bool isSent = connection->getSocket().send<u32>(gPoolShutdownRequest);
+		netsocket_assert(isSent);
+		std::optional<u32> response = connection->getSocket().receive<u32>();
+		netsocket_assert(response.has_value());
+	}
+	pool.clear();
+	spdlog::info("Connections closed successfully");
+	return 0;
+}
@@ -0,0 +1,69 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+#include "connectionpooltestconfig.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static constexpr std::string_view gPortNumber = "8000";
+
+// Answers the requests of one connection until the client closes it (or asks the server to close it)
+static void ServeConnection(netsocket::Socket socket, std::atomic<bool>& isShuttingDown)
+{
+	while(true)
+	{
+		std::optional<u32> request = socket.receive<u32>();
+		if(!request)
+			break;
+		if(*request == gPoolShutdownRequest)
+			isShuttingDown = true;
+		bool isSent = socket.send<u32>(*request * 2);
+		netsocket_assert(isSent);
+		if(*request == gPoolCloseRequest)
+		{
+			spdlog::info("Closing a connection on request");
+			break;
+		}
+	}
+	socket.close();
+}
+
+int main()
+{
+	spdlog::info("NetSocket connection pool server");
+
+	std::vector<std::pair<std::string, netsocket::IPv4Address>> ipAddresses = netsocket::GetInterfaceIPv4Addresses();
+	std::string ipAddress = netsocket::TrySelectingPhysicalInterfaceIPAddress(ipAddresses, "192.168.1.1");
+	spdlog::info("Selected IP address: {}", ipAddress);
+
+	netsocket::Socket mySocket(netsocket::SocketType::Stream,
+								netsocket::IPAddressFamily::IPv4,
+								netsocket::IPProtocol::TCP);
+	netsocket::Result result = mySocket.bind(ipAddress, gPortNumber);
+	netsocket_assert(result == netsocket::Result::Success);
+	spdlog::info("Listening on {}:{}", ipAddress, gPortNumber);
+	result = mySocket.listen();
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to listen");
+
+	std::atomic<bool> isShuttingDown = false;
+	std::vector<std::thread> connectionThreads;
+	while(!isShuttingDown)
+	{
+		if(!mySocket.waitReadable(100))
+			continue;
+		std::optional<netsocket::Socket> clientSocket = mySocket.tryAccept();
+		if(clientSocket)
+			connectionThreads.emplace_back(ServeConnection, std::move(*clientSocket), std::ref(isShuttingDown));
+	}
+	for(std::thread& thread : connectionThreads)
+		thread.join();
+	spdlog::info("Served {} connections", connectionThreads.size());
+	return 0;
+}
@@ -0,0 +1,71 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+#include <chrono>
+
+static constexpr std::string_view gPortNumber = "8000";
+
+// Receives the address the server sees this connection coming from, then acknowledges it
+static std::string ReceivePeerAddress(netsocket::Socket& socket)
+{
+	std::optional<u32> size = socket.receive<u32>();
+	netsocket_assert(size.has_value());
+	std::string address(*size, '\0');
+	netsocket::Result result = socket.receive(reinterpret_cast<u8*>(address.data()), *size);
+	netsocket_assert(result == netsocket::Result::Success);
+	bool isSent = socket.send<u8>(1);
+	netsocket_assert(isSent);
+	return address;
+}
+
+static void ConnectHappyEyeballs(const std::vector<std::string>& hosts)
+{
+	auto start = std::chrono::steady_clock::now();
+	std::optional<netsocket::Socket> socket = netsocket::Socket::ConnectHappyEyeballs(hosts, gPortNumber);
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	netsocket_assert(socket.has_value() && "Happy Eyeballs connect failed");
+	// The unreachable address must not hold the connection up until the system's connect timeout
+	netsocket_assert((elapsed < 5000) && "Happy Eyeballs connect took too long");
+	spdlog::info("Connected over {} in {} ms, server sees {}", (socket->getIPAddressFamily() == netsocket::IPAddressFamily::IPv6) ? "IPv6" : "IPv4",
+					elapsed, ReceivePeerAddress(*socket));
+	netsocket::Result result = socket->close();
+	netsocket_assert(result == netsocket::Result::Success);
+}
+
+int main()
+{
+	spdlog::info("NetSocket IPv6 client");
+
+	std::vector<std::pair<std::string, netsocket::IPv4Address>> ipAddresses = netsocket::GetInterfaceIPv4Addresses();
+	std::string ipAddress = netsocket::TrySelectingPhysicalInterfaceIPAddress(ipAddresses, "192.168.1.1");
+	spdlog::info("Selected IP address: {}", ipAddress);
+
+	// Plain IPv4 connection to the dual-stack server
+	{
+		netsocket::Socket mySocket(netsocket::SocketType::Stream,
+									netsocket::IPAddressFamily::IPv4,
+									netsocket::IPProtocol::TCP);
+		spdlog::info("Connecting to {}:{}", ipAddress, gPortNumber);
+		netsocket::Result result = mySocket.connect(ipAddress, gPortNumber);
+		netsocket_assert((result == netsocket::Result::Success) && "Failed to connect");
+		const std::string peerAddress = ReceivePeerAddress(mySocket);
+		spdlog::info("Server sees {}", peerAddress);
+		netsocket_assert((peerAddress == "::ffff:" + ipAddress) && "The server should see an IPv4-mapped address");
+		result = mySocket.close();
+		netsocket_assert(result == netsocket::Result::Success);
+	}
+
+	// 100::1 is in the discard-only prefix (RFC 6666), it stands for a broken IPv6 path that never answers
+	spdlog::info("Racing 100::1, ::1 and {}", ipAddress);
+	ConnectHappyEyeballs({ "100::1", "::1", ipAddress });
+
+	spdlog::info("Racing the addresses of localhost");
+	ConnectHappyEyeballs({ "localhost" });
+
+	return 0;
+}
@@ -0,0 +1,57 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+static constexpr std::string_view gPortNumber = "8000";
+// One plain IPv4 connection and two Happy Eyeballs connections, see the client
+static constexpr u32 gConnectionCount = 3;
+
+int main()
+{
+	spdlog::info("NetSocket IPv6 server");
+
+	for(const auto& [name, address] : netsocket::GetInterfaceIPv6Addresses())
+		spdlog::info("Interface {}: {}", name, address.str());
+
+	// Dual-stack: IPv4 clients are accepted too, they appear as IPv4-mapped addresses (::ffff:a.b.c.d)
+	netsocket::Socket mySocket(netsocket::SocketType::Stream,
+								netsocket::IPAddressFamily::IPv6,
+								netsocket::IPProtocol::TCP);
+	netsocket::Result result = mySocket.setIPv6Only(false);
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to make the socket dual-stack");
+
+	result = mySocket.bind("::", gPortNumber);
+	netsocket_assert(result == netsocket::Result::Success);
+
+	spdlog::info("Listening on [::]:{}", gPortNumber);
+	result = mySocket.listen();
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to listen");
+
+	for(u32 i = 0; i < gConnectionCount; ++i)
+	{
+		spdlog::info("Waiting to accept connection");
+		std::optional<netsocket::Socket> clientSocket = mySocket.accept();
+		netsocket_assert(clientSocket.has_value() && "Failed to accept connection");
+
+		// Tells the client which address it connected from
+		const std::string peerAddress = clientSocket->getPeerAddress();
+		spdlog::info("Accepted connection from {}", peerAddress);
+		bool isSent = clientSocket->send<u32>(static_cast<u32>(peerAddress.size()));
+		netsocket_assert(isSent);
+		result = clientSocket->send(reinterpret_cast<const u8*>(peerAddress.data()), static_cast<u32>(peerAddress.size()));
+		netsocket_assert(result == netsocket::Result::Success);
+
+		std::optional<u8> ack = clientSocket->receive<u8>();
+		netsocket_assert(ack.has_value() && (*ack == 1));
+
+		result = clientSocket->close();
+		netsocket_assert(result == netsocket::Result::Success);
+		spdlog::info("Connection closed successfully");
+	}
+
+	return 0;
+}
@@ -9,6 +9,8 @@
 #include <cstring>
 #include <thread> // for std::thread
 #include <vector> // for std::vector
+#include <mutex> // for std::mutex
+#include <atomic> // for std::atomic
 
 static constexpr std::string_view gPortNumber = "8000";
 
@@ -38,13 +40,20 @@ int main()
     result = mySocket.listen();
     netsocket_assert((result == netsocket::Result::Success) && "Failed to listen");
 
+    constexpr u32 clientCount = 10;
+    std::atomic<u32> servedCount = 0;
+    std::mutex threadsMutex;
     std::vector<std::thread> threads;
-    for(int k = 0; k < 10; ++k)
+
+    // Every accepted connection is handed to its own thread as soon as it arrives, no thread sits in accept()
+    auto executor = [&threadsMutex, &threads](std::function<void()> task)
     {
-        std::unique_ptr<netsocket::WebSocket> _clientSocket = mySocket.accept();
-        auto thread = std::thread([clientSocket = std::move(_clientSocket)]()
+        std::lock_guard<std::mutex> lock(threadsMutex);
+        threads.emplace_back(std::move(task));
+    };
+    spdlog::info("Waiting to accept connections");
+    mySocket.setOnAccept([&servedCount](std::unique_ptr<netsocket::WebSocket> clientSocket)
         {
-            spdlog::info("Waiting to accept connection");
             netsocket_assert(clientSocket && "Failed to accept connection");
             netsocket_assert(clientSocket->isConnected());
     
@@ -53,6 +62,9 @@ int main()
             std::this_thread::sleep_for(std::chrono::duration<float, std::ratio<1, 1>>(2));
             spdlog::info("Starting to send in 2 seconds");
     
+            // Keep at most 64 KB queued inside the WebSocket layer; send() blocks beyond that
+            clientSocket->setSendBufferWatermarks(64 * 1024, 16 * 1024);
+
             netsocket::Result result;
             for(int i = 0; i < 1000; ++i)
             {
@@ -62,16 +74,23 @@ int main()
                 result = clientSocket->send(reinterpret_cast<const u8*>(data), std::strlen(data));
                 netsocket_assert(result == netsocket::Result::Success);
             }
+
+            result = clientSocket->finish(std::chrono::seconds(5));
+            netsocket_assert(result == netsocket::Result::Success);
+            spdlog::info("Send buffer drained, buffered amount: {}", clientSocket->getBufferedAmount());
     
             spdlog::info("Closing client socket in 9 seconds");
             std::this_thread::sleep_for(std::chrono::duration<float, std::ratio<1, 1>>(9));
             result = clientSocket->close();
             netsocket_assert(result == netsocket::Result::Success);
             spdlog::info("Connection closed successfully");
-        });
-        threads.push_back(std::move(thread));
-    }
+            ++servedCount;
+        }, executor);
+
+    while(servedCount < clientCount)
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
+    std::lock_guard<std::mutex> lock(threadsMutex);
     for(auto& thread : threads)
     {
         if(thread.joinable())
@@ -0,0 +1,85 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/listenergroup.hpp>
+#include <netsocket/assert.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <cstdlib> // for std::strtoul
+
+// Accept rate over loopback as the number of SO_REUSEPORT shards grows: client threads open and close connections
+// as fast as they can, every shard closes what it accepts.
+// Usage: listener_group_benchmark [connection count per case, 5000 by default] [client thread count, 4 by default]
+// Every connection leaves a TIME_WAIT entry behind, keep the total under the ephemeral port range
+
+static constexpr std::string_view gIPAddress = "127.0.0.1";
+static constexpr std::string_view gPortNumber = "8003";
+static constexpr u32 gDefaultConnectionCount = 5000;
+static constexpr u32 gDefaultClientThreadCount = 4;
+
+static void RunClient(u32 connectionCount)
+{
+	for(u32 i = 0; i < connectionCount; ++i)
+	{
+		netsocket::Socket socket(netsocket::SocketType::Stream, netsocket::IPAddressFamily::IPv4, netsocket::IPProtocol::TCP);
+		netsocket::Result result = socket.connect(gIPAddress, gPortNumber);
+		netsocket_assert(result == netsocket::Result::Success);
+		// Waits for the server to close, so that the connection was accepted
+		std::optional<u8> value = socket.receive<u8>();
+		netsocket_assert(!value.has_value());
+	}
+}
+
+static void RunBenchmarkCase(u32 shardCount, bool isCpuSteeringEnabled, u32 connectionCount, u32 clientThreadCount)
+{
+	netsocket::ListenerGroupOptions options;
+	options.shardCount = shardCount;
+	options.isCpuSteeringEnabled = isCpuSteeringEnabled;
+	options.isPinnedToCores = isCpuSteeringEnabled;
+	netsocket::ListenerGroup listenerGroup(options);
+	netsocket::Result result = listenerGroup.listen(gIPAddress, gPortNumber);
+	netsocket_assert(result == netsocket::Result::Success);
+	std::atomic<u32> acceptedCount = 0;
+	result = listenerGroup.start([&acceptedCount](netsocket::Socket socket, u32)
+	{
+		socket.close();
+		++acceptedCount;
+	});
+	netsocket_assert(result == netsocket::Result::Success);
+
+	const u32 totalCount = (connectionCount / clientThreadCount) * clientThreadCount;
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> clientThreads;
+	for(u32 i = 0; i < clientThreadCount; ++i)
+		clientThreads.emplace_back(RunClient, connectionCount / clientThreadCount);
+	for(std::thread& thread : clientThreads)
+		thread.join();
+	auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	listenerGroup.stop();
+	netsocket_assert(acceptedCount == totalCount);
+
+	spdlog::info("{:>2} shard(s){:<14} {:>9.0f} accepts/s {:>8.1f} us/accept", listenerGroup.getShardCount(),
+					isCpuSteeringEnabled ? ", CPU steering" : "", totalCount / elapsed, elapsed * 1e6 / totalCount);
+}
+
+int main(int argc, const char* argv[])
+{
+	const u32 connectionCount = (argc > 1) ? static_cast<u32>(std::strtoul(argv[1], NULL, 10)) : gDefaultConnectionCount;
+	const u32 clientThreadCount = (argc > 2) ? static_cast<u32>(std::strtoul(argv[2], NULL, 10)) : gDefaultClientThreadCount;
+	netsocket_assert((clientThreadCount > 0) && (connectionCount >= clientThreadCount));
+	const u32 coreCount = std::max(std::thread::hardware_concurrency(), 1u);
+	spdlog::info("Listener group benchmark, {} connections per case from {} threads over {}:{}, {} cores", connectionCount, clientThreadCount,
+					gIPAddress, gPortNumber, coreCount);
+
+	for(u32 shardCount = 1; shardCount <= std::max(coreCount, 4u); shardCount *= 2)
+		RunBenchmarkCase(shardCount, false, connectionCount, clientThreadCount);
+	if(coreCount > 1)
+		RunBenchmarkCase(coreCount, true, connectionCount, clientThreadCount);
+	return 0;
+}
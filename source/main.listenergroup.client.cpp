@@ -0,0 +1,52 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+#include <cstring> // for std::memcmp
+#include <map>
+
+static constexpr std::string_view gPortNumber = "8000";
+static constexpr u32 gConnectionCount = 32;
+
+int main()
+{
+	spdlog::info("NetSocket listener group client");
+
+	std::vector<std::pair<std::string, netsocket::IPv4Address>> ipAddresses = netsocket::GetInterfaceIPv4Addresses();
+	std::string ipAddress = netsocket::TrySelectingPhysicalInterfaceIPAddress(ipAddresses, "192.168.1.1");
+	spdlog::info("Selected IP address: {}", ipAddress);
+
+	std::map<u32, u32> shardConnectionCounts;
+	for(u32 i = 0; i < gConnectionCount; ++i)
+	{
+		netsocket::Socket mySocket(netsocket::SocketType::Stream,
+									netsocket::IPAddressFamily::IPv4,
+									netsocket::IPProtocol::TCP);
+		netsocket::Result result = mySocket.connect(ipAddress, gPortNumber);
+		netsocket_assert((result == netsocket::Result::Success) && "Failed to connect");
+
+		std::optional<u32> shardIndex = mySocket.receive<u32>();
+		netsocket_assert(shardIndex.has_value());
+		++shardConnectionCounts[*shardIndex];
+
+		constexpr std::string_view refData = "Hello World";
+		char receiveBuffer[refData.size()];
+		result = mySocket.receive(reinterpret_cast<u8*>(receiveBuffer), refData.size());
+		netsocket_assert(result == netsocket::Result::Success);
+		netsocket_assert(std::memcmp(receiveBuffer, refData.data(), refData.size()) == 0);
+		bool isSent = mySocket.send<u32>(static_cast<u32>(refData.size()));
+		netsocket_assert(isSent);
+
+		result = mySocket.close();
+		netsocket_assert(result == netsocket::Result::Success);
+	}
+
+	for(const auto& [shardIndex, count] : shardConnectionCounts)
+		spdlog::info("Shard {} accepted {} connections", shardIndex, count);
+	spdlog::info("All {} connections done", gConnectionCount);
+	return 0;
+}
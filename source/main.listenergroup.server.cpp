@@ -0,0 +1,75 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/listenergroup.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstring> // for std::strlen
+#include <mutex>
+
+static constexpr std::string_view gPortNumber = "8000";
+static constexpr u32 gShardCount = 4;
+static constexpr u32 gConnectionCount = 32;
+
+int main()
+{
+	spdlog::info("NetSocket listener group server");
+
+	std::vector<std::pair<std::string, netsocket::IPv4Address>> ipAddresses = netsocket::GetInterfaceIPv4Addresses();
+	std::string ipAddress = netsocket::TrySelectingPhysicalInterfaceIPAddress(ipAddresses, "192.168.1.1");
+	spdlog::info("Selected IP address: {}", ipAddress);
+
+	netsocket::ListenerGroupOptions options;
+	options.shardCount = gShardCount;
+	netsocket::ListenerGroup listenerGroup(options);
+	netsocket::Result result = listenerGroup.listen(ipAddress, gPortNumber);
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to listen");
+	spdlog::info("Listening on {}:{} with {} shards", ipAddress, gPortNumber, listenerGroup.getShardCount());
+
+	std::array<std::atomic<u32>, gShardCount> connectionCounts { };
+	std::atomic<u32> servedCount = 0;
+	std::mutex mutex;
+	std::condition_variable servedCV;
+	result = listenerGroup.start([&](netsocket::Socket socket, u32 shardIndex)
+	{
+		// Served right here, on the thread of the shard which accepted it
+		bool isSent = socket.send<u32>(shardIndex);
+		netsocket_assert(isSent);
+		const char* data = "Hello World";
+		netsocket::Result result = socket.send(reinterpret_cast<const u8*>(data), std::strlen(data));
+		netsocket_assert(result == netsocket::Result::Success);
+		std::optional<u32> receivedSize = socket.receive<u32>();
+		netsocket_assert(receivedSize.has_value() && (*receivedSize == std::strlen(data)));
+		result = socket.close();
+		netsocket_assert(result == netsocket::Result::Success);
+
+		++connectionCounts[shardIndex];
+		std::lock_guard<std::mutex> lock(mutex);
+		if(++servedCount == gConnectionCount)
+			servedCV.notify_one();
+	});
+	netsocket_assert(result == netsocket::Result::Success);
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		servedCV.wait(lock, [&]() { return servedCount == gConnectionCount; });
+	}
+	listenerGroup.stop();
+
+	u32 busyShardCount = 0;
+	for(u32 i = 0; i < listenerGroup.getShardCount(); ++i)
+	{
+		spdlog::info("Shard {} served {} connections", i, connectionCounts[i].load());
+		busyShardCount += (connectionCounts[i] > 0) ? 1 : 0;
+	}
+	// The kernel hashes the client ports, 32 connections practically never land on a single one of several shards
+	netsocket_assert((busyShardCount >= std::min(listenerGroup.getShardCount(), 2u)) && "The connections weren't spread over the shards");
+	spdlog::info("Served {} connections", servedCount.load());
+	return 0;
+}
@@ -0,0 +1,91 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netasyncsocket.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+#include <vector>
+
+static constexpr std::string_view gPortNumber = "8000";
+static constexpr netsocket::MessageHeader gHeaders[] =
+{
+	netsocket::MessageHeader::U16,
+	netsocket::MessageHeader::U32,
+	netsocket::MessageHeader::U64,
+	netsocket::MessageHeader::VarInt
+};
+// Around the varint length boundaries and the read-ahead buffer size, the empty message comes last and ends the connection
+static constexpr u32 gMessageSizes[] = { 1, 127, 128, 16383, 16384, 100, 65535, 3, 200000, 7, 0 };
+
+static std::vector<u8> CreateMessage(u32 index, u32 size)
+{
+	std::vector<u8> message(size);
+	for(u32 i = 0; i < size; ++i)
+		message[i] = static_cast<u8>((index * 31 + i) & 0xFF);
+	return message;
+}
+
+struct EchoState
+{
+	std::vector<u32> sizes;
+	u32 receivedCount = 0;
+};
+
+int main()
+{
+	spdlog::info("NetSocket message client");
+
+	std::vector<std::pair<std::string, netsocket::IPv4Address>> ipAddresses = netsocket::GetInterfaceIPv4Addresses();
+	std::string ipAddress = netsocket::TrySelectingPhysicalInterfaceIPAddress(ipAddresses, "192.168.1.1");
+	spdlog::info("Selected IP address: {}", ipAddress);
+
+	for(netsocket::MessageHeader header : gHeaders)
+	{
+		netsocket::AsyncSocket mySocket(netsocket::SocketType::Stream,
+										netsocket::IPAddressFamily::IPv4,
+										netsocket::IPProtocol::TCP);
+
+		spdlog::info("Connecting to {}:{}", ipAddress, gPortNumber);
+		netsocket::Result result = mySocket.connect(ipAddress, gPortNumber);
+		netsocket_assert((result == netsocket::Result::Success) && "Failed to connect");
+
+		netsocket::MessageFramingOptions options;
+		options.header = header;
+		options.maxMessageSize = 1024 * 1024;
+		result = mySocket.setMessageFraming(options);
+		netsocket_assert(result == netsocket::Result::Success);
+
+		// The U16 header can't encode the 200000 bytes message
+		EchoState state;
+		for(u32 size : gMessageSizes)
+			if((header != netsocket::MessageHeader::U16) || (size <= 65535))
+				state.sizes.push_back(size);
+		for(u32 i = 0; i < state.sizes.size(); ++i)
+		{
+			std::vector<u8> message = CreateMessage(i, state.sizes[i]);
+			mySocket.sendMessage(message.data(), state.sizes[i]);
+			mySocket.receiveMessage([](const u8* bytes, u32 size, void* userData)
+			{
+				EchoState& state = *reinterpret_cast<EchoState*>(userData);
+				netsocket_assert((bytes != NULL) && "Failed to receive the echo");
+				const u32 index = state.receivedCount++;
+				netsocket_assert(size == state.sizes[index]);
+				netsocket_assert((CreateMessage(index, size) == std::vector<u8>(bytes, bytes + size)) && "Echo is corrupted");
+			}, &state);
+		}
+		result = mySocket.finish();
+		netsocket_assert(result == netsocket::Result::Success);
+		netsocket_assert(state.receivedCount == state.sizes.size());
+		spdlog::info("Received {} echoes, data is correct", state.receivedCount);
+
+		bool isSent = mySocket.getSocket().send<u8>(1);
+		netsocket_assert(isSent);
+		result = mySocket.close();
+		netsocket_assert(result == netsocket::Result::Success);
+		spdlog::info("Connection closed successfully");
+	}
+
+	return 0;
+}
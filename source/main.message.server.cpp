@@ -0,0 +1,78 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/messagesocket.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+#include <vector>
+
+static constexpr std::string_view gPortNumber = "8000";
+// One connection per header type, the client connects in the same order
+static constexpr netsocket::MessageHeader gHeaders[] =
+{
+	netsocket::MessageHeader::U16,
+	netsocket::MessageHeader::U32,
+	netsocket::MessageHeader::U64,
+	netsocket::MessageHeader::VarInt
+};
+
+int main()
+{
+	spdlog::info("NetSocket message server");
+
+	std::vector<std::pair<std::string, netsocket::IPv4Address>> ipAddresses = netsocket::GetInterfaceIPv4Addresses();
+	std::string ipAddress = netsocket::TrySelectingPhysicalInterfaceIPAddress(ipAddresses, "192.168.1.1");
+	spdlog::info("Selected IP address: {}", ipAddress);
+
+	netsocket::Socket mySocket(netsocket::SocketType::Stream,
+								netsocket::IPAddressFamily::IPv4,
+								netsocket::IPProtocol::TCP);
+
+	netsocket::Result result = mySocket.bind(ipAddress, gPortNumber);
+	netsocket_assert(result == netsocket::Result::Success);
+
+	spdlog::info("Listening on {}:{}", ipAddress, gPortNumber);
+	result = mySocket.listen();
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to listen");
+
+	for(netsocket::MessageHeader header : gHeaders)
+	{
+		spdlog::info("Waiting to accept connection");
+		std::optional<netsocket::Socket> clientSocket = mySocket.accept();
+		netsocket_assert(clientSocket.has_value() && "Failed to accept connection");
+
+		netsocket::MessageFramingOptions options;
+		options.header = header;
+		options.maxMessageSize = 1024 * 1024;
+		netsocket::MessageSocket messageSocket(*clientSocket, options);
+
+		// Echoes every message back until the empty one which ends the connection
+		std::vector<u8> message;
+		u32 messageCount = 0;
+		do
+		{
+			result = messageSocket.receiveMessage(message);
+			netsocket_assert(result == netsocket::Result::Success);
+			result = messageSocket.sendMessage(message.data(), static_cast<u32>(message.size()));
+			netsocket_assert(result == netsocket::Result::Success);
+			++messageCount;
+		} while(!message.empty());
+		spdlog::info("Echoed {} messages", messageCount);
+
+		// Refused before anything is sent
+		std::vector<u8> largeMessage(messageSocket.getMaxMessageSize() + 1u);
+		result = messageSocket.sendMessage(largeMessage.data(), static_cast<u32>(largeMessage.size()));
+		netsocket_assert(result == netsocket::Result::Failed);
+
+		std::optional<u8> ack = clientSocket->receive<u8>();
+		netsocket_assert(ack.has_value() && (*ack == 1));
+		result = clientSocket->close();
+		netsocket_assert(result == netsocket::Result::Success);
+		spdlog::info("Connection closed successfully");
+	}
+
+	return 0;
+}
@@ -0,0 +1,102 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/multicast.hpp>
+#include <netsocket/assert.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <algorithm> // for std::min
+#include <cstdlib> // for std::strtoul
+
+// Multicast throughput over the loopback interface: datagrams published one per send versus in batches (sendmmsg on Linux),
+// received in batches by a subscriber in this process. UDP has no flow control, datagrams the subscriber can't keep up with are dropped
+// and reported as lost.
+// Usage: multicast_benchmark [datagram count per case, 1000000 by default]
+
+static constexpr std::string_view gGroup = "239.255.42.2";
+static constexpr std::string_view gPort = "8002";
+static constexpr std::string_view gInterface = "127.0.0.1";
+static constexpr u32 gDefaultDatagramCount = 1000000;
+// The subscriber is done once nothing arrived for this many milliseconds after the publisher finished
+static constexpr s32 gDrainTimeout = 200;
+
+struct BenchmarkCase
+{
+	std::string_view name;
+	u32 datagramSize;
+	// 1 publishes the datagrams one by one
+	u32 publishBatchSize;
+};
+
+static void RunBenchmarkCase(const BenchmarkCase& benchmarkCase, u32 datagramCount)
+{
+	netsocket::MulticastOptions options;
+	options.networkInterface = gInterface;
+	options.batchSize = 64;
+	options.maxDatagramSize = benchmarkCase.datagramSize;
+	netsocket::MulticastSubscriber subscriber(gGroup, gPort, options);
+	netsocket_assert(subscriber.isValid());
+	netsocket::MulticastPublisher publisher(gGroup, gPort, options);
+	netsocket_assert(publisher.isValid());
+
+	std::atomic<bool> isPublishing = true;
+	u64 receivedCount = 0;
+	u64 batchCount = 0;
+	std::thread subscriberThread([&]()
+	{
+		while(true)
+		{
+			auto batch = subscriber.receiveBatch(gDrainTimeout);
+			netsocket_assert(batch.has_value());
+			if(batch->empty())
+			{
+				if(!isPublishing)
+					break;
+				continue;
+			}
+			receivedCount += batch->size();
+			++batchCount;
+		}
+	});
+
+	std::vector<u8> data(benchmarkCase.datagramSize, 0x5A);
+	std::vector<netsocket::SocketBuffer> datagrams(benchmarkCase.publishBatchSize, netsocket::SocketBuffer { data.data(), benchmarkCase.datagramSize });
+	auto start = std::chrono::steady_clock::now();
+	for(u32 sentCount = 0; sentCount < datagramCount; sentCount += benchmarkCase.publishBatchSize)
+	{
+		netsocket::Result result = publisher.publishBatch(datagrams.data(), std::min(benchmarkCase.publishBatchSize, datagramCount - sentCount));
+		netsocket_assert(result == netsocket::Result::Success);
+	}
+	auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	isPublishing = false;
+	subscriberThread.join();
+
+	spdlog::info("{:<28} {:>11.0f} datagrams/s {:>9.1f} MB/s, {:>5.2f}% lost, {:>5.1f} datagrams per receive", benchmarkCase.name,
+					datagramCount / elapsed, datagramCount * static_cast<double>(benchmarkCase.datagramSize) / elapsed / 1e6,
+					100.0 * static_cast<double>(datagramCount - receivedCount) / datagramCount,
+					(batchCount > 0) ? static_cast<double>(receivedCount) / batchCount : 0.0);
+}
+
+int main(int argc, const char* argv[])
+{
+	const u32 datagramCount = (argc > 1) ? static_cast<u32>(std::strtoul(argv[1], NULL, 10)) : gDefaultDatagramCount;
+	netsocket_assert(datagramCount > 0);
+	spdlog::info("Multicast benchmark, {} datagrams per case to {}:{} on {}", datagramCount, gGroup, gPort, gInterface);
+
+	const BenchmarkCase cases[] =
+	{
+		{ "64 bytes, one per send", 64, 1 },
+		{ "64 bytes, batches of 32", 64, 32 },
+		{ "1024 bytes, one per send", 1024, 1 },
+		{ "1024 bytes, batches of 32", 1024, 32 }
+	};
+	for(const BenchmarkCase& benchmarkCase : cases)
+		RunBenchmarkCase(benchmarkCase, datagramCount);
+	return 0;
+}
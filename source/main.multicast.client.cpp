@@ -0,0 +1,85 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/multicast.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+#include "multicasttestconfig.hpp"
+
+#include <cstring> // for std::memcpy
+#include <vector>
+
+static constexpr std::string_view gPortNumber = "8000";
+
+int main()
+{
+	spdlog::info("NetSocket multicast client (publisher)");
+
+	std::vector<std::pair<std::string, netsocket::IPv4Address>> ipAddresses = netsocket::GetInterfaceIPv4Addresses();
+	std::string ipAddress = netsocket::TrySelectingPhysicalInterfaceIPAddress(ipAddresses, "192.168.1.1");
+	spdlog::info("Selected IP address: {}", ipAddress);
+
+	// Control connection, the server has joined the group once it accepts
+	netsocket::Socket controlSocket(netsocket::SocketType::Stream,
+									netsocket::IPAddressFamily::IPv4,
+									netsocket::IPProtocol::TCP);
+	spdlog::info("Connecting to {}:{}", ipAddress, gPortNumber);
+	netsocket::Result result = controlSocket.connect(ipAddress, gPortNumber);
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to connect");
+
+	netsocket::MulticastOptions options;
+	options.networkInterface = gMulticastInterface;
+	// The subscriber runs on this host
+	options.isLoopbackEnabled = true;
+	netsocket::MulticastPublisher publisher(gMulticastGroup, gMulticastPort, options);
+	netsocket_assert(publisher.isValid() && "Failed to create the multicast publisher");
+	spdlog::info("Publishing to {}:{} on {}", gMulticastGroup, gMulticastPort, gMulticastInterface);
+
+	std::vector<u8> data(static_cast<std::size_t>(gMulticastRoundSize) * gMulticastDatagramSize);
+	std::vector<netsocket::SocketBuffer> datagrams(gMulticastRoundSize);
+	u32 sequence = 0;
+	for(u32 round = 0; round < gMulticastRoundCount; ++round)
+	{
+		for(u32 i = 0; i < gMulticastRoundSize; ++i, ++sequence)
+		{
+			u8* datagram = data.data() + static_cast<std::size_t>(i) * gMulticastDatagramSize;
+			std::memcpy(datagram, &sequence, sizeof(sequence));
+			for(u32 j = sizeof(sequence); j < gMulticastDatagramSize; ++j)
+				datagram[j] = GetMulticastTestByte(sequence, j);
+			datagrams[i] = { datagram, gMulticastDatagramSize };
+		}
+		// Half the rounds datagram by datagram, the other half in one batch
+		if((round % 2) == 0)
+		{
+			for(const netsocket::SocketBuffer& datagram : datagrams)
+			{
+				result = publisher.publish(datagram.bytes, datagram.size);
+				netsocket_assert(result == netsocket::Result::Success);
+			}
+		}
+		else
+		{
+			result = publisher.publishBatch(datagrams.data(), gMulticastRoundSize);
+			netsocket_assert(result == netsocket::Result::Success);
+		}
+		std::optional<u8> ack = controlSocket.receive<u8>();
+		netsocket_assert(ack.has_value() && (*ack == 1) && "The server didn't receive the round");
+	}
+	spdlog::info("Published {} datagrams", sequence);
+
+	// The server has left the group, this one must not reach it
+	std::optional<u8> ack = controlSocket.receive<u8>();
+	netsocket_assert(ack.has_value() && (*ack == 2));
+	result = publisher.publish(data.data(), gMulticastDatagramSize);
+	netsocket_assert(result == netsocket::Result::Success);
+	ack = controlSocket.receive<u8>();
+	netsocket_assert(ack.has_value() && (*ack == 3) && "The server still received the group's datagrams");
+
+	result = controlSocket.close();
+	netsocket_assert(result == netsocket::Result::Success);
+	spdlog::info("Connection closed successfully");
+	return 0;
+}
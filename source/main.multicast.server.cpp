@@ -0,0 +1,87 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/multicast.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+#include "multicasttestconfig.hpp"
+
+#include <cstring> // for std::memcpy
+#include <algorithm> // for std::max
+
+static constexpr std::string_view gPortNumber = "8000";
+// Loopback doesn't lose datagrams, a round which doesn't arrive within this many milliseconds fails the test
+static constexpr s32 gReceiveTimeout = 5000;
+
+int main()
+{
+	spdlog::info("NetSocket multicast server (subscriber)");
+
+	std::vector<std::pair<std::string, netsocket::IPv4Address>> ipAddresses = netsocket::GetInterfaceIPv4Addresses();
+	std::string ipAddress = netsocket::TrySelectingPhysicalInterfaceIPAddress(ipAddresses, "192.168.1.1");
+	spdlog::info("Selected IP address: {}", ipAddress);
+
+	netsocket::MulticastOptions options;
+	options.networkInterface = gMulticastInterface;
+	options.batchSize = 32;
+	netsocket::MulticastSubscriber subscriber(gMulticastGroup, gMulticastPort, options);
+	netsocket_assert(subscriber.isValid() && "Failed to join the multicast group");
+	spdlog::info("Joined {}:{} on {}", gMulticastGroup, gMulticastPort, gMulticastInterface);
+
+	netsocket::Socket mySocket(netsocket::SocketType::Stream,
+								netsocket::IPAddressFamily::IPv4,
+								netsocket::IPProtocol::TCP);
+	netsocket::Result result = mySocket.bind(ipAddress, gPortNumber);
+	netsocket_assert(result == netsocket::Result::Success);
+	result = mySocket.listen();
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to listen");
+	spdlog::info("Waiting to accept connection");
+	std::optional<netsocket::Socket> clientSocket = mySocket.accept();
+	netsocket_assert(clientSocket.has_value() && "Failed to accept connection");
+
+	u32 expectedSequence = 0;
+	u32 batchCount = 0;
+	u32 largestBatch = 0;
+	for(u32 round = 0; round < gMulticastRoundCount; ++round)
+	{
+		const u32 roundEnd = expectedSequence + gMulticastRoundSize;
+		while(expectedSequence < roundEnd)
+		{
+			auto batch = subscriber.receiveBatch(gReceiveTimeout);
+			netsocket_assert(batch.has_value() && !batch->empty() && "Failed to receive the datagrams");
+			++batchCount;
+			largestBatch = std::max(largestBatch, static_cast<u32>(batch->size()));
+			for(const netsocket::SocketDatagram& datagram : *batch)
+			{
+				netsocket_assert((datagram.size == gMulticastDatagramSize) && !datagram.isTruncated);
+				u32 sequence;
+				std::memcpy(&sequence, datagram.bytes, sizeof(sequence));
+				netsocket_assert((sequence == expectedSequence) && "Datagram lost or out of order");
+				for(u32 j = sizeof(sequence); j < datagram.size; ++j)
+					netsocket_assert((datagram.bytes[j] == GetMulticastTestByte(sequence, j)) && "Datagram is corrupted");
+				++expectedSequence;
+			}
+		}
+		bool isSent = clientSocket->send<u8>(1);
+		netsocket_assert(isSent);
+	}
+	spdlog::info("Received {} datagrams in {} batches, up to {} per batch", expectedSequence, batchCount, largestBatch);
+
+	result = subscriber.leave(gMulticastGroup);
+	netsocket_assert(result == netsocket::Result::Success);
+	bool isSent = clientSocket->send<u8>(2);
+	netsocket_assert(isSent);
+	auto batch = subscriber.receiveBatch(500);
+	netsocket_assert(batch.has_value() && batch->empty() && "Received a datagram after leaving the group");
+	spdlog::info("Left the group, no more datagrams");
+	isSent = clientSocket->send<u8>(3);
+	netsocket_assert(isSent);
+
+	std::optional<u8> end = clientSocket->receive<u8>();
+	netsocket_assert(!end.has_value());
+	spdlog::info("Connection closed successfully");
+	return 0;
+}
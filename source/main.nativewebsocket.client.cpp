@@ -0,0 +1,95 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/nativewebsocket.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+#include <cstring> // for std::memcmp
+#include <vector>
+
+static constexpr std::string_view gPortNumber = "8000";
+static constexpr u32 gStreamChunkSize = 64 * 1024;
+
+int main()
+{
+    spdlog::info("NetSocket-NativeWebSocket client");
+
+        std::vector<std::pair<std::string, netsocket::IPv4Address>> ipAddresses = netsocket::GetInterfaceIPv4Addresses();
+        spdlog::info("Following IPv4 Addresses have been assigned to interfaces on this machine:");
+        for(std::uint32_t index = 0; const auto& pair : ipAddresses)
+        {
+                const auto ipAddress = pair.second;
+                spdlog::info("\t[{}] {} -> {}.{}.{}.{}", index, pair.first, ipAddress[0], ipAddress[1], ipAddress[2], ipAddress[3]);
+                ++index;
+        }
+
+        std::string ipAddress = netsocket::TrySelectingPhysicalInterfaceIPAddress(ipAddresses, "192.168.1.1");
+
+        spdlog::info("Selected IP address: {}", ipAddress);
+
+        std::string ipAddress2 = netsocket::GetIPv4Address("192.168.1.1");
+        spdlog::info("TEST: netsocket::GetIPv4Address() = {}", ipAddress2);
+
+    netsocket::NativeWebSocket mySocket;
+
+    spdlog::info("Connecting to {}:{}", ipAddress, gPortNumber);
+    netsocket::Result result = mySocket.connect(ipAddress, gPortNumber, netsocket::WebSocketCompressionOptions::Enabled());
+    netsocket_assert((result == netsocket::Result::Success) && "Failed to connect");
+
+    mySocket.setOnDisconnect([](netsocket::NativeWebSocket&)
+    {
+        spdlog::info("OnDisconnect callback: socket has been closed");
+    });
+
+    spdlog::info("Connection successful");
+
+    spdlog::info("Starting to receive in 5 seconds");
+    std::this_thread::sleep_for(std::chrono::duration<float, std::ratio<1, 1>>(5));
+
+    for(int i = 0; i < 1000; ++i)
+    {
+        spdlog::info("Receiving Data...");
+
+        constexpr const char* refData = "Hello World";
+        constexpr u32 refDataLen = std::strlen(refData);
+        char receiveBuffer[refDataLen];
+        result = mySocket.receive(reinterpret_cast<u8*>(receiveBuffer), refDataLen);
+        netsocket_assert(result == netsocket::Result::Success);
+        bool isEqual = std::memcmp(receiveBuffer, refData, refDataLen) == 0;
+        netsocket_assert(isEqual);
+        std::optional<u32> value = mySocket.receive<u32>();
+        netsocket_assert(value.has_value());
+        netsocket_assert(*value == static_cast<u32>(i));
+        spdlog::info("Received data is correct {}", i);
+        bool isSuccess = mySocket.send<u32>(*value);
+        netsocket_assert(isSuccess);
+        spdlog::info("Echoed success");
+    }
+
+    spdlog::info("Receiving a streamed message");
+    std::vector<u8> chunk(gStreamChunkSize);
+    u32 streamedSize = 0;
+    while(true)
+    {
+        std::optional<netsocket::WebSocketChunk> info = mySocket.receiveChunk(chunk.data(), gStreamChunkSize);
+        netsocket_assert(info.has_value());
+        for(u32 i = 0; i < info->size; ++i)
+            netsocket_assert(chunk[i] == static_cast<u8>(streamedSize + i));
+        streamedSize += info->size;
+        if(info->isFinal)
+            break;
+    }
+    spdlog::info("Received {} bytes in chunks", streamedSize);
+    bool isSent = mySocket.send<u32>(streamedSize);
+    netsocket_assert(isSent);
+
+    spdlog::info("Closing connection in 5 seconds");
+    std::this_thread::sleep_for(std::chrono::duration<float, std::ratio<1, 1>>(5));
+    result = mySocket.close();
+    netsocket_assert(result == netsocket::Result::Success);
+    spdlog::info("Connection closed successfully");
+
+    return 0;
+}
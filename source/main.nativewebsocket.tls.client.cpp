@@ -0,0 +1,54 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/nativewebsocket.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+#include "tlstestcredentials.hpp"
+
+#include <cstring> // for std::memcmp
+
+static constexpr std::string_view gPortNumber = "8000";
+static constexpr u32 gConnectionCount = 2;
+
+int main()
+{
+	spdlog::info("NetSocket-NativeWebSocket TLS (wss://) client");
+
+	std::vector<std::pair<std::string, netsocket::IPv4Address>> ipAddresses = netsocket::GetInterfaceIPv4Addresses();
+	std::string ipAddress = netsocket::TrySelectingPhysicalInterfaceIPAddress(ipAddresses, "192.168.1.1");
+	spdlog::info("Selected IP address: {}", ipAddress);
+
+	// The server's certificate is self-signed, so it is its own trust anchor.
+	// "localhost" is the name in the certificate, whatever address the server is reached at
+	netsocket::WebSocketTlsOptions tlsOptions;
+	tlsOptions.isEnabled = true;
+	tlsOptions.caFile = WriteTestCredentialFile("netsocket_test_ca.pem", gTestCertificate);
+	tlsOptions.serverName = "localhost";
+
+	// The same socket reconnects: it keeps the TLS context created on the first connection, so the second one resumes its session
+	netsocket::NativeWebSocket mySocket;
+	for(u32 i = 0; i < gConnectionCount; ++i)
+	{
+		spdlog::info("Connecting to wss://{}:{}", ipAddress, gPortNumber);
+		netsocket::Result result = mySocket.connect(ipAddress, gPortNumber, netsocket::WebSocketCompressionOptions::Enabled(), tlsOptions);
+		netsocket_assert((result == netsocket::Result::Success) && "Failed to connect");
+		spdlog::info("Connection successful, TLS session resumed: {}", mySocket.isTlsSessionResumed());
+		netsocket_assert((mySocket.isTlsSessionResumed() == (i > 0)) && "Reconnecting should resume the session");
+
+		constexpr std::string_view refData = "Hello World";
+		char receiveBuffer[refData.size()];
+		result = mySocket.receive(reinterpret_cast<u8*>(receiveBuffer), refData.size());
+		netsocket_assert(result == netsocket::Result::Success);
+		netsocket_assert(std::memcmp(receiveBuffer, refData.data(), refData.size()) == 0);
+		spdlog::info("Received data is correct");
+		bool isSent = mySocket.send<u32>(static_cast<u32>(refData.size()));
+		netsocket_assert(isSent);
+
+		mySocket.close();
+		spdlog::info("Connection closed successfully");
+	}
+	return 0;
+}
@@ -0,0 +1,60 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/nativewebsocket.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+#include "tlstestcredentials.hpp"
+
+#include <cstring> // for std::strlen
+
+static constexpr std::string_view gPortNumber = "8000";
+// The client reconnects once, resuming the TLS session of its first connection
+static constexpr u32 gConnectionCount = 2;
+
+int main()
+{
+	spdlog::info("NetSocket-NativeWebSocket TLS (wss://) server");
+
+	std::vector<std::pair<std::string, netsocket::IPv4Address>> ipAddresses = netsocket::GetInterfaceIPv4Addresses();
+	std::string ipAddress = netsocket::TrySelectingPhysicalInterfaceIPAddress(ipAddresses, "192.168.1.1");
+	spdlog::info("Selected IP address: {}", ipAddress);
+
+	netsocket::WebSocketTlsOptions tlsOptions;
+	tlsOptions.isEnabled = true;
+	tlsOptions.certificateFile = WriteTestCredentialFile("netsocket_test_certificate.pem", gTestCertificate);
+	tlsOptions.privateKeyFile = WriteTestCredentialFile("netsocket_test_private_key.pem", gTestPrivateKey);
+
+	netsocket::NativeWebSocket mySocket;
+	netsocket::Result result = mySocket.bind(ipAddress, gPortNumber, netsocket::WebSocketCompressionOptions::Enabled(), tlsOptions);
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to bind");
+
+	spdlog::info("Listening on wss://{}:{}", ipAddress, gPortNumber);
+	result = mySocket.listen();
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to listen");
+
+	for(u32 i = 0; i < gConnectionCount; ++i)
+	{
+		spdlog::info("Waiting to accept connection");
+		std::unique_ptr<netsocket::NativeWebSocket> clientSocket = mySocket.accept();
+		netsocket_assert(clientSocket && "Failed to accept connection");
+		netsocket_assert(clientSocket->isTls());
+		spdlog::info("Connection accepted, TLS session resumed: {}", clientSocket->isTlsSessionResumed());
+		netsocket_assert((clientSocket->isTlsSessionResumed() == (i > 0)) && "Only the first connection should perform a full handshake");
+
+		const char* data = "Hello World";
+		result = clientSocket->send(reinterpret_cast<const u8*>(data), std::strlen(data));
+		netsocket_assert(result == netsocket::Result::Success);
+		std::optional<u32> receivedSize = clientSocket->receive<u32>();
+		netsocket_assert(receivedSize.has_value() && (*receivedSize == std::strlen(data)));
+		spdlog::info("Client acknowledged {} bytes", *receivedSize);
+
+		clientSocket->close();
+		spdlog::info("Connection closed successfully");
+	}
+
+	mySocket.close();
+	return 0;
+}
@@ -0,0 +1,100 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/netasyncsocket.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+#include "ratelimittestconfig.hpp"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+static netsocket::Socket Connect(const std::string& ipAddress, const netsocket::SocketOptions& options = { })
+{
+	netsocket::Socket socket(netsocket::SocketType::Stream, netsocket::IPAddressFamily::IPv4, netsocket::IPProtocol::TCP, options);
+	netsocket::Result result = socket.connect(ipAddress, gRateLimitTcpPortNumber);
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to connect");
+	return socket;
+}
+
+static void SendPhase(netsocket::Socket& socket, const std::vector<u8>& message)
+{
+	for(u32 i = 0; i < (gRateLimitPhaseSize / gRateLimitMessageSize); ++i)
+	{
+		netsocket::Result result = socket.send(message.data(), gRateLimitMessageSize);
+		netsocket_assert(result == netsocket::Result::Success);
+	}
+	netsocket::Result result = socket.close();
+	netsocket_assert(result == netsocket::Result::Success);
+}
+
+int main()
+{
+	spdlog::info("NetSocket rate limit client");
+
+	std::vector<std::pair<std::string, netsocket::IPv4Address>> ipAddresses = netsocket::GetInterfaceIPv4Addresses();
+	std::string ipAddress = netsocket::TrySelectingPhysicalInterfaceIPAddress(ipAddresses, "192.168.1.1");
+	spdlog::info("Selected IP address: {}", ipAddress);
+
+	std::vector<u8> message(gRateLimitMessageSize);
+	for(u32 i = 0; i < gRateLimitMessageSize; ++i)
+		message[i] = static_cast<u8>(i);
+
+	// The calls return at once, the transaction thread paces the sends
+	{
+		netsocket::AsyncSocket socket(Connect(ipAddress));
+		netsocket::Result result = socket.setSendRateLimit({ gRateLimit });
+		netsocket_assert(result == netsocket::Result::Success);
+		const auto start = std::chrono::steady_clock::now();
+		for(u32 i = 0; i < (gRateLimitPhaseSize / gRateLimitMessageSize); ++i)
+			socket.send(message.data(), gRateLimitMessageSize);
+		const auto queueTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+		result = socket.finish();
+		netsocket_assert(result == netsocket::Result::Success);
+		spdlog::info("AsyncSocket phase queued in {} ms, sent in {} ms", queueTime,
+						std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+		socket.close();
+	}
+
+	// Another thread raises the limit while this one sends
+	{
+		netsocket::Socket socket = Connect(ipAddress);
+		netsocket::Result result = socket.setSendRateLimit({ gRateLimit / 2 });
+		netsocket_assert(result == netsocket::Result::Success);
+		std::thread raisingThread([&socket]()
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(gRateLimitPhaseSize / 2 * 1000 / (gRateLimit / 2)));
+			netsocket::Result result = socket.setSendRateLimit({ gRateLimit * gRateLimitRaiseFactor });
+			netsocket_assert(result == netsocket::Result::Success);
+		});
+		SendPhase(socket, message);
+		raisingThread.join();
+		netsocket_assert(socket.getSendRateLimit().rate == (gRateLimit * gRateLimitRaiseFactor));
+	}
+
+	{
+		netsocket::SocketOptions options;
+		options.maxPacingRate = gRateLimit;
+		netsocket::Socket socket = Connect(ipAddress, options);
+		netsocket::SocketOptions effectiveOptions = socket.getOptions();
+		netsocket_assert(effectiveOptions.maxPacingRate.has_value() && (*effectiveOptions.maxPacingRate == gRateLimit));
+		SendPhase(socket, message);
+	}
+	spdlog::info("TCP phases done");
+
+	netsocket::Socket datagramSocket(netsocket::SocketType::Datagram, netsocket::IPAddressFamily::IPv4, netsocket::IPProtocol::UDP);
+	netsocket::Result result = datagramSocket.connect(ipAddress, gRateLimitUdpPortNumber);
+	netsocket_assert(result == netsocket::Result::Success);
+	result = datagramSocket.setSendRateLimit({ gRateLimit });
+	netsocket_assert(result == netsocket::Result::Success);
+	// All of them in one call, the rate limiter splits the batch
+	std::vector<netsocket::SocketBuffer> datagrams(gRateLimitPhaseSize / gRateLimitDatagramSize, { message.data(), gRateLimitDatagramSize });
+	result = datagramSocket.sendDatagrams(datagrams.data(), static_cast<u32>(datagrams.size()));
+	netsocket_assert(result == netsocket::Result::Success);
+	spdlog::info("{} datagrams sent", datagrams.size());
+	return 0;
+}
@@ -0,0 +1,131 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+#include "ratelimittestconfig.hpp"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double GetSeconds(Clock::duration duration)
+{
+	return std::chrono::duration<double>(duration).count();
+}
+
+// Time it takes the bytes to arrive, from the first one on (the first burst arrives at once)
+static double ReceivePhase(netsocket::Socket& socket)
+{
+	std::vector<u8> buffer(gRateLimitMessageSize);
+	u32 receivedSize = 0;
+	Clock::time_point start;
+	while(std::optional<u32> size = socket.receiveSome(buffer.data(), static_cast<u32>(buffer.size())))
+	{
+		if(receivedSize == 0)
+			start = Clock::now();
+		receivedSize += *size;
+	}
+	netsocket_assert((receivedSize == gRateLimitPhaseSize) && "Bytes are missing");
+	return GetSeconds(Clock::now() - start);
+}
+
+// Counts the datagrams, until none arrives for a second
+static void ReceiveDatagrams(netsocket::Socket& socket, u32& receivedCount, double& duration)
+{
+	constexpr u32 batchSize = 64;
+	std::vector<u8> buffer(batchSize * gRateLimitDatagramSize);
+	netsocket::SocketDatagram datagrams[batchSize];
+	for(u32 i = 0; i < batchSize; ++i)
+		datagrams[i] = { buffer.data() + i * gRateLimitDatagramSize, gRateLimitDatagramSize, 0, false };
+	Clock::time_point start;
+	Clock::time_point end;
+	receivedCount = 0;
+	while(true)
+	{
+		std::optional<u32> count = socket.receiveDatagrams(datagrams, batchSize, (receivedCount == 0) ? 30000 : 1000);
+		netsocket_assert(count.has_value());
+		if(*count == 0)
+			break;
+		if(receivedCount == 0)
+			start = Clock::now();
+		end = Clock::now();
+		receivedCount += *count;
+	}
+	duration = GetSeconds(end - start);
+}
+
+int main()
+{
+	spdlog::info("NetSocket rate limit server");
+
+	std::vector<std::pair<std::string, netsocket::IPv4Address>> ipAddresses = netsocket::GetInterfaceIPv4Addresses();
+	std::string ipAddress = netsocket::TrySelectingPhysicalInterfaceIPAddress(ipAddresses, "192.168.1.1");
+	spdlog::info("Selected IP address: {}", ipAddress);
+
+	netsocket::Socket datagramSocket(netsocket::SocketType::Datagram, netsocket::IPAddressFamily::IPv4, netsocket::IPProtocol::UDP);
+	netsocket::SocketOptions datagramOptions;
+	// Room for the whole phase, in case this thread is slow to pick the datagrams up
+	datagramOptions.receiveBufferSize = 2 * gRateLimitPhaseSize;
+	datagramSocket.setOptions(datagramOptions);
+	netsocket::Result result = datagramSocket.bind(ipAddress, gRateLimitUdpPortNumber);
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to bind the datagram socket");
+	u32 datagramCount = 0;
+	double datagramDuration = 0;
+	std::thread datagramThread(ReceiveDatagrams, std::ref(datagramSocket), std::ref(datagramCount), std::ref(datagramDuration));
+
+	netsocket::Socket listeningSocket(netsocket::SocketType::Stream, netsocket::IPAddressFamily::IPv4, netsocket::IPProtocol::TCP);
+	result = listeningSocket.bind(ipAddress, gRateLimitTcpPortNumber);
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to bind");
+	result = listeningSocket.listen();
+	netsocket_assert(result == netsocket::Result::Success);
+	spdlog::info("Listening on {}:{} (TCP) and {}:{} (UDP), limit of {} bytes per second", ipAddress, gRateLimitTcpPortNumber,
+					ipAddress, gRateLimitUdpPortNumber, gRateLimit);
+
+	// Without the limit the phases would take a few milliseconds over loopback
+	const double expectedDuration = static_cast<double>(gRateLimitPhaseSize) / gRateLimit;
+	for(u32 i = 0; i < static_cast<u32>(RateLimitPhase::Count); ++i)
+	{
+		std::optional<netsocket::Socket> socket = listeningSocket.accept();
+		netsocket_assert(socket.has_value());
+		const double duration = ReceivePhase(*socket);
+		switch(static_cast<RateLimitPhase>(i))
+		{
+			case RateLimitPhase::AsyncSocket:
+			{
+				spdlog::info("AsyncSocket token bucket: {} bytes in {:.3f} s, {:.2f} MiB/s", gRateLimitPhaseSize, duration,
+								gRateLimitPhaseSize / duration / (1024 * 1024));
+				netsocket_assert((duration > (0.8 * expectedDuration)) && (duration < (1.5 * expectedDuration)));
+				break;
+			}
+			case RateLimitPhase::RaisedAtRuntime:
+			{
+				// Half of the phase at half the rate, then the rest much faster
+				spdlog::info("Token bucket raised at runtime: {} bytes in {:.3f} s", gRateLimitPhaseSize, duration);
+				netsocket_assert((duration > (0.8 * expectedDuration)) && (duration < (1.6 * expectedDuration)));
+				break;
+			}
+			case RateLimitPhase::KernelPacing:
+			{
+				// The kernel doesn't pace every device (e.g. loopback with some kernels), so this one isn't checked
+				spdlog::info("Kernel pacing (SO_MAX_PACING_RATE): {} bytes in {:.3f} s, {:.2f} MiB/s", gRateLimitPhaseSize, duration,
+								gRateLimitPhaseSize / duration / (1024 * 1024));
+				break;
+			}
+			default:
+				break;
+		}
+	}
+
+	datagramThread.join();
+	const u32 expectedDatagramCount = gRateLimitPhaseSize / gRateLimitDatagramSize;
+	spdlog::info("Datagram token bucket: {} of {} datagrams in {:.3f} s", datagramCount, expectedDatagramCount, datagramDuration);
+	netsocket_assert(datagramCount >= (expectedDatagramCount * 9 / 10));
+	netsocket_assert((datagramDuration > (0.8 * expectedDuration)) && (datagramDuration < (1.5 * expectedDuration)));
+	return 0;
+}
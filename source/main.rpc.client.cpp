@@ -0,0 +1,142 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/rpc.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring> // for std::memcpy
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+static constexpr std::string_view gPortNumber = "8000";
+
+static constexpr u32 gEchoMethod = 1;
+static constexpr u32 gDelayedEchoMethod = 2;
+static constexpr u32 gIgnoredMethod = 3;
+static constexpr u32 gFailingMethod = 4;
+static constexpr u32 gShutdownMethod = 5;
+static constexpr u32 gUnknownMethod = 99;
+
+// Number of echo calls in flight at once on the connection
+static constexpr u32 gPipelinedCallCount = 10000;
+
+// Counts completed calls, so that the main thread can wait for all of them
+class CompletionCounter
+{
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	u32 m_count = 0;
+
+public:
+	void increment()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			++m_count;
+		}
+		m_cv.notify_all();
+	}
+	void wait(u32 count)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cv.wait(lock, [this, count] { return m_count >= count; });
+	}
+};
+
+int main()
+{
+	spdlog::info("NetSocket RPC client");
+
+	std::vector<std::pair<std::string, netsocket::IPv4Address>> ipAddresses = netsocket::GetInterfaceIPv4Addresses();
+	std::string ipAddress = netsocket::TrySelectingPhysicalInterfaceIPAddress(ipAddresses, "192.168.1.1");
+	spdlog::info("Selected IP address: {}", ipAddress);
+
+	netsocket::Socket mySocket(netsocket::SocketType::Stream,
+								netsocket::IPAddressFamily::IPv4,
+								netsocket::IPProtocol::TCP);
+
+	spdlog::info("Connecting to {}:{}", ipAddress, gPortNumber);
+	netsocket::Result result = mySocket.connect(ipAddress, gPortNumber);
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to connect");
+	mySocket.setTCPNoDelay();
+
+	netsocket::RpcChannel channel(mySocket);
+	result = channel.start();
+	netsocket_assert(result == netsocket::Result::Success);
+
+	// Pipelined: all the calls are sent before the first response is waited for
+	{
+		CompletionCounter counter;
+		auto start = std::chrono::steady_clock::now();
+		for(u32 i = 0; i < gPipelinedCallCount; ++i)
+		{
+			result = channel.call(gEchoMethod, reinterpret_cast<const u8*>(&i), sizeof(i), [i, &counter](netsocket::RpcStatus status, const u8* bytes, u32 size)
+			{
+				netsocket_assert((status == netsocket::RpcStatus::Success) && (size == sizeof(u32)));
+				u32 value;
+				std::memcpy(&value, bytes, sizeof(value));
+				netsocket_assert((value == i) && "Response doesn't match its request");
+				counter.increment();
+			});
+			netsocket_assert(result == netsocket::Result::Success);
+		}
+		counter.wait(gPipelinedCallCount);
+		auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		spdlog::info("{} pipelined echo calls in {:.1f} ms ({:.0f} calls/s)", gPipelinedCallCount, elapsed * 1e3, gPipelinedCallCount / elapsed);
+	}
+
+	// Out of order: the longest delay is requested first and answered last
+	{
+		constexpr u32 delays[] = { 300, 200, 100, 0 };
+		std::mutex mutex;
+		std::vector<u32> completionOrder;
+		CompletionCounter counter;
+		for(u32 delay : delays)
+		{
+			result = channel.call(gDelayedEchoMethod, reinterpret_cast<const u8*>(&delay), sizeof(delay), [&](netsocket::RpcStatus status, const u8* bytes, u32 size)
+			{
+				netsocket_assert((status == netsocket::RpcStatus::Success) && (size == sizeof(u32)));
+				u32 value;
+				std::memcpy(&value, bytes, sizeof(value));
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					completionOrder.push_back(value);
+				}
+				counter.increment();
+			});
+			netsocket_assert(result == netsocket::Result::Success);
+		}
+		counter.wait(std::size(delays));
+		netsocket_assert((completionOrder == std::vector<u32> { 0, 100, 200, 300 }) && "Responses should complete in the order of their delays");
+		spdlog::info("Delayed calls completed out of order: {}, {}, {}, {}", completionOrder[0], completionOrder[1], completionOrder[2], completionOrder[3]);
+	}
+
+	netsocket::RpcResult rpcResult = channel.callAndWait(gIgnoredMethod, NULL, 0, 200);
+	netsocket_assert(rpcResult.status == netsocket::RpcStatus::Timeout);
+	spdlog::info("Unanswered call timed out");
+
+	rpcResult = channel.callAndWait(gUnknownMethod, NULL, 0);
+	netsocket_assert(rpcResult.status == netsocket::RpcStatus::UnknownMethod);
+
+	rpcResult = channel.callAndWait(gFailingMethod, NULL, 0);
+	netsocket_assert(rpcResult.status == netsocket::RpcStatus::Error);
+	spdlog::info("Failing call reported: {}", std::string_view { reinterpret_cast<const char*>(rpcResult.data.data()), rpcResult.data.size() });
+	netsocket_assert(channel.getPendingCallCount() == 0);
+
+	rpcResult = channel.callAndWait(gShutdownMethod, NULL, 0);
+	netsocket_assert(rpcResult.status == netsocket::RpcStatus::Success);
+	channel.stop();
+
+	result = mySocket.close();
+	netsocket_assert(result == netsocket::Result::Success);
+	spdlog::info("Connection closed successfully");
+	return 0;
+}
@@ -0,0 +1,98 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/rpc.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+#include <chrono>
+#include <cstring> // for std::memcpy
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static constexpr std::string_view gPortNumber = "8000";
+
+// Methods, the client uses the same numbers
+static constexpr u32 gEchoMethod = 1;
+// Answers after the number of milliseconds in the request, from another thread
+static constexpr u32 gDelayedEchoMethod = 2;
+// Never answers, the client's call times out
+static constexpr u32 gIgnoredMethod = 3;
+// Answers with an error
+static constexpr u32 gFailingMethod = 4;
+static constexpr u32 gShutdownMethod = 5;
+
+int main()
+{
+	spdlog::info("NetSocket RPC server");
+
+	std::vector<std::pair<std::string, netsocket::IPv4Address>> ipAddresses = netsocket::GetInterfaceIPv4Addresses();
+	std::string ipAddress = netsocket::TrySelectingPhysicalInterfaceIPAddress(ipAddresses, "192.168.1.1");
+	spdlog::info("Selected IP address: {}", ipAddress);
+
+	netsocket::Socket mySocket(netsocket::SocketType::Stream,
+								netsocket::IPAddressFamily::IPv4,
+								netsocket::IPProtocol::TCP);
+
+	netsocket::Result result = mySocket.bind(ipAddress, gPortNumber);
+	netsocket_assert(result == netsocket::Result::Success);
+
+	spdlog::info("Listening on {}:{}", ipAddress, gPortNumber);
+	result = mySocket.listen();
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to listen");
+
+	spdlog::info("Waiting to accept connection");
+	std::optional<netsocket::Socket> clientSocket = mySocket.accept();
+	netsocket_assert(clientSocket.has_value() && "Failed to accept connection");
+	clientSocket->setTCPNoDelay();
+
+	netsocket::RpcChannel channel(*clientSocket);
+	channel.setRequestHandler(gEchoMethod, [](const u8* bytes, u32 size, netsocket::RpcChannel::Responder responder)
+	{
+		responder.respond(bytes, size);
+	});
+	std::mutex workerMutex;
+	std::vector<std::thread> workers;
+	channel.setRequestHandler(gDelayedEchoMethod, [&workerMutex, &workers](const u8* bytes, u32 size, netsocket::RpcChannel::Responder responder)
+	{
+		netsocket_assert(size == sizeof(u32));
+		u32 delay;
+		std::memcpy(&delay, bytes, sizeof(delay));
+		std::lock_guard<std::mutex> lock(workerMutex);
+		workers.emplace_back([delay, responder]()
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+			responder.respond(reinterpret_cast<const u8*>(&delay), sizeof(delay));
+		});
+	});
+	channel.setRequestHandler(gIgnoredMethod, [](const u8*, u32, netsocket::RpcChannel::Responder) { });
+	channel.setRequestHandler(gFailingMethod, [](const u8*, u32, netsocket::RpcChannel::Responder responder)
+	{
+		constexpr std::string_view error = "Failed on purpose";
+		responder.fail(reinterpret_cast<const u8*>(error.data()), static_cast<u32>(error.size()));
+	});
+	std::promise<void> shutdownPromise;
+	channel.setRequestHandler(gShutdownMethod, [&shutdownPromise](const u8*, u32, netsocket::RpcChannel::Responder responder)
+	{
+		responder.respond(NULL, 0);
+		shutdownPromise.set_value();
+	});
+	result = channel.start();
+	netsocket_assert(result == netsocket::Result::Success);
+
+	shutdownPromise.get_future().wait();
+	spdlog::info("Client asked to shut down");
+	for(std::thread& worker : workers)
+		worker.join();
+	// The response to the shutdown request has been sent, closing doesn't drop it
+	channel.stop();
+
+	result = clientSocket->close();
+	netsocket_assert(result == netsocket::Result::Success);
+	spdlog::info("Connection closed successfully");
+	return 0;
+}
@@ -0,0 +1,81 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/shmsocket.hpp>
+#include <netsocket/assert.hpp>
+
+#include "shmtestconfig.hpp"
+
+#include <algorithm> // for std::min
+#include <chrono>
+#include <cstring> // for std::memcmp
+#include <vector>
+
+// Same code for both transports, returns the average round trip in nanoseconds
+template<typename SocketType>
+static double MeasureRoundTrips(SocketType& socket)
+{
+	auto start = std::chrono::steady_clock::now();
+	for(u64 i = 0; i < gShmRoundTripCount; ++i)
+	{
+		bool isSent = socket.template send<u64>(i);
+		netsocket_assert(isSent);
+		std::optional<u64> value = socket.template receive<u64>();
+		netsocket_assert(value.has_value() && (*value == (i + 1)));
+	}
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / gShmRoundTripCount;
+}
+
+int main()
+{
+	spdlog::info("NetSocket shared memory client");
+
+	netsocket::Socket unixSocket(netsocket::SocketType::Stream, netsocket::IPAddressFamily::Unix, netsocket::IPProtocol::Default);
+	const std::string path = GetShmTestPath();
+	spdlog::info("Connecting to {}", path);
+	netsocket::Result result = unixSocket.connectUnix(path);
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to connect");
+	spdlog::info("Unix domain socket: {:.0f} ns per round trip", MeasureRoundTrips(unixSocket));
+
+	// The default spin count suits a shared core, SharedMemorySocketOptions::NeverSleep gets the lowest latency when both sides have their own
+	netsocket::SharedMemorySocketOptions options;
+	options.capacity = gShmRingCapacity;
+	std::optional<netsocket::SharedMemorySocket> shmSocket = netsocket::SharedMemorySocket::Connect(unixSocket, options);
+	netsocket_assert(shmSocket.has_value() && "Failed to create the shared memory segment");
+	result = unixSocket.close();
+	netsocket_assert(result == netsocket::Result::Success);
+
+	constexpr std::string_view refData = "Hello World";
+	char receiveBuffer[refData.size()];
+	result = shmSocket->receive(reinterpret_cast<u8*>(receiveBuffer), refData.size());
+	netsocket_assert(result == netsocket::Result::Success);
+	netsocket_assert(std::memcmp(receiveBuffer, refData.data(), refData.size()) == 0);
+	bool isSent = shmSocket->send<u32>(static_cast<u32>(refData.size()));
+	netsocket_assert(isSent);
+	spdlog::info("Received data is correct");
+
+	spdlog::info("Shared memory: {:.0f} ns per round trip", MeasureRoundTrips(*shmSocket));
+
+	std::vector<u8> chunk(gShmChunkSize);
+	auto start = std::chrono::steady_clock::now();
+	for(u32 offset = 0; offset < gShmBulkSize;)
+	{
+		const u32 size = std::min(gShmChunkSize, gShmBulkSize - offset);
+		for(u32 i = 0; i < size; ++i)
+			chunk[i] = GetShmTestByte(offset + i);
+		result = shmSocket->send(chunk.data(), size);
+		netsocket_assert(result == netsocket::Result::Success);
+		offset += size;
+	}
+	std::optional<u8> ack = shmSocket->receive<u8>();
+	netsocket_assert(ack.has_value() && (*ack == 1));
+	auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	spdlog::info("Sent {} bytes in {:.3f} s through a {} bytes ring", gShmBulkSize, elapsed, shmSocket->getCapacity());
+
+	result = shmSocket->close();
+	netsocket_assert(result == netsocket::Result::Success);
+	spdlog::info("Connection closed successfully");
+	return 0;
+}
@@ -0,0 +1,86 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/shmsocket.hpp>
+#include <netsocket/assert.hpp>
+
+#include "shmtestconfig.hpp"
+
+#include <algorithm> // for std::min
+#include <cstring> // for std::strlen
+#include <filesystem>
+#include <vector>
+
+// Same code for both transports
+template<typename SocketType>
+static void EchoRoundTrips(SocketType& socket)
+{
+	for(u32 i = 0; i < gShmRoundTripCount; ++i)
+	{
+		std::optional<u64> value = socket.template receive<u64>();
+		netsocket_assert(value.has_value());
+		bool isSent = socket.template send<u64>(*value + 1);
+		netsocket_assert(isSent);
+	}
+}
+
+int main()
+{
+	spdlog::info("NetSocket shared memory server");
+
+	// A previous run may have left the socket file behind
+	const std::string path = GetShmTestPath();
+	std::filesystem::remove(path);
+	netsocket::Socket mySocket(netsocket::SocketType::Stream, netsocket::IPAddressFamily::Unix, netsocket::IPProtocol::Default);
+	netsocket::Result result = mySocket.bindUnix(path);
+	netsocket_assert(result == netsocket::Result::Success);
+	result = mySocket.listen();
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to listen");
+	spdlog::info("Listening on {}", path);
+
+	std::optional<netsocket::Socket> unixSocket = mySocket.accept();
+	netsocket_assert(unixSocket.has_value() && "Failed to accept connection");
+	EchoRoundTrips(*unixSocket);
+	spdlog::info("Echoed {} round trips over the Unix domain socket", gShmRoundTripCount);
+
+	netsocket::SharedMemorySocketOptions options;
+	options.capacity = gShmRingCapacity;
+	std::optional<netsocket::SharedMemorySocket> shmSocket = netsocket::SharedMemorySocket::Accept(*unixSocket, options);
+	netsocket_assert(shmSocket.has_value() && "Failed to map the shared memory segment");
+	spdlog::info("Mapped the shared memory segment, {} bytes per direction", shmSocket->getCapacity());
+
+	const char* data = "Hello World";
+	result = shmSocket->send(reinterpret_cast<const u8*>(data), std::strlen(data));
+	netsocket_assert(result == netsocket::Result::Success);
+	std::optional<u32> receivedSize = shmSocket->receive<u32>();
+	netsocket_assert(receivedSize.has_value() && (*receivedSize == std::strlen(data)));
+
+	EchoRoundTrips(*shmSocket);
+	spdlog::info("Echoed {} round trips over shared memory", gShmRoundTripCount);
+
+	std::vector<u8> chunk(gShmChunkSize);
+	for(u32 offset = 0; offset < gShmBulkSize;)
+	{
+		const u32 size = std::min(gShmChunkSize, gShmBulkSize - offset);
+		result = shmSocket->receive(chunk.data(), size);
+		netsocket_assert(result == netsocket::Result::Success);
+		for(u32 i = 0; i < size; ++i)
+			netsocket_assert((chunk[i] == GetShmTestByte(offset + i)) && "Data is corrupted");
+		offset += size;
+	}
+	bool isSent = shmSocket->send<u8>(1);
+	netsocket_assert(isSent);
+	spdlog::info("Received {} bytes, data is correct", gShmBulkSize);
+
+	// The client closes its end
+	std::optional<u8> end = shmSocket->receive<u8>();
+	netsocket_assert(!end.has_value() && !shmSocket->isConnected());
+	result = shmSocket->close();
+	netsocket_assert(result == netsocket::Result::Success);
+	spdlog::info("Connection closed successfully");
+
+	std::filesystem::remove(path);
+	return 0;
+}
@@ -0,0 +1,75 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+#include <common/platform.h>
+
+#include <vector>
+
+static constexpr std::string_view gPortNumber = "8000";
+static constexpr u32 gBodySize = 3000;
+
+int main()
+{
+	spdlog::info("NetSocket socket options client");
+
+	std::vector<std::pair<std::string, netsocket::IPv4Address>> ipAddresses = netsocket::GetInterfaceIPv4Addresses();
+	std::string ipAddress = netsocket::TrySelectingPhysicalInterfaceIPAddress(ipAddresses, "192.168.1.1");
+	spdlog::info("Selected IP address: {}", ipAddress);
+
+	netsocket::SocketOptions options = netsocket::SocketOptions::LowLatency();
+	options.isKeepAliveEnabled = true;
+	options.keepAliveIdleTime = 60;
+	options.keepAliveInterval = 10;
+	options.keepAliveProbeCount = 5;
+	netsocket::Socket mySocket(netsocket::SocketType::Stream,
+								netsocket::IPAddressFamily::IPv4,
+								netsocket::IPProtocol::TCP,
+								options);
+	netsocket::SocketOptions effectiveOptions = mySocket.getOptions();
+	netsocket_assert((effectiveOptions.isNoDelay == true) && (effectiveOptions.isKeepAliveEnabled == true));
+	netsocket_assert((effectiveOptions.keepAliveIdleTime == 60u) && (effectiveOptions.keepAliveInterval == 10u) && (effectiveOptions.keepAliveProbeCount == 5u));
+	spdlog::info("Keepalive after {} s, every {} s, {} probes", effectiveOptions.keepAliveIdleTime.value_or(0),
+					effectiveOptions.keepAliveInterval.value_or(0), effectiveOptions.keepAliveProbeCount.value_or(0));
+
+	spdlog::info("Connecting to {}:{}", ipAddress, gPortNumber);
+	netsocket::Result result = mySocket.connect(ipAddress, gPortNumber);
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to connect");
+
+	// The header and the body leave in full segments while the socket is corked
+	std::vector<u8> body(gBodySize);
+	u32 sum = 0;
+	for(u32 i = 0; i < gBodySize; ++i)
+	{
+		body[i] = static_cast<u8>(i * 13);
+		sum += body[i];
+	}
+	netsocket::SocketOptions corkOptions;
+	corkOptions.isCorked = true;
+	result = mySocket.setOptions(corkOptions);
+#ifdef PLATFORM_LINUX
+	netsocket_assert(result == netsocket::Result::Success);
+	netsocket_assert(mySocket.getOptions().isCorked == true);
+#endif
+	bool isSent = mySocket.send<u32>(gBodySize);
+	netsocket_assert(isSent);
+	result = mySocket.send(body.data(), gBodySize);
+	netsocket_assert(result == netsocket::Result::Success);
+	corkOptions.isCorked = false;
+	mySocket.setOptions(corkOptions);
+
+	std::optional<u32> receivedSum = mySocket.receive<u32>();
+	netsocket_assert(receivedSum.has_value() && (*receivedSum == sum));
+	spdlog::info("Server received the body, sum is correct");
+	isSent = mySocket.send<u8>(1);
+	netsocket_assert(isSent);
+
+	result = mySocket.close();
+	netsocket_assert(result == netsocket::Result::Success);
+	spdlog::info("Connection closed successfully");
+	return 0;
+}
@@ -0,0 +1,77 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+#include <common/platform.h>
+
+#include <vector>
+
+static constexpr std::string_view gPortNumber = "8000";
+
+static void LogOptions(std::string_view name, const netsocket::SocketOptions& options)
+{
+	spdlog::info("{}: send buffer {}, receive buffer {}, no delay {}, quick ack {}, priority {}, not sent low watermark {}, backlog {}", name,
+					options.sendBufferSize.value_or(0), options.receiveBufferSize.value_or(0), options.isNoDelay.value_or(false),
+					options.isQuickAck.value_or(false), options.priority.value_or(0), options.notSentLowWatermark.value_or(0),
+					options.listenBacklog.value_or(0));
+}
+
+int main()
+{
+	spdlog::info("NetSocket socket options server");
+
+	std::vector<std::pair<std::string, netsocket::IPv4Address>> ipAddresses = netsocket::GetInterfaceIPv4Addresses();
+	std::string ipAddress = netsocket::TrySelectingPhysicalInterfaceIPAddress(ipAddresses, "192.168.1.1");
+	spdlog::info("Selected IP address: {}", ipAddress);
+
+	// Large buffers and a long backlog on the listening socket, which the accepted sockets inherit
+	netsocket::Socket mySocket(netsocket::SocketType::Stream,
+								netsocket::IPAddressFamily::IPv4,
+								netsocket::IPProtocol::TCP,
+								netsocket::SocketOptions::HighThroughput());
+	netsocket::SocketOptions listeningOptions = mySocket.getOptions();
+	LogOptions("Listening socket", listeningOptions);
+	netsocket_assert(listeningOptions.listenBacklog == 4096u);
+	netsocket_assert(listeningOptions.isNoDelay == false);
+
+	netsocket::Result result = mySocket.bind(ipAddress, gPortNumber);
+	netsocket_assert(result == netsocket::Result::Success);
+	spdlog::info("Listening on {}:{}", ipAddress, gPortNumber);
+	result = mySocket.listen();
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to listen");
+
+	// The latency profile on top for the connection itself
+	std::optional<netsocket::Socket> clientSocket = mySocket.accept(netsocket::SocketOptions::LowLatency());
+	netsocket_assert(clientSocket.has_value() && "Failed to accept connection");
+	netsocket::SocketOptions acceptedOptions = clientSocket->getOptions();
+	LogOptions("Accepted socket", acceptedOptions);
+	netsocket_assert(acceptedOptions.isNoDelay == true);
+	netsocket_assert(acceptedOptions.sendBufferSize == listeningOptions.sendBufferSize);
+#ifdef PLATFORM_LINUX
+	netsocket_assert(acceptedOptions.priority == 6u);
+	netsocket_assert(acceptedOptions.notSentLowWatermark == 16u * 1024u);
+#endif
+
+	// The client sends a header and a body while corked, answers with the sum of the body
+	std::optional<u32> size = clientSocket->receive<u32>();
+	netsocket_assert(size.has_value());
+	std::vector<u8> body(*size);
+	result = clientSocket->receive(body.data(), *size);
+	netsocket_assert(result == netsocket::Result::Success);
+	u32 sum = 0;
+	for(u8 value : body)
+		sum += value;
+	bool isSent = clientSocket->send<u32>(sum);
+	netsocket_assert(isSent);
+
+	std::optional<u8> ack = clientSocket->receive<u8>();
+	netsocket_assert(ack.has_value());
+	result = clientSocket->close();
+	netsocket_assert(result == netsocket::Result::Success);
+	spdlog::info("Connection closed successfully");
+	return 0;
+}
@@ -0,0 +1,63 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+#include "threadpercoretestconfig.hpp"
+
+#include <cstring> // for std::memcmp
+#include <thread>
+#include <vector>
+
+// Sends gServerRequestCount messages and checks their echo
+static void RunConnection(netsocket::Socket& socket, u32 connectionIndex)
+{
+	u8 message[gServerMessageSize];
+	u8 echo[gServerMessageSize];
+	for(u32 i = 0; i < gServerRequestCount; ++i)
+	{
+		for(u32 j = 0; j < gServerMessageSize; ++j)
+			message[j] = static_cast<u8>(connectionIndex * 31 + i * 7 + j);
+		netsocket::Result result = socket.send(message, gServerMessageSize);
+		netsocket_assert(result == netsocket::Result::Success);
+		result = socket.receive(echo, gServerMessageSize);
+		netsocket_assert(result == netsocket::Result::Success);
+		netsocket_assert((std::memcmp(message, echo, gServerMessageSize) == 0) && "Echo is corrupted");
+	}
+	netsocket::Result result = socket.close();
+	netsocket_assert(result == netsocket::Result::Success);
+}
+
+static void RunConnections(const std::string& ipAddress, std::string_view portNumber)
+{
+	// All connected before any request, so that the server has them all open at once
+	std::vector<netsocket::Socket> sockets;
+	for(u32 i = 0; i < gServerConnectionCount; ++i)
+	{
+		sockets.emplace_back(netsocket::SocketType::Stream, netsocket::IPAddressFamily::IPv4, netsocket::IPProtocol::TCP);
+		netsocket::Result result = sockets.back().connect(ipAddress, portNumber);
+		netsocket_assert((result == netsocket::Result::Success) && "Failed to connect");
+	}
+	std::vector<std::thread> threads;
+	for(u32 i = 0; i < gServerConnectionCount; ++i)
+		threads.emplace_back(RunConnection, std::ref(sockets[i]), i);
+	for(std::thread& thread : threads)
+		thread.join();
+	spdlog::info("{} connections to port {} done, {} round trips each", gServerConnectionCount, portNumber, gServerRequestCount);
+}
+
+int main()
+{
+	spdlog::info("NetSocket thread-per-core client");
+
+	std::vector<std::pair<std::string, netsocket::IPv4Address>> ipAddresses = netsocket::GetInterfaceIPv4Addresses();
+	std::string ipAddress = netsocket::TrySelectingPhysicalInterfaceIPAddress(ipAddresses, "192.168.1.1");
+	spdlog::info("Selected IP address: {}", ipAddress);
+
+	RunConnections(ipAddress, gCoroutinePortNumber);
+	RunConnections(ipAddress, gCallbackPortNumber);
+	return 0;
+}
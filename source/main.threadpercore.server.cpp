@@ -0,0 +1,89 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/server.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+#include "threadpercoretestconfig.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// Connections served to the end, by either server
+static std::atomic<u32> gFinishedCount = 0;
+static std::atomic<u32> gShardConnectionCounts[gServerShardCount] = { };
+
+// Echoes messages of exactly gServerMessageSize bytes, checking that the connection never leaves its shard's thread
+static netsocket::ServerTask ServeConnection(netsocket::ServerConnection& connection)
+{
+	const std::thread::id threadID = std::this_thread::get_id();
+	++gShardConnectionCounts[connection.getShardIndex()];
+	u8 buffer[gServerMessageSize];
+	u32 requestCount = 0;
+	while(std::optional<u32> size = co_await connection.receive(buffer, gServerMessageSize))
+	{
+		netsocket_assert((std::this_thread::get_id() == threadID) && "The connection moved to another thread");
+		netsocket::Result result = connection.send(buffer, *size);
+		netsocket_assert(result == netsocket::Result::Success);
+		++requestCount;
+	}
+	netsocket_assert((requestCount == gServerRequestCount) && !connection.isCancelled());
+	++gFinishedCount;
+}
+
+// Echoes whatever is available
+static void OnReadable(netsocket::ServerConnection& connection)
+{
+	u8 buffer[gServerMessageSize];
+	std::optional<u32> size = connection.getSocket().receiveSome(buffer, gServerMessageSize);
+	if(!size)
+	{
+		++gFinishedCount;
+		return;
+	}
+	netsocket::Result result = connection.send(buffer, *size);
+	netsocket_assert(result == netsocket::Result::Success);
+}
+
+int main()
+{
+	spdlog::info("NetSocket thread-per-core server");
+
+	std::vector<std::pair<std::string, netsocket::IPv4Address>> ipAddresses = netsocket::GetInterfaceIPv4Addresses();
+	std::string ipAddress = netsocket::TrySelectingPhysicalInterfaceIPAddress(ipAddresses, "192.168.1.1");
+	spdlog::info("Selected IP address: {}", ipAddress);
+
+	netsocket::ServerOptions options;
+	options.shardCount = gServerShardCount;
+	netsocket::Server coroutineServer(options);
+	netsocket::Result result = coroutineServer.listen(ipAddress, gCoroutinePortNumber);
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to listen");
+	result = coroutineServer.start(ServeConnection);
+	netsocket_assert(result == netsocket::Result::Success);
+	spdlog::info("Serving coroutines on {}:{} with {} shards", ipAddress, gCoroutinePortNumber, coroutineServer.getShardCount());
+
+	netsocket::Server callbackServer(options);
+	result = callbackServer.listen(ipAddress, gCallbackPortNumber);
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to listen");
+	result = callbackServer.startCallbacks(OnReadable);
+	netsocket_assert(result == netsocket::Result::Success);
+	spdlog::info("Serving callbacks on {}:{} with {} shards", ipAddress, gCallbackPortNumber, callbackServer.getShardCount());
+
+	while(gFinishedCount < (2 * gServerConnectionCount))
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	coroutineServer.stop(1000);
+	callbackServer.stop(1000);
+	netsocket_assert((coroutineServer.getConnectionCount() == 0) && (callbackServer.getConnectionCount() == 0));
+
+	// The connections are dealt out to the shards in turn
+	for(u32 i = 0; i < gServerShardCount; ++i)
+	{
+		spdlog::info("Shard {} served {} coroutine connections", i, gShardConnectionCounts[i].load());
+		netsocket_assert(gShardConnectionCounts[i] == (gServerConnectionCount / gServerShardCount));
+	}
+	spdlog::info("All {} connections served", gFinishedCount.load());
+	return 0;
+}
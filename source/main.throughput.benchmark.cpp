@@ -0,0 +1,394 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/netasyncsocket.hpp>
+#include <netsocket/nativewebsocket.hpp>
+#include <netsocket/websocket.hpp>
+#include <netsocket/assert.hpp>
+
+#include <algorithm> // for std::clamp, std::find
+#include <chrono>
+#include <cstdlib> // for std::strtoull
+#include <ctime> // for std::time, std::gmtime, std::strftime
+#include <fstream>
+#include <functional>
+#include <latch>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Loopback throughput of the transports, sweeping the message size and the number of connections (one sending and one receiving thread each,
+// all in this process). Every case is written to a JSON file, so that the results of two releases can be compared.
+// Usage: netsocket_bench [--sizes 16,256,...] [--threads 1,2,4] [--transports Socket,AsyncSocket,NativeWebSocket,WebSocket]
+//                        [--bytes bytes per connection and case, 64 MiB by default] [--output path, netsocket_bench.json by default]
+
+static constexpr std::string_view gIPAddress = "127.0.0.1";
+static constexpr u64 gDefaultCaseSize = 64 * 1024 * 1024;
+// Bounds of the number of messages per connection and case: small messages would take too long otherwise, large ones too few round trips
+static constexpr u64 gMinMessageCount = 8;
+static constexpr u64 gMaxMessageCount = 100000;
+static constexpr std::string_view gDefaultOutputPath = "netsocket_bench.json";
+
+struct BenchmarkConfig
+{
+	std::vector<u64> messageSizes = { 16, 256, 4096, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024 };
+	std::vector<u64> threadCounts = { 1, 2, 4 };
+	std::vector<std::string> transports = { "Socket", "AsyncSocket", "NativeWebSocket", "WebSocket" };
+	u64 caseSize = gDefaultCaseSize;
+	std::string outputPath { gDefaultOutputPath };
+};
+
+struct BenchmarkResult
+{
+	std::string transport;
+	u64 messageSize;
+	u64 threadCount;
+	// Per connection
+	u64 messageCount;
+	double seconds;
+};
+
+// One connection of a case: the sending side runs on one thread, the receiving side on another one
+struct Connection
+{
+	std::function<void()> send;
+	std::function<void()> receive;
+};
+
+using Clock = std::chrono::steady_clock;
+
+static std::vector<u8> CreateMessage(u64 size)
+{
+	std::vector<u8> message(size);
+	for(u64 i = 0; i < size; ++i)
+		message[i] = static_cast<u8>(i * 7);
+	return message;
+}
+
+static void CheckMessage(const std::vector<u8>& message)
+{
+	netsocket_assert((message.front() == 0) && (message.back() == static_cast<u8>((message.size() - 1) * 7)) && "Message is corrupted");
+}
+
+// Runs the connections' sides on their own threads, all starting at once, returns the time until everything has been received
+static double RunConnections(std::vector<Connection>& connections)
+{
+	std::latch startLatch(static_cast<std::ptrdiff_t>(2 * connections.size() + 1));
+	std::vector<std::thread> senders;
+	std::vector<std::thread> receivers;
+	for(Connection& connection : connections)
+	{
+		senders.emplace_back([&startLatch, &connection]() { startLatch.arrive_and_wait(); connection.send(); });
+		receivers.emplace_back([&startLatch, &connection]() { startLatch.arrive_and_wait(); connection.receive(); });
+	}
+	startLatch.arrive_and_wait();
+	const Clock::time_point start = Clock::now();
+	for(std::thread& receiver : receivers)
+		receiver.join();
+	const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	for(std::thread& sender : senders)
+		sender.join();
+	return seconds;
+}
+
+// Plain sockets, or AsyncSocket queueing the sends on its transaction thread (received by a Socket)
+class SocketBenchmark
+{
+private:
+	netsocket::Socket m_listeningSocket;
+	std::string_view m_portNumber;
+	bool m_isAsync;
+
+	static netsocket::Socket CreateTcpSocket()
+	{
+		netsocket::SocketOptions options;
+		options.isNoDelay = true;
+		return netsocket::Socket(netsocket::SocketType::Stream, netsocket::IPAddressFamily::IPv4, netsocket::IPProtocol::TCP, options);
+	}
+
+public:
+	SocketBenchmark(std::string_view portNumber, bool isAsync) : m_listeningSocket(CreateTcpSocket()), m_portNumber(portNumber), m_isAsync(isAsync)
+	{
+		netsocket::Result result = m_listeningSocket.bind(gIPAddress, portNumber);
+		netsocket_assert((result == netsocket::Result::Success) && "Failed to bind");
+		result = m_listeningSocket.listen();
+		netsocket_assert(result == netsocket::Result::Success);
+	}
+
+	double run(u64 messageSize, u64 messageCount, u64 threadCount)
+	{
+		std::vector<std::unique_ptr<netsocket::Socket>> clientSockets;
+		std::vector<std::unique_ptr<netsocket::AsyncSocket>> asyncSockets;
+		std::vector<std::unique_ptr<netsocket::Socket>> serverSockets;
+		for(u64 i = 0; i < threadCount; ++i)
+		{
+			netsocket::Socket socket = CreateTcpSocket();
+			netsocket::Result result = socket.connect(gIPAddress, m_portNumber);
+			netsocket_assert((result == netsocket::Result::Success) && "Failed to connect");
+			if(m_isAsync)
+				asyncSockets.push_back(std::make_unique<netsocket::AsyncSocket>(std::move(socket)));
+			else
+				clientSockets.push_back(std::make_unique<netsocket::Socket>(std::move(socket)));
+			std::optional<netsocket::Socket> acceptedSocket = m_listeningSocket.accept();
+			netsocket_assert(acceptedSocket.has_value());
+			acceptedSocket->setTCPNoDelay();
+			serverSockets.push_back(std::make_unique<netsocket::Socket>(std::move(*acceptedSocket)));
+		}
+
+		const std::vector<u8> message = CreateMessage(messageSize);
+		std::vector<Connection> connections;
+		for(u64 i = 0; i < threadCount; ++i)
+		{
+			Connection connection;
+			if(m_isAsync)
+				connection.send = [&message, messageCount, socket = asyncSockets[i].get()]()
+				{
+					for(u64 j = 0; j < messageCount; ++j)
+						socket->send(message.data(), static_cast<u32>(message.size()));
+					netsocket::Result result = socket->finish();
+					netsocket_assert(result == netsocket::Result::Success);
+				};
+			else
+				connection.send = [&message, messageCount, socket = clientSockets[i].get()]()
+				{
+					for(u64 j = 0; j < messageCount; ++j)
+					{
+						netsocket::Result result = socket->send(message.data(), static_cast<u32>(message.size()));
+						netsocket_assert(result == netsocket::Result::Success);
+					}
+				};
+			connection.receive = [messageSize, messageCount, socket = serverSockets[i].get()]()
+			{
+				std::vector<u8> buffer(messageSize);
+				for(u64 j = 0; j < messageCount; ++j)
+				{
+					netsocket::Result result = socket->receive(buffer.data(), static_cast<u32>(buffer.size()));
+					netsocket_assert(result == netsocket::Result::Success);
+				}
+				CheckMessage(buffer);
+			};
+			connections.push_back(std::move(connection));
+		}
+		const double seconds = RunConnections(connections);
+		for(auto& socket : asyncSockets)
+			socket->close();
+		for(auto& socket : clientSockets)
+			socket->close();
+		return seconds;
+	}
+};
+
+// netsocket::NativeWebSocket or netsocket::WebSocket (ixwebsocket), one binary message per send
+template<typename WebSocketType>
+class WebSocketBenchmark
+{
+private:
+	WebSocketType m_listeningSocket;
+	std::string_view m_portNumber;
+
+public:
+	WebSocketBenchmark(std::string_view portNumber) : m_portNumber(portNumber)
+	{
+		netsocket::Result result = m_listeningSocket.bind(gIPAddress, portNumber);
+		netsocket_assert((result == netsocket::Result::Success) && "Failed to bind");
+		result = m_listeningSocket.listen();
+		netsocket_assert(result == netsocket::Result::Success);
+	}
+
+	double run(u64 messageSize, u64 messageCount, u64 threadCount)
+	{
+		std::vector<std::unique_ptr<WebSocketType>> clientSockets;
+		std::vector<std::unique_ptr<WebSocketType>> serverSockets;
+		// The opening handshake needs both sides
+		std::thread acceptThread([this, &serverSockets, threadCount]()
+		{
+			for(u64 i = 0; i < threadCount; ++i)
+			{
+				serverSockets.push_back(m_listeningSocket.accept());
+				netsocket_assert(serverSockets.back() && "Failed to accept");
+			}
+		});
+		for(u64 i = 0; i < threadCount; ++i)
+		{
+			clientSockets.push_back(std::make_unique<WebSocketType>());
+			netsocket::Result result = clientSockets.back()->connect(gIPAddress, m_portNumber);
+			netsocket_assert((result == netsocket::Result::Success) && "Failed to connect");
+		}
+		acceptThread.join();
+
+		const std::vector<u8> message = CreateMessage(messageSize);
+		std::vector<Connection> connections;
+		for(u64 i = 0; i < threadCount; ++i)
+		{
+			Connection connection;
+			connection.send = [&message, messageCount, socket = clientSockets[i].get()]()
+			{
+				for(u64 j = 0; j < messageCount; ++j)
+				{
+					netsocket::Result result = socket->send(message.data(), static_cast<u32>(message.size()));
+					netsocket_assert(result == netsocket::Result::Success);
+				}
+			};
+			connection.receive = [messageSize, messageCount, socket = serverSockets[i].get()]()
+			{
+				std::vector<u8> buffer(messageSize);
+				for(u64 j = 0; j < messageCount; ++j)
+				{
+					netsocket::Result result = socket->receive(buffer.data(), static_cast<u32>(buffer.size()));
+					netsocket_assert(result == netsocket::Result::Success);
+				}
+				CheckMessage(buffer);
+			};
+			connections.push_back(std::move(connection));
+		}
+		const double seconds = RunConnections(connections);
+		for(auto& socket : clientSockets)
+			socket->close();
+		for(auto& socket : serverSockets)
+			socket->close();
+		return seconds;
+	}
+};
+
+static std::vector<u64> ParseNumberList(std::string_view list)
+{
+	std::vector<u64> numbers;
+	while(!list.empty())
+	{
+		const std::size_t end = std::min(list.find(','), list.size());
+		numbers.push_back(std::strtoull(std::string(list.substr(0, end)).c_str(), NULL, 10));
+		netsocket_assert((numbers.back() > 0) && "Expected a list of positive numbers separated by ','");
+		list.remove_prefix(std::min(end + 1, list.size()));
+	}
+	return numbers;
+}
+
+static std::vector<std::string> ParseNameList(std::string_view list)
+{
+	std::vector<std::string> names;
+	while(!list.empty())
+	{
+		const std::size_t end = std::min(list.find(','), list.size());
+		names.emplace_back(list.substr(0, end));
+		list.remove_prefix(std::min(end + 1, list.size()));
+	}
+	return names;
+}
+
+static BenchmarkConfig ParseArguments(int argc, const char* argv[])
+{
+	BenchmarkConfig config;
+	for(int i = 1; (i + 1) < argc; i += 2)
+	{
+		const std::string_view name = argv[i];
+		const std::string_view value = argv[i + 1];
+		if(name == "--sizes")
+			config.messageSizes = ParseNumberList(value);
+		else if(name == "--threads")
+			config.threadCounts = ParseNumberList(value);
+		else if(name == "--transports")
+			config.transports = ParseNameList(value);
+		else if(name == "--bytes")
+			config.caseSize = std::strtoull(std::string(value).c_str(), NULL, 10);
+		else if(name == "--output")
+			config.outputPath = value;
+		else
+			spdlog::warn("Unknown option {}", name);
+	}
+	for(u64 size : config.messageSizes)
+		netsocket_assert((size <= (64 * 1024 * 1024)) && "Messages are 64 MiB at most");
+	return config;
+}
+
+static std::string GetTimestamp()
+{
+	const std::time_t time = std::time(NULL);
+	char buffer[32];
+	std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&time));
+	return buffer;
+}
+
+static void WriteJson(const BenchmarkConfig& config, const std::vector<BenchmarkResult>& results)
+{
+	std::ofstream file(config.outputPath);
+	netsocket_assert(file.is_open() && "Failed to open the output file");
+	file << "{\n";
+	file << "\t\"benchmark\": \"netsocket_bench\",\n";
+	file << "\t\"schemaVersion\": 1,\n";
+	file << fmt::format("\t\"timestamp\": \"{}\",\n", GetTimestamp());
+	file << fmt::format("\t\"coreCount\": {},\n", std::thread::hardware_concurrency());
+	file << fmt::format("\t\"bytesPerCase\": {},\n", config.caseSize);
+	file << "\t\"results\": [\n";
+	for(std::size_t i = 0; i < results.size(); ++i)
+	{
+		const BenchmarkResult& result = results[i];
+		const double totalBytes = static_cast<double>(result.messageSize * result.messageCount * result.threadCount);
+		const double totalMessages = static_cast<double>(result.messageCount * result.threadCount);
+		file << fmt::format("\t\t{{ \"transport\": \"{}\", \"messageSize\": {}, \"threads\": {}, \"messagesPerThread\": {}, \"seconds\": {:.6f}, "
+							"\"bytesPerSecond\": {:.0f}, \"messagesPerSecond\": {:.0f} }}{}\n",
+							result.transport, result.messageSize, result.threadCount, result.messageCount, result.seconds,
+							totalBytes / result.seconds, totalMessages / result.seconds, ((i + 1) < results.size()) ? "," : "");
+	}
+	file << "\t]\n";
+	file << "}\n";
+}
+
+int main(int argc, const char* argv[])
+{
+	const BenchmarkConfig config = ParseArguments(argc, argv);
+	spdlog::info("NetSocket throughput benchmark over {}, {} bytes per connection and case, {} cores", gIPAddress, config.caseSize,
+					std::thread::hardware_concurrency());
+
+	// Each transport listens on its own port
+	using RunCase = std::function<double(u64 messageSize, u64 messageCount, u64 threadCount)>;
+	std::vector<std::pair<std::string, RunCase>> transports;
+	auto isSelected = [&config](std::string_view name)
+	{
+		return std::find(config.transports.begin(), config.transports.end(), name) != config.transports.end();
+	};
+	std::unique_ptr<SocketBenchmark> socketBenchmark;
+	std::unique_ptr<SocketBenchmark> asyncSocketBenchmark;
+	std::unique_ptr<WebSocketBenchmark<netsocket::NativeWebSocket>> nativeWebSocketBenchmark;
+	std::unique_ptr<WebSocketBenchmark<netsocket::WebSocket>> webSocketBenchmark;
+	if(isSelected("Socket"))
+	{
+		socketBenchmark = std::make_unique<SocketBenchmark>("8010", false);
+		transports.emplace_back("Socket", [&](u64 size, u64 count, u64 threads) { return socketBenchmark->run(size, count, threads); });
+	}
+	if(isSelected("AsyncSocket"))
+	{
+		asyncSocketBenchmark = std::make_unique<SocketBenchmark>("8011", true);
+		transports.emplace_back("AsyncSocket", [&](u64 size, u64 count, u64 threads) { return asyncSocketBenchmark->run(size, count, threads); });
+	}
+	if(isSelected("NativeWebSocket"))
+	{
+		nativeWebSocketBenchmark = std::make_unique<WebSocketBenchmark<netsocket::NativeWebSocket>>("8012");
+		transports.emplace_back("NativeWebSocket", [&](u64 size, u64 count, u64 threads) { return nativeWebSocketBenchmark->run(size, count, threads); });
+	}
+	if(isSelected("WebSocket"))
+	{
+		webSocketBenchmark = std::make_unique<WebSocketBenchmark<netsocket::WebSocket>>("8013");
+		transports.emplace_back("WebSocket", [&](u64 size, u64 count, u64 threads) { return webSocketBenchmark->run(size, count, threads); });
+	}
+	netsocket_assert(!transports.empty() && "None of the transports is known");
+
+	std::vector<BenchmarkResult> results;
+	for(auto& [name, runCase] : transports)
+		for(u64 threadCount : config.threadCounts)
+			for(u64 messageSize : config.messageSizes)
+			{
+				const u64 messageCount = std::clamp(config.caseSize / messageSize, gMinMessageCount, gMaxMessageCount);
+				const double seconds = runCase(messageSize, messageCount, threadCount);
+				results.push_back({ name, messageSize, threadCount, messageCount, seconds });
+				const double totalBytes = static_cast<double>(messageSize * messageCount * threadCount);
+				spdlog::info("{:<16} {:>9} bytes x {:>6} x {} threads: {:>10.2f} MiB/s, {:>10.0f} messages/s", name, messageSize, messageCount,
+								threadCount, totalBytes / seconds / (1024 * 1024), messageCount * threadCount / seconds);
+			}
+
+	WriteJson(config, results);
+	spdlog::info("{} results written to {}", results.size(), config.outputPath);
+	return 0;
+}
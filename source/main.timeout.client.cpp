@@ -0,0 +1,63 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+#include "timeouttestconfig.hpp"
+
+#include <chrono>
+#include <cstring> // for std::memcmp
+#include <thread>
+
+static netsocket::Socket Connect(const std::string& ipAddress)
+{
+	netsocket::Socket socket(netsocket::SocketType::Stream, netsocket::IPAddressFamily::IPv4, netsocket::IPProtocol::TCP);
+	netsocket::Result result = socket.connect(ipAddress, gTimeoutPortNumber);
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to connect");
+	return socket;
+}
+
+int main()
+{
+	spdlog::info("NetSocket connection timeout client");
+
+	std::vector<std::pair<std::string, netsocket::IPv4Address>> ipAddresses = netsocket::GetInterfaceIPv4Addresses();
+	std::string ipAddress = netsocket::TrySelectingPhysicalInterfaceIPAddress(ipAddresses, "192.168.1.1");
+	spdlog::info("Selected IP address: {}", ipAddress);
+
+	// Never sends anything, the server drops it once the idle timeout elapses
+	netsocket::Socket silentSocket = Connect(ipAddress);
+	const auto start = std::chrono::steady_clock::now();
+	std::thread silentThread([&silentSocket, &start]()
+	{
+		u8 byte;
+		std::optional<u32> size = silentSocket.receiveSome(&byte, 1);
+		netsocket_assert(!size.has_value() && "The server sent data on the silent connection");
+		const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+		spdlog::info("Silent connection dropped by the server after {} ms", elapsed);
+	});
+
+	// Busy enough never to be idle for long, although it lasts longer than the idle timeout
+	netsocket::Socket activeSocket = Connect(ipAddress);
+	u8 message[gTimeoutMessageSize];
+	u8 echo[gTimeoutMessageSize];
+	for(u32 i = 0; i < gActiveMessageCount; ++i)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(gActiveMessageInterval));
+		for(u32 j = 0; j < gTimeoutMessageSize; ++j)
+			message[j] = static_cast<u8>(i * 13 + j);
+		netsocket::Result result = activeSocket.send(message, gTimeoutMessageSize);
+		netsocket_assert(result == netsocket::Result::Success);
+		result = activeSocket.receive(echo, gTimeoutMessageSize);
+		netsocket_assert((result == netsocket::Result::Success) && "The active connection has been dropped");
+		netsocket_assert((std::memcmp(message, echo, gTimeoutMessageSize) == 0) && "Echo is corrupted");
+	}
+	spdlog::info("Active connection done, {} round trips over {} ms", gActiveMessageCount, gActiveMessageCount * gActiveMessageInterval);
+	netsocket::Result result = activeSocket.close();
+	netsocket_assert(result == netsocket::Result::Success);
+	silentThread.join();
+	return 0;
+}
@@ -0,0 +1,77 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/server.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+#include "timeouttestconfig.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+static std::atomic<u32> gTimedOutCount = 0;
+static std::atomic<u32> gCompletedCount = 0;
+
+// Echoes messages of exactly gTimeoutMessageSize bytes until the client closes the connection or it has been idle for too long
+static netsocket::ServerTask ServeConnection(netsocket::ServerConnection& connection)
+{
+	connection.setIdleTimeout(gServerIdleTimeout);
+	netsocket::Result result = connection.setWriteTimeout(gServerIdleTimeout);
+	netsocket_assert(result == netsocket::Result::Success);
+	const auto start = std::chrono::steady_clock::now();
+	u8 buffer[gTimeoutMessageSize];
+	u32 requestCount = 0;
+	while(true)
+	{
+		// Not in the loop's condition: GCC 12 miscompiles a co_await there
+		std::optional<u32> size = co_await connection.receive(buffer, gTimeoutMessageSize);
+		if(!size)
+			break;
+		result = connection.send(buffer, *size);
+		netsocket_assert(result == netsocket::Result::Success);
+		++requestCount;
+	}
+	if(connection.isTimedOut())
+	{
+		const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+		spdlog::info("Connection timed out after {} ms of silence", elapsed);
+		// Never early, and late by no more than a few ticks of the shard's timer wheel
+		netsocket_assert((requestCount == 0) && (elapsed >= gServerIdleTimeout) && (elapsed < (gServerIdleTimeout + 500)));
+		connection.close();
+		++gTimedOutCount;
+	}
+	else
+	{
+		spdlog::info("Connection closed by the client after {} requests", requestCount);
+		netsocket_assert(requestCount == gActiveMessageCount);
+		++gCompletedCount;
+	}
+}
+
+int main()
+{
+	spdlog::info("NetSocket connection timeout server");
+
+	std::vector<std::pair<std::string, netsocket::IPv4Address>> ipAddresses = netsocket::GetInterfaceIPv4Addresses();
+	std::string ipAddress = netsocket::TrySelectingPhysicalInterfaceIPAddress(ipAddresses, "192.168.1.1");
+	spdlog::info("Selected IP address: {}", ipAddress);
+
+	netsocket::ServerOptions options;
+	options.shardCount = 1;
+	netsocket::Server server(options);
+	netsocket::Result result = server.listen(ipAddress, gTimeoutPortNumber);
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to listen");
+	result = server.start(ServeConnection);
+	netsocket_assert(result == netsocket::Result::Success);
+	spdlog::info("Listening on {}:{}, idle timeout of {} ms", ipAddress, gTimeoutPortNumber, gServerIdleTimeout);
+
+	while((gTimedOutCount + gCompletedCount) < 2)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	server.stop(1000);
+	netsocket_assert((gTimedOutCount == 1) && (gCompletedCount == 1));
+	spdlog::info("The active connection was served to the end, the silent one timed out");
+	return 0;
+}
@@ -0,0 +1,151 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/timerwheel.hpp>
+#include <netsocket/assert.hpp>
+
+#include <algorithm> // for std::max
+#include <chrono>
+#include <cstdlib> // for std::strtoul
+#include <map>
+#include <random>
+#include <vector>
+
+// Idle timeouts of many connections: every connection arms a timer, some activity moves it, some connections close (cancel),
+// and the event loop advances the clock every tick until all of the remaining timers have fired.
+// The timer wheel is compared against an ordered map of deadlines (what a poll() loop without a wheel would keep), whose operations are O(log n).
+// Usage: timer_wheel_benchmark [connection count, 100000 by default]
+
+static constexpr u32 gDefaultConnectionCount = 100000;
+static constexpr u32 gTickDuration = netsocket::TimerWheel::DefaultTickDuration;
+// Idle timeouts are spread over this range, in milliseconds
+static constexpr u32 gMinTimeout = 1000;
+static constexpr u32 gMaxTimeout = 60000;
+
+using Clock = std::chrono::steady_clock;
+
+static double GetNanosecondsPerOperation(Clock::time_point start, u32 operationCount)
+{
+	return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count()) / operationCount;
+}
+
+static void RunTimerWheel(const std::vector<u32>& timeouts)
+{
+	const u32 count = static_cast<u32>(timeouts.size());
+	netsocket::TimerWheel wheel(gTickDuration);
+	// The wheel counts its ticks from its construction, the simulated clock starts there too (give or take the time it took)
+	const Clock::time_point baseTime = Clock::now();
+	std::vector<netsocket::TimerWheel::TimerId> ids(count);
+	// Simulated time of the advance() in progress, the callbacks check that no timer fires early
+	struct State
+	{
+		u64 now = 0;
+		u32 firedCount = 0;
+	} state;
+	u64& now = state.now;
+	u32& firedCount = state.firedCount;
+
+	Clock::time_point start = Clock::now();
+	for(u32 i = 0; i < count; ++i)
+		// Small enough a capture for std::function not to allocate
+		ids[i] = wheel.schedule(timeouts[i], [&state, timeout = timeouts[i]]()
+		{
+			netsocket_assert(((state.now + gTickDuration) >= timeout) && "A timer fired early");
+			++state.firedCount;
+		});
+	const double scheduleTime = GetNanosecondsPerOperation(start, count);
+	netsocket_assert(wheel.getTimerCount() == count);
+
+	// Activity on every other connection, its timer starts over
+	start = Clock::now();
+	for(u32 i = 0; i < count; i += 2)
+	{
+		bool isRescheduled = wheel.reschedule(ids[i], timeouts[i]);
+		netsocket_assert(isRescheduled);
+	}
+	const double rescheduleTime = GetNanosecondsPerOperation(start, (count + 1) / 2);
+
+	// Every fourth connection closes
+	start = Clock::now();
+	u32 cancelledCount = 0;
+	for(u32 i = 1; i < count; i += 4, ++cancelledCount)
+	{
+		bool isCancelled = wheel.cancel(ids[i]);
+		netsocket_assert(isCancelled);
+	}
+	const double cancelTime = GetNanosecondsPerOperation(start, std::max(cancelledCount, 1u));
+	netsocket_assert(!wheel.cancel(ids[1]) && !wheel.isScheduled(ids[1]));
+
+	// The event loop: one advance() per tick, whether a timer expires or not
+	start = Clock::now();
+	u32 tickCount = 0;
+	for(now = gTickDuration; wheel.getTimerCount() > 0; now += gTickDuration, ++tickCount)
+		wheel.advance(baseTime + std::chrono::milliseconds(now));
+	const double advanceTime = GetNanosecondsPerOperation(start, tickCount);
+	netsocket_assert(firedCount == (count - cancelledCount));
+	netsocket_assert(now <= (gMaxTimeout + 2 * gTickDuration));
+
+	spdlog::info("{:<14} schedule {:>7.1f} ns, reschedule {:>7.1f} ns, cancel {:>7.1f} ns, advance {:>9.1f} ns per tick ({} ticks, {} fired)",
+					"Timer wheel", scheduleTime, rescheduleTime, cancelTime, advanceTime, tickCount, firedCount);
+}
+
+static void RunOrderedMap(const std::vector<u32>& timeouts)
+{
+	const u32 count = static_cast<u32>(timeouts.size());
+	// Deadline in milliseconds, connection index
+	std::multimap<u64, u32> deadlines;
+	std::vector<std::multimap<u64, u32>::iterator> iterators(count);
+
+	Clock::time_point start = Clock::now();
+	for(u32 i = 0; i < count; ++i)
+		iterators[i] = deadlines.emplace(timeouts[i], i);
+	const double scheduleTime = GetNanosecondsPerOperation(start, count);
+
+	start = Clock::now();
+	for(u32 i = 0; i < count; i += 2)
+	{
+		deadlines.erase(iterators[i]);
+		iterators[i] = deadlines.emplace(timeouts[i], i);
+	}
+	const double rescheduleTime = GetNanosecondsPerOperation(start, (count + 1) / 2);
+
+	start = Clock::now();
+	u32 cancelledCount = 0;
+	for(u32 i = 1; i < count; i += 4, ++cancelledCount)
+		deadlines.erase(iterators[i]);
+	const double cancelTime = GetNanosecondsPerOperation(start, std::max(cancelledCount, 1u));
+
+	start = Clock::now();
+	u32 tickCount = 0;
+	u32 firedCount = 0;
+	for(u64 now = gTickDuration; !deadlines.empty(); now += gTickDuration, ++tickCount)
+		while(!deadlines.empty() && (deadlines.begin()->first <= now))
+		{
+			deadlines.erase(deadlines.begin());
+			++firedCount;
+		}
+	const double advanceTime = GetNanosecondsPerOperation(start, tickCount);
+	netsocket_assert(firedCount == (count - cancelledCount));
+
+	spdlog::info("{:<14} schedule {:>7.1f} ns, reschedule {:>7.1f} ns, cancel {:>7.1f} ns, advance {:>9.1f} ns per tick ({} ticks, {} fired)",
+					"Ordered map", scheduleTime, rescheduleTime, cancelTime, advanceTime, tickCount, firedCount);
+}
+
+int main(int argc, const char* argv[])
+{
+	const u32 connectionCount = (argc > 1) ? static_cast<u32>(std::strtoul(argv[1], NULL, 10)) : gDefaultConnectionCount;
+	netsocket_assert(connectionCount > 0);
+	spdlog::info("Timer wheel benchmark, {} connections, idle timeouts between {} and {} ms, tick of {} ms", connectionCount,
+					gMinTimeout, gMaxTimeout, gTickDuration);
+
+	std::mt19937 generator(42);
+	std::uniform_int_distribution<u32> distribution(gMinTimeout, gMaxTimeout);
+	std::vector<u32> timeouts(connectionCount);
+	for(u32& timeout : timeouts)
+		timeout = distribution(generator);
+
+	RunTimerWheel(timeouts);
+	RunOrderedMap(timeouts);
+	return 0;
+}
@@ -0,0 +1,82 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/tls.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+#include "tlstestcredentials.hpp"
+
+#include <cstring> // for std::memcmp
+#include <memory>
+
+static constexpr std::string_view gPortNumber = "8000";
+static constexpr u32 gConnectionCount = 2;
+
+int main()
+{
+	spdlog::info("NetSocket TLS client");
+
+	std::vector<std::pair<std::string, netsocket::IPv4Address>> ipAddresses = netsocket::GetInterfaceIPv4Addresses();
+	std::string ipAddress = netsocket::TrySelectingPhysicalInterfaceIPAddress(ipAddresses, "192.168.1.1");
+	spdlog::info("Selected IP address: {}", ipAddress);
+
+	// The server's certificate is self-signed, so it is its own trust anchor
+	auto tlsContext = std::make_shared<netsocket::TlsContext>(netsocket::TlsRole::Client);
+	netsocket_assert(tlsContext->isValid());
+	netsocket::Result result = tlsContext->setTrustedCertificates(gTestCertificate);
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to set the trusted certificates");
+	if(tlsContext->setKernelOffload(true) != netsocket::Result::Success)
+		spdlog::info("Kernel TLS offload isn't supported");
+
+	for(u32 i = 0; i < gConnectionCount; ++i)
+	{
+		netsocket::Socket mySocket(netsocket::SocketType::Stream,
+									netsocket::IPAddressFamily::IPv4,
+									netsocket::IPProtocol::TCP);
+
+		spdlog::info("Connecting to {}:{}", ipAddress, gPortNumber);
+		result = mySocket.connect(ipAddress, gPortNumber);
+		netsocket_assert((result == netsocket::Result::Success) && "Failed to connect");
+
+		// "localhost" is the name in the certificate, whatever address the server is reached at
+		result = mySocket.startTls(tlsContext, "localhost");
+		netsocket_assert((result == netsocket::Result::Success) && "TLS handshake failed");
+		netsocket::TlsConnection* tls = mySocket.getTlsConnection();
+		spdlog::info("TLS handshake done: {}, {}, session resumed: {}, kernel offload: tx {}, rx {}", tls->getVersion(), tls->getCipherSuite(),
+						mySocket.isTlsSessionResumed(), tls->isKernelTxOffloaded(), tls->isKernelRxOffloaded());
+		netsocket_assert((mySocket.isTlsSessionResumed() == (i > 0)) && "Reconnecting should resume the session");
+
+		spdlog::info("Receiving Data...");
+		constexpr std::string_view refData = "Hello World";
+		char receiveBuffer[refData.size()];
+		result = mySocket.receive(reinterpret_cast<u8*>(receiveBuffer), refData.size());
+		netsocket_assert(result == netsocket::Result::Success);
+		bool isEqual = std::memcmp(receiveBuffer, refData.data(), refData.size()) == 0;
+		netsocket_assert(isEqual);
+		spdlog::info("Received data is correct");
+
+		bool isSent = mySocket.send<u32>(static_cast<u32>(refData.size()));
+		netsocket_assert(isSent);
+
+		// The server sends a file with Socket::sendFile()
+		std::optional<u32> fileSize = mySocket.receive<u32>();
+		netsocket_assert(fileSize.has_value());
+		std::vector<u8> fileData(*fileSize);
+		result = mySocket.receive(fileData.data(), *fileSize);
+		netsocket_assert(result == netsocket::Result::Success);
+		for(u32 j = 0; j < *fileSize; ++j)
+			netsocket_assert((fileData[j] == static_cast<u8>((j * 7 + 3) & 0xFF)) && "File data is corrupted");
+		spdlog::info("Received file of {} bytes, data is correct", *fileSize);
+		isSent = mySocket.send<u8>(1);
+		netsocket_assert(isSent);
+
+		result = mySocket.close();
+		netsocket_assert(result == netsocket::Result::Success);
+		spdlog::info("Connection closed successfully");
+	}
+
+	return 0;
+}
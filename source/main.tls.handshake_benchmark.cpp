@@ -0,0 +1,118 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/tls.hpp>
+#include <netsocket/assert.hpp>
+
+#include "tlstestcredentials.hpp"
+
+#include <chrono>
+#include <thread>
+#include <memory>
+#include <string>
+#include <cstdlib> // for std::strtoul
+
+// Handshake rate over loopback: full handshakes versus handshakes resuming a session (by session ID or by session ticket).
+// Client and server run in this process, so the time covers both sides of every handshake.
+// Usage: tls_handshake_benchmark [handshake count per case, 1000 by default]
+
+static constexpr std::string_view gIPAddress = "127.0.0.1";
+static constexpr std::string_view gPortNumber = "8001";
+static constexpr u32 gDefaultHandshakeCount = 1000;
+
+struct BenchmarkCase
+{
+	std::string_view name;
+	netsocket::TlsSessionCacheOptions serverCacheOptions;
+	netsocket::TlsSessionCacheOptions clientCacheOptions;
+};
+
+static netsocket::Socket CreateTcpSocket()
+{
+	return netsocket::Socket(netsocket::SocketType::Stream, netsocket::IPAddressFamily::IPv4, netsocket::IPProtocol::TCP);
+}
+
+// Accepts 'count' connections, performs the handshake and echoes one byte on each
+static void RunServer(netsocket::Socket& listeningSocket, const std::shared_ptr<netsocket::TlsContext>& tlsContext, u32 count)
+{
+	for(u32 i = 0; i < count; ++i)
+	{
+		std::optional<netsocket::Socket> socket = listeningSocket.accept();
+		netsocket_assert(socket.has_value());
+		netsocket::Result result = socket->startTls(tlsContext);
+		netsocket_assert(result == netsocket::Result::Success);
+		std::optional<u8> value = socket->receive<u8>();
+		netsocket_assert(value.has_value());
+		socket->send<u8>(*value);
+		socket->close();
+	}
+}
+
+// Connects, performs the handshake and exchanges one byte, returns true if the session was resumed
+static bool RunClientConnection(const std::shared_ptr<netsocket::TlsContext>& tlsContext)
+{
+	netsocket::Socket socket = CreateTcpSocket();
+	netsocket::Result result = socket.connect(gIPAddress, gPortNumber);
+	netsocket_assert(result == netsocket::Result::Success);
+	result = socket.startTls(tlsContext, "localhost");
+	netsocket_assert(result == netsocket::Result::Success);
+	bool isSent = socket.send<u8>(1);
+	netsocket_assert(isSent);
+	std::optional<u8> value = socket.receive<u8>();
+	netsocket_assert(value.has_value() && (*value == 1));
+	const bool isResumed = socket.isTlsSessionResumed();
+	socket.close();
+	return isResumed;
+}
+
+static void RunBenchmarkCase(netsocket::Socket& listeningSocket, const BenchmarkCase& benchmarkCase, u32 handshakeCount)
+{
+	auto serverContext = std::make_shared<netsocket::TlsContext>(netsocket::TlsRole::Server, benchmarkCase.serverCacheOptions);
+	netsocket::Result result = serverContext->setCertificate(gTestCertificate, gTestPrivateKey);
+	netsocket_assert(result == netsocket::Result::Success);
+	auto clientContext = std::make_shared<netsocket::TlsContext>(netsocket::TlsRole::Client, benchmarkCase.clientCacheOptions);
+	result = clientContext->setTrustedCertificates(gTestCertificate);
+	netsocket_assert(result == netsocket::Result::Success);
+
+	// One more connection than measured, the first one establishes the session to resume
+	std::thread serverThread(RunServer, std::ref(listeningSocket), serverContext, handshakeCount + 1);
+	RunClientConnection(clientContext);
+
+	u32 resumedCount = 0;
+	auto start = std::chrono::steady_clock::now();
+	for(u32 i = 0; i < handshakeCount; ++i)
+		resumedCount += RunClientConnection(clientContext) ? 1 : 0;
+	auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	serverThread.join();
+
+	spdlog::info("{:<26} {:>9.1f} handshakes/s {:>9.1f} us/handshake, {} of {} resumed", benchmarkCase.name,
+					handshakeCount / elapsed, elapsed * 1e6 / handshakeCount, resumedCount, handshakeCount);
+}
+
+int main(int argc, const char* argv[])
+{
+	const u32 handshakeCount = (argc > 1) ? static_cast<u32>(std::strtoul(argv[1], NULL, 10)) : gDefaultHandshakeCount;
+	netsocket_assert(handshakeCount > 0);
+	spdlog::info("TLS handshake benchmark, {} handshakes per case over {}:{}", handshakeCount, gIPAddress, gPortNumber);
+
+	netsocket::Socket listeningSocket = CreateTcpSocket();
+	netsocket::Result result = listeningSocket.bind(gIPAddress, gPortNumber);
+	netsocket_assert(result == netsocket::Result::Success);
+	result = listeningSocket.listen();
+	netsocket_assert(result == netsocket::Result::Success);
+
+	const netsocket::TlsSessionCacheOptions sessionIdOptions { 1000, 86400, false };
+	const netsocket::TlsSessionCacheOptions ticketServerOptions { 0, 86400, true };
+	const netsocket::TlsSessionCacheOptions ticketClientOptions { 1000, 86400, true };
+	const BenchmarkCase cases[] =
+	{
+		{ "full handshake", netsocket::TlsSessionCacheOptions::Disabled(), netsocket::TlsSessionCacheOptions::Disabled() },
+		{ "resumed (session ID)", sessionIdOptions, sessionIdOptions },
+		{ "resumed (session ticket)", ticketServerOptions, ticketClientOptions }
+	};
+	for(const BenchmarkCase& benchmarkCase : cases)
+		RunBenchmarkCase(listeningSocket, benchmarkCase, handshakeCount);
+	return 0;
+}
@@ -0,0 +1,98 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/tls.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+#include "tlstestcredentials.hpp"
+
+#include <cstring>
+#include <memory>
+#include <filesystem>
+#include <fstream>
+
+static constexpr std::string_view gPortNumber = "8000";
+// The first connection performs a full handshake, the second one resumes its session
+static constexpr u32 gConnectionCount = 2;
+// Sent with Socket::sendFile(), not a multiple of the record size on purpose
+static constexpr u32 gFileSize = 1024 * 1024 + 123;
+
+// Same pattern as the client checks
+static std::string CreateTestFile()
+{
+	std::string path = (std::filesystem::temp_directory_path() / "netsocket_tls_sendfile_test.bin").string();
+	std::ofstream file(path, std::ios::binary);
+	for(u32 i = 0; i < gFileSize; ++i)
+		file.put(static_cast<char>((i * 7 + 3) & 0xFF));
+	return path;
+}
+
+int main()
+{
+	spdlog::info("NetSocket TLS server");
+
+	std::vector<std::pair<std::string, netsocket::IPv4Address>> ipAddresses = netsocket::GetInterfaceIPv4Addresses();
+	std::string ipAddress = netsocket::TrySelectingPhysicalInterfaceIPAddress(ipAddresses, "192.168.1.1");
+	spdlog::info("Selected IP address: {}", ipAddress);
+
+	auto tlsContext = std::make_shared<netsocket::TlsContext>(netsocket::TlsRole::Server);
+	netsocket_assert(tlsContext->isValid());
+	netsocket::Result result = tlsContext->setCertificate(gTestCertificate, gTestPrivateKey);
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to set the certificate");
+	// Only takes effect on Linux with the tls module loaded, the connections fall back to the user-space record layer otherwise
+	if(tlsContext->setKernelOffload(true) != netsocket::Result::Success)
+		spdlog::info("Kernel TLS offload isn't supported");
+	const std::string filePath = CreateTestFile();
+
+	netsocket::Socket mySocket(netsocket::SocketType::Stream,
+								netsocket::IPAddressFamily::IPv4,
+								netsocket::IPProtocol::TCP);
+
+	result = mySocket.bind(ipAddress, gPortNumber);
+	netsocket_assert(result == netsocket::Result::Success);
+
+	spdlog::info("Listening on {}:{}", ipAddress, gPortNumber);
+	result = mySocket.listen();
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to listen");
+
+	for(u32 i = 0; i < gConnectionCount; ++i)
+	{
+		spdlog::info("Waiting to accept connection");
+		std::optional<netsocket::Socket> clientSocket = mySocket.accept();
+		netsocket_assert(clientSocket.has_value() && "Failed to accept connection");
+
+		result = clientSocket->startTls(tlsContext);
+		netsocket_assert((result == netsocket::Result::Success) && "TLS handshake failed");
+		netsocket::TlsConnection* tls = clientSocket->getTlsConnection();
+		spdlog::info("TLS handshake done: {}, {}, session resumed: {}, kernel offload: tx {}, rx {}", tls->getVersion(), tls->getCipherSuite(),
+						clientSocket->isTlsSessionResumed(), tls->isKernelTxOffloaded(), tls->isKernelRxOffloaded());
+		netsocket_assert((clientSocket->isTlsSessionResumed() == (i > 0)) && "Only the first connection should perform a full handshake");
+
+		const char* data = "Hello World";
+		result = clientSocket->send(reinterpret_cast<const u8*>(data), std::strlen(data));
+		netsocket_assert(result == netsocket::Result::Success);
+
+		std::optional<u32> receivedSize = clientSocket->receive<u32>();
+		netsocket_assert(receivedSize.has_value() && (*receivedSize == std::strlen(data)));
+		spdlog::info("Client acknowledged {} bytes", *receivedSize);
+
+		spdlog::info("Sending file of {} bytes", gFileSize);
+		bool isSent = clientSocket->send<u32>(gFileSize);
+		netsocket_assert(isSent);
+		result = clientSocket->sendFile(filePath);
+		netsocket_assert(result == netsocket::Result::Success);
+		std::optional<u8> fileAck = clientSocket->receive<u8>();
+		netsocket_assert(fileAck.has_value() && (*fileAck == 1));
+		spdlog::info("Client received the file");
+
+		result = clientSocket->close();
+		netsocket_assert(result == netsocket::Result::Success);
+		spdlog::info("Connection closed successfully");
+	}
+
+	std::filesystem::remove(filePath);
+	return 0;
+}
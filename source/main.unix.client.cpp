@@ -0,0 +1,80 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+#include "unixtestpaths.hpp"
+
+#include <cstring> // for std::memcmp
+#include <vector>
+
+static constexpr std::string_view gPortNumber = "8000";
+
+int main()
+{
+	spdlog::info("NetSocket Unix domain socket client");
+
+	std::vector<std::pair<std::string, netsocket::IPv4Address>> ipAddresses = netsocket::GetInterfaceIPv4Addresses();
+	std::string ipAddress = netsocket::TrySelectingPhysicalInterfaceIPAddress(ipAddresses, "192.168.1.1");
+	spdlog::info("Selected IP address: {}", ipAddress);
+
+	const std::string path = GetUnixStreamTestPath();
+	netsocket::Socket unixSocket(netsocket::SocketType::Stream, netsocket::IPAddressFamily::Unix, netsocket::IPProtocol::Default);
+	spdlog::info("Connecting to {}", path);
+	netsocket::Result result = unixSocket.connectUnix(path);
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to connect");
+
+	constexpr std::string_view refData = "Hello World";
+	char receiveBuffer[refData.size()];
+	result = unixSocket.receive(reinterpret_cast<u8*>(receiveBuffer), refData.size());
+	netsocket_assert(result == netsocket::Result::Success);
+	netsocket_assert(std::memcmp(receiveBuffer, refData.data(), refData.size()) == 0);
+	bool isSent = unixSocket.send<u32>(static_cast<u32>(refData.size()));
+	netsocket_assert(isSent);
+	spdlog::info("Received data is correct");
+
+	// The server accepts this connection and passes its end of it back over the Unix domain socket
+	netsocket::Socket tcpSocket(netsocket::SocketType::Stream, netsocket::IPAddressFamily::IPv4, netsocket::IPProtocol::TCP);
+	result = tcpSocket.connect(ipAddress, gPortNumber);
+	netsocket_assert(result == netsocket::Result::Success);
+	std::optional<netsocket::Socket> handedSocket = unixSocket.receiveSocket();
+	netsocket_assert(handedSocket.has_value() && handedSocket->isConnected() && "Failed to receive the TCP connection");
+	isSent = tcpSocket.send<u32>(0x12345678);
+	netsocket_assert(isSent);
+	std::optional<u32> value = handedSocket->receive<u32>();
+	netsocket_assert(value.has_value() && (*value == 0x12345678));
+	isSent = handedSocket->send<u32>(0x87654321);
+	netsocket_assert(isSent);
+	value = tcpSocket.receive<u32>();
+	netsocket_assert(value.has_value() && (*value == 0x87654321));
+	handedSocket->close();
+	tcpSocket.close();
+	spdlog::info("Exchanged data over the handed over TCP connection");
+	isSent = unixSocket.send<u8>(1);
+	netsocket_assert(isSent);
+
+	netsocket::Socket datagramSocket(netsocket::SocketType::Datagram, netsocket::IPAddressFamily::Unix, netsocket::IPProtocol::Default);
+	result = datagramSocket.connectUnix(gUnixDatagramTestName);
+	netsocket_assert(result == netsocket::Result::Success);
+	for(u32 size : gUnixDatagramSizes)
+	{
+		std::vector<u8> datagram(size);
+		for(u32 i = 0; i < size; ++i)
+			datagram[i] = static_cast<u8>(i);
+		result = datagramSocket.send(datagram.data(), size);
+		netsocket_assert(result == netsocket::Result::Success);
+	}
+	spdlog::info("Sent {} datagrams", std::size(gUnixDatagramSizes));
+
+	// Until the server has received the datagrams
+	std::optional<u8> end = unixSocket.receive<u8>();
+	netsocket_assert(!end.has_value());
+	datagramSocket.close();
+	result = unixSocket.close();
+	netsocket_assert(result == netsocket::Result::Success);
+	spdlog::info("Connection closed successfully");
+	return 0;
+}
@@ -0,0 +1,82 @@
+#include <iostream>
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <netsocket/netsocket.hpp>
+#include <netsocket/netinterface.hpp>
+#include <netsocket/assert.hpp>
+
+#include "unixtestpaths.hpp"
+
+#include <cstring> // for std::strlen
+#include <filesystem>
+
+static constexpr std::string_view gPortNumber = "8000";
+
+int main()
+{
+	spdlog::info("NetSocket Unix domain socket server");
+
+	std::vector<std::pair<std::string, netsocket::IPv4Address>> ipAddresses = netsocket::GetInterfaceIPv4Addresses();
+	std::string ipAddress = netsocket::TrySelectingPhysicalInterfaceIPAddress(ipAddresses, "192.168.1.1");
+	spdlog::info("Selected IP address: {}", ipAddress);
+
+	netsocket::Socket datagramSocket(netsocket::SocketType::Datagram, netsocket::IPAddressFamily::Unix, netsocket::IPProtocol::Default);
+	netsocket::Result result = datagramSocket.bindUnix(gUnixDatagramTestName);
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to bind the datagram socket");
+
+	// A previous run may have left the socket file behind
+	const std::string path = GetUnixStreamTestPath();
+	std::filesystem::remove(path);
+	netsocket::Socket unixSocket(netsocket::SocketType::Stream, netsocket::IPAddressFamily::Unix, netsocket::IPProtocol::Default);
+	result = unixSocket.bindUnix(path);
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to bind the Unix domain socket");
+	result = unixSocket.listen();
+	netsocket_assert(result == netsocket::Result::Success);
+
+	// Its connection is handed over to the client process
+	netsocket::Socket tcpSocket(netsocket::SocketType::Stream, netsocket::IPAddressFamily::IPv4, netsocket::IPProtocol::TCP);
+	result = tcpSocket.bind(ipAddress, gPortNumber);
+	netsocket_assert(result == netsocket::Result::Success);
+	result = tcpSocket.listen();
+	netsocket_assert(result == netsocket::Result::Success);
+	spdlog::info("Listening on {}, {} and {}:{}", path, gUnixDatagramTestName, ipAddress, gPortNumber);
+
+	std::optional<netsocket::Socket> clientSocket = unixSocket.accept();
+	netsocket_assert(clientSocket.has_value() && "Failed to accept connection");
+	const char* data = "Hello World";
+	result = clientSocket->send(reinterpret_cast<const u8*>(data), std::strlen(data));
+	netsocket_assert(result == netsocket::Result::Success);
+	std::optional<u32> receivedSize = clientSocket->receive<u32>();
+	netsocket_assert(receivedSize.has_value() && (*receivedSize == std::strlen(data)));
+	spdlog::info("Client acknowledged {} bytes over the Unix domain socket", *receivedSize);
+
+	std::optional<netsocket::Socket> tcpConnection = tcpSocket.accept();
+	netsocket_assert(tcpConnection.has_value() && "Failed to accept the TCP connection");
+	result = clientSocket->sendSocket(*tcpConnection);
+	netsocket_assert((result == netsocket::Result::Success) && "Failed to pass the TCP connection");
+	// The client's copy keeps the connection open
+	tcpConnection->close();
+	spdlog::info("Handed the TCP connection over to the client");
+	std::optional<u8> handOffAck = clientSocket->receive<u8>();
+	netsocket_assert(handOffAck.has_value() && (*handOffAck == 1));
+
+	u8 buffer[2048];
+	for(u32 size : gUnixDatagramSizes)
+	{
+		std::optional<u32> datagramSize = datagramSocket.receiveSome(buffer, sizeof(buffer));
+		netsocket_assert(datagramSize.has_value() && (*datagramSize == size) && "Datagram boundaries aren't preserved");
+		for(u32 i = 0; i < size; ++i)
+			netsocket_assert(buffer[i] == static_cast<u8>(i));
+	}
+	spdlog::info("Received {} datagrams", std::size(gUnixDatagramSizes));
+
+	result = clientSocket->close();
+	netsocket_assert(result == netsocket::Result::Success);
+	datagramSocket.close();
+	unixSocket.close();
+	tcpSocket.close();
+	std::filesystem::remove(path);
+	spdlog::info("Connection closed successfully");
+	return 0;
+}
@@ -0,0 +1,197 @@
+#include <netsocket/messagesocket.hpp>
+#include <netsocket/assert.hpp>
+
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <algorithm> // for std::min
+#include <cstring> // for std::memcpy, std::memmove
+#include <limits>
+
+namespace netsocket
+{
+	static u32 GetFixedHeaderSize(MessageHeader header)
+	{
+		switch(header)
+		{
+			case MessageHeader::U16: return 2;
+			case MessageHeader::U32: return 4;
+			case MessageHeader::U64: return 8;
+			default: return 0;
+		}
+	}
+
+	MessageSocket::MessageSocket(Socket& socket, const MessageFramingOptions& options) : m_socket(socket),
+																					m_options(options),
+																					m_readAhead(std::max<u32>(options.readAheadSize, MaxHeaderSize)),
+																					m_readBegin(0),
+																					m_readEnd(0),
+																					m_remainingDataSize(0)
+	{
+	}
+
+	u32 MessageSocket::getMaxMessageSize() const noexcept
+	{
+		if(m_options.header == MessageHeader::U16)
+			return std::min<u32>(m_options.maxMessageSize, std::numeric_limits<u16>::max());
+		return m_options.maxMessageSize;
+	}
+
+	u32 MessageSocket::encodeHeader(u32 size, u8* header) const noexcept
+	{
+		if(m_options.header == MessageHeader::VarInt)
+		{
+			u32 length = 0;
+			while(size >= 0x80)
+			{
+				header[length++] = static_cast<u8>(size | 0x80);
+				size >>= 7;
+			}
+			header[length++] = static_cast<u8>(size);
+			return length;
+		}
+		const u32 length = GetFixedHeaderSize(m_options.header);
+		const u64 value = size;
+		for(u32 i = 0; i < length; ++i)
+			header[i] = static_cast<u8>(value >> (i * 8));
+		return length;
+	}
+
+	Result MessageSocket::sendMessage(const u8* bytes, u32 size)
+	{
+		const SocketBuffer buffer { bytes, size };
+		return sendMessageVectored(&buffer, 1);
+	}
+
+	Result MessageSocket::sendMessageVectored(const SocketBuffer* buffers, u32 count)
+	{
+		if(count > MaxVectoredBufferCount)
+		{
+			spdlog::error("Message of {} buffers has more than the maximum of {} buffers", count, MaxVectoredBufferCount);
+			return Result::Failed;
+		}
+		u64 size = 0;
+		for(u32 i = 0; i < count; ++i)
+			size += buffers[i].size;
+		if(size > getMaxMessageSize())
+		{
+			spdlog::error("Message of {} bytes is larger than the maximum of {} bytes", size, getMaxMessageSize());
+			return Result::Failed;
+		}
+		u8 header[MaxHeaderSize];
+		SocketBuffer messageBuffers[MaxVectoredBufferCount + 1];
+		messageBuffers[0] = { header, encodeHeader(static_cast<u32>(size), header) };
+		std::copy(buffers, buffers + count, messageBuffers + 1);
+		return m_socket.sendVectored(messageBuffers, count + 1);
+	}
+
+	Result MessageSocket::receiveMessage(std::vector<u8>& message)
+	{
+		std::optional<u32> size = receiveMessageSize();
+		if(!size)
+			return Result::SocketError;
+		message.resize(*size);
+		return receiveMessageData(message.data(), *size);
+	}
+
+	bool MessageSocket::fillReadAhead()
+	{
+		if(m_readBegin == m_readEnd)
+			m_readBegin = m_readEnd = 0;
+		else if(m_readEnd == m_readAhead.size())
+		{
+			// Only a partial header can be left over here, move it to the front
+			std::memmove(m_readAhead.data(), m_readAhead.data() + m_readBegin, m_readEnd - m_readBegin);
+			m_readEnd -= m_readBegin;
+			m_readBegin = 0;
+		}
+		std::optional<u32> result = m_socket.receiveSome(m_readAhead.data() + m_readEnd, static_cast<u32>(m_readAhead.size()) - m_readEnd);
+		if(!result)
+			return false;
+		m_readEnd += *result;
+		return true;
+	}
+
+	std::optional<u64> MessageSocket::receiveHeader()
+	{
+		if(m_options.header != MessageHeader::VarInt)
+		{
+			const u32 length = GetFixedHeaderSize(m_options.header);
+			while(getBufferedSize() < length)
+				if(!fillReadAhead())
+					return { };
+			u64 value = 0;
+			for(u32 i = 0; i < length; ++i)
+				value |= static_cast<u64>(m_readAhead[m_readBegin + i]) << (i * 8);
+			m_readBegin += length;
+			return { value };
+		}
+
+		u32 length = 0;
+		while(true)
+		{
+			// Decodes what has been received so far, 'length' is the number of bytes decoded
+			u64 value = 0;
+			for(length = 0; (length < getBufferedSize()) && (length < MaxHeaderSize); ++length)
+			{
+				const u8 byte = m_readAhead[m_readBegin + length];
+				value |= static_cast<u64>(byte & 0x7F) << (length * 7);
+				if((byte & 0x80) == 0)
+				{
+					m_readBegin += length + 1;
+					return { value };
+				}
+			}
+			if(length == MaxHeaderSize)
+			{
+				spdlog::error("Message header is longer than {} bytes", MaxHeaderSize);
+				return { };
+			}
+			if(!fillReadAhead())
+				return { };
+		}
+	}
+
+	std::optional<u32> MessageSocket::receiveMessageSize()
+	{
+		netsocket_assert((m_remainingDataSize == 0) && "The data of the previous message hasn't been received");
+		std::optional<u64> size = receiveHeader();
+		if(!size)
+			return { };
+		if(*size > getMaxMessageSize())
+		{
+			spdlog::error("Received message of {} bytes, larger than the maximum of {} bytes", *size, getMaxMessageSize());
+			return { };
+		}
+		m_remainingDataSize = static_cast<u32>(*size);
+		return { m_remainingDataSize };
+	}
+
+	Result MessageSocket::receiveMessageData(u8* bytes, u32 size)
+	{
+		netsocket_assert((size == m_remainingDataSize) && "Must receive exactly the size returned by receiveMessageSize()");
+		const u32 bufferedSize = std::min(getBufferedSize(), size);
+		std::memcpy(bytes, m_readAhead.data() + m_readBegin, bufferedSize);
+		m_readBegin += bufferedSize;
+		u32 receivedSize = bufferedSize;
+		// Large data skips the read-ahead buffer, small data goes through it to pick up the next messages along
+		if((size - receivedSize) >= m_readAhead.size())
+		{
+			Result result = m_socket.receive(bytes + receivedSize, size - receivedSize);
+			if(result != Result::Success)
+				return result;
+			receivedSize = size;
+		}
+		while(receivedSize < size)
+		{
+			if(!fillReadAhead())
+				return Result::SocketError;
+			const u32 copySize = std::min(getBufferedSize(), size - receivedSize);
+			std::memcpy(bytes + receivedSize, m_readAhead.data() + m_readBegin, copySize);
+			m_readBegin += copySize;
+			receivedSize += copySize;
+		}
+		m_remainingDataSize = 0;
+		return Result::Success;
+	}
+}
@@ -0,0 +1,74 @@
+#include <netsocket/multicast.hpp>
+#include <netsocket/assert.hpp>
+
+namespace netsocket
+{
+	static IPAddressFamily GetGroupFamily(const std::string_view group)
+	{
+		return (group.find(':') != std::string_view::npos) ? IPAddressFamily::IPv6 : IPAddressFamily::IPv4;
+	}
+
+	MulticastPublisher::MulticastPublisher(const std::string_view group, const std::string_view port, const MulticastOptions& options) :
+																					m_socket(SocketType::Datagram, GetGroupFamily(group), IPProtocol::UDP)
+	{
+		if(!m_socket.isValid())
+			return;
+		if((!options.networkInterface.empty() && (m_socket.setMulticastInterface(options.networkInterface) != Result::Success))
+			|| (m_socket.setMulticastTTL(options.ttl) != Result::Success)
+			|| (m_socket.setMulticastLoopback(options.isLoopbackEnabled) != Result::Success))
+		{
+			m_socket.close();
+			return;
+		}
+		// Connected to the group, so that every send goes there without an address
+		if(m_socket.connect(std::string { group }, std::string { port }) != Result::Success)
+			m_socket.close();
+	}
+
+	Result MulticastPublisher::publish(const u8* bytes, u32 size)
+	{
+		const SocketBuffer datagram { bytes, size };
+		return m_socket.sendDatagrams(&datagram, 1);
+	}
+
+	Result MulticastPublisher::publishBatch(const SocketBuffer* datagrams, u32 count)
+	{
+		return m_socket.sendDatagrams(datagrams, count);
+	}
+
+	MulticastSubscriber::MulticastSubscriber(const std::string_view group, const std::string_view port, const MulticastOptions& options) :
+																					m_socket(SocketType::Datagram, GetGroupFamily(group), IPProtocol::UDP),
+																					m_options(options),
+																					m_buffer(static_cast<std::size_t>(options.batchSize) * options.maxDatagramSize),
+																					m_datagrams(options.batchSize)
+	{
+		netsocket_assert((options.batchSize > 0) && (options.maxDatagramSize > 0));
+		for(u32 i = 0; i < options.batchSize; ++i)
+			m_datagrams[i] = { m_buffer.data() + static_cast<std::size_t>(i) * options.maxDatagramSize, options.maxDatagramSize, 0, false };
+		if(!m_socket.isValid())
+			return;
+		// The wildcard address, so that the groups joined later are received too (Windows can't bind to a multicast address anyway)
+		const std::string bindAddress = (GetGroupFamily(group) == IPAddressFamily::IPv6) ? "::" : "0.0.0.0";
+		// isValid() reports whether the subscriber can receive, so the socket is closed if it can't be set up
+		if((m_socket.bind(bindAddress, std::string { port }) != Result::Success) || (join(group) != Result::Success))
+			m_socket.close();
+	}
+
+	Result MulticastSubscriber::join(const std::string_view group)
+	{
+		return m_socket.joinMulticastGroup(group, m_options.networkInterface);
+	}
+
+	Result MulticastSubscriber::leave(const std::string_view group)
+	{
+		return m_socket.leaveMulticastGroup(group, m_options.networkInterface);
+	}
+
+	std::optional<std::span<const SocketDatagram>> MulticastSubscriber::receiveBatch(s32 timeout)
+	{
+		std::optional<u32> count = m_socket.receiveDatagrams(m_datagrams.data(), static_cast<u32>(m_datagrams.size()), timeout);
+		if(!count)
+			return { };
+		return { std::span<const SocketDatagram>(m_datagrams.data(), *count) };
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <common/defines.hpp>
+
+#include <string_view>
+
+// Shared by the multicast test client and server: administratively scoped group (RFC 2365), sent over the loopback interface
+static constexpr std::string_view gMulticastGroup = "239.255.42.1";
+static constexpr std::string_view gMulticastPort = "8001";
+static constexpr std::string_view gMulticastInterface = "127.0.0.1";
+// The client publishes the datagrams in rounds, the server acknowledges each round over TCP so that none overflows the receive buffer
+static constexpr u32 gMulticastRoundCount = 20;
+static constexpr u32 gMulticastRoundSize = 100;
+// Sequence number (u32) followed by a pattern derived from it
+static constexpr u32 gMulticastDatagramSize = 256;
+
+static u8 GetMulticastTestByte(u32 sequence, u32 index)
+{
+	return static_cast<u8>((sequence * 31 + index) & 0xFF);
+}
@@ -0,0 +1,1341 @@
+#include <netsocket/nativewebsocket.hpp>
+#include <netsocket/zstream.hpp>
+#include <netsocket/tls.hpp>
+#include <netsocket/assert.hpp>
+
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <mbedtls/version.h>
+#include <mbedtls/sha1.h>
+#include <mbedtls/base64.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/ctr_drbg.h>
+
+#include <cstring> // for std::memcpy, std::memcmp
+#include <algorithm> // for std::min, std::clamp, std::search, std::sort, std::binary_search
+#include <cctype> // for std::tolower
+#include <charconv> // for std::from_chars
+#include <limits>
+
+namespace netsocket
+{
+	static constexpr std::string_view gWebSocketGUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+	static constexpr std::string_view gHttpHeaderTerminator = "\r\n\r\n";
+	static constexpr u32 gMaxHttpHeaderSize = 8 * 1024;
+	static constexpr u32 gReadBufferSize = 64 * 1024;
+	static constexpr u64 gDefaultMaxMessageSize = 64 * 1024 * 1024;
+	static constexpr std::chrono::milliseconds gDefaultHandshakeTimeout { 10000 };
+	// Unmasked payloads up to this size are copied next to the frame header so that the frame goes out with a single send()
+	static constexpr u64 gMaxCoalescedPayloadSize = 16 * 1024;
+	// Masked payloads are masked (copied) into the send buffer in chunks of this size, which bounds the send buffer
+	static constexpr u64 gMaskChunkSize = 64 * 1024;
+	// Compressed input read ahead by receiveChunk(), which bounds its memory use along with the caller's chunk size
+	static constexpr u32 gStreamInputSize = 16 * 1024;
+	// Trailer of a Z_SYNC_FLUSH, stripped from compressed messages and appended back before inflating them (RFC 7692, section 7.2)
+	static constexpr u8 gDeflateTrailer[4] = { 0x00, 0x00, 0xFF, 0xFF };
+
+	// Removes the 00 00 FF FF trailer of a sync flushed message, the receiver appends it back (RFC 7692, section 7.2.1).
+	// zlib produces nothing at all when there is nothing to flush, in which case a single 0x00 (empty stored block header)
+	// is sent instead, so that the trailer appended by the receiver completes a block (section 7.2.3.6)
+	static void StripDeflateTrailer(std::vector<u8>& payload)
+	{
+		if((payload.size() >= sizeof(gDeflateTrailer)) && (std::memcmp(payload.data() + payload.size() - sizeof(gDeflateTrailer), gDeflateTrailer, sizeof(gDeflateTrailer)) == 0))
+			payload.resize(payload.size() - sizeof(gDeflateTrailer));
+		else if(payload.empty())
+			payload.push_back(0x00);
+	}
+
+	struct NativeWebSocket::ClientRegistry
+	{
+		std::mutex mutex;
+		std::vector<NativeWebSocket*> clients;
+	};
+
+	// Masking keys must not be predictable from the previous ones (RFC 6455, section 10.3), so they come from a CTR_DRBG
+	// seeded from the system's entropy rather than from a general purpose generator. Every masked frame needs 4 bytes,
+	// they are drawn a block at a time.
+	struct NativeWebSocket::RandomGenerator
+	{
+		mbedtls_entropy_context entropy;
+		mbedtls_ctr_drbg_context ctrDrbg;
+		u8 buffer[256];
+		u32 bufferOffset;
+		bool isValid;
+
+		RandomGenerator() : bufferOffset(sizeof(buffer)), isValid(false)
+		{
+			mbedtls_entropy_init(&entropy);
+			mbedtls_ctr_drbg_init(&ctrDrbg);
+			static constexpr std::string_view personalization = "netsocket websocket";
+			int result = mbedtls_ctr_drbg_seed(&ctrDrbg, mbedtls_entropy_func, &entropy, reinterpret_cast<const unsigned char*>(personalization.data()), personalization.size());
+			if(result != 0)
+				spdlog::error("mbedtls_ctr_drbg_seed failed, error: {}", result);
+			isValid = result == 0;
+		}
+		RandomGenerator(RandomGenerator&) = delete;
+		~RandomGenerator()
+		{
+			mbedtls_ctr_drbg_free(&ctrDrbg);
+			mbedtls_entropy_free(&entropy);
+		}
+
+		bool generate(u8* bytes, u32 size)
+		{
+			if(!isValid)
+				return false;
+			while(size > 0)
+			{
+				if(bufferOffset == sizeof(buffer))
+				{
+					if(mbedtls_ctr_drbg_random(&ctrDrbg, buffer, sizeof(buffer)) != 0)
+						return false;
+					bufferOffset = 0;
+				}
+				const u32 count = std::min<u32>(size, sizeof(buffer) - bufferOffset);
+				std::memcpy(bytes, buffer + bufferOffset, count);
+				bufferOffset += count;
+				bytes += count;
+				size -= count;
+			}
+			return true;
+		}
+	};
+
+	static std::string Base64Encode(const u8* bytes, u32 size)
+	{
+		std::string str(4 * ((size + 2) / 3) + 1, '\0');
+		std::size_t length = 0;
+		int result = mbedtls_base64_encode(reinterpret_cast<unsigned char*>(str.data()), str.size(), &length, bytes, size);
+		netsocket_assert(result == 0);
+		str.resize(length);
+		return str;
+	}
+
+	static std::string ComputeAcceptKey(const std::string_view key)
+	{
+		std::string str { key };
+		str.append(gWebSocketGUID);
+		u8 digest[20];
+#if MBEDTLS_VERSION_MAJOR >= 3
+		int result = mbedtls_sha1(reinterpret_cast<const unsigned char*>(str.data()), str.size(), digest);
+#else
+		int result = mbedtls_sha1_ret(reinterpret_cast<const unsigned char*>(str.data()), str.size(), digest);
+#endif
+		netsocket_assert(result == 0);
+		return Base64Encode(digest, sizeof(digest));
+	}
+
+	static std::string_view Trim(std::string_view str)
+	{
+		while(!str.empty() && ((str.front() == ' ') || (str.front() == '\t')))
+			str.remove_prefix(1);
+		while(!str.empty() && ((str.back() == ' ') || (str.back() == '\t')))
+			str.remove_suffix(1);
+		return str;
+	}
+
+	static bool EqualsIgnoreCase(const std::string_view str1, const std::string_view str2)
+	{
+		return std::equal(str1.begin(), str1.end(), str2.begin(), str2.end(), [](char c1, char c2)
+		{
+			return std::tolower(static_cast<unsigned char>(c1)) == std::tolower(static_cast<unsigned char>(c2));
+		});
+	}
+
+	// Visits each element of a 'separator' separated list, with surrounding whitespaces trimmed
+	template<typename Visitor>
+	static void ForEachListElement(std::string_view list, char separator, Visitor visitor)
+	{
+		while(true)
+		{
+			std::size_t index = list.find(separator);
+			if(!visitor(Trim(list.substr(0, index))))
+				return;
+			if(index == std::string_view::npos)
+				return;
+			list.remove_prefix(index + 1);
+		}
+	}
+
+	// True if the comma separated header value (e.g. 'Connection: keep-alive, Upgrade') contains 'token'
+	static bool ContainsToken(const std::string_view list, const std::string_view token)
+	{
+		bool isFound = false;
+		ForEachListElement(list, ',', [&isFound, token](std::string_view element)
+		{
+			isFound = EqualsIgnoreCase(element, token);
+			return !isFound;
+		});
+		return isFound;
+	}
+
+	struct HttpHeader
+	{
+		std::string_view startLine;
+		std::vector<std::pair<std::string_view, std::string_view>> fields;
+
+		std::optional<std::string_view> get(const std::string_view name) const
+		{
+			for(const auto& field : fields)
+				if(EqualsIgnoreCase(field.first, name))
+					return { field.second };
+			return { };
+		}
+	};
+
+	// 'text' must outlive the returned HttpHeader, the fields are views into it
+	static std::optional<HttpHeader> ParseHttpHeader(std::string_view text)
+	{
+		HttpHeader header;
+		bool isStartLine = true;
+		bool isValid = true;
+		while(!text.empty())
+		{
+			std::size_t index = text.find("\r\n");
+			std::string_view line = text.substr(0, index);
+			text.remove_prefix((index == std::string_view::npos) ? text.size() : (index + 2));
+			if(line.empty())
+				break;
+			if(isStartLine)
+			{
+				header.startLine = line;
+				isStartLine = false;
+				continue;
+			}
+			std::size_t colonIndex = line.find(':');
+			if(colonIndex == std::string_view::npos)
+			{
+				isValid = false;
+				break;
+			}
+			header.fields.push_back({ Trim(line.substr(0, colonIndex)), Trim(line.substr(colonIndex + 1)) });
+		}
+		if(!isValid || header.startLine.empty())
+			return { };
+		return { header };
+	}
+
+	// Parameters of a permessage-deflate element of Sec-WebSocket-Extensions (an offer or a response)
+	struct DeflateExtension
+	{
+		bool isServerNoContextTakeover = false;
+		bool isClientNoContextTakeover = false;
+		bool hasClientMaxWindowBits = false;
+		std::optional<u8> clientMaxWindowBits;
+		std::optional<u8> serverMaxWindowBits;
+	};
+
+	static std::optional<u8> ParseWindowBits(std::string_view value)
+	{
+		if((value.size() >= 2) && (value.front() == '"') && (value.back() == '"'))
+			value = value.substr(1, value.size() - 2);
+		u32 bits = 0;
+		auto result = std::from_chars(value.data(), value.data() + value.size(), bits);
+		if((result.ec != std::errc { }) || (result.ptr != (value.data() + value.size())) || (bits < 8) || (bits > 15))
+			return { };
+		return { static_cast<u8>(bits) };
+	}
+
+	// Returns the first valid permessage-deflate element of a Sec-WebSocket-Extensions header value,
+	// 'isUnknownFound' is set if any other extension is present
+	static std::optional<DeflateExtension> ParseDeflateExtension(const std::string_view value, bool& isUnknownFound)
+	{
+		std::optional<DeflateExtension> deflateExtension;
+		isUnknownFound = false;
+		ForEachListElement(value, ',', [&deflateExtension, &isUnknownFound](std::string_view element)
+		{
+			DeflateExtension extension;
+			bool isName = true;
+			bool isValid = true;
+			ForEachListElement(element, ';', [&](std::string_view parameter)
+			{
+				if(isName)
+				{
+					isName = false;
+					isValid = parameter == "permessage-deflate";
+					if(!isValid)
+						isUnknownFound = true;
+					return isValid;
+				}
+				std::size_t index = parameter.find('=');
+				std::string_view name = Trim(parameter.substr(0, index));
+				std::optional<std::string_view> argument;
+				if(index != std::string_view::npos)
+					argument = Trim(parameter.substr(index + 1));
+				if(name == "server_no_context_takeover")
+					extension.isServerNoContextTakeover = true;
+				else if(name == "client_no_context_takeover")
+					extension.isClientNoContextTakeover = true;
+				else if(name == "server_max_window_bits")
+				{
+					extension.serverMaxWindowBits = argument ? ParseWindowBits(*argument) : std::optional<u8> { };
+					isValid = extension.serverMaxWindowBits.has_value();
+				}
+				else if(name == "client_max_window_bits")
+				{
+					extension.hasClientMaxWindowBits = true;
+					if(argument)
+					{
+						extension.clientMaxWindowBits = ParseWindowBits(*argument);
+						isValid = extension.clientMaxWindowBits.has_value();
+					}
+				}
+				else
+					isValid = false;
+				return isValid;
+			});
+			if(isValid && !deflateExtension)
+				deflateExtension = extension;
+			return true;
+		});
+		return deflateExtension;
+	}
+
+	// TLS context of a connection configured with files, nullptr if they can't be loaded
+	static std::shared_ptr<TlsContext> CreateTlsContext(TlsRole role, const WebSocketTlsOptions& options)
+	{
+		auto context = std::make_shared<TlsContext>(role);
+		if(!context->isValid())
+			return { };
+		if(!options.certificateFile.empty() && (context->loadCertificate(options.certificateFile, options.privateKeyFile) != Result::Success))
+			return { };
+		if(!options.caFile.empty() && (context->loadTrustedCertificates(options.caFile) != Result::Success))
+			return { };
+		if(role == TlsRole::Client)
+			context->setInsecureSkipVerify(options.isInsecureSkipVerify);
+		if(!options.cipherSuites.empty() && (context->setCipherSuites(options.cipherSuites) != Result::Success))
+			return { };
+		return context;
+	}
+
+	static bool IsSameTlsConfiguration(const WebSocketTlsOptions& options1, const WebSocketTlsOptions& options2)
+	{
+		return (options1.certificateFile == options2.certificateFile)
+				&& (options1.privateKeyFile == options2.privateKeyFile)
+				&& (options1.caFile == options2.caFile)
+				&& (options1.isInsecureSkipVerify == options2.isInsecureSkipVerify)
+				&& (options1.cipherSuites == options2.cipherSuites);
+	}
+
+	// zlib can't produce raw deflate streams with a 256 bytes (8 bits) window
+	// time_point::max() if 'timeout' is 0 (no timeout)
+	static std::chrono::steady_clock::time_point GetHandshakeDeadline(std::chrono::milliseconds timeout)
+	{
+		return (timeout.count() == 0) ? std::chrono::steady_clock::time_point::max() : (std::chrono::steady_clock::now() + timeout);
+	}
+
+	// Milliseconds left until 'deadline' as Socket's timeouts take them: -1 if there is no deadline, 0 once it has passed
+	static s32 GetRemainingTimeout(std::chrono::steady_clock::time_point deadline)
+	{
+		if(deadline == std::chrono::steady_clock::time_point::max())
+			return -1;
+		const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+		return static_cast<s32>(std::clamp<decltype(remaining)>(remaining, 0, std::numeric_limits<s32>::max()));
+	}
+
+	static u8 ClampWindowBits(u8 windowBits)
+	{
+		return std::clamp<u8>(windowBits, 9, 15);
+	}
+
+	NativeWebSocket::NativeWebSocket() : m_isConnected(false),
+										m_isServer(false),
+										m_isServerOwnedClient(false),
+										m_isCloseSent(false),
+										m_readBegin(0),
+										m_readEnd(0),
+										m_hasMessage(false),
+										m_maxMessageSize(gDefaultMaxMessageSize),
+										m_handshakeTimeout(gDefaultHandshakeTimeout),
+										m_isSendingChunks(false),
+										m_isSendChunksCompressed(false),
+										m_isDeflateNoContextTakeover(false),
+										m_isInflateNoContextTakeover(false),
+										m_sendHighWatermark(0),
+										m_sendLowWatermark(0)
+	{
+	}
+
+	NativeWebSocket::~NativeWebSocket()
+	{
+		close();
+	}
+
+	Result NativeWebSocket::listen()
+	{
+		netsocket_assert(m_isServer && "NativeWebSocket is not usable as server, call bind() first");
+		return m_socket.listen();
+	}
+
+	std::unique_ptr<NativeWebSocket> NativeWebSocket::CreateAcceptedSocket(Socket socket, const WebSocketCompressionOptions& compressionOptions, u64 maxMessageSize,
+																			std::chrono::milliseconds handshakeTimeout, const std::shared_ptr<ClientRegistry>& clientRegistry,
+																			const std::shared_ptr<TlsContext>& tlsContext)
+	{
+		const auto deadline = GetHandshakeDeadline(handshakeTimeout);
+		std::unique_ptr<NativeWebSocket> webSocket = std::make_unique<NativeWebSocket>();
+		webSocket->m_socket = std::move(socket);
+		webSocket->m_socket.setTCPNoDelay();
+		if(tlsContext)
+		{
+			if(webSocket->m_socket.startTls(tlsContext, { }, GetRemainingTimeout(deadline)) != Result::Success)
+			{
+				spdlog::error("TLS handshake failed, dropping the connection");
+				return { };
+			}
+			webSocket->m_tlsContext = tlsContext;
+		}
+		webSocket->m_isServerOwnedClient = true;
+		webSocket->m_compressionOptions = compressionOptions;
+		webSocket->m_maxMessageSize = maxMessageSize;
+		webSocket->m_handshakeTimeout = handshakeTimeout;
+		if(webSocket->performServerHandshake(deadline) != Result::Success)
+		{
+			spdlog::error("WebSocket opening handshake failed, dropping the connection");
+			return { };
+		}
+		webSocket->m_socket.setReceiveTimeout(-1);
+		webSocket->m_isConnected = true;
+
+		webSocket->m_clientRegistry = clientRegistry;
+		std::lock_guard<std::mutex> lock(clientRegistry->mutex);
+		clientRegistry->clients.push_back(webSocket.get());
+		return webSocket;
+	}
+
+	std::unique_ptr<NativeWebSocket> NativeWebSocket::accept()
+	{
+		netsocket_assert(m_isServer && "NativeWebSocket is not usable as server");
+		while(true)
+		{
+			std::optional<Socket> acceptedSocket = m_socket.accept();
+			if(!acceptedSocket)
+				return { };
+			std::unique_ptr<NativeWebSocket> webSocket = CreateAcceptedSocket(std::move(*acceptedSocket), m_compressionOptions, m_maxMessageSize, m_handshakeTimeout,
+																				m_clientRegistry, m_tlsContext);
+			if(webSocket)
+				return webSocket;
+		}
+	}
+
+	std::unique_ptr<NativeWebSocket> NativeWebSocket::tryAccept()
+	{
+		netsocket_assert(m_isServer && "NativeWebSocket is not usable as server");
+		std::optional<Socket> acceptedSocket = m_socket.tryAccept();
+		if(!acceptedSocket)
+			return { };
+		return CreateAcceptedSocket(std::move(*acceptedSocket), m_compressionOptions, m_maxMessageSize, m_handshakeTimeout, m_clientRegistry, m_tlsContext);
+	}
+
+	void NativeWebSocket::setOnAccept(const OnAcceptCallback& callback, const TaskExecutor& executor)
+	{
+		netsocket_assert(m_isServer && "NativeWebSocket is not usable as server");
+		m_acceptor.reset();
+		if(!callback)
+			return;
+		m_acceptor = std::make_unique<Acceptor>(m_socket);
+		// The tasks may outlive this server socket, so they carry copies of what the handshake needs
+		auto onAccept = [callback, executor, compressionOptions = m_compressionOptions, maxMessageSize = m_maxMessageSize, handshakeTimeout = m_handshakeTimeout,
+							clientRegistry = m_clientRegistry, tlsContext = m_tlsContext](Socket socket)
+		{
+			auto sharedSocket = std::make_shared<Socket>(std::move(socket));
+			auto task = [callback, compressionOptions, maxMessageSize, handshakeTimeout, clientRegistry, tlsContext, sharedSocket]()
+			{
+				std::unique_ptr<NativeWebSocket> webSocket = CreateAcceptedSocket(std::move(*sharedSocket), compressionOptions, maxMessageSize, handshakeTimeout,
+																					clientRegistry, tlsContext);
+				if(webSocket)
+					callback(std::move(webSocket));
+			};
+			if(executor)
+				executor(task);
+			else
+				task();
+		};
+		if(m_acceptor->start(onAccept) != Result::Success)
+			spdlog::error("Failed to start the accept thread");
+	}
+
+	Result NativeWebSocket::bind(const std::string_view ipAddress, const std::string_view portNumber, const WebSocketCompressionOptions& compressionOptions,
+									const WebSocketTlsOptions& tlsOptions)
+	{
+		m_tlsContext.reset();
+		if(tlsOptions.isEnabled)
+		{
+			m_tlsContext = tlsOptions.context ? tlsOptions.context : CreateTlsContext(TlsRole::Server, tlsOptions);
+			if(!m_tlsContext || (m_tlsContext->getRole() != TlsRole::Server))
+				return Result::Failed;
+		}
+		m_socket = Socket(SocketType::Stream, IPAddressFamily::IPv4, IPProtocol::TCP);
+		m_compressionOptions = compressionOptions;
+		Result result = m_socket.bind(ipAddress, portNumber);
+		if(result != Result::Success)
+			return result;
+		m_isServer = true;
+		m_clientRegistry = std::make_shared<ClientRegistry>();
+		return Result::Success;
+	}
+
+	Result NativeWebSocket::connect(const std::string_view ipAddress, const std::string_view port, const WebSocketCompressionOptions& compressionOptions,
+									const WebSocketTlsOptions& tlsOptions)
+	{
+		netsocket_assert(!isConnected() && "Already connected NativeWebSocket, first close it");
+		if(!tlsOptions.isEnabled)
+			m_tlsContext.reset();
+		else if(tlsOptions.context)
+			m_tlsContext = tlsOptions.context;
+		// Reconnecting with the same files keeps the context, and with it the session to resume
+		else if(!m_tlsContext || m_tlsOptions.context || !IsSameTlsConfiguration(m_tlsOptions, tlsOptions))
+			m_tlsContext = CreateTlsContext(TlsRole::Client, tlsOptions);
+		m_tlsOptions = tlsOptions;
+		if(tlsOptions.isEnabled && (!m_tlsContext || (m_tlsContext->getRole() != TlsRole::Client)))
+			return Result::Failed;
+
+		m_socket = Socket(SocketType::Stream, IPAddressFamily::IPv4, IPProtocol::TCP);
+		m_compressionOptions = compressionOptions;
+		Result result = m_socket.connect(ipAddress, port);
+		if(result != Result::Success)
+			return result;
+		m_socket.setTCPNoDelay();
+		const auto deadline = GetHandshakeDeadline(m_handshakeTimeout);
+		if(m_tlsContext && (m_socket.startTls(m_tlsContext, tlsOptions.serverName.empty() ? ipAddress : std::string_view { tlsOptions.serverName },
+												GetRemainingTimeout(deadline)) != Result::Success))
+		{
+			m_socket.close();
+			return Result::Failed;
+		}
+		m_isCloseSent = false;
+		m_hasMessage = false;
+		m_receiveStream = { };
+		m_isSendingChunks = false;
+		if(performClientHandshake(ipAddress, port, deadline) != Result::Success)
+		{
+			m_socket.close();
+			return Result::Failed;
+		}
+		m_socket.setReceiveTimeout(-1);
+		m_isConnected = true;
+		return Result::Success;
+	}
+
+	Result NativeWebSocket::close()
+	{
+		if(m_isServer)
+		{
+			m_isServer = false;
+			// Join the accept thread before the listening socket goes away
+			m_acceptor.reset();
+			// The accepted sockets still hold a reference to the registry, they unregister from it when they are closed
+			m_clientRegistry.reset();
+			return m_socket.close();
+		}
+		if(!m_isConnected)
+			return Result::Success;
+
+		const u16 code = com::EnumClassToInt(WebSocketCloseCode::Normal);
+		const u8 payload[2] = { static_cast<u8>(code >> 8), static_cast<u8>(code) };
+		return closeConnection(payload, sizeof(payload));
+	}
+
+	Result NativeWebSocket::closeConnection(const u8* payload, u32 size)
+	{
+		// Unregister first, so that an in-progress broadcast() is done with this socket before it is torn down
+		unregisterFromServer();
+		bool wasConnected = false;
+		Result result = Result::Success;
+		{
+			std::lock_guard<std::mutex> lock(m_sendMutex);
+			if(!m_isCloseSent && isConnected())
+			{
+				m_isCloseSent = true;
+				sendFrameLocked(WebSocketOpcode::Close, true, false, payload, size);
+			}
+			wasConnected = m_isConnected.exchange(false);
+			result = m_socket.close();
+		}
+		// Outside of the lock, the callback may use this socket
+		if(wasConnected)
+			callOnDisconnect();
+		return result;
+	}
+
+	Result NativeWebSocket::send(const u8* bytes, u32 size)
+	{
+		return sendMessage(WebSocketOpcode::Binary, bytes, size);
+	}
+
+	Result NativeWebSocket::receive(u8* bytes, u32 size)
+	{
+		if(!isConnected())
+			return Result::SocketError;
+		std::lock_guard<std::mutex> lock(m_receiveMutex);
+		netsocket_assert(!m_receiveStream.isActive && "A message is being read with receiveChunk(), finish it first");
+		if(!m_hasMessage)
+		{
+			Result result = readMessage();
+			if(result != Result::Success)
+				return result;
+		}
+		// Same contract as netsocket::WebSocket: the message is kept for a receive() with the matching size
+		if(m_message.size() != size)
+			return Result::Failed;
+		std::memcpy(bytes, m_message.data(), size);
+		m_hasMessage = false;
+		return Result::Success;
+	}
+
+	Result NativeWebSocket::sendChunk(const u8* bytes, u32 size, bool isFinal)
+	{
+		std::lock_guard<std::mutex> lock(m_sendMutex);
+		if(!isConnected())
+			return Result::SocketError;
+		const bool isFirst = !m_isSendingChunks;
+		if(isFirst)
+			// The total size isn't known upfront, so minMessageSize can't be applied
+			m_isSendChunksCompressed = m_deflateStream != nullptr;
+		m_isSendingChunks = !isFinal;
+		const WebSocketOpcode opcode = isFirst ? WebSocketOpcode::Binary : WebSocketOpcode::Continuation;
+		if(!m_isSendChunksCompressed)
+			return sendFrameLocked(opcode, isFinal, false, bytes, size);
+
+		// Each chunk is sync flushed so that it can be inflated as soon as it arrives, only the message's last trailer is stripped
+		m_compressBuffer.clear();
+		if(!m_deflateStream->compress(bytes, size, DeflateStream::Flush::Sync, m_compressBuffer))
+			return Result::Failed;
+		if(isFinal)
+		{
+			StripDeflateTrailer(m_compressBuffer);
+			if(m_isDeflateNoContextTakeover)
+				m_deflateStream->reset();
+		}
+		return sendFrameLocked(opcode, isFinal, isFirst, m_compressBuffer.data(), m_compressBuffer.size());
+	}
+
+	Result NativeWebSocket::ping(const u8* bytes, u32 size)
+	{
+		netsocket_assert(size <= WebSocketFrameHeader::MaxControlPayloadSize);
+		return sendControlFrame(WebSocketOpcode::Ping, bytes, size);
+	}
+
+	NativeWebSocketBroadcastResult NativeWebSocket::broadcast(const u8* bytes, u32 size)
+	{
+		netsocket_assert(m_isServer && "NativeWebSocket is not usable as server");
+		std::lock_guard<std::mutex> lock(m_clientRegistry->mutex);
+		return broadcastLocked(bytes, size, m_clientRegistry->clients);
+	}
+
+	NativeWebSocketBroadcastResult NativeWebSocket::broadcast(const u8* bytes, u32 size, std::span<NativeWebSocket* const> clients)
+	{
+		netsocket_assert(m_isServer && "NativeWebSocket is not usable as server");
+		std::lock_guard<std::mutex> lock(m_clientRegistry->mutex);
+		// Only the registered clients are kept alive by the lock, the others (e.g. closed ones) are reported without being touched
+		std::vector<NativeWebSocket*> registeredClients(m_clientRegistry->clients);
+		std::sort(registeredClients.begin(), registeredClients.end());
+		std::vector<NativeWebSocket*> members;
+		std::vector<std::pair<NativeWebSocket*, Result>> failures;
+		for(NativeWebSocket* client : clients)
+		{
+			if(std::binary_search(registeredClients.begin(), registeredClients.end(), client))
+				members.push_back(client);
+			else
+				failures.push_back({ client, Result::SocketError });
+		}
+		NativeWebSocketBroadcastResult broadcastResult = broadcastLocked(bytes, size, members);
+		broadcastResult.failures.insert(broadcastResult.failures.end(), failures.begin(), failures.end());
+		return broadcastResult;
+	}
+
+	NativeWebSocketBroadcastResult NativeWebSocket::broadcastLocked(const u8* bytes, u32 size, std::span<NativeWebSocket* const> clients)
+	{
+		NativeWebSocketBroadcastResult broadcastResult;
+		// Frames sent by a server are not masked, so the encoded frame is the same for every client
+		// as long as the compressor starts from an empty sliding window, i.e. the client negotiated server_no_context_takeover.
+		// The encoded frames are keyed by the deflate window bits, 0 for the uncompressed frame.
+		std::vector<std::pair<u8, std::vector<u8>>> encodedFrames;
+		auto getEncodedFrame = [&encodedFrames, bytes, size, this](u8 windowBits) -> const std::vector<u8>&
+		{
+			for(const auto& pair : encodedFrames)
+				if(pair.first == windowBits)
+					return pair.second;
+
+			WebSocketFrameHeader header;
+			header.opcode = WebSocketOpcode::Binary;
+			std::vector<u8> frame(WebSocketFrameHeader::MaxSize);
+			if(windowBits == 0)
+			{
+				header.payloadLength = size;
+				frame.resize(header.encode(frame.data()));
+				frame.insert(frame.end(), bytes, bytes + size);
+			}
+			else
+			{
+				std::vector<u8> payload;
+				DeflateStream deflateStream(m_compressionOptions.level, windowBits, true);
+				bool isSuccess = deflateStream.isValid() && deflateStream.compress(bytes, size, DeflateStream::Flush::Sync, payload);
+				netsocket_assert(isSuccess);
+				StripDeflateTrailer(payload);
+				header.isCompressed = true;
+				header.payloadLength = payload.size();
+				frame.resize(header.encode(frame.data()));
+				frame.insert(frame.end(), payload.begin(), payload.end());
+			}
+			encodedFrames.push_back({ windowBits, std::move(frame) });
+			return encodedFrames.back().second;
+		};
+
+		for(NativeWebSocket* client : clients)
+		{
+			Result result = Result::SocketError;
+			if(client->isConnected())
+			{
+				const bool isCompressed = client->m_deflateStream && (size >= client->m_compressionOptions.minMessageSize);
+				if(isCompressed && !client->m_isDeflateNoContextTakeover)
+					result = client->sendMessage(WebSocketOpcode::Binary, bytes, size);
+				else
+				{
+					const std::vector<u8>& frame = getEncodedFrame(isCompressed ? client->m_deflateParameters.serverMaxWindowBits : 0);
+					result = client->sendEncodedFrame(frame.data(), frame.size());
+				}
+			}
+			if(result == Result::Success)
+				++broadcastResult.deliveredCount;
+			else
+				broadcastResult.failures.push_back({ client, result });
+		}
+		return broadcastResult;
+	}
+
+	u32 NativeWebSocket::getClientCount() const
+	{
+		if(!m_clientRegistry)
+			return 0;
+		std::lock_guard<std::mutex> lock(m_clientRegistry->mutex);
+		return static_cast<u32>(m_clientRegistry->clients.size());
+	}
+
+	Result NativeWebSocket::finish(std::chrono::milliseconds timeout)
+	{
+		static_cast<void>(timeout);
+		return isConnected() ? Result::Success : Result::SocketError;
+	}
+
+	void NativeWebSocket::setSendBufferWatermarks(u64 highWatermark, u64 lowWatermark)
+	{
+		netsocket_assert((highWatermark == 0) || (lowWatermark <= highWatermark));
+		m_sendHighWatermark = highWatermark;
+		m_sendLowWatermark = lowWatermark;
+	}
+
+	void NativeWebSocket::setOnSendBufferHigh(const OnSendBufferHighCallback& callback)
+	{
+		m_onSendBufferHighCallback = callback;
+	}
+
+	void NativeWebSocket::setOnSendBufferDrain(const OnSendBufferDrainCallback& callback)
+	{
+		m_onSendBufferDrainCallback = callback;
+	}
+
+	void NativeWebSocket::setOnDisconnect(const OnDisconnectCallback& callback)
+	{
+		m_onDisconnectCallback = callback;
+	}
+
+	void NativeWebSocket::callOnDisconnect()
+	{
+		if(m_onDisconnectCallback)
+			m_onDisconnectCallback(*this);
+	}
+
+	void NativeWebSocket::markDisconnected()
+	{
+		if(m_isConnected.exchange(false))
+			callOnDisconnect();
+	}
+
+	Result NativeWebSocket::generateRandom(u8* bytes, u32 size)
+	{
+		if(!m_randomGenerator)
+			m_randomGenerator = std::make_unique<RandomGenerator>();
+		if(!m_randomGenerator->generate(bytes, size))
+		{
+			spdlog::error("Failed to generate random bytes");
+			return Result::Failed;
+		}
+		return Result::Success;
+	}
+
+	void NativeWebSocket::unregisterFromServer()
+	{
+		if(!m_clientRegistry)
+			return;
+		{
+			std::lock_guard<std::mutex> lock(m_clientRegistry->mutex);
+			auto& clients = m_clientRegistry->clients;
+			clients.erase(std::remove(clients.begin(), clients.end(), this), clients.end());
+		}
+		m_clientRegistry.reset();
+	}
+
+	Result NativeWebSocket::performClientHandshake(const std::string_view host, const std::string_view port, std::chrono::steady_clock::time_point deadline)
+	{
+		m_readBuffer.resize(gReadBufferSize);
+		m_readBegin = 0;
+		m_readEnd = 0;
+
+		u8 keyBytes[16];
+		if(generateRandom(keyBytes, sizeof(keyBytes)) != Result::Success)
+			return Result::Failed;
+		const std::string key = Base64Encode(keyBytes, sizeof(keyBytes));
+
+		std::string request;
+		request.append("GET / HTTP/1.1\r\nHost: ").append(host).append(":").append(port)
+				.append("\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: ").append(key)
+				.append("\r\nSec-WebSocket-Version: 13\r\n");
+		const u8 windowBits = ClampWindowBits(m_compressionOptions.windowBits);
+		if(m_compressionOptions.isEnabled)
+		{
+			request.append("Sec-WebSocket-Extensions: permessage-deflate; client_max_window_bits");
+			if(windowBits < 15)
+				request.append("=").append(std::to_string(windowBits)).append("; server_max_window_bits=").append(std::to_string(windowBits));
+			if(!m_compressionOptions.isContextTakeover)
+				request.append("; client_no_context_takeover; server_no_context_takeover");
+			request.append("\r\n");
+		}
+		request.append("\r\n");
+		Result result = m_socket.send(reinterpret_cast<const u8*>(request.data()), static_cast<u32>(request.size()));
+		if(result != Result::Success)
+			return result;
+
+		std::optional<std::string> text = readHttpHeader(deadline);
+		if(!text)
+			return Result::Failed;
+		std::optional<HttpHeader> response = ParseHttpHeader(*text);
+		if(!response || !response->startLine.starts_with("HTTP/1.1 101"))
+		{
+			spdlog::error("WebSocket server didn't switch protocols: {}", response ? response->startLine : std::string_view { "<malformed response>" });
+			return Result::Failed;
+		}
+		auto upgrade = response->get("Upgrade");
+		auto connection = response->get("Connection");
+		auto accept = response->get("Sec-WebSocket-Accept");
+		if(!upgrade || !EqualsIgnoreCase(*upgrade, "websocket") || !connection || !ContainsToken(*connection, "upgrade")
+			|| !accept || (*accept != ComputeAcceptKey(key)))
+		{
+			spdlog::error("Invalid WebSocket opening handshake response");
+			return Result::Failed;
+		}
+
+		m_deflateParameters = { };
+		if(auto extensions = response->get("Sec-WebSocket-Extensions"))
+		{
+			bool isUnknownFound = false;
+			std::optional<DeflateExtension> extension = ParseDeflateExtension(*extensions, isUnknownFound);
+			// The server must not respond with an extension we haven't offered
+			if(!m_compressionOptions.isEnabled || isUnknownFound || !extension)
+			{
+				spdlog::error("WebSocket server accepted an extension which was not offered: {}", *extensions);
+				return Result::Failed;
+			}
+			m_deflateParameters.isEnabled = true;
+			m_deflateParameters.isServerNoContextTakeover = extension->isServerNoContextTakeover;
+			m_deflateParameters.isClientNoContextTakeover = extension->isClientNoContextTakeover || !m_compressionOptions.isContextTakeover;
+			m_deflateParameters.serverMaxWindowBits = extension->serverMaxWindowBits.value_or(15);
+			m_deflateParameters.clientMaxWindowBits = std::min<u8>(windowBits, ClampWindowBits(extension->clientMaxWindowBits.value_or(15)));
+		}
+		setupCompression();
+		return Result::Success;
+	}
+
+	Result NativeWebSocket::performServerHandshake(std::chrono::steady_clock::time_point deadline)
+	{
+		m_readBuffer.resize(gReadBufferSize);
+		m_readBegin = 0;
+		m_readEnd = 0;
+
+		std::optional<std::string> text = readHttpHeader(deadline);
+		if(!text)
+			return Result::Failed;
+		std::optional<HttpHeader> request = ParseHttpHeader(*text);
+		auto rejectRequest = [this](std::string_view reason)
+		{
+			spdlog::error("Rejecting WebSocket opening handshake: {}", reason);
+			constexpr std::string_view response = "HTTP/1.1 400 Bad Request\r\nSec-WebSocket-Version: 13\r\nConnection: close\r\n\r\n";
+			m_socket.send(reinterpret_cast<const u8*>(response.data()), static_cast<u32>(response.size()));
+			return Result::Failed;
+		};
+		if(!request || !request->startLine.starts_with("GET ") || !request->startLine.ends_with(" HTTP/1.1"))
+			return rejectRequest("not a HTTP/1.1 GET request");
+		auto upgrade = request->get("Upgrade");
+		auto connection = request->get("Connection");
+		auto version = request->get("Sec-WebSocket-Version");
+		auto key = request->get("Sec-WebSocket-Key");
+		if(!upgrade || !ContainsToken(*upgrade, "websocket") || !connection || !ContainsToken(*connection, "upgrade"))
+			return rejectRequest("not an upgrade request");
+		if(!version || (*version != "13"))
+			return rejectRequest("unsupported Sec-WebSocket-Version");
+		if(!key || key->empty())
+			return rejectRequest("missing Sec-WebSocket-Key");
+
+		std::string response;
+		response.append("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: ")
+				.append(ComputeAcceptKey(*key)).append("\r\n");
+
+		m_deflateParameters = { };
+		auto extensions = request->get("Sec-WebSocket-Extensions");
+		if(m_compressionOptions.isEnabled && extensions)
+		{
+			bool isUnknownFound = false;
+			std::optional<DeflateExtension> offer = ParseDeflateExtension(*extensions, isUnknownFound);
+			// We can't honor a server window of 256 bytes (zlib limitation), decline such offers
+			if(offer && (offer->serverMaxWindowBits.value_or(15) > 8))
+			{
+				const u8 windowBits = ClampWindowBits(m_compressionOptions.windowBits);
+				DeflateParameters& parameters = m_deflateParameters;
+				parameters.isEnabled = true;
+				parameters.isServerNoContextTakeover = offer->isServerNoContextTakeover || !m_compressionOptions.isContextTakeover;
+				parameters.isClientNoContextTakeover = offer->isClientNoContextTakeover || !m_compressionOptions.isContextTakeover;
+				parameters.serverMaxWindowBits = std::min<u8>(windowBits, offer->serverMaxWindowBits.value_or(15));
+				// client_max_window_bits may only be sent back if the client has offered it
+				parameters.clientMaxWindowBits = offer->hasClientMaxWindowBits ? std::min<u8>(windowBits, ClampWindowBits(offer->clientMaxWindowBits.value_or(15))) : 15;
+
+				response.append("Sec-WebSocket-Extensions: permessage-deflate");
+				if(parameters.isServerNoContextTakeover)
+					response.append("; server_no_context_takeover");
+				if(parameters.isClientNoContextTakeover)
+					response.append("; client_no_context_takeover");
+				if(offer->serverMaxWindowBits || (parameters.serverMaxWindowBits < 15))
+					response.append("; server_max_window_bits=").append(std::to_string(parameters.serverMaxWindowBits));
+				if(offer->hasClientMaxWindowBits && (parameters.clientMaxWindowBits < 15))
+					response.append("; client_max_window_bits=").append(std::to_string(parameters.clientMaxWindowBits));
+				response.append("\r\n");
+			}
+		}
+		response.append("\r\n");
+
+		Result result = m_socket.send(reinterpret_cast<const u8*>(response.data()), static_cast<u32>(response.size()));
+		if(result != Result::Success)
+			return result;
+		setupCompression();
+		return Result::Success;
+	}
+
+	void NativeWebSocket::setupCompression()
+	{
+		m_deflateStream.reset();
+		m_inflateStream.reset();
+		if(!m_deflateParameters.isEnabled)
+			return;
+		const DeflateParameters& parameters = m_deflateParameters;
+		const bool isServerSide = m_isServerOwnedClient;
+		const u8 deflateWindowBits = isServerSide ? parameters.serverMaxWindowBits : parameters.clientMaxWindowBits;
+		m_isDeflateNoContextTakeover = isServerSide ? parameters.isServerNoContextTakeover : parameters.isClientNoContextTakeover;
+		m_isInflateNoContextTakeover = isServerSide ? parameters.isClientNoContextTakeover : parameters.isServerNoContextTakeover;
+		m_deflateStream = std::make_unique<DeflateStream>(m_compressionOptions.level, ClampWindowBits(deflateWindowBits), true);
+		// A larger window than the peer's always works for inflating
+		m_inflateStream = std::make_unique<InflateStream>(15, true);
+	}
+
+	std::optional<std::string> NativeWebSocket::readHttpHeader(std::chrono::steady_clock::time_point deadline)
+	{
+		u32 searchBegin = m_readBegin;
+		while(true)
+		{
+			auto begin = m_readBuffer.begin() + m_readBegin;
+			auto end = m_readBuffer.begin() + m_readEnd;
+			auto it = std::search(m_readBuffer.begin() + searchBegin, end, gHttpHeaderTerminator.begin(), gHttpHeaderTerminator.end());
+			if(it != end)
+			{
+				// Anything after the header (e.g. the first frame) stays in the read-ahead buffer
+				std::string header(begin, it + gHttpHeaderTerminator.size());
+				m_readBegin += static_cast<u32>(header.size());
+				return { header };
+			}
+			const u32 available = m_readEnd - m_readBegin;
+			if(available >= gMaxHttpHeaderSize)
+			{
+				spdlog::error("HTTP header exceeds {} bytes", gMaxHttpHeaderSize);
+				return { };
+			}
+			// Resume the search a few bytes back in case the terminator straddles two reads
+			searchBegin = (available >= gHttpHeaderTerminator.size()) ? (m_readEnd - static_cast<u32>(gHttpHeaderTerminator.size())) : m_readBegin;
+			const u32 readBegin = m_readBegin;
+			const s32 timeout = GetRemainingTimeout(deadline);
+			if(timeout == 0)
+			{
+				spdlog::error("HTTP header not received within the handshake timeout");
+				return { };
+			}
+			if((m_socket.setReceiveTimeout(timeout) != Result::Success) || (fillReadBuffer(available + 1) != Result::Success))
+				return { };
+			// fillReadBuffer() may have moved the unconsumed bytes to the front
+			searchBegin -= (readBegin - m_readBegin);
+		}
+	}
+
+	Result NativeWebSocket::fillReadBuffer(u32 minSize)
+	{
+		u32 available = m_readEnd - m_readBegin;
+		if(available >= minSize)
+			return Result::Success;
+		netsocket_debug_assert(minSize <= m_readBuffer.size());
+		if(m_readBegin != 0)
+		{
+			std::memmove(m_readBuffer.data(), m_readBuffer.data() + m_readBegin, available);
+			m_readBegin = 0;
+			m_readEnd = available;
+		}
+		while(m_readEnd < minSize)
+		{
+			std::optional<u32> numReceivedBytes = m_socket.receiveSome(m_readBuffer.data() + m_readEnd, static_cast<u32>(m_readBuffer.size()) - m_readEnd);
+			if(!numReceivedBytes)
+			{
+				markDisconnected();
+				return Result::SocketError;
+			}
+			m_readEnd += *numReceivedBytes;
+		}
+		return Result::Success;
+	}
+
+	Result NativeWebSocket::readExact(u8* bytes, u64 size)
+	{
+		const u64 numBufferedBytes = std::min<u64>(m_readEnd - m_readBegin, size);
+		std::memcpy(bytes, m_readBuffer.data() + m_readBegin, numBufferedBytes);
+		m_readBegin += static_cast<u32>(numBufferedBytes);
+		bytes += numBufferedBytes;
+		size -= numBufferedBytes;
+		if(size == 0)
+			return Result::Success;
+
+		// Large payloads are received directly into the destination, small ones through the read-ahead buffer
+		if(size >= (m_readBuffer.size() / 2))
+		{
+			while(size > 0)
+			{
+				const u32 chunkSize = static_cast<u32>(std::min<u64>(size, U32_MAX));
+				if(m_socket.receive(bytes, chunkSize) != Result::Success)
+				{
+					markDisconnected();
+					return Result::SocketError;
+				}
+				bytes += chunkSize;
+				size -= chunkSize;
+			}
+			return Result::Success;
+		}
+		Result result = fillReadBuffer(static_cast<u32>(size));
+		if(result != Result::Success)
+			return result;
+		std::memcpy(bytes, m_readBuffer.data() + m_readBegin, size);
+		m_readBegin += static_cast<u32>(size);
+		return Result::Success;
+	}
+
+	Result NativeWebSocket::readFrameHeader(WebSocketFrameHeader& header)
+	{
+		Result result = fillReadBuffer(2);
+		if(result != Result::Success)
+			return result;
+		result = fillReadBuffer(WebSocketFrameHeader::GetEncodedSize(m_readBuffer[m_readBegin + 1]));
+		if(result != Result::Success)
+			return result;
+		std::optional<u32> headerSize = header.decode(m_readBuffer.data() + m_readBegin, m_readEnd - m_readBegin);
+		if(!headerSize)
+			return failConnection(WebSocketCloseCode::ProtocolError);
+		netsocket_debug_assert(*headerSize != 0);
+		m_readBegin += *headerSize;
+		return Result::Success;
+	}
+
+	Result NativeWebSocket::handleControlFrame(const WebSocketFrameHeader& header)
+	{
+		u8 payload[WebSocketFrameHeader::MaxControlPayloadSize];
+		const u32 payloadSize = static_cast<u32>(header.payloadLength);
+		Result result = readExact(payload, payloadSize);
+		if(result != Result::Success)
+			return result;
+		if(header.isMasked)
+			MaskWebSocketPayload(payload, payload, payloadSize, header.maskKey);
+		switch(header.opcode)
+		{
+			case WebSocketOpcode::Ping:
+				return sendControlFrame(WebSocketOpcode::Pong, payload, payloadSize);
+			case WebSocketOpcode::Close:
+			{
+				// Echo the status code back, unless we have initiated the closing handshake
+				closeConnection(payload, std::min<u32>(payloadSize, 2));
+				return Result::SocketError;
+			}
+			default:
+				return Result::Success;
+		}
+	}
+
+	Result NativeWebSocket::readDataFrameHeader(WebSocketFrameHeader& header)
+	{
+		while(true)
+		{
+			Result result = readFrameHeader(header);
+			if(result != Result::Success)
+				return result;
+
+			// Frames from a client must be masked, frames from a server must not be
+			if(header.isMasked != m_isServerOwnedClient)
+				return failConnection(WebSocketCloseCode::ProtocolError);
+			// RSV1 is only valid on the first frame of a data message, and only if permessage-deflate was negotiated
+			if(header.isCompressed && (!m_inflateStream || IsWebSocketControlOpcode(header.opcode) || (header.opcode == WebSocketOpcode::Continuation)))
+				return failConnection(WebSocketCloseCode::ProtocolError);
+
+			if(!IsWebSocketControlOpcode(header.opcode))
+				return Result::Success;
+			result = handleControlFrame(header);
+			if(result != Result::Success)
+				return result;
+		}
+	}
+
+	Result NativeWebSocket::readMessage()
+	{
+		m_message.clear();
+		bool isInMessage = false;
+		bool isCompressed = false;
+		while(true)
+		{
+			WebSocketFrameHeader header;
+			Result result = readDataFrameHeader(header);
+			if(result != Result::Success)
+				return result;
+
+			if(header.opcode == WebSocketOpcode::Continuation)
+			{
+				if(!isInMessage)
+					return failConnection(WebSocketCloseCode::ProtocolError);
+			}
+			else
+			{
+				// A new data message can't start before the previous one has been finished
+				if(isInMessage)
+					return failConnection(WebSocketCloseCode::ProtocolError);
+				isInMessage = true;
+				isCompressed = header.isCompressed;
+			}
+
+			const u64 offset = m_message.size();
+			if((offset + header.payloadLength) > m_maxMessageSize)
+				return failConnection(WebSocketCloseCode::MessageTooBig);
+			m_message.resize(offset + header.payloadLength);
+			result = readExact(m_message.data() + offset, header.payloadLength);
+			if(result != Result::Success)
+				return result;
+			if(header.isMasked)
+				MaskWebSocketPayload(m_message.data() + offset, m_message.data() + offset, header.payloadLength, header.maskKey);
+
+			if(!header.isFinal)
+				continue;
+
+			if(isCompressed)
+			{
+				m_message.insert(m_message.end(), std::begin(gDeflateTrailer), std::end(gDeflateTrailer));
+				m_inflateBuffer.clear();
+				if(!m_inflateStream->decompress(m_message.data(), static_cast<u32>(m_message.size()), m_inflateBuffer, m_maxMessageSize))
+					return failConnection(WebSocketCloseCode::InvalidPayload);
+				if(m_isInflateNoContextTakeover)
+					m_inflateStream->reset();
+				std::swap(m_message, m_inflateBuffer);
+			}
+			m_hasMessage = true;
+			return Result::Success;
+		}
+	}
+
+	std::optional<WebSocketChunk> NativeWebSocket::receiveChunk(u8* bytes, u32 size)
+	{
+		netsocket_assert(size > 0);
+		if(!isConnected())
+			return { };
+		std::lock_guard<std::mutex> lock(m_receiveMutex);
+		netsocket_assert(!m_hasMessage && "A message is pending for receive(), it can't be read in chunks");
+		ReceiveStream& stream = m_receiveStream;
+		while(true)
+		{
+			const bool isInputDrained = stream.inputBegin == m_streamInput.size();
+			// The next data frame is read once the current one has been consumed
+			if(!stream.isActive || ((stream.frameRemaining == 0) && !stream.header.isFinal && isInputDrained))
+			{
+				WebSocketFrameHeader header;
+				if(readDataFrameHeader(header) != Result::Success)
+					return { };
+				if(stream.isActive != (header.opcode == WebSocketOpcode::Continuation))
+				{
+					failConnection(WebSocketCloseCode::ProtocolError);
+					return { };
+				}
+				if(!stream.isActive)
+				{
+					stream.isActive = true;
+					stream.isCompressed = header.isCompressed;
+					stream.isTrailerFed = false;
+				}
+				stream.header = header;
+				stream.frameRemaining = header.payloadLength;
+			}
+
+			if(!stream.isCompressed)
+			{
+				// Straight from the socket (or the read-ahead buffer) into the caller's buffer
+				const u32 chunkSize = static_cast<u32>(std::min<u64>(stream.frameRemaining, size));
+				if(readExact(bytes, chunkSize) != Result::Success)
+					return { };
+				if(stream.header.isMasked)
+					MaskWebSocketPayload(bytes, bytes, chunkSize, stream.header.maskKey, stream.header.payloadLength - stream.frameRemaining);
+				stream.frameRemaining -= chunkSize;
+				const bool isFinal = stream.header.isFinal && (stream.frameRemaining == 0);
+				if(isFinal)
+					stream.isActive = false;
+				return { WebSocketChunk { chunkSize, isFinal } };
+			}
+
+			// Compressed payload: read it in bounded pieces, the trailer stripped by the sender is fed after the last piece
+			if(isInputDrained)
+			{
+				m_streamInput.clear();
+				stream.inputBegin = 0;
+				if(stream.frameRemaining > 0)
+				{
+					const u32 inputSize = static_cast<u32>(std::min<u64>(stream.frameRemaining, gStreamInputSize));
+					m_streamInput.resize(inputSize);
+					if(readExact(m_streamInput.data(), inputSize) != Result::Success)
+						return { };
+					if(stream.header.isMasked)
+						MaskWebSocketPayload(m_streamInput.data(), m_streamInput.data(), inputSize, stream.header.maskKey, stream.header.payloadLength - stream.frameRemaining);
+					stream.frameRemaining -= inputSize;
+				}
+				else if(stream.header.isFinal && !stream.isTrailerFed)
+				{
+					m_streamInput.assign(std::begin(gDeflateTrailer), std::end(gDeflateTrailer));
+					stream.isTrailerFed = true;
+				}
+			}
+			const u32 inputSize = static_cast<u32>(m_streamInput.size()) - stream.inputBegin;
+			std::optional<std::pair<u32, u32>> progress = m_inflateStream->decompressPartial(m_streamInput.data() + stream.inputBegin, inputSize, bytes, size);
+			if(!progress || ((inputSize != 0) && (progress->first == 0) && (progress->second == 0)))
+			{
+				failConnection(WebSocketCloseCode::InvalidPayload);
+				return { };
+			}
+			stream.inputBegin += progress->first;
+
+			// Everything has been fed and inflate had room to spare, so nothing is left inside zlib either
+			const bool isFinal = stream.isTrailerFed && (stream.inputBegin == m_streamInput.size()) && (progress->second < size);
+			if(isFinal)
+			{
+				if(m_isInflateNoContextTakeover)
+					m_inflateStream->reset();
+				stream.isActive = false;
+				return { WebSocketChunk { progress->second, true } };
+			}
+			if(progress->second > 0)
+				return { WebSocketChunk { progress->second, false } };
+		}
+	}
+
+	Result NativeWebSocket::failConnection(WebSocketCloseCode code)
+	{
+		spdlog::error("Failing the WebSocket connection, status code: {}", com::EnumClassToInt(code));
+		const u16 value = com::EnumClassToInt(code);
+		const u8 payload[2] = { static_cast<u8>(value >> 8), static_cast<u8>(value) };
+		closeConnection(payload, sizeof(payload));
+		return Result::SocketError;
+	}
+
+	Result NativeWebSocket::sendFrameLocked(WebSocketOpcode opcode, bool isFinal, bool isCompressed, const u8* payload, u64 size)
+	{
+		WebSocketFrameHeader header;
+		header.isFinal = isFinal;
+		header.isCompressed = isCompressed;
+		header.opcode = opcode;
+		// Only the frames from a client are masked
+		header.isMasked = !m_isServerOwnedClient;
+		header.maskKey = 0;
+		if(header.isMasked && (generateRandom(reinterpret_cast<u8*>(&header.maskKey), sizeof(header.maskKey)) != Result::Success))
+			return Result::Failed;
+		header.payloadLength = size;
+
+		Result result = Result::Success;
+		if(header.isMasked)
+		{
+			// Mask into the send buffer chunk by chunk, the first chunk goes out along with the header
+			m_sendBuffer.resize(WebSocketFrameHeader::MaxSize + std::min<u64>(size, gMaskChunkSize));
+			u32 headerSize = header.encode(m_sendBuffer.data());
+			u64 offset = 0;
+			do
+			{
+				const u64 chunkSize = std::min<u64>(size - offset, gMaskChunkSize);
+				MaskWebSocketPayload(m_sendBuffer.data() + headerSize, payload + offset, chunkSize, header.maskKey, offset);
+				result = m_socket.send(m_sendBuffer.data(), static_cast<u32>(headerSize + chunkSize));
+				offset += chunkSize;
+				headerSize = 0;
+			} while((result == Result::Success) && (offset < size));
+		}
+		else if(size <= gMaxCoalescedPayloadSize)
+		{
+			m_sendBuffer.resize(WebSocketFrameHeader::MaxSize + size);
+			const u32 headerSize = header.encode(m_sendBuffer.data());
+			if(size != 0)
+				std::memcpy(m_sendBuffer.data() + headerSize, payload, size);
+			result = m_socket.send(m_sendBuffer.data(), static_cast<u32>(headerSize + size));
+		}
+		else
+		{
+			u8 headerBytes[WebSocketFrameHeader::MaxSize];
+			const u32 headerSize = header.encode(headerBytes);
+			result = m_socket.send(headerBytes, headerSize);
+			if(result == Result::Success)
+				result = m_socket.send(payload, static_cast<u32>(size));
+		}
+		if(result != Result::Success)
+			markDisconnected();
+		return result;
+	}
+
+	Result NativeWebSocket::sendControlFrame(WebSocketOpcode opcode, const u8* payload, u32 size)
+	{
+		std::lock_guard<std::mutex> lock(m_sendMutex);
+		if(!isConnected())
+			return Result::SocketError;
+		return sendFrameLocked(opcode, true, false, payload, size);
+	}
+
+	Result NativeWebSocket::sendMessage(WebSocketOpcode opcode, const u8* bytes, u32 size)
+	{
+		std::lock_guard<std::mutex> lock(m_sendMutex);
+		if(!isConnected())
+			return Result::SocketError;
+		// The frames would end up inside the message being sent with sendChunk()
+		if(m_isSendingChunks)
+			return Result::Failed;
+		if(!m_deflateStream || (size < m_compressionOptions.minMessageSize))
+			return sendFrameLocked(opcode, true, false, bytes, size);
+
+		m_compressBuffer.clear();
+		if(!m_deflateStream->compress(bytes, size, DeflateStream::Flush::Sync, m_compressBuffer))
+			return Result::Failed;
+		StripDeflateTrailer(m_compressBuffer);
+		if(m_isDeflateNoContextTakeover)
+			m_deflateStream->reset();
+		return sendFrameLocked(opcode, true, true, m_compressBuffer.data(), m_compressBuffer.size());
+	}
+
+	Result NativeWebSocket::sendEncodedFrame(const u8* bytes, u64 size)
+	{
+		std::lock_guard<std::mutex> lock(m_sendMutex);
+		if(!isConnected())
+			return Result::SocketError;
+		if(m_isSendingChunks)
+			return Result::Failed;
+		Result result = m_socket.send(bytes, static_cast<u32>(size));
+		if(result != Result::Success)
+			markDisconnected();
+		return result;
+	}
+}
@@ -5,12 +5,13 @@
 
 #include <functional>
 #include <cstring>
+#include <chrono>
 
 namespace netsocket
 {
 	AsyncSocket::Transxn::Transxn(const u8* data, u32 dataSize, Type type) : m_type(type), m_isValid(false)
 	{
-		netsocket_assert(type == Type::Send);
+		netsocket_assert((type == Type::Send) || (type == Type::SendMessage));
 		m_buffer = buf_create(sizeof(u8), dataSize, 0);
 		buf_push_pseudo(&m_buffer, dataSize);
 		void* ptr = buf_get_ptr(&m_buffer);
@@ -29,6 +30,17 @@ namespace netsocket
 		m_buffer = buf_create(sizeof(u8), 0, 0);
 		m_isValid = true;
 	}
+
+	AsyncSocket::Transxn::Transxn(ReceiveCallbackHandler receiveHandler, void* userData, Type type) : 
+																									m_receiveHandler(receiveHandler),
+																									m_userData(userData), 
+																									m_type(type), 
+																									m_isValid(false)
+	{
+		netsocket_assert(type == Type::ReceiveMessage);
+		m_buffer = buf_create(sizeof(u8), 0, 0);
+		m_isValid = true;
+	}
 	
 	AsyncSocket::Transxn::Transxn(Transxn&& transxn) : 
 														 	m_receiveHandler(transxn.m_receiveHandler),
@@ -53,7 +65,7 @@ namespace netsocket
 	u8* AsyncSocket::Transxn::getBufferPtr() { return buf_get_ptr_typeof(&m_buffer, u8); }
 	u32 AsyncSocket::Transxn::getBufferSize() { return static_cast<u32>(buf_get_element_count(&m_buffer)); }
 	
-	bool AsyncSocket::Transxn::doit(Socket& socket)
+	bool AsyncSocket::Transxn::doit(Socket& socket, MessageSocket* messageSocket)
 	{
 		switch(m_type)
 		{
@@ -92,6 +104,31 @@ namespace netsocket
 					m_receiveHandler(NULL, getBufferSize(), m_userData);
 				return result;
 			}
+			case Type::SendMessage:
+			{
+				netsocket_assert((messageSocket != nullptr) && "Call setMessageFraming() first");
+				return messageSocket->sendMessage(getBufferPtr(), getBufferSize()) == Result::Success;
+			}
+			case Type::ReceiveMessage:
+			{
+				netsocket_assert((messageSocket != nullptr) && "Call setMessageFraming() first");
+				netsocket_assert(m_receiveHandler != NULL);
+				std::optional<u32> size = messageSocket->receiveMessageSize();
+				bool result = size.has_value();
+				if(result)
+				{
+					buf_push_pseudo(&m_buffer, *size);
+					result = messageSocket->receiveMessageData(getBufferPtr(), *size) == Result::Success;
+				}
+				if(result)
+					m_receiveHandler(getBufferPtr(), getBufferSize(), m_userData);
+				else
+				{
+					spdlog::error("Failed to receive message");
+					m_receiveHandler(NULL, getBufferSize(), m_userData);
+				}
+				return result;
+			}
 			default:
 			{
 				spdlog::error("Unrecognized Transxn::Type: {}", com::EnumClassToInt(m_type));
@@ -104,6 +141,8 @@ namespace netsocket
 	AsyncSocket::AsyncSocket(Socket&& socket) : m_socket(std::move(socket)), m_isValid(false)
 	{
 		m_isTransactionError = false;
+		m_queuedTransxnCount = 0;
+		m_busyPollSpinTime = 0;
 		m_isValid = true; 
 		if(m_socket.isConnected())
 		{
@@ -159,8 +198,54 @@ namespace netsocket
 		return result;
 	}
 
+	Result AsyncSocket::startTls(const std::shared_ptr<TlsContext>& context, const std::string_view serverName)
+	{
+		// Holding the lock keeps the transaction thread off the socket during the handshake
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_socket.startTls(context, serverName);
+	}
+
+	Result AsyncSocket::startCompression(const SocketCompressionOptions& options)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_socket.startCompression(options);
+	}
+
+	Result AsyncSocket::setMessageFraming(const MessageFramingOptions& options)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_messageSocket = std::make_unique<MessageSocket>(m_socket, options);
+		return Result::Success;
+	}
+
+	Result AsyncSocket::setBusyPoll(const BusyPollOptions& options)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		Result result = m_socket.setBusyPoll(options);
+		if(result == Result::Success)
+			m_busyPollSpinTime = m_socket.isBusyPollEnabled() ? options.spinTime : 0;
+		return result;
+	}
+
+	Result AsyncSocket::setSendRateLimit(const RateLimit& limit)
+	{
+		// Doesn't take m_mutex: the transaction thread may be waiting for the rate limiter while the limit changes
+		return m_socket.setSendRateLimit(limit);
+	}
+
+	template<typename Condition>
+	void AsyncSocket::spinUntil(Condition condition)
+	{
+		const u32 spinTime = m_busyPollSpinTime;
+		if(spinTime == 0)
+			return;
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(spinTime);
+		while(!condition() && (std::chrono::steady_clock::now() < deadline)) { }
+	}
+
 	Result AsyncSocket::finish()
 	{
+		spinUntil([this] { return m_queuedTransxnCount == 0; });
 		std::unique_lock<std::mutex> lock(m_mutex);
 		m_finishCV.wait(lock, [this] { return m_transxnQueue.empty(); });
 		if(m_isTransactionError)
@@ -169,6 +254,9 @@ namespace netsocket
 			m_isTransactionError = false;
 			return Result::Failed;
 		}
+		// The transaction thread is idle with the queue empty
+		if(m_socket.isConnected() && (m_socket.flush() != Result::Success))
+			return Result::Failed;
 		return Result::Success;
 	}
 	
@@ -197,6 +285,7 @@ namespace netsocket
 		Transxn transxn(bytes, size, Transxn::Type::Send);
 		std::unique_lock<std::mutex> lock(m_mutex);
 		m_transxnQueue.push_front(std::move(transxn));
+		++m_queuedTransxnCount;
 		lock.unlock();
 		m_dataAvailableCV.notify_one();
 	}
@@ -206,14 +295,37 @@ namespace netsocket
 		Transxn transxn(receiveHandler, userData, receiveFormatter, Transxn::Type::Receive);
 		std::unique_lock<std::mutex> lock(m_mutex);
 		m_transxnQueue.push_front(std::move(transxn));
+		++m_queuedTransxnCount;
 		lock.unlock();
 		m_dataAvailableCV.notify_one();
 	}
 	
+	void AsyncSocket::sendMessage(const u8* bytes, u32 size)
+	{
+		Transxn transxn(bytes, size, Transxn::Type::SendMessage);
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_transxnQueue.push_front(std::move(transxn));
+		++m_queuedTransxnCount;
+		lock.unlock();
+		m_dataAvailableCV.notify_one();
+	}
+
+	void AsyncSocket::receiveMessage(Transxn::ReceiveCallbackHandler receiveHandler, void* userData)
+	{
+		Transxn transxn(receiveHandler, userData, Transxn::Type::ReceiveMessage);
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_transxnQueue.push_front(std::move(transxn));
+		++m_queuedTransxnCount;
+		lock.unlock();
+		m_dataAvailableCV.notify_one();
+	}
+
 	void AsyncSocket::threadHandler()
 	{
 		while(true)
 		{
+			// Busy polling: the next transaction usually arrives before the spin is over, it then doesn't wait for a wakeup
+			spinUntil([this] { return (m_queuedTransxnCount > 0) || m_isStopThread; });
 			/* lock and copy/move the Transxn object into the local storage of this thread */
 			std::unique_lock<std::mutex> lock(m_mutex);
 			while(m_transxnQueue.empty() && (!m_isStopThread))
@@ -226,7 +338,7 @@ namespace netsocket
 			lock.unlock();
 
 			/* Transxn::doit takes a long time to process due to network latency */
-			bool result = transxn.doit(m_socket);
+			bool result = transxn.doit(m_socket, m_messageSocket.get());
 			if(!result)
 			{
 				m_isCanSendOrReceive = false;
@@ -235,6 +347,7 @@ namespace netsocket
 					
 				lock.lock();
 				m_transxnQueue.pop_back();
+				--m_queuedTransxnCount;
 				m_finishCV.notify_all();
 				lock.unlock();
 
@@ -244,6 +357,7 @@ namespace netsocket
 
 			lock.lock();
 			m_transxnQueue.pop_back();
+			--m_queuedTransxnCount;
 			if(m_transxnQueue.empty())
 				m_finishCV.notify_all();
 			lock.unlock();
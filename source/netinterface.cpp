@@ -9,12 +9,14 @@
 #	include <ifaddrs.h>
 #	include <arpa/inet.h>
 #	include <netinet/in.h>
+#	include <net/if.h> // for if_nametoindex
 #endif
 
 #include <ranges>
 #include <algorithm>
 #include <string>
 #include <sstream>
+#include <cstring> // for std::memcpy
 
 namespace netsocket
 {
@@ -36,6 +38,54 @@ namespace netsocket
 		return stream.str();
 	}
 
+	IPv6Address::IPv6Address(const std::string_view str) : parts { }, scopeId(0)
+	{
+		std::string address { str };
+		const std::size_t scopeIndex = address.find('%');
+		if(scopeIndex != std::string::npos)
+		{
+			const std::string scope = address.substr(scopeIndex + 1);
+			address.resize(scopeIndex);
+			const bool isNumber = !scope.empty() && std::ranges::all_of(scope, [](char c) { return (c >= '0') && (c <= '9'); });
+			scopeId = isNumber ? static_cast<u32>(std::stoul(scope)) : static_cast<u32>(if_nametoindex(scope.c_str()));
+		}
+		const int result = inet_pton(AF_INET6, address.c_str(), parts.data());
+		netsocket_assert((result == 1) && "Invalid IPv6 address");
+	}
+
+	bool IPv6Address::isLoopback() const noexcept
+	{
+		return std::all_of(parts.begin(), parts.end() - 1, [](u8 part) { return part == 0; }) && (parts[15] == 1);
+	}
+
+	bool IPv6Address::isLinkLocal() const noexcept
+	{
+		return (parts[0] == 0xfe) && ((parts[1] & 0xc0) == 0x80);
+	}
+
+	bool IPv6Address::isIPv4Mapped() const noexcept
+	{
+		return std::all_of(parts.begin(), parts.begin() + 10, [](u8 part) { return part == 0; }) && (parts[10] == 0xff) && (parts[11] == 0xff);
+	}
+
+	IPv4Address IPv6Address::getMappedIPv4Address() const noexcept
+	{
+		IPv4Address address;
+		std::copy(parts.begin() + 12, parts.end(), address.begin());
+		return address;
+	}
+
+	std::string IPv6Address::str() const
+	{
+		char buffer[INET6_ADDRSTRLEN];
+		if(inet_ntop(AF_INET6, parts.data(), buffer, sizeof(buffer)) == NULL)
+			return { };
+		std::string result { buffer };
+		if(scopeId != 0)
+			result += "%" + std::to_string(scopeId);
+		return result;
+	}
+
 	NETSOCKET_API std::vector<std::pair<std::string, IPv4Address>> GetInterfaceIPv4Addresses()
 	{
 		std::vector<std::pair<std::string, IPv4Address>> addresses;
@@ -103,6 +153,69 @@ namespace netsocket
 		return addresses;
 	}
 
+	NETSOCKET_API std::vector<std::pair<std::string, IPv6Address>> GetInterfaceIPv6Addresses()
+	{
+		std::vector<std::pair<std::string, IPv6Address>> addresses;
+
+#ifdef PLATFORM_WINDOWS
+		ULONG outBufLen = 15000; // large enough buffer
+		PIP_ADAPTER_ADDRESSES pAddresses = (IP_ADAPTER_ADDRESSES*)malloc(outBufLen);
+		if(!pAddresses)
+		    throw std::runtime_error("Memory allocation failed for IP_ADAPTER_ADDRESSES");
+
+		DWORD dwRet = GetAdaptersAddresses(AF_INET6, 0, nullptr, pAddresses, &outBufLen);
+		if(dwRet != NO_ERROR)
+		{
+    		free(pAddresses);
+    		throw std::runtime_error("GetAdaptersAddresses failed");
+		}
+
+    	for(PIP_ADAPTER_ADDRESSES pCurr = pAddresses; pCurr != nullptr; pCurr = pCurr->Next)
+    	{
+        	for(PIP_ADAPTER_UNICAST_ADDRESS pUnicast = pCurr->FirstUnicastAddress; pUnicast != nullptr; pUnicast = pUnicast->Next) 
+        	{
+        	    SOCKADDR* addr = pUnicast->Address.lpSockaddr;
+        	    if(addr->sa_family == AF_INET6)
+        	    {
+					const sockaddr_in6* addr6 = reinterpret_cast<const sockaddr_in6*>(addr);
+					IPv6Address ipAddress;
+					std::memcpy(ipAddress.parts.data(), &addr6->sin6_addr, ipAddress.parts.size());
+					ipAddress.scopeId = addr6->sin6_scope_id;
+
+					// Convert wide FriendlyName -> narrow string
+					std::wstring wname = pCurr->FriendlyName;
+					std::string ifName(wname.begin(), wname.end());
+
+					addresses.emplace_back(ifName, ipAddress);
+				}
+			}
+		}
+		free(pAddresses);
+#else // PLATFORM_LINUX
+		struct ifaddrs* ifaddr;
+
+		int result = getifaddrs(&ifaddr);
+		netsocket_assert(result != -1);
+
+		for(struct ifaddrs* ifa = ifaddr; ifa != NULL; ifa = ifa->ifa_next)
+		{
+			if(ifa->ifa_addr == NULL) continue;
+
+			if(ifa->ifa_addr->sa_family == AF_INET6)
+			{
+				const struct sockaddr_in6* addr = reinterpret_cast<const struct sockaddr_in6*>(ifa->ifa_addr);
+				IPv6Address ipAddress;
+				std::memcpy(ipAddress.parts.data(), &addr->sin6_addr, ipAddress.parts.size());
+				ipAddress.scopeId = addr->sin6_scope_id;
+				addresses.push_back({ std::string { ifa->ifa_name }, ipAddress });
+			}
+		}
+
+		freeifaddrs(ifaddr);
+#endif
+		return addresses;
+	}
+
 	NETSOCKET_API std::string TrySelectingPhysicalInterfaceIPAddress(const std::vector<std::pair<std::string, IPv4Address>>& ipAddresses, std::string_view prefix)
 	{
 		std::vector<std::pair<std::string, IPv4Address>> filtered;
@@ -1,10 +1,14 @@
 #include <netsocket/netsocket.hpp>
+#include <netsocket/tls.hpp>
+#include <netsocket/zstream.hpp>
 #include <common/platform.h>
 #include <common/debug.h>
 #include <netsocket/assert.hpp>
 
 #ifdef PLATFORM_WINDOWS
 #	include <ws2tcpip.h>
+#	include <iphlpapi.h> // for if_nametoindex
+#	include <afunix.h> // for sockaddr_un
 #elif defined(PLATFORM_LINUX)
 #	include <sys/socket.h>
 #	include <netinet/tcp.h>
@@ -13,6 +17,13 @@
 #	include <unistd.h> // for close
 #	include <errno.h> // for errno
 #	include <string.h> // for memset
+#	include <poll.h> // for poll
+#	include <fcntl.h> // for fcntl
+#	include <sys/sendfile.h> // for sendfile
+#	include <sys/stat.h> // for fstat
+#	include <sys/un.h> // for sockaddr_un
+#	include <net/if.h> // for if_nametoindex
+#	include <linux/filter.h> // for sock_filter, sock_fprog
 #	define ZeroMemory(ptr, size) memset(ptr, 0, size) // on Linux ZeroMemory is not defined.
 #else
 #	error "Unsupported platform"
@@ -26,6 +37,16 @@
 #	define closesocket(socket_handle) ::close(socket_handle)
 #endif
 
+#include <cstdio> // for std::fopen
+#include <cstdlib> // for std::strtoul
+#include <algorithm> // for std::min, std::max
+#include <cstring> // for std::memcpy
+#include <cstddef> // for offsetof
+#include <chrono> // for std::chrono::steady_clock
+#include <mutex>
+#include <thread> // for std::thread::hardware_concurrency
+#include <type_traits> // for std::is_same
+
 namespace netsocket
 {
 	#ifdef PLATFORM_WINDOWS
@@ -50,6 +71,7 @@ namespace netsocket
 		{
 			case IPAddressFamily::IPv4: return AF_INET;
 			case IPAddressFamily::IPv6: return AF_INET6;
+			case IPAddressFamily::Unix: return AF_UNIX;
 			default:
 				com_debug_log_fetal_error("IPAddressFamily %lu is not supported as of now", ipaFamily);
 		}
@@ -62,6 +84,7 @@ namespace netsocket
 		{
 			case SocketType::Stream: return SOCK_STREAM;
 			case SocketType::Raw: return SOCK_RAW;
+			case SocketType::Datagram: return SOCK_DGRAM;
 			default:
 				com_debug_log_fetal_error("SocketType %lu is not supported as of now", socketType);
 		}
@@ -75,18 +98,352 @@ namespace netsocket
 			case IPProtocol::TCP: return IPPROTO_TCP;
 			case IPProtocol::UDP: return IPPROTO_UDP;
 			// case IPProtocol::RM: return IPPROTO_RM;
+			case IPProtocol::Default: return 0;
 			default:
 				com_debug_log_fetal_error("IPProtocol %lu is not supported as of now", ipProtocol);
 		}
 		return 0;
 	}
 
+	// Fills 'address' for Socket::bindUnix() and connectUnix(), returns its length or 0 if the path is invalid
+	static int GetUnixAddress(std::string_view path, sockaddr_un& address)
+	{
+		ZeroMemory(&address, sizeof(address));
+		address.sun_family = AF_UNIX;
+		// sun_path is null terminated unless the name is abstract
+		if(path.empty() || (path.size() >= sizeof(address.sun_path)))
+			return 0;
+		if(path[0] == '@')
+		{
+#ifdef PLATFORM_LINUX
+			std::memcpy(address.sun_path + 1, path.data() + 1, path.size() - 1);
+			return static_cast<int>(offsetof(sockaddr_un, sun_path) + path.size());
+#else
+			return 0;
+#endif
+		}
+		std::memcpy(address.sun_path, path.data(), path.size());
+		return static_cast<int>(offsetof(sockaddr_un, sun_path) + path.size() + 1);
+	}
+
+#ifdef PLATFORM_WINDOWS
+	// Integer socket options
+	using SocketOptionInt = DWORD;
+#else
+	using SocketOptionInt = int;
+#endif
+
+	template<typename T>
+	static Result SetSocketOption(SocketHandle socket, int level, int name, const T& value)
+	{
+		return (setsockopt(socket, level, name, reinterpret_cast<const char*>(&value), sizeof(value)) == NETSOCKET_SOCKET_ERROR) ? Result::SocketError : Result::Success;
+	}
+
+	// Sets an integer (or boolean) option if 'value' has one, keeps the first error in 'result'
+	template<typename T>
+	static void ApplySocketOption(SocketHandle socket, int level, int name, const std::optional<T>& value, Result& result)
+	{
+		if(!value.has_value())
+			return;
+		Result optionResult = SetSocketOption(socket, level, name, static_cast<SocketOptionInt>(*value));
+		if(result == Result::Success)
+			result = optionResult;
+	}
+
+	// Empty if the socket doesn't have the option
+	template<typename T>
+	static std::optional<T> GetSocketOption(SocketHandle socket, int level, int name)
+	{
+		SocketOptionInt value = 0;
+		socklen_t size = sizeof(value);
+		if(getsockopt(socket, level, name, reinterpret_cast<char*>(&value), &size) == NETSOCKET_SOCKET_ERROR)
+			return { };
+		if constexpr (std::is_same<T, bool>::value)
+			return { value != 0 };
+		else
+			return { static_cast<T>(value) };
+	}
+
+	// Clears 'option' if it is the same as on a fresh socket, so that only the options which were changed are carried over
+	template<typename T>
+	static void ClearDefaultSocketOption(std::optional<T>& option, const std::optional<T>& defaultOption)
+	{
+		if(option == defaultOption)
+			option.reset();
+	}
+
+	// 0 for an address of another family than IPv4 and IPv6
+	static u16 GetSocketAddressPort(const sockaddr_storage& address)
+	{
+		if(address.ss_family == AF_INET)
+			return ntohs(reinterpret_cast<const sockaddr_in&>(address).sin_port);
+		if(address.ss_family == AF_INET6)
+			return ntohs(reinterpret_cast<const sockaddr_in6&>(address).sin6_port);
+		return 0;
+	}
+
+	// Interface name or index, 0 if the interface is unknown or the name is empty
+	static u32 GetInterfaceIndex(const std::string_view networkInterface)
+	{
+		if(networkInterface.empty())
+			return 0;
+		const std::string name { networkInterface };
+		if(std::all_of(name.begin(), name.end(), [](char c) { return (c >= '0') && (c <= '9'); }))
+			return static_cast<u32>(std::strtoul(name.c_str(), NULL, 10));
+		return if_nametoindex(name.c_str());
+	}
+
+	static Result ChangeMulticastMembership(SocketHandle socket, int family, const std::string_view group, const std::string_view networkInterface, bool isJoin)
+	{
+		const std::string groupAddress { group };
+		if(family == AF_INET)
+		{
+			ip_mreq request;
+			ZeroMemory(&request, sizeof(request));
+			if(inet_pton(AF_INET, groupAddress.c_str(), &request.imr_multiaddr) != 1)
+				return Result::Failed;
+			request.imr_interface.s_addr = htonl(INADDR_ANY);
+			if(!networkInterface.empty() && (inet_pton(AF_INET, std::string { networkInterface }.c_str(), &request.imr_interface) != 1))
+				return Result::Failed;
+			return SetSocketOption(socket, IPPROTO_IP, isJoin ? IP_ADD_MEMBERSHIP : IP_DROP_MEMBERSHIP, request);
+		}
+		if(family == AF_INET6)
+		{
+			ipv6_mreq request;
+			ZeroMemory(&request, sizeof(request));
+			if(inet_pton(AF_INET6, groupAddress.c_str(), &request.ipv6mr_multiaddr) != 1)
+				return Result::Failed;
+			request.ipv6mr_interface = GetInterfaceIndex(networkInterface);
+			if(!networkInterface.empty() && (request.ipv6mr_interface == 0))
+				return Result::Failed;
+			return SetSocketOption(socket, IPPROTO_IPV6, isJoin ? IPV6_JOIN_GROUP : IPV6_LEAVE_GROUP, request);
+		}
+		return Result::Failed;
+	}
+
+	struct ConnectCandidate
+	{
+		sockaddr_storage address;
+		socklen_t addressLength;
+		int family;
+	};
+
+	// Appends the IPv6 and IPv4 addresses of 'host' in getaddrinfo()'s order (RFC 6724, so usually IPv6 first)
+	static void ResolveConnectCandidates(const std::string& host, const std::string& port, std::vector<ConnectCandidate>& candidates)
+	{
+		struct addrinfo hints;
+		ZeroMemory(&hints, sizeof(hints));
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_protocol = IPPROTO_TCP;
+		struct addrinfo* addressInfo = NULL;
+		if(getaddrinfo(host.c_str(), port.c_str(), &hints, &addressInfo) != 0)
+			return;
+		for(struct addrinfo* info = addressInfo; info != NULL; info = info->ai_next)
+		{
+			if((info->ai_family != AF_INET) && (info->ai_family != AF_INET6))
+				continue;
+			ConnectCandidate candidate;
+			std::memcpy(&candidate.address, info->ai_addr, info->ai_addrlen);
+			candidate.addressLength = static_cast<socklen_t>(info->ai_addrlen);
+			candidate.family = info->ai_family;
+			candidates.push_back(candidate);
+		}
+		freeaddrinfo(addressInfo);
+	}
+
+	// RFC 8305 section 4: alternates the families, starting with the family of the first address
+	static std::vector<ConnectCandidate> InterleaveConnectCandidates(const std::vector<ConnectCandidate>& candidates)
+	{
+		std::vector<ConnectCandidate> preferred, others, interleaved;
+		for(const ConnectCandidate& candidate : candidates)
+			(candidate.family == candidates[0].family ? preferred : others).push_back(candidate);
+		for(std::size_t i = 0; (i < preferred.size()) || (i < others.size()); ++i)
+		{
+			if(i < preferred.size())
+				interleaved.push_back(preferred[i]);
+			if(i < others.size())
+				interleaved.push_back(others[i]);
+		}
+		return interleaved;
+	}
+
+	// True if the last socket call failed only because a non-blocking socket wasn't ready
+	static bool IsWouldBlockError()
+	{
+#ifdef PLATFORM_WINDOWS
+		return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+		return (errno == EAGAIN) || (errno == EWOULDBLOCK);
+#endif
+	}
+
+	static bool WaitForSocket(SocketHandle socket, short events, s32 timeout)
+	{
+#ifdef PLATFORM_WINDOWS
+		WSAPOLLFD pollFD = { };
+		pollFD.fd = socket;
+		pollFD.events = events;
+		int result = WSAPoll(&pollFD, 1, timeout);
+#else
+		struct pollfd pollFD = { };
+		pollFD.fd = socket;
+		pollFD.events = events;
+		int result;
+		do
+		{
+			result = ::poll(&pollFD, 1, timeout);
+		} while((result < 0) && (errno == EINTR));
+#endif
+		return (result > 0) && ((pollFD.revents & events) != 0);
+	}
+
+	static SocketHandle AcceptSocketHandle(SocketHandle socket, bool isNonBlocking)
+	{
+#ifdef PLATFORM_WINDOWS
+		SocketHandle acceptedSocket = ::accept(socket, NULL, NULL);
+		// Accepted sockets inherit the non-blocking mode of the listening socket on Windows
+		if(acceptedSocket != NETSOCKET_INVALID_SOCKET_HANDLE)
+		{
+			u_long mode = isNonBlocking ? 1 : 0;
+			ioctlsocket(acceptedSocket, FIONBIO, &mode);
+		}
+		return acceptedSocket;
+#else // PLATFORM_LINUX
+		return ::accept4(socket, NULL, NULL, SOCK_CLOEXEC | (isNonBlocking ? SOCK_NONBLOCK : 0));
+#endif
+	}
+
+	static bool GetTCPNoDelay(SocketHandle socket)
+	{
+#ifdef PLATFORM_WINDOWS
+		BOOL flag = FALSE;
+		int size = sizeof(flag);
+		return (getsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<char*>(&flag), &size) == 0) && (flag != FALSE);
+#else // PLATFORM_LINUX
+		int flag = 0;
+		socklen_t size = sizeof(flag);
+		return (getsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &flag, &size) == 0) && (flag != 0);
+#endif
+	}
+
+	static bool SetTCPNoDelay(SocketHandle socket, bool isNoDelay)
+	{
+#ifdef PLATFORM_WINDOWS
+		BOOL flag = isNoDelay ? TRUE : FALSE;
+		return setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<char*>(&flag), sizeof(flag)) == 0;
+#else // PLATFORM_LINUX
+		int flag = isNoDelay ? 1 : 0;
+		return setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag)) == 0;
+#endif
+	}
+
+	// Waits for what the TLS record layer asked for, false if 'result' isn't TlsConnection::WantRead or WantWrite (or the wait failed)
+	static bool WaitForTls(SocketHandle socket, int result, s32 timeout = -1)
+	{
+		if(result == TlsConnection::WantRead)
+			return WaitForSocket(socket, POLLIN, timeout);
+		if(result == TlsConnection::WantWrite)
+			return WaitForSocket(socket, POLLOUT, timeout);
+		return false;
+	}
+
+	// Same contract as ::send() and ::recv(), blocking until some bytes have been transferred (or 'timeout' elapsed, see Socket::setSendTimeout())
+	static int SendTls(TlsConnection& tls, SocketHandle socket, const u8* bytes, u32 size, s32 timeout)
+	{
+		while(true)
+		{
+			int result = tls.send(bytes, size);
+			if(result >= 0)
+				return result;
+			if(!WaitForTls(socket, result, timeout))
+				return NETSOCKET_SOCKET_ERROR;
+		}
+	}
+
+	// Deadline of an operation bounded by 'timeout' milliseconds, time_point::max() if the timeout is -1
+	static std::chrono::steady_clock::time_point GetDeadline(s32 timeout)
+	{
+		return (timeout < 0) ? std::chrono::steady_clock::time_point::max() : (std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout));
+	}
+
+	// Timeout for poll() which ends at 'deadline', -1 if there is none
+	static s32 GetRemainingTimeout(std::chrono::steady_clock::time_point deadline)
+	{
+		if(deadline == std::chrono::steady_clock::time_point::max())
+			return -1;
+		const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+		return static_cast<s32>(std::max<decltype(remaining)>(remaining, 0));
+	}
+
+	// 'timeout' bounds the whole call, a peer trickling a record piece by piece doesn't extend it
+	static int ReceiveTls(TlsConnection& tls, SocketHandle socket, u8* bytes, u32 size, s32 timeout)
+	{
+		const auto deadline = GetDeadline(timeout);
+		while(true)
+		{
+			int result = tls.receive(bytes, size);
+			if(result >= 0)
+				return result;
+			if(!WaitForTls(socket, result, GetRemainingTimeout(deadline)))
+				return NETSOCKET_SOCKET_ERROR;
+		}
+	}
+
+	struct Socket::CompressionState
+	{
+		DeflateStream deflateStream;
+		InflateStream inflateStream;
+		SocketCompressionOptions::FlushPolicy flushPolicy;
+		u32 batchSize;
+		// send() and the flush receiveSome() performs before waiting may run on different threads
+		std::mutex sendMutex;
+		std::vector<u8> output;
+		// Bytes fed to the compressor since the last flush
+		u32 unflushedSize;
+		// Compressed bytes received, [inputBegin, inputEnd) haven't been inflated yet
+		std::vector<u8> input;
+		u32 inputBegin;
+		u32 inputEnd;
+		SocketCompressionStats stats;
+
+		// The inflate window is always the largest, so that it accepts whatever window the peer compresses with
+		CompressionState(const SocketCompressionOptions& options) : deflateStream(options.level, options.windowBits, true, options.memLevel),
+																	inflateStream(15, true),
+																	flushPolicy(options.flushPolicy),
+																	batchSize(options.batchSize),
+																	unflushedSize(0),
+																	input(64 * 1024),
+																	inputBegin(0),
+																	inputEnd(0)
+		{
+		}
+	};
+
+	Socket::Socket() :
+					m_socket(NETSOCKET_INVALID_SOCKET_HANDLE),
+					m_ipaFamily(0),
+					m_socketType(0),
+					m_ipProtocol(0),
+					m_isConnected(false),
+					m_isValid(false),
+					m_listenBacklog(0),
+					m_busyPollSpinTime(0),
+					m_sendTimeout(-1),
+					m_receiveTimeout(-1)
+	{
+	}
+
 	Socket::Socket(SocketType socketType, IPAddressFamily ipAddressFamily, IPProtocol ipProtocol) : 
 																						m_ipaFamily(GetWin32IPAddressFamily(ipAddressFamily)), 
 																						m_socketType(GetWin32SocketType(socketType)), 
-																						m_ipProtocol(GetWin32IPProtocol(ipProtocol)),
+																						m_ipProtocol((ipAddressFamily == IPAddressFamily::Unix) ? 0 : GetWin32IPProtocol(ipProtocol)),
 																						m_isConnected(false),
-																						m_isValid(false)
+																						m_isValid(false),
+																						m_listenBacklog(0),
+																						m_busyPollSpinTime(0),
+																						m_sendTimeout(-1),
+																						m_receiveTimeout(-1)
 	{
 		m_socket = socket(m_ipaFamily, m_socketType, m_ipProtocol);
 
@@ -102,6 +459,12 @@ namespace netsocket
 		m_isValid = true;
 	}
 
+	Socket::Socket(SocketType socketType, IPAddressFamily ipAddressFamily, IPProtocol ipProtocol, const SocketOptions& options) : Socket(socketType, ipAddressFamily, ipProtocol)
+	{
+		if(m_socket != NETSOCKET_INVALID_SOCKET_HANDLE)
+			setOptions(options);
+	}
+
 	Socket::Socket(Socket&& socket) :
 									m_socket(socket.m_socket),
 									m_ipaFamily(socket.m_ipaFamily),
@@ -109,6 +472,13 @@ namespace netsocket
 									m_ipProtocol(socket.m_ipProtocol),
 									m_isConnected(socket.m_isConnected),
 									m_isValid(socket.m_isValid),
+									m_listenBacklog(socket.m_listenBacklog),
+									m_busyPollSpinTime(socket.m_busyPollSpinTime),
+									m_sendTimeout(socket.m_sendTimeout),
+									m_receiveTimeout(socket.m_receiveTimeout),
+									m_tls(std::move(socket.m_tls)),
+									m_compression(std::move(socket.m_compression)),
+									m_sendRateLimiter(std::move(socket.m_sendRateLimiter)),
 									m_onDisconnectCallback(std::move(socket.m_onDisconnectCallback))
 	{
 		socket.m_socket = NETSOCKET_INVALID_SOCKET_HANDLE;
@@ -121,12 +491,23 @@ namespace netsocket
 
 	Socket& Socket::operator=(Socket&& socket)
 	{
+		if(this == &socket)
+			return *this;
+		// Don't leak the handle this socket currently owns
+		close();
 		m_socket = socket.m_socket;
 		m_ipaFamily = socket.m_ipaFamily;
 		m_socketType = socket.m_socketType;
 		m_ipProtocol = socket.m_ipProtocol;
 		m_isConnected = socket.m_isConnected;
 		m_isValid = socket.m_isValid;
+		m_listenBacklog = socket.m_listenBacklog;
+		m_busyPollSpinTime = socket.m_busyPollSpinTime;
+		m_sendTimeout = socket.m_sendTimeout;
+		m_receiveTimeout = socket.m_receiveTimeout;
+		m_tls = std::move(socket.m_tls);
+		m_compression = std::move(socket.m_compression);
+		m_sendRateLimiter = std::move(socket.m_sendRateLimiter);
 		m_onDisconnectCallback = std::move(socket.m_onDisconnectCallback);
 
 		socket.m_socket = NETSOCKET_INVALID_SOCKET_HANDLE;
@@ -141,24 +522,56 @@ namespace netsocket
 
 	Socket::~Socket()
 	{
-		if(m_isValid)
-			close();
+		close();
 	}
 
 	Result Socket::listen()
 	{
-		if(::listen(m_socket, SOMAXCONN) == NETSOCKET_SOCKET_ERROR)
+		const int backlog = (m_listenBacklog == 0) ? SOMAXCONN : static_cast<int>(m_listenBacklog);
+		if(::listen(m_socket, backlog) == NETSOCKET_SOCKET_ERROR)
 			return Result::SocketError;
-		return Result::Success;
+		// So that tryAccept() and acceptMany() never block, accept() waits with poll instead
+		return setNonBlocking(true);
+	}
+
+	std::optional<Socket> Socket::accept(const SocketOptions& options)
+	{
+		while(true)
+		{
+			SocketHandle acceptedSocket = AcceptSocketHandle(m_socket, false);
+			if(acceptedSocket != NETSOCKET_INVALID_SOCKET_HANDLE)
+			{
+				Socket socket = Socket::CreateAcceptedSocket(acceptedSocket, m_socketType, m_ipaFamily, m_ipProtocol);
+				socket.setOptions(options);
+				return { std::move(socket) };
+			}
+			if(!IsWouldBlockError() || !waitReadable())
+				return { };
+		}
 	}
 
-	std::optional<Socket> Socket::accept()
+	std::optional<Socket> Socket::tryAccept(const SocketOptions& options)
 	{
-		SocketHandle acceptedSocket = NETSOCKET_INVALID_SOCKET_HANDLE;
-		acceptedSocket = ::accept(m_socket, NULL, NULL);
+		SocketHandle acceptedSocket = AcceptSocketHandle(m_socket, false);
 		if(acceptedSocket == NETSOCKET_INVALID_SOCKET_HANDLE)
 			return { };
-		return { Socket::CreateAcceptedSocket(acceptedSocket, m_socketType, m_ipaFamily, m_ipProtocol) };
+		Socket socket = Socket::CreateAcceptedSocket(acceptedSocket, m_socketType, m_ipaFamily, m_ipProtocol);
+		socket.setOptions(options);
+		return { std::move(socket) };
+	}
+
+	u32 Socket::acceptMany(std::vector<Socket>& sockets, u32 maxCount, const SocketOptions& options)
+	{
+		u32 count = 0;
+		for(; count < maxCount; ++count)
+		{
+			SocketHandle acceptedSocket = AcceptSocketHandle(m_socket, true);
+			if(acceptedSocket == NETSOCKET_INVALID_SOCKET_HANDLE)
+				break;
+			sockets.push_back(Socket::CreateAcceptedSocket(acceptedSocket, m_socketType, m_ipaFamily, m_ipProtocol));
+			sockets.back().setOptions(options);
+		}
+		return count;
 	}
 
 	Result Socket::bind(const std::string_view ipAddress, const std::string_view portNumber)
@@ -203,6 +616,9 @@ namespace netsocket
 			return Result::SocketError;
 		}
 
+		// Datagram sockets have no connection, receive() works once they are bound
+		if(m_socketType == SOCK_DGRAM)
+			m_isConnected = true;
 		return Result::Success;			
 	}
 
@@ -225,7 +641,28 @@ namespace netsocket
 
 		netsocket_assert((addressInfo->ai_family == m_ipaFamily) && (addressInfo->ai_socktype == m_socketType) && (addressInfo->ai_protocol == m_ipProtocol));
 
-		result = ::connect(m_socket, addressInfo->ai_addr, (int)addressInfo->ai_addrlen);
+		// Taken before connecting, a failed connect() may bind the socket to an ephemeral port
+		sockaddr_storage localAddress;
+		socklen_t localAddressLength = sizeof(localAddress);
+		if((getsockname(m_socket, reinterpret_cast<sockaddr*>(&localAddress), &localAddressLength) == NETSOCKET_SOCKET_ERROR)
+			|| (GetSocketAddressPort(localAddress) == 0))
+			localAddressLength = 0;
+
+		// A name can resolve to several addresses, some of which may be unreachable
+		for(struct addrinfo* candidate = addressInfo; candidate != NULL; candidate = candidate->ai_next)
+		{
+			result = ::connect(m_socket, candidate->ai_addr, (int)candidate->ai_addrlen);
+			if(result != NETSOCKET_SOCKET_ERROR)
+				break;
+			if(candidate->ai_next == NULL)
+				break;
+			if((reopen() != Result::Success)
+				|| ((localAddressLength != 0) && (::bind(m_socket, reinterpret_cast<const sockaddr*>(&localAddress), localAddressLength) == NETSOCKET_SOCKET_ERROR)))
+			{
+				result = NETSOCKET_SOCKET_ERROR;
+				break;
+			}
+		}
 
 		freeaddrinfo(addressInfo);
 		if(result == NETSOCKET_SOCKET_ERROR)
@@ -238,81 +675,634 @@ namespace netsocket
 		return Result::Success;
 	}
 
-	Result Socket::close()
+	Result Socket::reopen()
 	{
-		if(!m_isConnected)
-			return Result::Success;
+		SocketOptions options = getOptions();
+		const std::optional<bool> isIPv6Only = (m_ipaFamily == AF_INET6) ? GetSocketOption<bool>(m_socket, IPPROTO_IPV6, IPV6_V6ONLY) : std::optional<bool> { };
+		SocketHandle socket = ::socket(m_ipaFamily, m_socketType, m_ipProtocol);
+		if(socket == NETSOCKET_INVALID_SOCKET_HANDLE)
+			return Result::SocketError;
+		closesocket(m_socket);
+		m_socket = socket;
+
+		// Setting a buffer size would stop the kernel from tuning it, so only what differs from a fresh socket is applied again
+		const SocketOptions defaultOptions = getOptions();
+		ClearDefaultSocketOption(options.sendBufferSize, defaultOptions.sendBufferSize);
+		ClearDefaultSocketOption(options.receiveBufferSize, defaultOptions.receiveBufferSize);
+		ClearDefaultSocketOption(options.isNoDelay, defaultOptions.isNoDelay);
+		ClearDefaultSocketOption(options.isQuickAck, defaultOptions.isQuickAck);
+		ClearDefaultSocketOption(options.isCorked, defaultOptions.isCorked);
+		ClearDefaultSocketOption(options.isKeepAliveEnabled, defaultOptions.isKeepAliveEnabled);
+		ClearDefaultSocketOption(options.keepAliveIdleTime, defaultOptions.keepAliveIdleTime);
+		ClearDefaultSocketOption(options.keepAliveInterval, defaultOptions.keepAliveInterval);
+		ClearDefaultSocketOption(options.keepAliveProbeCount, defaultOptions.keepAliveProbeCount);
+		ClearDefaultSocketOption(options.busyPollTime, defaultOptions.busyPollTime);
+		ClearDefaultSocketOption(options.notSentLowWatermark, defaultOptions.notSentLowWatermark);
+		ClearDefaultSocketOption(options.priority, defaultOptions.priority);
+		ClearDefaultSocketOption(options.maxPacingRate, defaultOptions.maxPacingRate);
+#ifdef PLATFORM_LINUX
+		// Linux reports twice the buffer sizes which were set
+		if(options.sendBufferSize.has_value())
+			*options.sendBufferSize /= 2;
+		if(options.receiveBufferSize.has_value())
+			*options.receiveBufferSize /= 2;
+#endif
+		Result result = setOptions(options);
+		if(isIPv6Only.has_value() && (GetSocketOption<bool>(m_socket, IPPROTO_IPV6, IPV6_V6ONLY) != isIPv6Only) && (result == Result::Success))
+			result = SetSocketOption(m_socket, IPPROTO_IPV6, IPV6_V6ONLY, static_cast<SocketOptionInt>(*isIPv6Only));
+		// The timeouts and the busy polling rely on a non-blocking socket
+		if(((m_sendTimeout >= 0) || (m_receiveTimeout >= 0) || (m_busyPollSpinTime > 0)) && (setNonBlocking(true) != Result::Success))
+			result = Result::SocketError;
+		return result;
+	}
+
+	Result Socket::bindUnix(const std::string_view path)
+	{
+		sockaddr_un address;
+		const int addressLength = GetUnixAddress(path, address);
+		if((m_ipaFamily != AF_UNIX) || (addressLength == 0))
+			return Result::Failed;
+		if(::bind(m_socket, reinterpret_cast<const sockaddr*>(&address), addressLength) == NETSOCKET_SOCKET_ERROR)
+		{
+			m_isValid = false;
+			return Result::SocketError;
+		}
+		// Datagram sockets have no connection, receive() works once they are bound
+		if(m_socketType == SOCK_DGRAM)
+			m_isConnected = true;
+		return Result::Success;
+	}
 
-		if(closesocket(m_socket) == NETSOCKET_SOCKET_ERROR)
+	Result Socket::connectUnix(const std::string_view path)
+	{
+		sockaddr_un address;
+		const int addressLength = GetUnixAddress(path, address);
+		if((m_ipaFamily != AF_UNIX) || (addressLength == 0))
+			return Result::Failed;
+		if(::connect(m_socket, reinterpret_cast<const sockaddr*>(&address), addressLength) == NETSOCKET_SOCKET_ERROR)
 		{
 			m_isValid = false;
-			m_isConnected = false;
-			callOnDisconnect();
 			return Result::SocketError;
 		}
+		m_isConnected = true;
+		return Result::Success;
+	}
+
+	std::optional<Socket> Socket::ConnectHappyEyeballs(const std::string_view host, const std::string_view port, const HappyEyeballsOptions& options)
+	{
+		return ConnectHappyEyeballs(std::vector<std::string> { std::string { host } }, port, options);
+	}
+
+	std::optional<Socket> Socket::ConnectHappyEyeballs(const std::vector<std::string>& hosts, const std::string_view port, const HappyEyeballsOptions& options)
+	{
+		// getaddrinfo() returns the AAAA and A records together, so there is no resolution delay to race (RFC 8305 section 3)
+		std::vector<ConnectCandidate> resolvedCandidates;
+		for(const std::string& host : hosts)
+			ResolveConnectCandidates(host, std::string { port }, resolvedCandidates);
+		if(resolvedCandidates.empty())
+			return { };
+		const std::vector<ConnectCandidate> candidates = InterleaveConnectCandidates(resolvedCandidates);
+
+		using Clock = std::chrono::steady_clock;
+		const Clock::time_point startTime = Clock::now();
+		const Clock::time_point deadline = (options.timeout == 0) ? Clock::time_point::max() : (startTime + std::chrono::milliseconds(options.timeout));
+		Clock::time_point nextAttemptTime = startTime;
+		std::size_t nextCandidate = 0;
+		// Pending attempts, in the order they were started
+		std::vector<std::pair<SocketHandle, int>> attempts;
+		SocketHandle winner = NETSOCKET_INVALID_SOCKET_HANDLE;
+		int winnerFamily = 0;
+
+		while(winner == NETSOCKET_INVALID_SOCKET_HANDLE)
+		{
+			Clock::time_point now = Clock::now();
+			if((nextCandidate < candidates.size()) && (attempts.empty() || (now >= nextAttemptTime)))
+			{
+				const ConnectCandidate& candidate = candidates[nextCandidate++];
+#ifdef PLATFORM_WINDOWS
+				SocketHandle socket = ::socket(candidate.family, SOCK_STREAM, IPPROTO_TCP);
+				u_long mode = 1;
+				if((socket != NETSOCKET_INVALID_SOCKET_HANDLE) && (ioctlsocket(socket, FIONBIO, &mode) == NETSOCKET_SOCKET_ERROR))
+				{
+					closesocket(socket);
+					socket = NETSOCKET_INVALID_SOCKET_HANDLE;
+				}
+#else
+				SocketHandle socket = ::socket(candidate.family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+#endif
+				if(socket == NETSOCKET_INVALID_SOCKET_HANDLE)
+					continue;
+				if(::connect(socket, reinterpret_cast<const sockaddr*>(&candidate.address), candidate.addressLength) != NETSOCKET_SOCKET_ERROR)
+				{
+					winner = socket;
+					winnerFamily = candidate.family;
+					break;
+				}
+#ifdef PLATFORM_WINDOWS
+				const bool isInProgress = WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+				const bool isInProgress = errno == EINPROGRESS;
+#endif
+				if(!isInProgress)
+				{
+					closesocket(socket);
+					continue;
+				}
+				attempts.push_back({ socket, candidate.family });
+				nextAttemptTime = now + std::chrono::milliseconds(options.connectionAttemptDelay);
+				continue;
+			}
+			if(attempts.empty() || (now >= deadline))
+				break;
+
+			// Until an attempt completes, the next attempt is due or the deadline
+			const Clock::time_point waitUntil = (nextCandidate < candidates.size()) ? std::min(nextAttemptTime, deadline) : deadline;
+			const s32 timeout = (waitUntil == Clock::time_point::max()) ? -1
+								: static_cast<s32>(std::chrono::ceil<std::chrono::milliseconds>(waitUntil - now).count());
+#ifdef PLATFORM_WINDOWS
+			std::vector<WSAPOLLFD> pollFDs(attempts.size());
+#else
+			std::vector<struct pollfd> pollFDs(attempts.size());
+#endif
+			for(std::size_t i = 0; i < attempts.size(); ++i)
+			{
+				pollFDs[i].fd = attempts[i].first;
+				pollFDs[i].events = POLLOUT;
+				pollFDs[i].revents = 0;
+			}
+#ifdef PLATFORM_WINDOWS
+			int result = WSAPoll(pollFDs.data(), static_cast<ULONG>(pollFDs.size()), timeout);
+#else
+			int result = ::poll(pollFDs.data(), pollFDs.size(), timeout);
+			if((result < 0) && (errno == EINTR))
+				continue;
+#endif
+			if(result < 0)
+				break;
+			// Completed attempts are either connected or failed, SO_ERROR tells which
+			for(std::size_t i = attempts.size(); i-- > 0;)
+			{
+				if(pollFDs[i].revents == 0)
+					continue;
+				int error = 0;
+				socklen_t errorSize = sizeof(error);
+				if((getsockopt(attempts[i].first, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error), &errorSize) == 0) && (error == 0))
+				{
+					winner = attempts[i].first;
+					winnerFamily = attempts[i].second;
+					attempts.erase(attempts.begin() + i);
+					break;
+				}
+				closesocket(attempts[i].first);
+				attempts.erase(attempts.begin() + i);
+				// The next address doesn't wait for the attempt delay
+				nextAttemptTime = now;
+			}
+		}
+
+		for(const auto& attempt : attempts)
+			closesocket(attempt.first);
+		if(winner == NETSOCKET_INVALID_SOCKET_HANDLE)
+			return { };
+		Socket socket = CreateAcceptedSocket(winner, SOCK_STREAM, winnerFamily, IPPROTO_TCP);
+		socket.setNonBlocking(false);
+		return { std::move(socket) };
+	}
+
+	Result Socket::close()
+	{
+		// Listening sockets are never connected, so check the handle rather than m_isConnected
+		if(m_socket == NETSOCKET_INVALID_SOCKET_HANDLE)
+			return Result::Success;
+
+		const bool wasConnected = m_isConnected;
+		if(m_compression != nullptr)
+		{
+			if(wasConnected)
+				flush();
+			m_compression.reset();
+		}
+		if(m_tls != nullptr)
+		{
+			// Lets the peer tell a deliberate close from a truncation attack
+			if(wasConnected)
+				m_tls->closeNotify();
+			m_tls.reset();
+		}
+		const bool isError = closesocket(m_socket) == NETSOCKET_SOCKET_ERROR;
+		m_socket = NETSOCKET_INVALID_SOCKET_HANDLE;
 		m_isValid = false;
 		m_isConnected = false;
-		callOnDisconnect();
-		return Result::Success;
+		if(wasConnected)
+			callOnDisconnect();
+		return isError ? Result::SocketError : Result::Success;
+	}
+
+	Result Socket::shutdownReceive()
+	{
+		if(m_socket == NETSOCKET_INVALID_SOCKET_HANDLE)
+			return Result::Failed;
+#ifdef PLATFORM_WINDOWS
+		const bool isError = ::shutdown(m_socket, SD_RECEIVE) == NETSOCKET_SOCKET_ERROR;
+#else
+		const bool isError = ::shutdown(m_socket, SHUT_RD) == NETSOCKET_SOCKET_ERROR;
+#endif
+		return isError ? Result::SocketError : Result::Success;
 	}
 
 	Result Socket::send(const u8* bytes, u32 size)
 	{
-		u32 numSentBytes = 0;
-		while(numSentBytes < size)
+		if(m_compression != nullptr)
 		{
-			int result = ::send(m_socket, reinterpret_cast<const char*>(bytes + numSentBytes), size - numSentBytes, 0);
-			if(result == NETSOCKET_SOCKET_ERROR)
+			const SocketBuffer buffer { bytes, size };
+			return sendCompressed(&buffer, 1);
+		}
+		return sendStream(bytes, size);
+	}
+
+	Result Socket::sendVectored(const SocketBuffer* buffers, u32 count)
+	{
+		if(m_compression != nullptr)
+			return sendCompressed(buffers, count);
+		if((m_tls == nullptr) || m_tls->isKernelTxOffloaded())
+			return sendStreamVectored(buffers, count);
+
+		// Small buffers are gathered so that they don't each take a record, large ones are records already
+		constexpr u32 recordSize = 16 * 1024;
+		u8 record[recordSize];
+		u32 recordLength = 0;
+		for(u32 i = 0; i < count; ++i)
+		{
+			const SocketBuffer& buffer = buffers[i];
+			if((recordLength + buffer.size) <= recordSize)
 			{
-				m_isValid = false;
-				m_isConnected = false;
-				callOnDisconnect();
-				return Result::SocketError;
+				std::memcpy(record + recordLength, buffer.bytes, buffer.size);
+				recordLength += buffer.size;
+				continue;
+			}
+			if(recordLength > 0)
+			{
+				Result result = sendStream(record, recordLength);
+				if(result != Result::Success)
+					return result;
+				recordLength = 0;
+			}
+			if(buffer.size < recordSize)
+			{
+				std::memcpy(record, buffer.bytes, buffer.size);
+				recordLength = buffer.size;
+			}
+			else
+			{
+				Result result = sendStream(buffer.bytes, buffer.size);
+				if(result != Result::Success)
+					return result;
 			}
-			numSentBytes += static_cast<u32>(result);
 		}
-		// debug_log_info("Sent: %lu bytes", numSentBytes);
-		return Result::Success;
+		return (recordLength > 0) ? sendStream(record, recordLength) : Result::Success;
 	}
 
 	Result Socket::receive(u8* bytes, u32 size)
 	{
-		if(!m_isConnected)
-			return Result::SocketError;
-
+		if(m_compression == nullptr)
+			return receiveStream(bytes, size);
 		u32 numReceivedBytes = 0;
 		while(numReceivedBytes < size)
 		{
-			int result = ::recv(m_socket, reinterpret_cast<char*>(bytes + numReceivedBytes), size - numReceivedBytes, 0);
-			if(result == NETSOCKET_SOCKET_ERROR)
-			{
-				m_isValid = false;
-				m_isConnected = false;
-				callOnDisconnect();
-				return Result::SocketError;
-			}
-			else if(result == 0)
-			{
-				m_isConnected = false;
-				callOnDisconnect();
+			std::optional<u32> result = receiveSomeCompressed(bytes + numReceivedBytes, size - numReceivedBytes);
+			if(!result)
 				return Result::SocketError;
-			}
-			numReceivedBytes += static_cast<u32>(result);
+			numReceivedBytes += *result;
 		}
 		return Result::Success;
 	}
 
-	void Socket::callOnDisconnect()
+	std::optional<u32> Socket::receiveSome(u8* bytes, u32 size)
 	{
-		if(m_onDisconnectCallback)
-			m_onDisconnectCallback(*this);
+		if(m_compression != nullptr)
+			return receiveSomeCompressed(bytes, size);
+		return receiveSomeStream(bytes, size);
 	}
 
-	void Socket::setTCPNoDelay()
+	u64 Socket::acquireSendAllowance(u64 size)
 	{
-#ifdef PLATFORM_WINDOWS
-		BOOL flag = TRUE;
-		auto result = setsockopt(m_socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<char*>(&flag), sizeof(flag));
+		// A datagram can't be cut into pieces
+		if(m_socketType == SOCK_DGRAM)
+		{
+			m_sendRateLimiter->acquireAll(size);
+			return size;
+		}
+		return m_sendRateLimiter->acquire(size);
+	}
+
+	Result Socket::sendStream(const u8* bytes, u32 size)
+	{
+		u32 numSentBytes = 0;
+		// Bytes the rate limiter has let through which haven't been sent yet, see setSendRateLimit()
+		u32 allowedSize = 0;
+		while(numSentBytes < size)
+		{
+			u32 sendSize = size - numSentBytes;
+			if(m_sendRateLimiter != nullptr)
+			{
+				if(allowedSize == 0)
+					allowedSize = static_cast<u32>(acquireSendAllowance(sendSize));
+				sendSize = allowedSize;
+			}
+			int result = (m_tls != nullptr) ? SendTls(*m_tls, m_socket, bytes + numSentBytes, sendSize, m_sendTimeout)
+											: ::send(m_socket, reinterpret_cast<const char*>(bytes + numSentBytes), sendSize, 0);
+			if(result == NETSOCKET_SOCKET_ERROR)
+			{
+				if((m_tls == nullptr) && IsWouldBlockError() && waitWritable(m_sendTimeout))
+					continue;
+				m_isValid = false;
+				m_isConnected = false;
+				callOnDisconnect();
+				return Result::SocketError;
+			}
+			numSentBytes += static_cast<u32>(result);
+			allowedSize -= std::min(allowedSize, static_cast<u32>(result));
+		}
+		// debug_log_info("Sent: %lu bytes", numSentBytes);
+		return Result::Success;
+	}
+
+	Result Socket::sendStreamVectored(const SocketBuffer* buffers, u32 count)
+	{
+		// Where the next write starts, a partial write can stop in the middle of a buffer
+		u32 index = 0;
+		u32 offset = 0;
+		// Bytes left to send and those of them the rate limiter has let through, see setSendRateLimit()
+		u64 remainingTotalSize = 0;
+		u64 allowedSize = 0;
+		if(m_sendRateLimiter != nullptr)
+			for(u32 i = 0; i < count; ++i)
+				remainingTotalSize += buffers[i].size;
+		while(true)
+		{
+			while((index < count) && (offset == buffers[index].size))
+			{
+				++index;
+				offset = 0;
+			}
+			if(index == count)
+				return Result::Success;
+			if((m_sendRateLimiter != nullptr) && (allowedSize == 0))
+				allowedSize = m_sendRateLimiter->acquire(remainingTotalSize);
+			// Bytes the vectors may still take
+			u64 vectorSizeLimit = (m_sendRateLimiter != nullptr) ? allowedSize : std::numeric_limits<u64>::max();
+
+			constexpr u32 maxVectorCount = 64;
+#ifdef PLATFORM_WINDOWS
+			WSABUF vectors[maxVectorCount];
+#else
+			iovec vectors[maxVectorCount];
+#endif
+			u32 vectorCount = 0;
+			for(u32 i = index; (i < count) && (vectorCount < maxVectorCount) && (vectorSizeLimit > 0); ++i)
+			{
+				const u32 skippedSize = (i == index) ? offset : 0;
+				if(buffers[i].size == skippedSize)
+					continue;
+				const u32 vectorSize = static_cast<u32>(std::min<u64>(buffers[i].size - skippedSize, vectorSizeLimit));
+				vectorSizeLimit -= vectorSize;
+#ifdef PLATFORM_WINDOWS
+				vectors[vectorCount].buf = reinterpret_cast<CHAR*>(const_cast<u8*>(buffers[i].bytes + skippedSize));
+				vectors[vectorCount].len = vectorSize;
+#else
+				vectors[vectorCount].iov_base = const_cast<u8*>(buffers[i].bytes + skippedSize);
+				vectors[vectorCount].iov_len = vectorSize;
+#endif
+				++vectorCount;
+			}
+
+#ifdef PLATFORM_WINDOWS
+			DWORD sentSize = 0;
+			const bool isError = WSASend(m_socket, vectors, vectorCount, &sentSize, 0, NULL, NULL) == NETSOCKET_SOCKET_ERROR;
+#else
+			msghdr message { };
+			message.msg_iov = vectors;
+			message.msg_iovlen = vectorCount;
+			const ssize_t sentSize = ::sendmsg(m_socket, &message, 0);
+			const bool isError = sentSize < 0;
+#endif
+			if(isError)
+			{
+				if(IsWouldBlockError() && waitWritable(m_sendTimeout))
+					continue;
+				m_isValid = false;
+				m_isConnected = false;
+				callOnDisconnect();
+				return Result::SocketError;
+			}
+
+			u64 remainingSize = static_cast<u64>(sentSize);
+			if(m_sendRateLimiter != nullptr)
+			{
+				remainingTotalSize -= remainingSize;
+				allowedSize -= std::min(allowedSize, remainingSize);
+			}
+			while(remainingSize > 0)
+			{
+				const u32 bufferRemainingSize = buffers[index].size - offset;
+				if(remainingSize < bufferRemainingSize)
+				{
+					offset += static_cast<u32>(remainingSize);
+					break;
+				}
+				remainingSize -= bufferRemainingSize;
+				++index;
+				offset = 0;
+			}
+		}
+	}
+
+	Result Socket::receiveStream(u8* bytes, u32 size)
+	{
+		if(!m_isConnected)
+			return Result::SocketError;
+
+		u32 numReceivedBytes = 0;
+		while(numReceivedBytes < size)
+		{
+			int result = (m_tls != nullptr) ? ReceiveTls(*m_tls, m_socket, bytes + numReceivedBytes, size - numReceivedBytes, m_receiveTimeout)
+											: ::recv(m_socket, reinterpret_cast<char*>(bytes + numReceivedBytes), size - numReceivedBytes, 0);
+			if(result == NETSOCKET_SOCKET_ERROR)
+			{
+				if((m_tls == nullptr) && IsWouldBlockError() && waitReceivable())
+					continue;
+				m_isValid = false;
+				m_isConnected = false;
+				callOnDisconnect();
+				return Result::SocketError;
+			}
+			else if(result == 0)
+			{
+				m_isConnected = false;
+				callOnDisconnect();
+				return Result::SocketError;
+			}
+			numReceivedBytes += static_cast<u32>(result);
+		}
+		return Result::Success;
+	}
+
+	std::optional<u32> Socket::receiveSomeStream(u8* bytes, u32 size)
+	{
+		if(!m_isConnected)
+			return { };
+
+		int result;
+		if(m_tls != nullptr)
+			result = ReceiveTls(*m_tls, m_socket, bytes, size, m_receiveTimeout);
+		else
+		{
+			result = ::recv(m_socket, reinterpret_cast<char*>(bytes), size, 0);
+			while((result == NETSOCKET_SOCKET_ERROR) && IsWouldBlockError() && waitReceivable())
+				result = ::recv(m_socket, reinterpret_cast<char*>(bytes), size, 0);
+		}
+		if(result == NETSOCKET_SOCKET_ERROR)
+		{
+			m_isValid = false;
+			m_isConnected = false;
+			callOnDisconnect();
+			return { };
+		}
+		else if(result == 0)
+		{
+			m_isConnected = false;
+			callOnDisconnect();
+			return { };
+		}
+		return { static_cast<u32>(result) };
+	}
+
+	Result Socket::sendFile(const std::string& filePath, u64 offset, u64 size)
+	{
+		if(!m_isConnected)
+			return Result::SocketError;
+
+#ifdef PLATFORM_LINUX
+		if((m_compression == nullptr) && ((m_tls == nullptr) || m_tls->isKernelTxOffloaded()))
+		{
+			int file = ::open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+			struct stat fileStatus;
+			if((file < 0) || (fstat(file, &fileStatus) != 0) || (offset > static_cast<u64>(fileStatus.st_size)))
+			{
+				if(file >= 0)
+					::close(file);
+				return Result::Failed;
+			}
+			u64 remainingSize = std::min(size, static_cast<u64>(fileStatus.st_size) - offset);
+			off_t fileOffset = static_cast<off_t>(offset);
+			bool isError = false;
+			// See setSendRateLimit()
+			u64 allowedSize = 0;
+			while(remainingSize > 0)
+			{
+				// sendfile() transfers at most 0x7ffff000 bytes per call anyway
+				u64 sendSize = std::min<u64>(remainingSize, 1u << 30);
+				if(m_sendRateLimiter != nullptr)
+				{
+					if(allowedSize == 0)
+						allowedSize = m_sendRateLimiter->acquire(sendSize);
+					sendSize = allowedSize;
+				}
+				ssize_t result = ::sendfile(m_socket, file, &fileOffset, static_cast<size_t>(sendSize));
+				if(result < 0)
+				{
+					if((errno == EINTR) || (IsWouldBlockError() && waitWritable(m_sendTimeout)))
+						continue;
+					isError = true;
+					break;
+				}
+				// The file has been truncated meanwhile
+				if(result == 0)
+					break;
+				remainingSize -= static_cast<u64>(result);
+				allowedSize -= std::min(allowedSize, static_cast<u64>(result));
+			}
+			::close(file);
+			if(isError)
+			{
+				m_isValid = false;
+				m_isConnected = false;
+				callOnDisconnect();
+				return Result::SocketError;
+			}
+			return (remainingSize == 0) ? Result::Success : Result::Failed;
+		}
+#endif
+
+		std::FILE* file = std::fopen(filePath.c_str(), "rb");
+		if((file == NULL) || (std::fseek(file, static_cast<long>(offset), SEEK_SET) != 0))
+		{
+			if(file != NULL)
+				std::fclose(file);
+			return Result::Failed;
+		}
+		std::vector<u8> buffer(64 * 1024);
+		Result result = Result::Success;
+		while(size > 0)
+		{
+			const std::size_t readSize = std::fread(buffer.data(), 1, static_cast<std::size_t>(std::min<u64>(size, buffer.size())), file);
+			if(readSize == 0)
+				break;
+			result = send(buffer.data(), static_cast<u32>(readSize));
+			if(result != Result::Success)
+				break;
+			size -= readSize;
+		}
+		if((result == Result::Success) && std::ferror(file))
+			result = Result::Failed;
+		std::fclose(file);
+		return result;
+	}
+
+	void Socket::callOnDisconnect()
+	{
+		if(m_onDisconnectCallback)
+			m_onDisconnectCallback(*this);
+	}
+
+	bool Socket::waitReadable(s32 timeout)
+	{
+		// Decrypted bytes already in the record layer don't show up in poll()
+		if((m_tls != nullptr) && (m_tls->getPendingSize() > 0))
+			return true;
+		// Same for compressed bytes left over when the last receive's buffer filled up
+		if((m_compression != nullptr) && (m_compression->inputBegin < m_compression->inputEnd))
+			return true;
+		return WaitForSocket(m_socket, POLLIN, timeout);
+	}
+
+	bool Socket::waitWritable(s32 timeout)
+	{
+		return WaitForSocket(m_socket, POLLOUT, timeout);
+	}
+
+	Result Socket::setNonBlocking(bool isNonBlocking)
+	{
+#ifdef PLATFORM_WINDOWS
+		u_long mode = isNonBlocking ? 1 : 0;
+		if(ioctlsocket(m_socket, FIONBIO, &mode) == NETSOCKET_SOCKET_ERROR)
+			return Result::SocketError;
+#else // PLATFORM_LINUX
+		int flags = fcntl(m_socket, F_GETFL, 0);
+		if(flags == -1)
+			return Result::SocketError;
+		flags = isNonBlocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+		if(fcntl(m_socket, F_SETFL, flags) == -1)
+			return Result::SocketError;
+#endif
+		return Result::Success;
+	}
+
+	void Socket::setTCPNoDelay()
+	{
+#ifdef PLATFORM_WINDOWS
+		BOOL flag = TRUE;
+		auto result = setsockopt(m_socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<char*>(&flag), sizeof(flag));
 #else // PLATFORM_LINUX
 		int flag = 1;
 		auto result = setsockopt(m_socket, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
@@ -321,6 +1311,696 @@ namespace netsocket
     			com_debug_log_error("Failed to set TCP_NODELAY");
 	}
 
+	Result Socket::setOptions(const SocketOptions& options)
+	{
+		Result result = Result::Success;
+		ApplySocketOption(m_socket, SOL_SOCKET, SO_SNDBUF, options.sendBufferSize, result);
+		ApplySocketOption(m_socket, SOL_SOCKET, SO_RCVBUF, options.receiveBufferSize, result);
+		ApplySocketOption(m_socket, IPPROTO_TCP, TCP_NODELAY, options.isNoDelay, result);
+		ApplySocketOption(m_socket, SOL_SOCKET, SO_KEEPALIVE, options.isKeepAliveEnabled, result);
+#ifdef TCP_KEEPIDLE
+		ApplySocketOption(m_socket, IPPROTO_TCP, TCP_KEEPIDLE, options.keepAliveIdleTime, result);
+		ApplySocketOption(m_socket, IPPROTO_TCP, TCP_KEEPINTVL, options.keepAliveInterval, result);
+		ApplySocketOption(m_socket, IPPROTO_TCP, TCP_KEEPCNT, options.keepAliveProbeCount, result);
+#else
+		// Older Windows SDKs
+		if(options.keepAliveIdleTime || options.keepAliveInterval || options.keepAliveProbeCount)
+			result = (result == Result::Success) ? Result::Failed : result;
+#endif
+#ifdef PLATFORM_LINUX
+		ApplySocketOption(m_socket, IPPROTO_TCP, TCP_QUICKACK, options.isQuickAck, result);
+		ApplySocketOption(m_socket, IPPROTO_TCP, TCP_CORK, options.isCorked, result);
+		ApplySocketOption(m_socket, SOL_SOCKET, SO_BUSY_POLL, options.busyPollTime, result);
+		ApplySocketOption(m_socket, IPPROTO_TCP, TCP_NOTSENT_LOWAT, options.notSentLowWatermark, result);
+		ApplySocketOption(m_socket, SOL_SOCKET, SO_PRIORITY, options.priority, result);
+		if(options.maxPacingRate.has_value())
+		{
+			// 64 bits since Linux 4.20, older kernels read the lower 32 bits. The kernel's "unlimited" is all bits set
+			const u64 rate = (*options.maxPacingRate == 0) ? std::numeric_limits<u64>::max() : *options.maxPacingRate;
+			if((setsockopt(m_socket, SOL_SOCKET, SO_MAX_PACING_RATE, &rate, sizeof(rate)) != 0) && (result == Result::Success))
+				result = Result::SocketError;
+		}
+#else
+		if(options.isQuickAck || options.isCorked || options.busyPollTime || options.notSentLowWatermark || options.priority || options.maxPacingRate)
+			result = (result == Result::Success) ? Result::Failed : result;
+#endif
+		if(options.listenBacklog.has_value())
+			m_listenBacklog = *options.listenBacklog;
+		return result;
+	}
+
+	SocketOptions Socket::getOptions() const
+	{
+		SocketOptions options;
+		options.sendBufferSize = GetSocketOption<u32>(m_socket, SOL_SOCKET, SO_SNDBUF);
+		options.receiveBufferSize = GetSocketOption<u32>(m_socket, SOL_SOCKET, SO_RCVBUF);
+		options.isKeepAliveEnabled = GetSocketOption<bool>(m_socket, SOL_SOCKET, SO_KEEPALIVE);
+		if(m_ipProtocol == IPPROTO_TCP)
+		{
+			options.isNoDelay = GetSocketOption<bool>(m_socket, IPPROTO_TCP, TCP_NODELAY);
+#ifdef TCP_KEEPIDLE
+			options.keepAliveIdleTime = GetSocketOption<u32>(m_socket, IPPROTO_TCP, TCP_KEEPIDLE);
+			options.keepAliveInterval = GetSocketOption<u32>(m_socket, IPPROTO_TCP, TCP_KEEPINTVL);
+			options.keepAliveProbeCount = GetSocketOption<u32>(m_socket, IPPROTO_TCP, TCP_KEEPCNT);
+#endif
+#ifdef PLATFORM_LINUX
+			options.isQuickAck = GetSocketOption<bool>(m_socket, IPPROTO_TCP, TCP_QUICKACK);
+			options.isCorked = GetSocketOption<bool>(m_socket, IPPROTO_TCP, TCP_CORK);
+			options.notSentLowWatermark = GetSocketOption<u32>(m_socket, IPPROTO_TCP, TCP_NOTSENT_LOWAT);
+#endif
+		}
+#ifdef PLATFORM_LINUX
+		options.busyPollTime = GetSocketOption<u32>(m_socket, SOL_SOCKET, SO_BUSY_POLL);
+		options.priority = GetSocketOption<u32>(m_socket, SOL_SOCKET, SO_PRIORITY);
+		u64 pacingRate = 0;
+		socklen_t pacingRateSize = sizeof(pacingRate);
+		if(getsockopt(m_socket, SOL_SOCKET, SO_MAX_PACING_RATE, &pacingRate, &pacingRateSize) == 0)
+		{
+			// Unlimited, all bits set in 32 or 64 bits
+			const u64 unlimitedRate = (pacingRateSize == sizeof(u32)) ? std::numeric_limits<u32>::max() : std::numeric_limits<u64>::max();
+			options.maxPacingRate = (pacingRate == unlimitedRate) ? 0 : pacingRate;
+		}
+#endif
+		options.listenBacklog = (m_listenBacklog == 0) ? static_cast<u32>(SOMAXCONN) : m_listenBacklog;
+		return options;
+	}
+
+	Result Socket::setBusyPoll(const BusyPollOptions& options)
+	{
+		// Spinning only helps if the peer runs meanwhile, on another core
+		const u32 spinTime = (std::thread::hardware_concurrency() == 1) ? 0 : options.spinTime;
+		if((spinTime > 0) && (setNonBlocking(true) != Result::Success))
+			return Result::SocketError;
+#ifdef PLATFORM_LINUX
+		if(options.kernelBusyPollTime > 0)
+		{
+			SocketOptions socketOptions;
+			socketOptions.busyPollTime = options.kernelBusyPollTime;
+			if(setOptions(socketOptions) != Result::Success)
+				com_debug_log_error("Failed to set SO_BUSY_POLL, it requires CAP_NET_ADMIN above net.core.busy_read");
+		}
+#endif
+		m_busyPollSpinTime = spinTime;
+		return Result::Success;
+	}
+
+	Result Socket::setSendRateLimit(const RateLimit& limit)
+	{
+		if(m_sendRateLimiter == nullptr)
+			m_sendRateLimiter = std::make_unique<TokenBucket>(limit);
+		else
+			m_sendRateLimiter->setLimit(limit);
+		return Result::Success;
+	}
+
+	RateLimit Socket::getSendRateLimit() const
+	{
+		if(m_sendRateLimiter == nullptr)
+			return { };
+		return m_sendRateLimiter->getLimit();
+	}
+
+	Result Socket::setSendTimeout(s32 timeout)
+	{
+		if((timeout >= 0) && (setNonBlocking(true) != Result::Success))
+			return Result::SocketError;
+		m_sendTimeout = std::max(timeout, -1);
+		return Result::Success;
+	}
+
+	Result Socket::setReceiveTimeout(s32 timeout)
+	{
+		if((timeout >= 0) && (setNonBlocking(true) != Result::Success))
+			return Result::SocketError;
+		m_receiveTimeout = std::max(timeout, -1);
+		return Result::Success;
+	}
+
+	bool Socket::waitReceivable()
+	{
+		if(m_busyPollSpinTime > 0)
+		{
+			const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(m_busyPollSpinTime);
+			char byte;
+			do
+			{
+				// Peeks, the caller's recv() then takes whatever ended the spin
+				int result = ::recv(m_socket, &byte, 1, MSG_PEEK);
+				if((result != NETSOCKET_SOCKET_ERROR) || !IsWouldBlockError())
+					return true;
+			} while(std::chrono::steady_clock::now() < deadline);
+		}
+		return waitReadable(m_receiveTimeout);
+	}
+
+	Result Socket::setReusePort(bool isEnabled)
+	{
+#ifdef PLATFORM_LINUX
+		int flag = isEnabled ? 1 : 0;
+		auto result = setsockopt(m_socket, SOL_SOCKET, SO_REUSEPORT, &flag, sizeof(flag));
+		return (result == NETSOCKET_SOCKET_ERROR) ? Result::SocketError : Result::Success;
+#else
+		return Result::Failed;
+#endif
+	}
+
+	Result Socket::attachReusePortCpuSteering(u32 groupSize)
+	{
+#ifdef PLATFORM_LINUX
+		if(groupSize == 0)
+			return Result::Failed;
+		// A = CPU, A %= groupSize, return A: the index of the socket in the group
+		sock_filter code[] =
+		{
+			{ BPF_LD | BPF_W | BPF_ABS, 0, 0, static_cast<u32>(SKF_AD_OFF + SKF_AD_CPU) },
+			{ BPF_ALU | BPF_MOD | BPF_K, 0, 0, groupSize },
+			{ BPF_RET | BPF_A, 0, 0, 0 }
+		};
+		sock_fprog program { static_cast<unsigned short>(sizeof(code) / sizeof(code[0])), code };
+		auto result = setsockopt(m_socket, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program));
+		return (result == NETSOCKET_SOCKET_ERROR) ? Result::SocketError : Result::Success;
+#else
+		return Result::Failed;
+#endif
+	}
+
+	Result Socket::setIPv6Only(bool isIPv6Only)
+	{
+		if(m_ipaFamily != AF_INET6)
+			return Result::Failed;
+#ifdef PLATFORM_WINDOWS
+		DWORD flag = isIPv6Only ? 1 : 0;
+		auto result = setsockopt(m_socket, IPPROTO_IPV6, IPV6_V6ONLY, reinterpret_cast<char*>(&flag), sizeof(flag));
+#else // PLATFORM_LINUX
+		int flag = isIPv6Only ? 1 : 0;
+		auto result = setsockopt(m_socket, IPPROTO_IPV6, IPV6_V6ONLY, &flag, sizeof(flag));
+#endif
+		return (result == NETSOCKET_SOCKET_ERROR) ? Result::SocketError : Result::Success;
+	}
+
+	std::string Socket::getPeerAddress() const
+	{
+		sockaddr_storage address;
+		socklen_t addressLength = sizeof(address);
+		if(getpeername(m_socket, reinterpret_cast<sockaddr*>(&address), &addressLength) == NETSOCKET_SOCKET_ERROR)
+			return { };
+		char host[NI_MAXHOST];
+		if(getnameinfo(reinterpret_cast<const sockaddr*>(&address), addressLength, host, sizeof(host), NULL, 0, NI_NUMERICHOST) != 0)
+			return { };
+		return { host };
+	}
+
+	IPAddressFamily Socket::getIPAddressFamily() const noexcept
+	{
+		switch(m_ipaFamily)
+		{
+			case AF_INET6: return IPAddressFamily::IPv6;
+			case AF_UNIX: return IPAddressFamily::Unix;
+			default: return IPAddressFamily::IPv4;
+		}
+	}
+
+	Result Socket::sendDatagrams(const SocketBuffer* datagrams, u32 count)
+	{
+		if(m_socketType != SOCK_DGRAM)
+			return Result::Failed;
+		// A failed datagram doesn't break the socket (no connection), the next ones can still be sent
+		u32 index = 0;
+		// Datagrams from 'index' on the rate limiter has let through, see setSendRateLimit()
+		u32 allowedCount = 0;
+		while(index < count)
+		{
+			if((m_sendRateLimiter != nullptr) && (allowedCount == 0))
+			{
+				// Waits for the first one only, the following ones join it as long as there are tokens for them
+				m_sendRateLimiter->acquireAll(datagrams[index].size);
+				allowedCount = 1;
+				while(((index + allowedCount) < count) && m_sendRateLimiter->tryAcquireAll(datagrams[index + allowedCount].size))
+					++allowedCount;
+			}
+			const u32 sendableCount = (m_sendRateLimiter != nullptr) ? allowedCount : (count - index);
+#ifdef PLATFORM_WINDOWS
+			int result = ::send(m_socket, reinterpret_cast<const char*>(datagrams[index].bytes), datagrams[index].size, 0);
+			const u32 sentCount = 1;
+#else
+			constexpr u32 maxBatchSize = 64;
+			mmsghdr messages[maxBatchSize];
+			iovec vectors[maxBatchSize];
+			const u32 batchSize = std::min(sendableCount, maxBatchSize);
+			for(u32 i = 0; i < batchSize; ++i)
+			{
+				vectors[i].iov_base = const_cast<u8*>(datagrams[index + i].bytes);
+				vectors[i].iov_len = datagrams[index + i].size;
+				messages[i] = { };
+				messages[i].msg_hdr.msg_iov = &vectors[i];
+				messages[i].msg_hdr.msg_iovlen = 1;
+			}
+			int result = ::sendmmsg(m_socket, messages, batchSize, 0);
+			const u32 sentCount = static_cast<u32>(result);
+#endif
+			if(result == NETSOCKET_SOCKET_ERROR)
+			{
+				if(IsWouldBlockError() && waitWritable())
+					continue;
+				return Result::SocketError;
+			}
+			index += sentCount;
+			allowedCount -= std::min(allowedCount, sentCount);
+		}
+		return Result::Success;
+	}
+
+	std::optional<u32> Socket::receiveDatagrams(SocketDatagram* datagrams, u32 count, s32 timeout)
+	{
+		if((m_socketType != SOCK_DGRAM) || !m_isValid)
+			return { };
+		if((count == 0) || !waitReadable(timeout))
+			return { 0 };
+
+		u32 receivedCount = 0;
+#ifdef PLATFORM_WINDOWS
+		while(receivedCount < count)
+		{
+			// The first datagram is there, don't block for the following ones
+			u_long pendingSize = 0;
+			if((receivedCount > 0) && ((ioctlsocket(m_socket, FIONREAD, &pendingSize) != 0) || (pendingSize == 0)))
+				break;
+			SocketDatagram& datagram = datagrams[receivedCount];
+			datagram.isTruncated = false;
+			int result = ::recv(m_socket, reinterpret_cast<char*>(datagram.bytes), datagram.capacity, 0);
+			if(result == NETSOCKET_SOCKET_ERROR)
+			{
+				if(WSAGetLastError() != WSAEMSGSIZE)
+				{
+					if(IsWouldBlockError())
+						break;
+					return (receivedCount > 0) ? std::optional<u32> { receivedCount } : std::optional<u32> { };
+				}
+				result = static_cast<int>(datagram.capacity);
+				datagram.isTruncated = true;
+			}
+			datagram.size = static_cast<u32>(result);
+			++receivedCount;
+		}
+#else
+		constexpr u32 maxBatchSize = 64;
+		mmsghdr messages[maxBatchSize];
+		iovec vectors[maxBatchSize];
+		while(receivedCount < count)
+		{
+			const u32 batchSize = std::min(count - receivedCount, maxBatchSize);
+			for(u32 i = 0; i < batchSize; ++i)
+			{
+				vectors[i].iov_base = datagrams[receivedCount + i].bytes;
+				vectors[i].iov_len = datagrams[receivedCount + i].capacity;
+				messages[i] = { };
+				messages[i].msg_hdr.msg_iov = &vectors[i];
+				messages[i].msg_hdr.msg_iovlen = 1;
+			}
+			int result = ::recvmmsg(m_socket, messages, batchSize, MSG_DONTWAIT, NULL);
+			if(result < 0)
+			{
+				if(IsWouldBlockError())
+					break;
+				return (receivedCount > 0) ? std::optional<u32> { receivedCount } : std::optional<u32> { };
+			}
+			for(int i = 0; i < result; ++i)
+			{
+				datagrams[receivedCount + i].size = messages[i].msg_len;
+				datagrams[receivedCount + i].isTruncated = (messages[i].msg_hdr.msg_flags & MSG_TRUNC) != 0;
+			}
+			receivedCount += static_cast<u32>(result);
+			if(static_cast<u32>(result) < batchSize)
+				break;
+		}
+#endif
+		return { receivedCount };
+	}
+
+	Result Socket::joinMulticastGroup(const std::string_view group, const std::string_view networkInterface)
+	{
+#ifdef PLATFORM_LINUX
+		// Linux delivers the datagrams of every group joined on the host to a socket bound to the wildcard address, unless told otherwise
+		const SocketOptionInt isAllGroups = 0;
+		if(m_ipaFamily == AF_INET)
+			SetSocketOption(m_socket, IPPROTO_IP, IP_MULTICAST_ALL, isAllGroups);
+#	ifdef IPV6_MULTICAST_ALL
+		else if(m_ipaFamily == AF_INET6)
+			SetSocketOption(m_socket, IPPROTO_IPV6, IPV6_MULTICAST_ALL, isAllGroups);
+#	endif
+#endif
+		return ChangeMulticastMembership(m_socket, m_ipaFamily, group, networkInterface, true);
+	}
+
+	Result Socket::leaveMulticastGroup(const std::string_view group, const std::string_view networkInterface)
+	{
+		return ChangeMulticastMembership(m_socket, m_ipaFamily, group, networkInterface, false);
+	}
+
+	Result Socket::setMulticastInterface(const std::string_view networkInterface)
+	{
+		if(m_ipaFamily == AF_INET)
+		{
+			in_addr address;
+			address.s_addr = htonl(INADDR_ANY);
+			if(!networkInterface.empty() && (inet_pton(AF_INET, std::string { networkInterface }.c_str(), &address) != 1))
+				return Result::Failed;
+			return SetSocketOption(m_socket, IPPROTO_IP, IP_MULTICAST_IF, address);
+		}
+		if(m_ipaFamily == AF_INET6)
+		{
+			const SocketOptionInt index = GetInterfaceIndex(networkInterface);
+			if(!networkInterface.empty() && (index == 0))
+				return Result::Failed;
+			return SetSocketOption(m_socket, IPPROTO_IPV6, IPV6_MULTICAST_IF, index);
+		}
+		return Result::Failed;
+	}
+
+	Result Socket::setMulticastTTL(u8 ttl)
+	{
+		const SocketOptionInt value = ttl;
+		if(m_ipaFamily == AF_INET)
+			return SetSocketOption(m_socket, IPPROTO_IP, IP_MULTICAST_TTL, value);
+		if(m_ipaFamily == AF_INET6)
+			return SetSocketOption(m_socket, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, value);
+		return Result::Failed;
+	}
+
+	Result Socket::setMulticastLoopback(bool isEnabled)
+	{
+		const SocketOptionInt value = isEnabled ? 1 : 0;
+		if(m_ipaFamily == AF_INET)
+			return SetSocketOption(m_socket, IPPROTO_IP, IP_MULTICAST_LOOP, value);
+		if(m_ipaFamily == AF_INET6)
+			return SetSocketOption(m_socket, IPPROTO_IPV6, IPV6_MULTICAST_LOOP, value);
+		return Result::Failed;
+	}
+
+	Result Socket::sendFileDescriptors(const int* descriptors, u32 count)
+	{
+#ifdef PLATFORM_LINUX
+		if(!isConnected() || (m_ipaFamily != AF_UNIX) || (count == 0) || (count > MaxPassedDescriptorCount))
+			return Result::Failed;
+		// Stream sockets only carry ancillary data along with some data, the byte is the count
+		u8 byte = static_cast<u8>(count);
+		iovec vector { &byte, 1 };
+		alignas(cmsghdr) u8 control[CMSG_SPACE(sizeof(int) * MaxPassedDescriptorCount)];
+		msghdr message { };
+		message.msg_iov = &vector;
+		message.msg_iovlen = 1;
+		message.msg_control = control;
+		message.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+		cmsghdr* header = CMSG_FIRSTHDR(&message);
+		header->cmsg_level = SOL_SOCKET;
+		header->cmsg_type = SCM_RIGHTS;
+		header->cmsg_len = CMSG_LEN(sizeof(int) * count);
+		std::memcpy(CMSG_DATA(header), descriptors, sizeof(int) * count);
+		while(true)
+		{
+			ssize_t result = ::sendmsg(m_socket, &message, 0);
+			if(result == 1)
+				return Result::Success;
+			if((result < 0) && ((errno == EINTR) || (IsWouldBlockError() && waitWritable())))
+				continue;
+			m_isValid = false;
+			m_isConnected = false;
+			callOnDisconnect();
+			return Result::SocketError;
+		}
+#else
+		return Result::Failed;
+#endif
+	}
+
+	Result Socket::receiveFileDescriptors(std::vector<int>& descriptors)
+	{
+#ifdef PLATFORM_LINUX
+		if(!isConnected() || (m_ipaFamily != AF_UNIX))
+			return Result::Failed;
+		u8 byte = 0;
+		iovec vector { &byte, 1 };
+		alignas(cmsghdr) u8 control[CMSG_SPACE(sizeof(int) * MaxPassedDescriptorCount)];
+		msghdr message { };
+		message.msg_iov = &vector;
+		message.msg_iovlen = 1;
+		message.msg_control = control;
+		message.msg_controllen = sizeof(control);
+		ssize_t result;
+		do
+		{
+			result = ::recvmsg(m_socket, &message, MSG_CMSG_CLOEXEC);
+		} while((result < 0) && ((errno == EINTR) || (IsWouldBlockError() && waitReadable())));
+		if(result <= 0)
+		{
+			if(result < 0)
+				m_isValid = false;
+			m_isConnected = false;
+			callOnDisconnect();
+			return Result::SocketError;
+		}
+		const std::size_t previousCount = descriptors.size();
+		for(cmsghdr* header = CMSG_FIRSTHDR(&message); header != NULL; header = CMSG_NXTHDR(&message, header))
+		{
+			if((header->cmsg_level != SOL_SOCKET) || (header->cmsg_type != SCM_RIGHTS))
+				continue;
+			const std::size_t count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+			const std::size_t offset = descriptors.size();
+			descriptors.resize(offset + count);
+			std::memcpy(descriptors.data() + offset, CMSG_DATA(header), sizeof(int) * count);
+		}
+		// The byte wasn't sent by sendFileDescriptors(), or the descriptors didn't fit
+		if(((descriptors.size() - previousCount) != byte) || ((message.msg_flags & MSG_CTRUNC) != 0))
+		{
+			for(std::size_t i = previousCount; i < descriptors.size(); ++i)
+				::close(descriptors[i]);
+			descriptors.resize(previousCount);
+			return Result::Failed;
+		}
+		return Result::Success;
+#else
+		return Result::Failed;
+#endif
+	}
+
+	Result Socket::sendSocket(const Socket& socket)
+	{
+		if((socket.m_socket == NETSOCKET_INVALID_SOCKET_HANDLE) || (socket.m_tls != nullptr) || (socket.m_compression != nullptr))
+			return Result::Failed;
+#ifdef PLATFORM_LINUX
+		return sendFileDescriptors(&socket.m_socket, 1);
+#else
+		return Result::Failed;
+#endif
+	}
+
+	std::optional<Socket> Socket::receiveSocket()
+	{
+#ifdef PLATFORM_LINUX
+		std::vector<int> descriptors;
+		if(receiveFileDescriptors(descriptors) != Result::Success)
+			return { };
+		// The peer may have sent no descriptor at all (only the data byte), or more than one
+		if(descriptors.size() != 1)
+		{
+			for(int descriptor : descriptors)
+				::close(descriptor);
+			return { };
+		}
+		int family = 0, type = 0, protocol = 0;
+		socklen_t size = sizeof(int);
+		const bool isSocket = (getsockopt(descriptors[0], SOL_SOCKET, SO_DOMAIN, &family, &size) == 0)
+							&& (getsockopt(descriptors[0], SOL_SOCKET, SO_TYPE, &type, &size) == 0)
+							&& (getsockopt(descriptors[0], SOL_SOCKET, SO_PROTOCOL, &protocol, &size) == 0);
+		if(!isSocket)
+		{
+			::close(descriptors[0]);
+			return { };
+		}
+		Socket socket = CreateAcceptedSocket(descriptors[0], type, family, protocol);
+		// A listening socket can be passed too
+		sockaddr_storage address;
+		socklen_t addressLength = sizeof(address);
+		socket.m_isConnected = getpeername(descriptors[0], reinterpret_cast<sockaddr*>(&address), &addressLength) == 0;
+		return { std::move(socket) };
+#else
+		return { };
+#endif
+	}
+
+	std::optional<std::pair<Socket, Socket>> Socket::CreateUnixPair(SocketType socketType)
+	{
+#ifdef PLATFORM_LINUX
+		const int type = GetWin32SocketType(socketType);
+		int descriptors[2];
+		if(::socketpair(AF_UNIX, type | SOCK_CLOEXEC, 0, descriptors) != 0)
+			return { };
+		return { { CreateAcceptedSocket(descriptors[0], type, AF_UNIX, 0), CreateAcceptedSocket(descriptors[1], type, AF_UNIX, 0) } };
+#else
+		return { };
+#endif
+	}
+
+	Result Socket::startTls(const std::shared_ptr<TlsContext>& context, const std::string_view serverName, s32 timeout)
+	{
+		if(!isConnected() || (m_tls != nullptr) || !context || !context->isValid())
+			return Result::Failed;
+		// The record layer reports would-block and the waiting happens here, see TlsConnection
+		if(setNonBlocking(true) != Result::Success)
+			return Result::SocketError;
+		auto tls = std::make_unique<TlsConnection>(context, m_socket, serverName);
+		if(!tls->isValid())
+			return Result::Failed;
+		// A flight of handshake messages is written one message at a time, and Nagle's algorithm would hold
+		// the last ones back until the peer's delayed ACK (~40 ms per round trip)
+		const bool wasNoDelay = GetTCPNoDelay(m_socket);
+		if(!wasNoDelay)
+			SetTCPNoDelay(m_socket, true);
+		const auto deadline = GetDeadline(timeout);
+		int result;
+		do
+		{
+			result = tls->handshake();
+		} while((result != 0) && WaitForTls(m_socket, result, GetRemainingTimeout(deadline)));
+		if(!wasNoDelay)
+			SetTCPNoDelay(m_socket, false);
+		if(result != 0)
+			return Result::Failed;
+		m_tls = std::move(tls);
+		return Result::Success;
+	}
+
+	bool Socket::isTlsSessionResumed() const noexcept
+	{
+		return (m_tls != nullptr) && m_tls->isSessionResumed();
+	}
+
+	Result Socket::startCompression(const SocketCompressionOptions& options)
+	{
+		if(!isConnected() || (m_compression != nullptr))
+			return Result::Failed;
+		if((options.level < -1) || (options.level > 9) || (options.windowBits < 9) || (options.windowBits > 15)
+			|| (options.memLevel < 1) || (options.memLevel > 9) || (options.batchSize == 0))
+			return Result::Failed;
+		auto state = std::make_unique<CompressionState>(options);
+		if(!state->deflateStream.isValid() || !state->inflateStream.isValid())
+			return Result::Failed;
+		if(!options.dictionary.empty())
+		{
+			const u32 dictionarySize = static_cast<u32>(options.dictionary.size());
+			if(!state->deflateStream.setDictionary(options.dictionary.data(), dictionarySize)
+				|| !state->inflateStream.setDictionary(options.dictionary.data(), dictionarySize))
+				return Result::Failed;
+		}
+		m_compression = std::move(state);
+		return Result::Success;
+	}
+
+	Result Socket::sendCompressed(const SocketBuffer* buffers, u32 count)
+	{
+		if(count == 0)
+			return Result::Success;
+		CompressionState& state = *m_compression;
+		std::lock_guard<std::mutex> lock(state.sendMutex);
+		u64 size = 0;
+		for(u32 i = 0; i < count; ++i)
+			size += buffers[i].size;
+		state.stats.sentBytes += size;
+		state.unflushedSize = static_cast<u32>(std::min<u64>(state.unflushedSize + size, U32_MAX));
+		const bool isFlush = (state.flushPolicy == SocketCompressionOptions::FlushPolicy::PerMessage) || (state.unflushedSize >= state.batchSize);
+		// In slices, so that a large send() doesn't hold all of its compressed bytes in memory
+		constexpr u32 sliceSize = 64 * 1024;
+		for(u32 i = 0; i < count; ++i)
+		{
+			const SocketBuffer& buffer = buffers[i];
+			u32 offset = 0;
+			do
+			{
+				const u32 sliceLength = std::min(buffer.size - offset, sliceSize);
+				const bool isLastSlice = ((offset + sliceLength) == buffer.size) && ((i + 1) == count);
+				state.output.clear();
+				if(!state.deflateStream.compress(buffer.bytes + offset, sliceLength,
+					(isLastSlice && isFlush) ? DeflateStream::Flush::Sync : DeflateStream::Flush::None, state.output))
+					return Result::Failed;
+				if(!state.output.empty())
+				{
+					state.stats.sentCompressedBytes += state.output.size();
+					Result result = sendStream(state.output.data(), static_cast<u32>(state.output.size()));
+					if(result != Result::Success)
+						return result;
+				}
+				offset += sliceLength;
+			} while(offset < buffer.size);
+		}
+		if(isFlush)
+			state.unflushedSize = 0;
+		return Result::Success;
+	}
+
+	std::optional<u32> Socket::receiveSomeCompressed(u8* bytes, u32 size)
+	{
+		if(!m_isConnected)
+			return { };
+		// The peer may be waiting for what has been held back before it answers
+		if(flush() != Result::Success)
+			return { };
+		if(size == 0)
+			return { 0 };
+
+		CompressionState& state = *m_compression;
+		while(true)
+		{
+			// Also called without input, inflate may have more output for the previous input when the last buffer filled up
+			auto progress = state.inflateStream.decompressPartial(state.input.data() + state.inputBegin, state.inputEnd - state.inputBegin, bytes, size);
+			if(!progress)
+			{
+				com_debug_log_error("Failed to decompress the received data");
+				m_isValid = false;
+				m_isConnected = false;
+				callOnDisconnect();
+				return { };
+			}
+			state.inputBegin += progress->first;
+			if(state.inputBegin == state.inputEnd)
+				state.inputBegin = state.inputEnd = 0;
+			if(progress->second > 0)
+			{
+				state.stats.receivedBytes += progress->second;
+				return { progress->second };
+			}
+			// A truncated block is buffered inside inflate, so the input is all consumed here
+			std::optional<u32> result = receiveSomeStream(state.input.data() + state.inputEnd, static_cast<u32>(state.input.size()) - state.inputEnd);
+			if(!result)
+				return { };
+			state.inputEnd += *result;
+			state.stats.receivedCompressedBytes += *result;
+		}
+	}
+
+	Result Socket::flush()
+	{
+		if(m_compression == nullptr)
+			return Result::Success;
+		CompressionState& state = *m_compression;
+		std::lock_guard<std::mutex> lock(state.sendMutex);
+		if(state.unflushedSize == 0)
+			return Result::Success;
+		state.output.clear();
+		if(!state.deflateStream.compress(NULL, 0, DeflateStream::Flush::Sync, state.output))
+			return Result::Failed;
+		state.unflushedSize = 0;
+		state.stats.sentCompressedBytes += state.output.size();
+		return sendStream(state.output.data(), static_cast<u32>(state.output.size()));
+	}
+
+	SocketCompressionStats Socket::getCompressionStats() const
+	{
+		if(m_compression == nullptr)
+			return { };
+		std::lock_guard<std::mutex> lock(m_compression->sendMutex);
+		return m_compression->stats;
+	}
+
 	void Socket::setOnDisconnect(const OnDisconnectCallback& callback)
 	{
 		m_onDisconnectCallback = callback;
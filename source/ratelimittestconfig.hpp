@@ -0,0 +1,28 @@
+#pragma once
+
+#include <common/defines.hpp>
+
+#include <string_view>
+
+static constexpr std::string_view gRateLimitTcpPortNumber = "8000";
+static constexpr std::string_view gRateLimitUdpPortNumber = "8001";
+// Bytes per second
+static constexpr u64 gRateLimit = 4 * 1024 * 1024;
+// Bytes sent by every phase, in messages of gRateLimitMessageSize bytes (datagrams of gRateLimitDatagramSize bytes over UDP)
+static constexpr u32 gRateLimitPhaseSize = 2 * 1024 * 1024;
+static constexpr u32 gRateLimitMessageSize = 64 * 1024;
+static constexpr u32 gRateLimitDatagramSize = 1024;
+// The runtime phase starts at half the rate and is raised to this many times the rate once half of the phase is expected to be sent
+static constexpr u32 gRateLimitRaiseFactor = 4;
+
+// The TCP phases, in order, each one over a connection of its own
+enum class RateLimitPhase : u32
+{
+	// AsyncSocket with a token bucket
+	AsyncSocket,
+	// Socket with a token bucket whose rate is raised by another thread while it sends
+	RaisedAtRuntime,
+	// Socket with SocketOptions::maxPacingRate
+	KernelPacing,
+	Count
+};
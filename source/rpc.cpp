@@ -0,0 +1,285 @@
+#include <netsocket/rpc.hpp>
+#include <netsocket/assert.hpp>
+
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <future>
+
+namespace netsocket
+{
+	// How often the receiving thread checks whether it has been asked to stop
+	static constexpr s32 gStopCheckInterval = 100;
+	// How long stop() waits for the receiving thread to notice before it considers it stuck in the middle of a frame
+	static constexpr s32 gStopGracePeriod = 2 * gStopCheckInterval;
+
+	template<typename T>
+	static void WriteLittleEndian(u8* bytes, T value)
+	{
+		for(u32 i = 0; i < sizeof(T); ++i)
+			bytes[i] = static_cast<u8>(static_cast<u64>(value) >> (i * 8));
+	}
+
+	template<typename T>
+	static T ReadLittleEndian(const u8* bytes)
+	{
+		u64 value = 0;
+		for(u32 i = 0; i < sizeof(T); ++i)
+			value |= static_cast<u64>(bytes[i]) << (i * 8);
+		return static_cast<T>(value);
+	}
+
+	Result RpcChannel::Responder::respond(const u8* bytes, u32 size) const
+	{
+		return m_channel->sendFrame(FrameKind::Response, RpcStatus::Success, m_method, m_requestId, bytes, size);
+	}
+
+	Result RpcChannel::Responder::fail(const u8* bytes, u32 size) const
+	{
+		return m_channel->sendFrame(FrameKind::Response, RpcStatus::Error, m_method, m_requestId, bytes, size);
+	}
+
+	RpcChannel::RpcChannel(Socket& socket, const RpcOptions& options) : m_socket(socket),
+																		m_messageSocket(socket, options.framing),
+																		m_options(options),
+																		m_nextRequestId(1),
+																		m_pendingCount(0),
+																		m_isRunning(false),
+																		m_isStopping(false),
+																		m_isReceiveThreadDone(false)
+	{
+	}
+
+	RpcChannel::~RpcChannel()
+	{
+		stop();
+	}
+
+	void RpcChannel::setRequestHandler(u32 method, const RequestHandler& handler)
+	{
+		netsocket_assert(!m_receiveThread && "Set the request handlers before start()");
+		m_requestHandlers[method] = handler;
+	}
+
+	Result RpcChannel::start()
+	{
+		if(!m_socket.isConnected() || m_receiveThread)
+			return Result::Failed;
+		m_isStopping = false;
+		m_isReceiveThreadDone = false;
+		m_isRunning = true;
+		m_receiveThread = std::make_unique<std::thread>(&RpcChannel::receiveThreadHandler, this);
+		m_timeoutThread = std::make_unique<std::thread>(&RpcChannel::timeoutThreadHandler, this);
+		return Result::Success;
+	}
+
+	void RpcChannel::stop()
+	{
+		if(!m_receiveThread)
+			return;
+		{
+			std::lock_guard<std::mutex> lock(m_deadlineMutex);
+			m_isStopping = true;
+		}
+		m_deadlineCV.notify_all();
+		const std::thread::id threadId = std::this_thread::get_id();
+		const bool isReceiveThread = threadId == m_receiveThread->get_id();
+		if(!isReceiveThread)
+		{
+			// The receiving thread only checks m_isStopping between frames, a peer which stalls in the middle of one would keep it waiting.
+			// The stream can't be resynchronized at that point anyway
+			std::unique_lock<std::mutex> lock(m_deadlineMutex);
+			if(!m_deadlineCV.wait_for(lock, std::chrono::milliseconds(gStopGracePeriod), [this] { return m_isReceiveThreadDone; }))
+				m_socket.shutdownReceive();
+		}
+		// A thread can't join itself, the next stop() does
+		if(isReceiveThread || (threadId == m_timeoutThread->get_id()))
+		{
+			m_isRunning = false;
+			return;
+		}
+		m_receiveThread->join();
+		m_timeoutThread->join();
+		m_receiveThread.reset();
+		m_timeoutThread.reset();
+		m_isRunning = false;
+		failPendingCalls(RpcStatus::Disconnected);
+	}
+
+	Result RpcChannel::call(u32 method, const u8* bytes, u32 size, const ResponseHandler& handler, std::optional<u32> timeout)
+	{
+		if(!m_isRunning)
+			return Result::Failed;
+		const u64 requestId = m_nextRequestId++;
+		const u32 timeoutMilliseconds = timeout.value_or(m_options.defaultTimeout);
+		const auto deadline = (timeoutMilliseconds == 0) ? std::chrono::steady_clock::time_point::max()
+														: (std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMilliseconds));
+		// Registered before sending, the response can arrive before sendFrame() returns
+		{
+			PendingShard& shard = getShard(requestId);
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			shard.calls.emplace(requestId, PendingCall { handler, deadline });
+		}
+		++m_pendingCount;
+		if(timeoutMilliseconds != 0)
+		{
+			std::unique_lock<std::mutex> lock(m_deadlineMutex);
+			const bool isEarliest = m_deadlines.empty() || (deadline < m_deadlines.begin()->first);
+			m_deadlines.emplace(deadline, requestId);
+			lock.unlock();
+			if(isEarliest)
+				m_deadlineCV.notify_one();
+		}
+		// The channel may have stopped after the check above, past the point where it fails the pending calls
+		if(!m_isRunning && takePendingCall(requestId))
+			return Result::Failed;
+
+		Result result = sendFrame(FrameKind::Request, RpcStatus::Success, method, requestId, bytes, size);
+		// Unless the call has completed meanwhile (the channel got disconnected), the handler is never called
+		if((result != Result::Success) && takePendingCall(requestId))
+			return result;
+		return Result::Success;
+	}
+
+	RpcResult RpcChannel::callAndWait(u32 method, const u8* bytes, u32 size, std::optional<u32> timeout)
+	{
+		auto promise = std::make_shared<std::promise<RpcResult>>();
+		std::future<RpcResult> future = promise->get_future();
+		Result result = call(method, bytes, size, [promise](RpcStatus status, const u8* bytes, u32 size)
+		{
+			promise->set_value(RpcResult { status, std::vector<u8>(bytes, bytes + size) });
+		}, timeout);
+		if(result != Result::Success)
+			return { RpcStatus::Disconnected, { } };
+		return future.get();
+	}
+
+	std::optional<RpcChannel::PendingCall> RpcChannel::takePendingCall(u64 requestId)
+	{
+		std::optional<PendingCall> call;
+		{
+			PendingShard& shard = getShard(requestId);
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			auto it = shard.calls.find(requestId);
+			if(it == shard.calls.end())
+				return { };
+			call = std::move(it->second);
+			shard.calls.erase(it);
+		}
+		--m_pendingCount;
+		if(call->deadline != std::chrono::steady_clock::time_point::max())
+		{
+			std::lock_guard<std::mutex> lock(m_deadlineMutex);
+			m_deadlines.erase({ call->deadline, requestId });
+		}
+		return call;
+	}
+
+	Result RpcChannel::sendFrame(FrameKind kind, RpcStatus status, u32 method, u64 requestId, const u8* bytes, u32 size)
+	{
+		u8 header[FrameHeaderSize];
+		header[0] = static_cast<u8>(kind);
+		header[1] = static_cast<u8>(status);
+		WriteLittleEndian<u32>(header + 2, method);
+		WriteLittleEndian<u64>(header + 6, requestId);
+		const SocketBuffer buffers[] = { { header, FrameHeaderSize }, { bytes, size } };
+		std::lock_guard<std::mutex> lock(m_sendMutex);
+		return m_messageSocket.sendMessageVectored(buffers, 2);
+	}
+
+	void RpcChannel::dispatchFrame(const std::vector<u8>& frame)
+	{
+		if(frame.size() < FrameHeaderSize)
+		{
+			spdlog::error("RPC frame of {} bytes is shorter than its header", frame.size());
+			return;
+		}
+		const FrameKind kind = static_cast<FrameKind>(frame[0]);
+		const RpcStatus status = static_cast<RpcStatus>(frame[1]);
+		const u32 method = ReadLittleEndian<u32>(frame.data() + 2);
+		const u64 requestId = ReadLittleEndian<u64>(frame.data() + 6);
+		const u8* payload = frame.data() + FrameHeaderSize;
+		const u32 payloadSize = static_cast<u32>(frame.size()) - FrameHeaderSize;
+
+		if(kind == FrameKind::Request)
+		{
+			auto it = m_requestHandlers.find(method);
+			if(it == m_requestHandlers.end())
+				sendFrame(FrameKind::Response, RpcStatus::UnknownMethod, method, requestId, NULL, 0);
+			else
+				it->second(payload, payloadSize, Responder(this, method, requestId));
+		}
+		else if(kind == FrameKind::Response)
+		{
+			// Nothing is waiting for it if the call has timed out
+			std::optional<PendingCall> call = takePendingCall(requestId);
+			if(call)
+				call->handler(status, payload, payloadSize);
+		}
+		else
+			spdlog::error("Unknown RPC frame kind: {}", frame[0]);
+	}
+
+	void RpcChannel::receiveThreadHandler()
+	{
+		std::vector<u8> frame;
+		while(!m_isStopping)
+		{
+			// Waits in slices to notice stop(), unless complete frames may be waiting in the read-ahead buffer already
+			if((m_messageSocket.getBufferedSize() == 0) && !m_socket.waitReadable(gStopCheckInterval))
+				continue;
+			if(m_messageSocket.receiveMessage(frame) != Result::Success)
+				break;
+			dispatchFrame(frame);
+		}
+		m_isRunning = false;
+		failPendingCalls(RpcStatus::Disconnected);
+		{
+			std::lock_guard<std::mutex> lock(m_deadlineMutex);
+			m_isReceiveThreadDone = true;
+		}
+		m_deadlineCV.notify_all();
+	}
+
+	void RpcChannel::timeoutThreadHandler()
+	{
+		std::unique_lock<std::mutex> lock(m_deadlineMutex);
+		while(!m_isStopping)
+		{
+			if(m_deadlines.empty())
+			{
+				m_deadlineCV.wait(lock);
+				continue;
+			}
+			const auto [deadline, requestId] = *m_deadlines.begin();
+			if(std::chrono::steady_clock::now() < deadline)
+			{
+				m_deadlineCV.wait_until(lock, deadline);
+				continue;
+			}
+			m_deadlines.erase(m_deadlines.begin());
+			lock.unlock();
+			std::optional<PendingCall> call = takePendingCall(requestId);
+			if(call)
+				call->handler(RpcStatus::Timeout, NULL, 0);
+			lock.lock();
+		}
+	}
+
+	void RpcChannel::failPendingCalls(RpcStatus status)
+	{
+		for(PendingShard& shard : m_pendingShards)
+		{
+			std::unordered_map<u64, PendingCall> calls;
+			{
+				std::lock_guard<std::mutex> lock(shard.mutex);
+				calls.swap(shard.calls);
+			}
+			m_pendingCount -= static_cast<u32>(calls.size());
+			for(auto& pair : calls)
+				pair.second.handler(status, NULL, 0);
+		}
+		std::lock_guard<std::mutex> lock(m_deadlineMutex);
+		m_deadlines.clear();
+	}
+}
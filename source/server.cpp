@@ -0,0 +1,592 @@
+#include <netsocket/server.hpp>
+#include <netsocket/assert.hpp>
+
+#include <common/platform.h>
+
+#ifdef PLATFORM_LINUX
+#	include <poll.h> // for poll
+#	include <errno.h> // for errno
+#	include <unistd.h> // for read, write, close
+#	include <sys/eventfd.h> // for eventfd
+#	include <pthread.h> // for pthread_setaffinity_np
+#	include <sched.h> // for cpu_set_t
+#endif
+
+#include <algorithm> // for std::min, std::max, std::remove_if
+#include <iterator> // for std::distance
+#include <chrono>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+namespace netsocket
+{
+#ifdef PLATFORM_WINDOWS
+	using PollDescriptor = WSAPOLLFD;
+	// Nothing can interrupt WSAPoll(), so the shards wake up this often (in milliseconds) to pick up new connections and notice stop()
+	static constexpr s32 gShardPollInterval = 10;
+#else
+	using PollDescriptor = struct pollfd;
+	// The shards are woken up through their eventfd
+	static constexpr s32 gShardPollInterval = -1;
+#endif
+	// How often stop() checks whether the connections are done, in milliseconds
+	static constexpr u32 gStopCheckInterval = 10;
+
+	static u32 GetCoreCount()
+	{
+		return std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	ServerTask& ServerTask::operator=(ServerTask&& task) noexcept
+	{
+		if(this != &task)
+		{
+			if(m_handle)
+				m_handle.destroy();
+			m_handle = task.m_handle;
+			task.m_handle = { };
+		}
+		return *this;
+	}
+
+	ServerTask::~ServerTask()
+	{
+		if(m_handle)
+			m_handle.destroy();
+	}
+
+	ServerConnection::ServerConnection(Socket socket, u32 shardIndex, TimerWheel& timerWheel) noexcept : m_socket(std::move(socket)),
+																										m_shardIndex(shardIndex),
+																										m_timerWheel(timerWheel),
+																										m_awaiter(nullptr),
+																										m_idleTimeout(0),
+																										m_readTimeout(0),
+																										m_idleTimer(TimerWheel::InvalidTimerId),
+																										m_readTimer(TimerWheel::InvalidTimerId),
+																										m_lastActivityTime(std::chrono::steady_clock::now()),
+																										m_isPollReady(false),
+																										m_isCancelled(false),
+																										m_isTimedOut(false)
+	{
+	}
+
+	ServerConnection::~ServerConnection()
+	{
+		m_timerWheel.cancel(m_idleTimer);
+		m_timerWheel.cancel(m_readTimer);
+	}
+
+	void ServerConnection::setIdleTimeout(u32 timeout)
+	{
+		m_timerWheel.cancel(m_idleTimer);
+		m_idleTimer = TimerWheel::InvalidTimerId;
+		m_idleTimeout = timeout;
+		touch();
+		if(timeout > 0)
+			armIdleTimer(timeout);
+	}
+
+	Result ServerConnection::setWriteTimeout(u32 timeout)
+	{
+		return m_socket.setSendTimeout((timeout == 0) ? -1 : static_cast<s32>(std::min<u32>(timeout, std::numeric_limits<s32>::max())));
+	}
+
+	void ServerConnection::armIdleTimer(u32 delay)
+	{
+		m_idleTimer = m_timerWheel.schedule(delay, [this]()
+		{
+			m_idleTimer = TimerWheel::InvalidTimerId;
+			onIdleTimer();
+		});
+	}
+
+	void ServerConnection::onIdleTimer()
+	{
+		const auto idleTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_lastActivityTime).count();
+		if(idleTime < m_idleTimeout)
+		{
+			armIdleTimer(m_idleTimeout - static_cast<u32>(idleTime));
+			return;
+		}
+		timeOut();
+	}
+
+	void ServerConnection::timeOut()
+	{
+		m_isTimedOut = true;
+		resumeIfDone();
+	}
+
+	void ServerConnection::resumeIfDone()
+	{
+		if((m_awaiter == nullptr) || !m_awaiter->progress())
+			return;
+		m_awaiter = nullptr;
+		m_timerWheel.cancel(m_readTimer);
+		m_readTimer = TimerWheel::InvalidTimerId;
+		m_waitingHandle.resume();
+	}
+
+	bool ServerConnection::takeReadable()
+	{
+		if(m_isPollReady)
+		{
+			m_isPollReady = false;
+			return true;
+		}
+		return m_socket.waitReadable(0);
+	}
+
+	void ServerConnection::Awaiter::await_suspend(std::coroutine_handle<> handle) noexcept
+	{
+		m_connection.m_awaiter = this;
+		m_connection.m_waitingHandle = handle;
+		if(m_connection.m_readTimeout > 0)
+		{
+			ServerConnection& connection = m_connection;
+			connection.m_readTimer = connection.m_timerWheel.schedule(connection.m_readTimeout, [&connection]()
+			{
+				connection.m_readTimer = TimerWheel::InvalidTimerId;
+				connection.timeOut();
+			});
+		}
+	}
+
+	bool ServerConnection::ReadableAwaiter::progress()
+	{
+		if(m_connection.isFailed())
+		{
+			m_isFailed = true;
+			return true;
+		}
+		if(!m_connection.takeReadable())
+			return false;
+		m_connection.touch();
+		return true;
+	}
+
+	ServerConnection::ReceiveAwaiter::ReceiveAwaiter(ServerConnection& connection, u8* bytes, u32 size, bool isExact) noexcept : Awaiter(connection),
+																																m_bytes(bytes),
+																																m_size(size),
+																																m_receivedSize(0),
+																																m_isExact(isExact)
+	{
+	}
+
+	bool ServerConnection::ReceiveAwaiter::progress()
+	{
+		while(true)
+		{
+			if(m_connection.isFailed())
+			{
+				m_isFailed = true;
+				return true;
+			}
+			if(m_receivedSize == m_size)
+				return true;
+			if(!m_connection.takeReadable())
+				return false;
+			// Doesn't block: there is data or the peer has hung up (the latter fails the receive)
+			std::optional<u32> result = m_connection.m_socket.receiveSome(m_bytes + m_receivedSize, m_size - m_receivedSize);
+			if(!result.has_value())
+			{
+				m_isFailed = true;
+				return true;
+			}
+			m_receivedSize += *result;
+			m_connection.touch();
+			if(!m_isExact)
+				return true;
+		}
+	}
+
+	std::optional<u32> ServerConnection::ReceiveAwaiter::await_resume() const noexcept
+	{
+		if(m_isFailed)
+			return { };
+		return { m_receivedSize };
+	}
+
+	// One event loop on its own thread, owning the connections it has been given
+	class ServerShard
+	{
+	private:
+		struct Entry
+		{
+			std::unique_ptr<ServerConnection> connection;
+			ServerTask task;
+		};
+
+		u32 m_index;
+		const ServerOptions& m_options;
+		const Server::ConnectionHandler* m_handler;
+		std::thread m_thread;
+		// Timeouts of the connections, outlives them. Only touched by the shard's thread
+		TimerWheel m_timerWheel;
+		// Connections handed over by the acceptor, adopted by the shard's thread
+		std::mutex m_mutex;
+		std::vector<Socket> m_incomingSockets;
+		// Only touched by the shard's thread
+		std::vector<Entry> m_entries;
+		// Incoming and served connections
+		std::atomic<u32> m_connectionCount;
+		std::atomic<bool> m_isAccepting;
+		std::atomic<bool> m_isStopping;
+#ifdef PLATFORM_LINUX
+		int m_wakeDescriptor;
+#endif
+
+		void run();
+		void adopt(Socket socket);
+		void adoptIncoming();
+		void acceptListening();
+		// Until the next timer (or the next check for new connections and stop() on Windows)
+		s32 getPollTimeout() const;
+		// Destroys the handlers which have returned, closing their connections
+		void reap();
+		void cancelAll();
+		void wake();
+
+	public:
+		// Linux with ServerOptions::isReusePortEnabled: this shard's own listening socket
+		Socket listeningSocket;
+
+		ServerShard(u32 index, const ServerOptions& options);
+		ServerShard(ServerShard&) = delete;
+		ServerShard(ServerShard&&) = delete;
+		~ServerShard();
+
+		void start(const Server::ConnectionHandler& handler);
+		void post(Socket socket);
+		void stopAccepting();
+		// Cancels the pending waits of the remaining connections, destroys them and joins the thread
+		void stop();
+		u32 getConnectionCount() const noexcept { return m_connectionCount; }
+	};
+
+	ServerShard::ServerShard(u32 index, const ServerOptions& options) : m_index(index),
+																		m_options(options),
+																		m_handler(nullptr),
+																		m_timerWheel(options.timerTickDuration),
+																		m_connectionCount(0),
+																		m_isAccepting(false),
+																		m_isStopping(false)
+	{
+#ifdef PLATFORM_LINUX
+		m_wakeDescriptor = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+	}
+
+	ServerShard::~ServerShard()
+	{
+		stop();
+#ifdef PLATFORM_LINUX
+		if(m_wakeDescriptor >= 0)
+			::close(m_wakeDescriptor);
+#endif
+	}
+
+	void ServerShard::start(const Server::ConnectionHandler& handler)
+	{
+		m_handler = &handler;
+		m_isStopping = false;
+		m_isAccepting = true;
+		m_thread = std::thread(&ServerShard::run, this);
+	}
+
+	void ServerShard::post(Socket socket)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_incomingSockets.push_back(std::move(socket));
+			++m_connectionCount;
+		}
+		wake();
+	}
+
+	void ServerShard::stopAccepting()
+	{
+		m_isAccepting = false;
+		wake();
+	}
+
+	void ServerShard::stop()
+	{
+		m_isAccepting = false;
+		m_isStopping = true;
+		wake();
+		if(m_thread.joinable())
+			m_thread.join();
+	}
+
+	void ServerShard::wake()
+	{
+#ifdef PLATFORM_LINUX
+		const u64 value = 1;
+		[[maybe_unused]] ssize_t result = ::write(m_wakeDescriptor, &value, sizeof(value));
+#endif
+	}
+
+	void ServerShard::adopt(Socket socket)
+	{
+		auto connection = std::make_unique<ServerConnection>(std::move(socket), m_index, m_timerWheel);
+		ServerTask task = (*m_handler)(*connection);
+		std::coroutine_handle<> handle = task.getHandle();
+		m_entries.push_back({ std::move(connection), std::move(task) });
+		// Runs the handler up to its first wait
+		handle.resume();
+	}
+
+	void ServerShard::adoptIncoming()
+	{
+		std::vector<Socket> sockets;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			sockets.swap(m_incomingSockets);
+		}
+		for(Socket& socket : sockets)
+			adopt(std::move(socket));
+	}
+
+	void ServerShard::acceptListening()
+	{
+		std::vector<Socket> sockets;
+		listeningSocket.acceptMany(sockets, m_options.batchSize, m_options.socketOptions);
+		m_connectionCount += static_cast<u32>(sockets.size());
+		for(Socket& socket : sockets)
+			adopt(std::move(socket));
+	}
+
+	s32 ServerShard::getPollTimeout() const
+	{
+		const s32 timeout = m_timerWheel.getTimeout();
+#ifdef PLATFORM_WINDOWS
+		return (timeout < 0) ? gShardPollInterval : std::min(timeout, gShardPollInterval);
+#else
+		return timeout;
+#endif
+	}
+
+	void ServerShard::reap()
+	{
+		auto it = std::remove_if(m_entries.begin(), m_entries.end(), [](const Entry& entry) { return entry.task.getHandle().done(); });
+		m_connectionCount -= static_cast<u32>(std::distance(it, m_entries.end()));
+		m_entries.erase(it, m_entries.end());
+	}
+
+	void ServerShard::cancelAll()
+	{
+		for(Entry& entry : m_entries)
+		{
+			entry.connection->m_isCancelled = true;
+			entry.connection->resumeIfDone();
+		}
+		reap();
+		// Whatever doesn't return when cancelled (e.g. waits on something else) is destroyed as is
+		m_connectionCount -= static_cast<u32>(m_entries.size());
+		m_entries.clear();
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_connectionCount -= static_cast<u32>(m_incomingSockets.size());
+		m_incomingSockets.clear();
+	}
+
+	void ServerShard::run()
+	{
+#ifdef PLATFORM_LINUX
+		if(m_options.isPinnedToCores)
+		{
+			cpu_set_t cpuSet;
+			CPU_ZERO(&cpuSet);
+			CPU_SET(m_index % GetCoreCount(), &cpuSet);
+			pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+		}
+#endif
+		std::vector<PollDescriptor> descriptors;
+		// Index of the entry behind each descriptor, after the wake and listening ones
+		std::vector<u32> entryIndices;
+		while(!m_isStopping)
+		{
+			adoptIncoming();
+			reap();
+
+			descriptors.clear();
+			entryIndices.clear();
+#ifdef PLATFORM_LINUX
+			descriptors.push_back({ m_wakeDescriptor, POLLIN, 0 });
+#endif
+			const bool isListening = m_isAccepting && listeningSocket.isValid();
+			if(isListening)
+				descriptors.push_back({ listeningSocket.getHandle(), POLLIN, 0 });
+			const u32 firstEntryDescriptor = static_cast<u32>(descriptors.size());
+			for(u32 i = 0; i < m_entries.size(); ++i)
+			{
+				if(m_entries[i].connection->m_awaiter == nullptr)
+					continue;
+				descriptors.push_back({ m_entries[i].connection->getSocket().getHandle(), POLLIN, 0 });
+				entryIndices.push_back(i);
+			}
+
+			const s32 timeout = getPollTimeout();
+#ifdef PLATFORM_WINDOWS
+			int result = descriptors.empty() ? (std::this_thread::sleep_for(std::chrono::milliseconds(timeout)), 0)
+											: WSAPoll(descriptors.data(), static_cast<ULONG>(descriptors.size()), timeout);
+#else
+			int result = ::poll(descriptors.data(), descriptors.size(), timeout);
+			if((result < 0) && (errno == EINTR))
+				continue;
+#endif
+			// After the events, so that what arrived in time doesn't time out
+			if(result <= 0)
+			{
+				m_timerWheel.advance();
+				continue;
+			}
+#ifdef PLATFORM_LINUX
+			if(descriptors[0].revents != 0)
+			{
+				u64 value;
+				[[maybe_unused]] ssize_t readResult = ::read(m_wakeDescriptor, &value, sizeof(value));
+			}
+#endif
+			if(isListening && (descriptors[firstEntryDescriptor - 1].revents != 0))
+				acceptListening();
+			for(u32 i = 0; i < entryIndices.size(); ++i)
+			{
+				// A hang up or an error is reported too, the wait then finds out the connection is closed
+				if(descriptors[firstEntryDescriptor + i].revents == 0)
+					continue;
+				ServerConnection& connection = *m_entries[entryIndices[i]].connection;
+				connection.m_isPollReady = true;
+				connection.resumeIfDone();
+				connection.m_isPollReady = false;
+			}
+			m_timerWheel.advance();
+		}
+		cancelAll();
+	}
+
+	static ServerTask RunOnReadableCallback(ServerConnection& connection, const Server::OnReadableCallback& callback)
+	{
+		while(true)
+		{
+			// Not in the loop's condition: GCC 12 miscompiles a co_await there
+			const bool isReadable = co_await connection.readable();
+			if(!isReadable)
+				break;
+			callback(connection);
+			if(!connection.getSocket().isConnected())
+				break;
+		}
+	}
+
+	Server::Server(const ServerOptions& options) : m_options(options), m_nextShardIndex(0), m_isRunning(false)
+	{
+#ifndef PLATFORM_LINUX
+		m_options.isReusePortEnabled = false;
+#endif
+	}
+
+	Server::~Server()
+	{
+		stop(0);
+	}
+
+	Result Server::listen(const std::string_view ipAddress, const std::string_view portNumber)
+	{
+		netsocket_assert(!m_isRunning && m_shards.empty() && "Server is already listening");
+		const u32 shardCount = (m_options.shardCount == 0) ? GetCoreCount() : m_options.shardCount;
+		for(u32 i = 0; i < shardCount; ++i)
+			m_shards.push_back(std::make_unique<ServerShard>(i, m_options));
+
+		std::vector<Socket*> listeningSockets;
+		if(m_options.isReusePortEnabled)
+			for(auto& shard : m_shards)
+				listeningSockets.push_back(&shard->listeningSocket);
+		else
+			listeningSockets.push_back(&m_listeningSocket);
+		for(Socket* socket : listeningSockets)
+		{
+			*socket = Socket(SocketType::Stream, m_options.ipAddressFamily, IPProtocol::TCP, m_options.socketOptions);
+			if(!socket->isValid())
+			{
+				m_shards.clear();
+				return Result::SocketError;
+			}
+			Result result = m_options.isReusePortEnabled ? socket->setReusePort(true) : Result::Success;
+			if(result == Result::Success)
+				result = socket->bind(ipAddress, portNumber);
+			if(result == Result::Success)
+				result = socket->listen();
+			if(result != Result::Success)
+			{
+				m_shards.clear();
+				return result;
+			}
+		}
+		return Result::Success;
+	}
+
+	Result Server::start(const ConnectionHandler& handler)
+	{
+		netsocket_assert(!m_isRunning && "Server is already running, call stop() first");
+		netsocket_assert(handler && "A connection handler is required");
+		if(m_shards.empty())
+			return Result::Failed;
+		m_connectionHandler = handler;
+		for(auto& shard : m_shards)
+			shard->start(m_connectionHandler);
+		m_isRunning = true;
+		if(!m_options.isReusePortEnabled)
+		{
+			m_acceptor = std::make_unique<Acceptor>(m_listeningSocket);
+			Result result = m_acceptor->start([this](Socket socket) { dispatch(std::move(socket)); }, { }, m_options.batchSize);
+			if(result != Result::Success)
+			{
+				stop(0);
+				return result;
+			}
+		}
+		return Result::Success;
+	}
+
+	Result Server::startCallbacks(const OnReadableCallback& callback)
+	{
+		netsocket_assert(callback && "A callback is required");
+		m_onReadableCallback = callback;
+		return start([this](ServerConnection& connection) { return RunOnReadableCallback(connection, m_onReadableCallback); });
+	}
+
+	void Server::dispatch(Socket socket)
+	{
+		socket.setOptions(m_options.socketOptions);
+		m_shards[m_nextShardIndex++ % m_shards.size()]->post(std::move(socket));
+	}
+
+	void Server::stop(u32 gracePeriod)
+	{
+		if(!m_isRunning)
+			return;
+		if(m_acceptor)
+		{
+			m_acceptor->stop();
+			m_acceptor.reset();
+		}
+		for(auto& shard : m_shards)
+			shard->stopAccepting();
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(gracePeriod);
+		while((getConnectionCount() > 0) && (std::chrono::steady_clock::now() < deadline))
+			std::this_thread::sleep_for(std::chrono::milliseconds(gStopCheckInterval));
+		for(auto& shard : m_shards)
+			shard->stop();
+		m_isRunning = false;
+	}
+
+	u32 Server::getConnectionCount() const
+	{
+		u32 count = 0;
+		for(const auto& shard : m_shards)
+			count += shard->getConnectionCount();
+		return count;
+	}
+}
@@ -0,0 +1,483 @@
+#include <netsocket/shmsocket.hpp>
+#include <netsocket/assert.hpp>
+#include <common/platform.h>
+
+#ifdef PLATFORM_LINUX
+#	include <sys/mman.h> // for mmap, memfd_create
+#	include <sys/stat.h> // for fstat
+#	include <sys/syscall.h> // for SYS_futex
+#	include <linux/futex.h> // for FUTEX_WAIT, FUTEX_WAKE
+#	include <unistd.h> // for close, ftruncate, syscall
+#	include <fcntl.h> // for fcntl
+#	include <time.h> // for timespec
+#endif
+
+#include <atomic>
+#include <algorithm> // for std::min
+#include <bit> // for std::bit_ceil
+#include <chrono>
+#include <climits> // for INT_MAX
+#include <cstring> // for std::memcpy
+#include <thread> // for std::thread::hardware_concurrency, std::this_thread::yield
+#include <vector>
+
+namespace netsocket
+{
+	static constexpr u32 SegmentMagic = 0x524D534E; // "NSMR"
+	static constexpr u32 SegmentVersion = 1;
+	static constexpr std::size_t CacheLineSize = 64;
+
+	// The segment is shared between processes, the atomics must not fall back to a (process local) lock
+	static_assert(std::atomic<u64>::is_always_lock_free && std::atomic<u32>::is_always_lock_free);
+
+	// Positions only grow, the byte at position p is at p modulo the capacity
+	struct SharedMemoryRing
+	{
+		// Written by the producer only
+		alignas(CacheLineSize) std::atomic<u64> head;
+		// Written by the consumer only
+		alignas(CacheLineSize) std::atomic<u64> tail;
+		// Futex words, bumped to wake the consumer (new data) or the producer (free space) once it has announced that it sleeps
+		alignas(CacheLineSize) std::atomic<u32> dataSignal;
+		std::atomic<u32> isConsumerSleeping;
+		alignas(CacheLineSize) std::atomic<u32> spaceSignal;
+		std::atomic<u32> isProducerSleeping;
+	};
+
+	// At the start of the memfd, zero-initialized by ftruncate(). The data of the creator's send ring follows (at HeaderSize), then the opener's
+	struct SharedMemorySegment
+	{
+		u32 magic;
+		u32 version;
+		u32 capacity;
+		alignas(CacheLineSize) std::atomic<u32> isClosed;
+		// Creator to opener, opener to creator
+		SharedMemoryRing rings[2];
+	};
+
+	static constexpr u64 HeaderSize = (sizeof(SharedMemorySegment) + 4095) & ~static_cast<u64>(4095);
+
+	// Counts a call on one side for its duration, so that close() doesn't unmap the segment underneath it.
+	// The call increments the counter before checking the closing flag and close() sets the flag before checking the counters (all seq_cst),
+	// so either the call sees the flag and stays away from the segment, or close() waits for the call to return
+	class SharedMemoryCallGuard
+	{
+	private:
+		std::atomic<u32>& m_callCount;
+		bool m_isEntered;
+
+	public:
+		SharedMemoryCallGuard(std::atomic<u32>& callCount, const std::atomic<bool>& isClosing) : m_callCount(callCount)
+		{
+			m_callCount.fetch_add(1);
+			m_isEntered = !isClosing.load();
+		}
+		SharedMemoryCallGuard(SharedMemoryCallGuard&) = delete;
+		~SharedMemoryCallGuard() { m_callCount.fetch_sub(1, std::memory_order_release); }
+
+		// False if the socket is being closed, the segment must not be touched then
+		bool isEntered() const noexcept { return m_isEntered; }
+	};
+
+	static void CpuRelax()
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#elif defined(__aarch64__)
+		asm volatile("yield");
+#endif
+	}
+
+	// Sleeps while 'word' holds 'expected', up to 'timeout' milliseconds (-1 forever). Spurious returns are fine, the callers check again
+	static void FutexWait(std::atomic<u32>& word, u32 expected, s32 timeout)
+	{
+#ifdef PLATFORM_LINUX
+		timespec duration;
+		if(timeout >= 0)
+		{
+			duration.tv_sec = timeout / 1000;
+			duration.tv_nsec = static_cast<long>(timeout % 1000) * 1000000L;
+		}
+		// Not FUTEX_PRIVATE_FLAG: the waker can be another process mapping the same memfd
+		syscall(SYS_futex, reinterpret_cast<u32*>(&word), FUTEX_WAIT, expected, (timeout >= 0) ? &duration : NULL, NULL, 0);
+#endif
+	}
+
+	static void FutexWake(std::atomic<u32>& word, int count)
+	{
+#ifdef PLATFORM_LINUX
+		syscall(SYS_futex, reinterpret_cast<u32*>(&word), FUTEX_WAKE, count, NULL, NULL, 0);
+#endif
+	}
+
+	static void Signal(std::atomic<u32>& signal, int count)
+	{
+		signal.fetch_add(1, std::memory_order_release);
+		FutexWake(signal, count);
+	}
+
+	static void CopyToRing(u8* data, u64 capacity, u64 position, const u8* bytes, u64 size)
+	{
+		const u64 index = position & (capacity - 1);
+		const u64 firstSize = std::min(size, capacity - index);
+		std::memcpy(data + index, bytes, firstSize);
+		std::memcpy(data, bytes + firstSize, size - firstSize);
+	}
+
+	static void CopyFromRing(const u8* data, u64 capacity, u64 position, u8* bytes, u64 size)
+	{
+		const u64 index = position & (capacity - 1);
+		const u64 firstSize = std::min(size, capacity - index);
+		std::memcpy(bytes, data + index, firstSize);
+		std::memcpy(bytes + firstSize, data, size - firstSize);
+	}
+
+	SharedMemorySocket::SharedMemorySocket() : m_descriptor(-1),
+												m_mapping(nullptr),
+												m_mappingSize(0),
+												m_segment(nullptr),
+												m_sendRing(nullptr),
+												m_receiveRing(nullptr),
+												m_sendData(nullptr),
+												m_receiveData(nullptr),
+												m_capacity(0),
+												m_spinCount(0),
+												m_sendCallCount(0),
+												m_receiveCallCount(0),
+												m_isClosing(false)
+	{
+	}
+
+	SharedMemorySocket::SharedMemorySocket(SharedMemorySocket&& socket) : m_descriptor(socket.m_descriptor),
+																			m_mapping(socket.m_mapping),
+																			m_mappingSize(socket.m_mappingSize),
+																			m_segment(socket.m_segment),
+																			m_sendRing(socket.m_sendRing),
+																			m_receiveRing(socket.m_receiveRing),
+																			m_sendData(socket.m_sendData),
+																			m_receiveData(socket.m_receiveData),
+																			m_capacity(socket.m_capacity),
+																			m_spinCount(socket.m_spinCount),
+																			m_sendCallCount(0),
+																			m_receiveCallCount(0),
+																			m_isClosing(false)
+	{
+		socket.m_descriptor = -1;
+		socket.m_mapping = nullptr;
+		socket.m_segment = nullptr;
+	}
+
+	SharedMemorySocket& SharedMemorySocket::operator=(SharedMemorySocket&& socket)
+	{
+		if(this == &socket)
+			return *this;
+		close();
+		m_descriptor = socket.m_descriptor;
+		m_mapping = socket.m_mapping;
+		m_mappingSize = socket.m_mappingSize;
+		m_segment = socket.m_segment;
+		m_sendRing = socket.m_sendRing;
+		m_receiveRing = socket.m_receiveRing;
+		m_sendData = socket.m_sendData;
+		m_receiveData = socket.m_receiveData;
+		m_capacity = socket.m_capacity;
+		m_spinCount = socket.m_spinCount;
+		socket.m_descriptor = -1;
+		socket.m_mapping = nullptr;
+		socket.m_segment = nullptr;
+		return *this;
+	}
+
+	SharedMemorySocket::~SharedMemorySocket()
+	{
+		if(isValid())
+			close();
+	}
+
+	bool SharedMemorySocket::map(int descriptor, bool isCreator, u32 spinCount)
+	{
+#ifdef PLATFORM_LINUX
+		struct stat status;
+		if((fstat(descriptor, &status) != 0) || (static_cast<u64>(status.st_size) <= HeaderSize))
+			return false;
+		const u64 mappingSize = static_cast<u64>(status.st_size);
+		void* mapping = mmap(NULL, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+		if(mapping == MAP_FAILED)
+			return false;
+		SharedMemorySegment* segment = static_cast<SharedMemorySegment*>(mapping);
+		if(isCreator)
+		{
+			segment->magic = SegmentMagic;
+			segment->version = SegmentVersion;
+			segment->capacity = static_cast<u32>((mappingSize - HeaderSize) / 2);
+		}
+		// The descriptor comes from another process, don't trust its size
+		const u64 capacity = segment->capacity;
+		if((segment->magic != SegmentMagic) || (segment->version != SegmentVersion) || !std::has_single_bit(capacity)
+			|| (mappingSize != (HeaderSize + capacity * 2)))
+		{
+			munmap(mapping, mappingSize);
+			return false;
+		}
+
+		u8* data = static_cast<u8*>(mapping) + HeaderSize;
+		m_descriptor = descriptor;
+		m_mapping = mapping;
+		m_mappingSize = mappingSize;
+		m_segment = segment;
+		m_sendRing = &segment->rings[isCreator ? 0 : 1];
+		m_receiveRing = &segment->rings[isCreator ? 1 : 0];
+		m_sendData = data + (isCreator ? 0 : capacity);
+		m_receiveData = data + (isCreator ? capacity : 0);
+		m_capacity = static_cast<u32>(capacity);
+		// Spinning only helps if the peer runs meanwhile, on another core
+		m_spinCount = (std::thread::hardware_concurrency() == 1) ? 0 : spinCount;
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	std::optional<SharedMemorySocket> SharedMemorySocket::Create(const SharedMemorySocketOptions& options)
+	{
+#ifdef PLATFORM_LINUX
+		if((options.capacity == 0) || (options.capacity > (1u << 31)))
+			return { };
+		const u64 capacity = std::bit_ceil(options.capacity);
+		int descriptor = memfd_create("netsocket_shm", MFD_CLOEXEC);
+		if(descriptor < 0)
+			return { };
+		SharedMemorySocket socket;
+		if((ftruncate(descriptor, static_cast<off_t>(HeaderSize + capacity * 2)) != 0) || !socket.map(descriptor, true, options.spinCount))
+		{
+			::close(descriptor);
+			return { };
+		}
+		return { std::move(socket) };
+#else
+		return { };
+#endif
+	}
+
+	std::optional<SharedMemorySocket> SharedMemorySocket::Open(int descriptor, const SharedMemorySocketOptions& options)
+	{
+#ifdef PLATFORM_LINUX
+		SharedMemorySocket socket;
+		if(!socket.map(descriptor, false, options.spinCount))
+		{
+			::close(descriptor);
+			return { };
+		}
+		return { std::move(socket) };
+#else
+		return { };
+#endif
+	}
+
+	std::optional<std::pair<SharedMemorySocket, SharedMemorySocket>> SharedMemorySocket::CreatePair(const SharedMemorySocketOptions& options)
+	{
+#ifdef PLATFORM_LINUX
+		std::optional<SharedMemorySocket> creator = Create(options);
+		if(!creator)
+			return { };
+		const int descriptor = fcntl(creator->getDescriptor(), F_DUPFD_CLOEXEC, 0);
+		if(descriptor < 0)
+			return { };
+		std::optional<SharedMemorySocket> opener = Open(descriptor, options);
+		if(!opener)
+			return { };
+		return { std::pair<SharedMemorySocket, SharedMemorySocket> { std::move(*creator), std::move(*opener) } };
+#else
+		return { };
+#endif
+	}
+
+	std::optional<SharedMemorySocket> SharedMemorySocket::Connect(Socket& unixSocket, const SharedMemorySocketOptions& options)
+	{
+		std::optional<SharedMemorySocket> socket = Create(options);
+		if(!socket)
+			return { };
+		const int descriptor = socket->getDescriptor();
+		if(unixSocket.sendFileDescriptors(&descriptor, 1) != Result::Success)
+			return { };
+		return socket;
+	}
+
+	std::optional<SharedMemorySocket> SharedMemorySocket::Accept(Socket& unixSocket, const SharedMemorySocketOptions& options)
+	{
+		std::vector<int> descriptors;
+		if(unixSocket.receiveFileDescriptors(descriptors) != Result::Success)
+			return { };
+		if(descriptors.size() != 1)
+		{
+#ifdef PLATFORM_LINUX
+			for(int descriptor : descriptors)
+				::close(descriptor);
+#endif
+			return { };
+		}
+		return Open(descriptors[0], options);
+	}
+
+	bool SharedMemorySocket::isConnected() const noexcept
+	{
+		SharedMemoryCallGuard guard(m_receiveCallCount, m_isClosing);
+		return guard.isEntered() && isValid() && (m_segment->isClosed.load(std::memory_order_acquire) == 0);
+	}
+
+	u32 SharedMemorySocket::getCapacity() const noexcept
+	{
+		return isValid() ? m_capacity : 0;
+	}
+
+	Result SharedMemorySocket::close()
+	{
+		if(!isValid())
+			return Result::Failed;
+		m_isClosing.store(true);
+		m_segment->isClosed.store(1, std::memory_order_release);
+		// Whoever sleeps, on either side, has to notice
+		for(SharedMemoryRing& ring : m_segment->rings)
+		{
+			Signal(ring.dataSignal, INT_MAX);
+			Signal(ring.spaceSignal, INT_MAX);
+		}
+		// The calls in flight on this socket return as soon as they notice
+		while((m_sendCallCount.load() != 0) || (m_receiveCallCount.load() != 0))
+			std::this_thread::yield();
+#ifdef PLATFORM_LINUX
+		munmap(m_mapping, m_mappingSize);
+		::close(m_descriptor);
+#endif
+		m_descriptor = -1;
+		m_mapping = nullptr;
+		m_segment = nullptr;
+		m_isClosing.store(false);
+		return Result::Success;
+	}
+
+	bool SharedMemorySocket::waitForData(s32 timeout)
+	{
+		using Clock = std::chrono::steady_clock;
+		const Clock::time_point deadline = (timeout < 0) ? Clock::time_point::max() : (Clock::now() + std::chrono::milliseconds(timeout));
+		for(u32 i = 0; ; ++i)
+		{
+			if(m_receiveRing->head.load(std::memory_order_acquire) != m_receiveRing->tail.load(std::memory_order_relaxed))
+				return true;
+			// What was sent before closing is still there
+			if(m_segment->isClosed.load(std::memory_order_acquire) != 0)
+				return m_receiveRing->head.load(std::memory_order_acquire) != m_receiveRing->tail.load(std::memory_order_relaxed);
+			if((m_spinCount == SharedMemorySocketOptions::NeverSleep) || (i < m_spinCount))
+			{
+				if((timeout >= 0) && ((i & 0xFF) == 0xFF) && (Clock::now() >= deadline))
+					return false;
+				CpuRelax();
+				continue;
+			}
+
+			s32 remaining = -1;
+			if(timeout >= 0)
+			{
+				remaining = static_cast<s32>(std::chrono::ceil<std::chrono::milliseconds>(deadline - Clock::now()).count());
+				if(remaining <= 0)
+					return false;
+			}
+			// Announces the sleep, then checks again: the producer either sees the flag or its data is seen here (both sides fence)
+			const u32 signal = m_receiveRing->dataSignal.load(std::memory_order_acquire);
+			m_receiveRing->isConsumerSleeping.store(1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if((m_receiveRing->head.load(std::memory_order_relaxed) == m_receiveRing->tail.load(std::memory_order_relaxed))
+				&& (m_segment->isClosed.load(std::memory_order_relaxed) == 0))
+				FutexWait(m_receiveRing->dataSignal, signal, remaining);
+			m_receiveRing->isConsumerSleeping.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	bool SharedMemorySocket::waitForSpace()
+	{
+		const u64 capacity = m_capacity;
+		const u64 head = m_sendRing->head.load(std::memory_order_relaxed);
+		for(u32 i = 0; ; ++i)
+		{
+			if(m_segment->isClosed.load(std::memory_order_acquire) != 0)
+				return false;
+			if((head - m_sendRing->tail.load(std::memory_order_acquire)) < capacity)
+				return true;
+			if((m_spinCount == SharedMemorySocketOptions::NeverSleep) || (i < m_spinCount))
+			{
+				CpuRelax();
+				continue;
+			}
+
+			const u32 signal = m_sendRing->spaceSignal.load(std::memory_order_acquire);
+			m_sendRing->isProducerSleeping.store(1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if(((head - m_sendRing->tail.load(std::memory_order_relaxed)) == capacity) && (m_segment->isClosed.load(std::memory_order_relaxed) == 0))
+				FutexWait(m_sendRing->spaceSignal, signal, -1);
+			m_sendRing->isProducerSleeping.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	Result SharedMemorySocket::send(const u8* bytes, u32 size)
+	{
+		SharedMemoryCallGuard guard(m_sendCallCount, m_isClosing);
+		if(!guard.isEntered() || !isValid())
+			return Result::SocketError;
+		const u64 capacity = m_capacity;
+		u32 sentSize = 0;
+		while(sentSize < size)
+		{
+			if(!waitForSpace())
+				return Result::SocketError;
+			const u64 head = m_sendRing->head.load(std::memory_order_relaxed);
+			const u64 freeSize = capacity - (head - m_sendRing->tail.load(std::memory_order_acquire));
+			const u64 chunkSize = std::min<u64>(size - sentSize, freeSize);
+			CopyToRing(m_sendData, capacity, head, bytes + sentSize, chunkSize);
+			m_sendRing->head.store(head + chunkSize, std::memory_order_release);
+			sentSize += static_cast<u32>(chunkSize);
+
+			// Pairs with the fence in waitForData()
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if(m_sendRing->isConsumerSleeping.load(std::memory_order_relaxed) != 0)
+				Signal(m_sendRing->dataSignal, 1);
+		}
+		return Result::Success;
+	}
+
+	std::optional<u32> SharedMemorySocket::receiveSome(u8* bytes, u32 size)
+	{
+		SharedMemoryCallGuard guard(m_receiveCallCount, m_isClosing);
+		if(!guard.isEntered() || !isValid() || !waitForData(-1))
+			return { };
+		const u64 capacity = m_capacity;
+		const u64 tail = m_receiveRing->tail.load(std::memory_order_relaxed);
+		const u64 chunkSize = std::min<u64>(size, m_receiveRing->head.load(std::memory_order_acquire) - tail);
+		CopyFromRing(m_receiveData, capacity, tail, bytes, chunkSize);
+		m_receiveRing->tail.store(tail + chunkSize, std::memory_order_release);
+
+		// Pairs with the fence in waitForSpace()
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if(m_receiveRing->isProducerSleeping.load(std::memory_order_relaxed) != 0)
+			Signal(m_receiveRing->spaceSignal, 1);
+		return { static_cast<u32>(chunkSize) };
+	}
+
+	Result SharedMemorySocket::receive(u8* bytes, u32 size)
+	{
+		u32 receivedSize = 0;
+		while(receivedSize < size)
+		{
+			std::optional<u32> result = receiveSome(bytes + receivedSize, size - receivedSize);
+			if(!result)
+				return Result::SocketError;
+			receivedSize += *result;
+		}
+		return Result::Success;
+	}
+
+	bool SharedMemorySocket::waitReadable(s32 timeout)
+	{
+		SharedMemoryCallGuard guard(m_receiveCallCount, m_isClosing);
+		return guard.isEntered() && isValid() && waitForData(timeout);
+	}
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <common/defines.hpp>
+
+#include <string>
+#include <filesystem>
+
+// The shared memory demo sets up its segment over this Unix domain socket
+static std::string GetShmTestPath()
+{
+	return (std::filesystem::temp_directory_path() / "netsocket_shm_test.sock").string();
+}
+
+// Round trips of one u64, over the Unix domain socket and then over shared memory
+static constexpr u32 gShmRoundTripCount = 10000;
+// Streamed through a smaller ring, so that it wraps around and the sender waits for room
+static constexpr u32 gShmBulkSize = 64 * 1024 * 1024 + 7;
+static constexpr u32 gShmRingCapacity = 256 * 1024;
+static constexpr u32 gShmChunkSize = 100 * 1000;
+
+static u8 GetShmTestByte(u32 index)
+{
+	return static_cast<u8>((index * 13 + 5) & 0xFF);
+}
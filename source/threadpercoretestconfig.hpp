@@ -0,0 +1,16 @@
+#pragma once
+
+#include <common/defines.hpp>
+
+#include <string_view>
+
+// The coroutine handlers are served on the first port, the callbacks on the second one
+static constexpr std::string_view gCoroutinePortNumber = "8000";
+static constexpr std::string_view gCallbackPortNumber = "8001";
+// More shards than cores is fine, there are just several event loops per core then
+static constexpr u32 gServerShardCount = 4;
+// Connections per port, all of them open at the same time
+static constexpr u32 gServerConnectionCount = 8;
+// Echo round trips per connection, each with a message of gServerMessageSize bytes
+static constexpr u32 gServerRequestCount = 200;
+static constexpr u32 gServerMessageSize = 256;
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <common/defines.hpp>
+
+#include <string_view>
+
+static constexpr std::string_view gTimeoutPortNumber = "8000";
+// Milliseconds without anything received or sent after which the server drops a connection
+static constexpr u32 gServerIdleTimeout = 800;
+// The active connection sends a message this often, well within the idle timeout, for longer than the idle timeout in total
+static constexpr u32 gActiveMessageInterval = 200;
+static constexpr u32 gActiveMessageCount = 10;
+static constexpr u32 gTimeoutMessageSize = 64;
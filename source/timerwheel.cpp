@@ -0,0 +1,256 @@
+#include <netsocket/timerwheel.hpp>
+#include <netsocket/assert.hpp>
+
+#include <algorithm> // for std::max, std::clamp
+#include <bit> // for std::countr_zero
+#include <limits>
+
+namespace netsocket
+{
+	// The timer whose callback advance() is running (repeating timers only, one-shot timers are released before their callback runs)
+	static constexpr u32 gRunningSlot = U32_MAX - 1;
+
+	TimerWheel::TimerWheel(u32 tickDuration) : m_startTime(std::chrono::steady_clock::now()),
+												m_currentTick(0),
+												m_tickDuration(std::max(tickDuration, 1u)),
+												m_timerCount(0)
+	{
+		m_slots.fill(InvalidIndex);
+		m_occupiedSlots.fill(0);
+	}
+
+	u32 TimerWheel::allocate()
+	{
+		if(!m_freeTimers.empty())
+		{
+			u32 index = m_freeTimers.back();
+			m_freeTimers.pop_back();
+			return index;
+		}
+		m_timers.push_back({ { }, 0, 0, 1, InvalidIndex, InvalidIndex, InvalidIndex });
+		return static_cast<u32>(m_timers.size() - 1);
+	}
+
+	void TimerWheel::release(u32 index)
+	{
+		Timer& timer = m_timers[index];
+		timer.callback = nullptr;
+		timer.slot = InvalidIndex;
+		// 0 would make InvalidTimerId a valid identifier
+		timer.generation = (timer.generation == U32_MAX) ? 1 : (timer.generation + 1);
+		m_freeTimers.push_back(index);
+		--m_timerCount;
+	}
+
+	void TimerWheel::link(u32 index, u32 slot)
+	{
+		Timer& timer = m_timers[index];
+		timer.previous = InvalidIndex;
+		timer.next = m_slots[slot];
+		if(timer.next != InvalidIndex)
+			m_timers[timer.next].previous = index;
+		m_slots[slot] = index;
+		timer.slot = slot;
+		if(slot < SlotCount)
+			m_occupiedSlots[slot / 64] |= u64(1) << (slot % 64);
+	}
+
+	void TimerWheel::unlink(u32 index)
+	{
+		Timer& timer = m_timers[index];
+		if(timer.previous != InvalidIndex)
+			m_timers[timer.previous].next = timer.next;
+		else
+			m_slots[timer.slot] = timer.next;
+		if(timer.next != InvalidIndex)
+			m_timers[timer.next].previous = timer.previous;
+		if((timer.slot < SlotCount) && (m_slots[timer.slot] == InvalidIndex))
+			m_occupiedSlots[timer.slot / 64] &= ~(u64(1) << (timer.slot % 64));
+		timer.slot = InvalidIndex;
+	}
+
+	void TimerWheel::insert(u32 index)
+	{
+		const u64 expiry = m_timers[index].expiry;
+		const u64 delta = (expiry > m_currentTick) ? (expiry - m_currentTick) : 0;
+		u32 level = 0;
+		while((level < (LevelCount - 1)) && (delta >= (u64(1) << (SlotBits * (level + 1)))))
+			++level;
+		link(index, level * SlotCount + static_cast<u32>((expiry >> (SlotBits * level)) & (SlotCount - 1)));
+	}
+
+	void TimerWheel::cascade(u32 level)
+	{
+		const u32 slot = level * SlotCount + static_cast<u32>((m_currentTick >> (SlotBits * level)) & (SlotCount - 1));
+		u32 index = m_slots[slot];
+		m_slots[slot] = InvalidIndex;
+		while(index != InvalidIndex)
+		{
+			const u32 next = m_timers[index].next;
+			insert(index);
+			index = next;
+		}
+	}
+
+	u32 TimerWheel::fire()
+	{
+		// The whole slot moves to FiringSlot first: callbacks may cancel timers of the same slot, or schedule new ones into it
+		const u32 slot = static_cast<u32>(m_currentTick & (SlotCount - 1));
+		m_slots[FiringSlot] = m_slots[slot];
+		m_slots[slot] = InvalidIndex;
+		m_occupiedSlots[slot / 64] &= ~(u64(1) << (slot % 64));
+		for(u32 index = m_slots[FiringSlot]; index != InvalidIndex; index = m_timers[index].next)
+			m_timers[index].slot = FiringSlot;
+
+		u32 firedCount = 0;
+		while(m_slots[FiringSlot] != InvalidIndex)
+		{
+			const u32 index = m_slots[FiringSlot];
+			unlink(index);
+			Timer& timer = m_timers[index];
+			netsocket_assert(timer.expiry == m_currentTick);
+			Callback callback = std::move(timer.callback);
+			++firedCount;
+			if(timer.interval == 0)
+			{
+				release(index);
+				callback();
+				continue;
+			}
+			const u32 generation = timer.generation;
+			timer.slot = gRunningSlot;
+			// The callback may reschedule it
+			timer.expiry = m_currentTick + timer.interval;
+			callback();
+			// Not cancelled by its own callback
+			Timer& repeatingTimer = m_timers[index];
+			if(repeatingTimer.generation == generation)
+			{
+				repeatingTimer.callback = std::move(callback);
+				insert(index);
+			}
+		}
+		return firedCount;
+	}
+
+	u32 TimerWheel::getTimerIndex(TimerId id) const noexcept
+	{
+		const u64 index = (id & U32_MAX) - 1;
+		if((id == InvalidTimerId) || (index >= m_timers.size()))
+			return InvalidIndex;
+		const Timer& timer = m_timers[index];
+		if((timer.generation != (id >> 32)) || (timer.slot == InvalidIndex))
+			return InvalidIndex;
+		return static_cast<u32>(index);
+	}
+
+	TimerWheel::TimerId TimerWheel::schedule(u32 delay, u32 interval, Callback&& callback)
+	{
+		netsocket_assert(callback && "A callback is required");
+		const u32 index = allocate();
+		Timer& timer = m_timers[index];
+		timer.callback = std::move(callback);
+		// Rounded up, a timer never fires early
+		timer.expiry = m_currentTick + std::max<u64>((u64(delay) + m_tickDuration - 1) / m_tickDuration, 1);
+		timer.interval = (interval == 0) ? 0 : std::max((interval + m_tickDuration - 1) / m_tickDuration, 1u);
+		++m_timerCount;
+		insert(index);
+		return (u64(timer.generation) << 32) | (index + 1);
+	}
+
+	TimerWheel::TimerId TimerWheel::schedule(u32 delay, Callback callback)
+	{
+		return schedule(delay, 0, std::move(callback));
+	}
+
+	TimerWheel::TimerId TimerWheel::scheduleRepeating(u32 interval, Callback callback)
+	{
+		return schedule(interval, interval, std::move(callback));
+	}
+
+	bool TimerWheel::cancel(TimerId id)
+	{
+		const u32 index = getTimerIndex(id);
+		if(index == InvalidIndex)
+			return false;
+		Timer& timer = m_timers[index];
+		if(timer.slot == gRunningSlot)
+		{
+			// fire() sees the new generation and drops the callback once it returns
+			timer.generation = (timer.generation == U32_MAX) ? 1 : (timer.generation + 1);
+			timer.slot = InvalidIndex;
+			m_freeTimers.push_back(index);
+			--m_timerCount;
+			return true;
+		}
+		unlink(index);
+		release(index);
+		return true;
+	}
+
+	bool TimerWheel::reschedule(TimerId id, u32 delay)
+	{
+		const u32 index = getTimerIndex(id);
+		if(index == InvalidIndex)
+			return false;
+		Timer& timer = m_timers[index];
+		timer.expiry = m_currentTick + std::max<u64>((u64(delay) + m_tickDuration - 1) / m_tickDuration, 1);
+		// A repeating timer rescheduled from its own callback is inserted again once the callback returns
+		if(timer.slot == gRunningSlot)
+			return true;
+		unlink(index);
+		insert(index);
+		return true;
+	}
+
+	u32 TimerWheel::advance()
+	{
+		return advance(std::chrono::steady_clock::now());
+	}
+
+	u32 TimerWheel::advance(std::chrono::steady_clock::time_point now)
+	{
+		const u64 elapsed = static_cast<u64>(std::max<s64>(std::chrono::duration_cast<std::chrono::milliseconds>(now - m_startTime).count(), 0));
+		const u64 targetTick = elapsed / m_tickDuration;
+		u32 firedCount = 0;
+		while(m_currentTick < targetTick)
+		{
+			if(m_timerCount == 0)
+			{
+				m_currentTick = targetTick;
+				break;
+			}
+			++m_currentTick;
+			// Once a level has gone round, the next slot of the level above comes down
+			for(u32 level = 1; level < LevelCount; ++level)
+			{
+				if(((m_currentTick >> (SlotBits * (level - 1))) & (SlotCount - 1)) != 0)
+					break;
+				cascade(level);
+			}
+			firedCount += fire();
+		}
+		return firedCount;
+	}
+
+	s32 TimerWheel::getTimeout() const
+	{
+		if(m_timerCount == 0)
+			return -1;
+		// The next occupied slot of the first level, or the next cascade if there is none before it
+		const u32 currentSlot = static_cast<u32>(m_currentTick & (SlotCount - 1));
+		u32 tickCount = SlotCount - currentSlot;
+		for(u32 slot = currentSlot + 1; slot < SlotCount; slot = (slot / 64 + 1) * 64)
+		{
+			const u64 word = m_occupiedSlots[slot / 64] & (~u64(0) << (slot % 64));
+			if(word != 0)
+			{
+				tickCount = (slot / 64) * 64 + static_cast<u32>(std::countr_zero(word)) - currentSlot;
+				break;
+			}
+		}
+		const s64 expiry = static_cast<s64>((m_currentTick + tickCount) * m_tickDuration);
+		const s64 elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_startTime).count();
+		return static_cast<s32>(std::clamp<s64>(expiry - elapsed, 0, std::numeric_limits<s32>::max()));
+	}
+}
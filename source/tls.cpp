@@ -0,0 +1,927 @@
+#include <netsocket/tls.hpp>
+#include <netsocket/assert.hpp>
+#include <common/platform.h>
+
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <mbedtls/version.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/ssl_cache.h>
+#include <mbedtls/ssl_ticket.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/x509_crt.h>
+#include <mbedtls/pk.h>
+#include <mbedtls/net_sockets.h> // for MBEDTLS_ERR_NET_SEND_FAILED, MBEDTLS_ERR_NET_RECV_FAILED
+#include <mbedtls/error.h> // for mbedtls_strerror
+#include <mbedtls/platform_util.h> // for mbedtls_platform_zeroize
+#if MBEDTLS_VERSION_MAJOR >= 3
+#	include <psa/crypto.h> // for psa_crypto_init
+#endif
+
+#ifdef PLATFORM_WINDOWS
+#	include <ws2tcpip.h>
+#else
+#	include <sys/socket.h>
+#	include <netdb.h> // for getnameinfo
+#	include <errno.h>
+#endif
+
+// Kernel TLS needs the TLS 1.2 master secret and randoms, which mbedtls 2.x only exports when built with MBEDTLS_SSL_EXPORT_KEYS
+#if defined(PLATFORM_LINUX) && ((MBEDTLS_VERSION_MAJOR >= 3) || defined(MBEDTLS_SSL_EXPORT_KEYS)) && __has_include(<linux/tls.h>)
+#	define NETSOCKET_KERNEL_TLS
+#	include <linux/tls.h>
+#	include <netinet/tcp.h> // for TCP_ULP
+#	ifndef SOL_TLS
+#		define SOL_TLS 282
+#	endif
+#	ifndef TCP_ULP
+#		define TCP_ULP 31
+#	endif
+#endif
+
+#include <cstring> // for std::memcmp
+#include <cstdlib> // for std::getenv
+#include <algorithm> // for std::min
+#include <unordered_map>
+#include <iterator> // for std::prev
+#include <list>
+#include <vector>
+
+namespace netsocket
+{
+	struct TlsContextState
+	{
+		mbedtls_ssl_config config;
+		mbedtls_entropy_context entropy;
+		mbedtls_ctr_drbg_context ctrDrbg;
+		mbedtls_x509_crt certificateChain;
+		mbedtls_pk_context privateKey;
+		mbedtls_x509_crt trustedCertificates;
+		// Client: trustedCertificates holds the system's CA bundle, which setTrustedCertificates() replaces
+		bool isSystemTrust = false;
+		bool isTrustedCertificatesSet = false;
+		std::mutex trustMutex;
+		mbedtls_ssl_cache_context sessionCache;
+		mbedtls_ssl_ticket_context ticketContext;
+		// Zero-terminated list given to mbedtls_ssl_conf_ciphersuites(), which keeps pointing to it
+		std::vector<int> cipherSuites;
+		// mbedtls only locks these itself when built with MBEDTLS_THREADING_C
+		std::mutex randomMutex;
+		std::mutex sessionCacheMutex;
+		struct ClientSession
+		{
+			std::shared_ptr<mbedtls_ssl_session> session;
+			// Key in clientSessionOrder, so that forgetting the session removes it from there as well
+			std::list<std::string>::iterator orderIt;
+		};
+		// Client: last session established with each server, oldest first in clientSessionOrder
+		std::unordered_map<std::string, ClientSession> clientSessions;
+		std::list<std::string> clientSessionOrder;
+	};
+
+	// Set while a server handshake runs on this thread, so that the session cache callbacks can report a resumption
+	static thread_local bool* tIsSessionResumed = NULL;
+
+	struct TlsKeyMaterial
+	{
+		unsigned char masterSecret[48];
+		// Seed of the key expansion: server random followed by client random
+		unsigned char randoms[64];
+		mbedtls_tls_prf_types prfType;
+		bool isSet;
+
+		TlsKeyMaterial() : masterSecret { }, randoms { }, prfType(MBEDTLS_SSL_TLS_PRF_NONE), isSet(false) { }
+		~TlsKeyMaterial() { mbedtls_platform_zeroize(this, sizeof(*this)); }
+
+		void set(const unsigned char* secret, const unsigned char* clientRandom, const unsigned char* serverRandom, mbedtls_tls_prf_types type)
+		{
+			std::memcpy(masterSecret, secret, sizeof(masterSecret));
+			std::memcpy(randoms, serverRandom, 32);
+			std::memcpy(randoms + 32, clientRandom, 32);
+			prfType = type;
+			isSet = true;
+		}
+	};
+
+	static std::string GetTlsErrorString(int error)
+	{
+		char buffer[128];
+		mbedtls_strerror(error, buffer, sizeof(buffer));
+		return { buffer };
+	}
+
+	static int GenerateRandom(void* userData, unsigned char* output, size_t size)
+	{
+		TlsContextState* state = reinterpret_cast<TlsContextState*>(userData);
+		std::lock_guard<std::mutex> lock(state->randomMutex);
+		return mbedtls_ctr_drbg_random(&state->ctrDrbg, output, size);
+	}
+
+#if MBEDTLS_VERSION_MAJOR >= 3
+	static int GetCachedSession(void* userData, unsigned char const* sessionId, size_t sessionIdSize, mbedtls_ssl_session* session)
+	{
+		TlsContextState* state = reinterpret_cast<TlsContextState*>(userData);
+		std::lock_guard<std::mutex> lock(state->sessionCacheMutex);
+		int result = mbedtls_ssl_cache_get(&state->sessionCache, sessionId, sessionIdSize, session);
+		if((result == 0) && (tIsSessionResumed != NULL))
+			*tIsSessionResumed = true;
+		return result;
+	}
+
+	static int SetCachedSession(void* userData, unsigned char const* sessionId, size_t sessionIdSize, const mbedtls_ssl_session* session)
+	{
+		TlsContextState* state = reinterpret_cast<TlsContextState*>(userData);
+		std::lock_guard<std::mutex> lock(state->sessionCacheMutex);
+		return mbedtls_ssl_cache_set(&state->sessionCache, sessionId, sessionIdSize, session);
+	}
+#else
+	static int GetCachedSession(void* userData, mbedtls_ssl_session* session)
+	{
+		TlsContextState* state = reinterpret_cast<TlsContextState*>(userData);
+		std::lock_guard<std::mutex> lock(state->sessionCacheMutex);
+		int result = mbedtls_ssl_cache_get(&state->sessionCache, session);
+		if((result == 0) && (tIsSessionResumed != NULL))
+			*tIsSessionResumed = true;
+		return result;
+	}
+
+	static int SetCachedSession(void* userData, const mbedtls_ssl_session* session)
+	{
+		TlsContextState* state = reinterpret_cast<TlsContextState*>(userData);
+		std::lock_guard<std::mutex> lock(state->sessionCacheMutex);
+		return mbedtls_ssl_cache_set(&state->sessionCache, session);
+	}
+#endif
+
+	static int WriteSessionTicket(void* userData, const mbedtls_ssl_session* session, unsigned char* start, const unsigned char* end, size_t* size, uint32_t* lifetime)
+	{
+		TlsContextState* state = reinterpret_cast<TlsContextState*>(userData);
+		std::lock_guard<std::mutex> lock(state->sessionCacheMutex);
+		return mbedtls_ssl_ticket_write(&state->ticketContext, session, start, end, size, lifetime);
+	}
+
+	static int ParseSessionTicket(void* userData, mbedtls_ssl_session* session, unsigned char* bytes, size_t size)
+	{
+		TlsContextState* state = reinterpret_cast<TlsContextState*>(userData);
+		std::lock_guard<std::mutex> lock(state->sessionCacheMutex);
+		int result = mbedtls_ssl_ticket_parse(&state->ticketContext, session, bytes, size);
+		if((result == 0) && (tIsSessionResumed != NULL))
+			*tIsSessionResumed = true;
+		return result;
+	}
+
+	// mbedtls only recognizes PEM data if it is null-terminated, with the terminator counted in the size
+	static std::string GetParsableData(std::string_view data, std::size_t& size)
+	{
+		std::string str { data };
+		size = str.size() + ((data.find("-----BEGIN") != std::string_view::npos) ? 1 : 0);
+		return str;
+	}
+
+	static int ParsePrivateKey(mbedtls_pk_context* key, std::string_view data, std::string_view password, TlsContextState* state)
+	{
+		std::size_t size;
+		std::string str = GetParsableData(data, size);
+		const unsigned char* passwordBytes = password.empty() ? NULL : reinterpret_cast<const unsigned char*>(password.data());
+#if MBEDTLS_VERSION_MAJOR >= 3
+		return mbedtls_pk_parse_key(key, reinterpret_cast<const unsigned char*>(str.c_str()), size, passwordBytes, password.size(), GenerateRandom, state);
+#else
+		(void)state;
+		return mbedtls_pk_parse_key(key, reinterpret_cast<const unsigned char*>(str.c_str()), size, passwordBytes, password.size());
+#endif
+	}
+
+	static bool IsSocketWouldBlockError()
+	{
+#ifdef PLATFORM_WINDOWS
+		const int error = WSAGetLastError();
+		return (error == WSAEWOULDBLOCK) || (error == WSAEINTR);
+#else
+		return (errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR);
+#endif
+	}
+
+#ifdef MSG_NOSIGNAL
+	// Alerts and close_notify are often written to a peer which has already gone, which must fail rather than raise SIGPIPE
+	static constexpr int gSendFlags = MSG_NOSIGNAL;
+#else
+	static constexpr int gSendFlags = 0;
+#endif
+
+	// I/O callbacks of the record layer, 'userData' points to TlsConnection::m_socket
+	static int SendCallback(void* userData, const unsigned char* bytes, size_t size)
+	{
+		const SocketHandle socket = *reinterpret_cast<const SocketHandle*>(userData);
+		int result = ::send(socket, reinterpret_cast<const char*>(bytes), static_cast<int>(size), gSendFlags);
+		if(result >= 0)
+			return result;
+		return IsSocketWouldBlockError() ? MBEDTLS_ERR_SSL_WANT_WRITE : MBEDTLS_ERR_NET_SEND_FAILED;
+	}
+
+	static int ReceiveCallback(void* userData, unsigned char* bytes, size_t size)
+	{
+		const SocketHandle socket = *reinterpret_cast<const SocketHandle*>(userData);
+		int result = ::recv(socket, reinterpret_cast<char*>(bytes), static_cast<int>(size), 0);
+		if(result >= 0)
+			return result;
+		return IsSocketWouldBlockError() ? MBEDTLS_ERR_SSL_WANT_READ : MBEDTLS_ERR_NET_RECV_FAILED;
+	}
+
+#ifdef NETSOCKET_KERNEL_TLS
+#	if MBEDTLS_VERSION_MAJOR >= 3
+	static void ExportKeys(void* userData, mbedtls_ssl_key_export_type type, const unsigned char* secret, size_t secretSize,
+							const unsigned char clientRandom[32], const unsigned char serverRandom[32], mbedtls_tls_prf_types prfType)
+	{
+		if((type == MBEDTLS_SSL_KEY_EXPORT_TLS12_MASTER_SECRET) && (secretSize == sizeof(TlsKeyMaterial::masterSecret)))
+			reinterpret_cast<TlsKeyMaterial*>(userData)->set(secret, clientRandom, serverRandom, prfType);
+	}
+#	else
+	// mbedtls 2.x only has a callback per configuration, shared by all the connections: this points to the one whose handshake runs on this thread
+	static thread_local TlsKeyMaterial* tKeyMaterial = NULL;
+
+	static int ExportKeys(void*, const unsigned char* masterSecret, const unsigned char*, size_t, size_t, size_t,
+							const unsigned char clientRandom[32], const unsigned char serverRandom[32], mbedtls_tls_prf_types prfType)
+	{
+		if(tKeyMaterial != NULL)
+			tKeyMaterial->set(masterSecret, clientRandom, serverRandom, prfType);
+		return 0;
+	}
+#	endif
+
+	// TLS 1.2 AEAD cipher suites the kernel implements, the MAC key size is 0 for all of them
+	struct KernelCipher
+	{
+		std::string_view name;
+		u16 type;
+		u32 keySize;
+		// Implicit part of the nonce (client_write_IV/server_write_IV)
+		u32 fixedIVSize;
+	};
+
+	static const KernelCipher gKernelCiphers[] =
+	{
+		{ "AES-128-GCM", TLS_CIPHER_AES_GCM_128, TLS_CIPHER_AES_GCM_128_KEY_SIZE, TLS_CIPHER_AES_GCM_128_SALT_SIZE },
+		{ "AES-256-GCM", TLS_CIPHER_AES_GCM_256, TLS_CIPHER_AES_GCM_256_KEY_SIZE, TLS_CIPHER_AES_GCM_256_SALT_SIZE },
+#	ifdef TLS_CIPHER_CHACHA20_POLY1305
+		{ "CHACHA20-POLY1305", TLS_CIPHER_CHACHA20_POLY1305, TLS_CIPHER_CHACHA20_POLY1305_KEY_SIZE, TLS_CIPHER_CHACHA20_POLY1305_IV_SIZE }
+#	endif
+	};
+
+	static const KernelCipher* FindKernelCipher(std::string_view cipherSuite)
+	{
+		for(const KernelCipher& cipher : gKernelCiphers)
+			if(cipherSuite.find(cipher.name) != std::string_view::npos)
+				return &cipher;
+		return NULL;
+	}
+
+	// Installs the keys of one direction (TLS_TX or TLS_RX), 'CryptoInfo' is the tls12_crypto_info_* struct of the cipher
+	template<typename CryptoInfo>
+	static bool SetKernelKeys(SocketHandle socket, int direction, const KernelCipher& cipher, const unsigned char* key, const unsigned char* fixedIV, u64 sequenceNumber)
+	{
+		CryptoInfo info = { };
+		info.info.version = TLS_1_2_VERSION;
+		info.info.cipher_type = cipher.type;
+		std::memcpy(info.key, key, sizeof(info.key));
+		for(u32 i = 0; i < sizeof(info.rec_seq); ++i)
+			info.rec_seq[i] = static_cast<unsigned char>(sequenceNumber >> (8 * (sizeof(info.rec_seq) - 1 - i)));
+		if constexpr (sizeof(info.salt) > 0)
+		{
+			// AES-GCM: the fixed IV is the salt, the explicit part of the nonce follows the sequence number as mbedtls does
+			std::memcpy(info.salt, fixedIV, sizeof(info.salt));
+			std::memcpy(info.iv, info.rec_seq, sizeof(info.iv));
+		}
+		else
+			std::memcpy(info.iv, fixedIV, sizeof(info.iv));
+		const bool isSet = setsockopt(socket, SOL_TLS, direction, &info, sizeof(info)) == 0;
+		mbedtls_platform_zeroize(&info, sizeof(info));
+		return isSet;
+	}
+
+	static bool SetKernelKeys(SocketHandle socket, int direction, const KernelCipher& cipher, const unsigned char* key, const unsigned char* fixedIV, u64 sequenceNumber)
+	{
+		switch(cipher.type)
+		{
+			case TLS_CIPHER_AES_GCM_128: return SetKernelKeys<tls12_crypto_info_aes_gcm_128>(socket, direction, cipher, key, fixedIV, sequenceNumber);
+			case TLS_CIPHER_AES_GCM_256: return SetKernelKeys<tls12_crypto_info_aes_gcm_256>(socket, direction, cipher, key, fixedIV, sequenceNumber);
+#	ifdef TLS_CIPHER_CHACHA20_POLY1305
+			case TLS_CIPHER_CHACHA20_POLY1305: return SetKernelKeys<tls12_crypto_info_chacha20_poly1305>(socket, direction, cipher, key, fixedIV, sequenceNumber);
+#	endif
+			default: return false;
+		}
+	}
+
+	// A record which isn't application data (an alert, or a handshake message) is returned on its own, its type in a control message:
+	// recv() would fail with EIO instead
+	static int ReceiveKernel(SocketHandle socket, u8* bytes, u32 size)
+	{
+		struct iovec buffer = { bytes, size };
+		char control[CMSG_SPACE(sizeof(unsigned char))] = { };
+		struct msghdr message = { };
+		message.msg_iov = &buffer;
+		message.msg_iovlen = 1;
+		message.msg_control = control;
+		message.msg_controllen = sizeof(control);
+		ssize_t result = ::recvmsg(socket, &message, 0);
+		if(result < 0)
+			return IsSocketWouldBlockError() ? TlsConnection::WantRead : -1;
+		struct cmsghdr* header = CMSG_FIRSTHDR(&message);
+		if((header != NULL) && (header->cmsg_level == SOL_TLS) && (header->cmsg_type == TLS_GET_RECORD_TYPE))
+		{
+			static constexpr unsigned char applicationData = 23;
+			static constexpr unsigned char alert = 21;
+			const unsigned char recordType = *CMSG_DATA(header);
+			// close_notify, or a fatal alert: either way the peer is done
+			if(recordType == alert)
+				return 0;
+			if(recordType != applicationData)
+			{
+				spdlog::error("Unexpected TLS record of type {} after the handshake", recordType);
+				return -1;
+			}
+		}
+		return static_cast<int>(result);
+	}
+
+	static void SendKernelCloseNotify(SocketHandle socket)
+	{
+		static constexpr unsigned char alert = 21;
+		// Level warning, description close_notify
+		unsigned char closeNotify[2] = { 1, 0 };
+		struct iovec buffer = { closeNotify, sizeof(closeNotify) };
+		char control[CMSG_SPACE(sizeof(unsigned char))] = { };
+		struct msghdr message = { };
+		message.msg_iov = &buffer;
+		message.msg_iovlen = 1;
+		message.msg_control = control;
+		message.msg_controllen = sizeof(control);
+		struct cmsghdr* header = CMSG_FIRSTHDR(&message);
+		header->cmsg_level = SOL_TLS;
+		header->cmsg_type = TLS_SET_RECORD_TYPE;
+		header->cmsg_len = CMSG_LEN(sizeof(unsigned char));
+		*CMSG_DATA(header) = alert;
+		::sendmsg(socket, &message, MSG_DONTWAIT | gSendFlags);
+	}
+#endif // NETSOCKET_KERNEL_TLS
+
+	// Client session cache key: the server name (or address if there is none) and the port
+	static std::string GetSessionKey(SocketHandle socket, std::string_view serverName)
+	{
+		struct sockaddr_storage address = { };
+		socklen_t addressSize = sizeof(address);
+		char host[NI_MAXHOST] = { };
+		char port[NI_MAXSERV] = { };
+		if((getpeername(socket, reinterpret_cast<struct sockaddr*>(&address), &addressSize) != 0)
+			|| (getnameinfo(reinterpret_cast<struct sockaddr*>(&address), addressSize, host, sizeof(host), port, sizeof(port), NI_NUMERICHOST | NI_NUMERICSERV) != 0))
+			return { };
+		std::string key { serverName.empty() ? std::string_view { host } : serverName };
+		key.append(":");
+		key.append(port);
+		return key;
+	}
+
+	// Master secret of a session: a resumed session keeps the one of the session it resumes, a full handshake derives a new one
+	static bool IsSameMasterSecret(const mbedtls_ssl_session* session1, const mbedtls_ssl_session* session2)
+	{
+#if MBEDTLS_VERSION_MAJOR >= 3
+		return std::memcmp(session1->MBEDTLS_PRIVATE(master), session2->MBEDTLS_PRIVATE(master), sizeof(session1->MBEDTLS_PRIVATE(master))) == 0;
+#else
+		return std::memcmp(session1->master, session2->master, sizeof(session1->master)) == 0;
+#endif
+	}
+
+	// mbedtls 3 runs TLS 1.3 (and, depending on its configuration, parts of TLS 1.2) on the PSA crypto API,
+	// which has to be initialized once per process before the first handshake
+	static bool InitializePsaCrypto()
+	{
+#if MBEDTLS_VERSION_MAJOR >= 3
+		static const psa_status_t status = psa_crypto_init();
+		if(status != PSA_SUCCESS)
+		{
+			spdlog::error("psa_crypto_init failed, status: {}", static_cast<int>(status));
+			return false;
+		}
+#endif
+		return true;
+	}
+
+	TlsContext::TlsContext(TlsRole role, const TlsSessionCacheOptions& cacheOptions) : m_state(std::make_unique<TlsContextState>()), m_role(role), m_cacheOptions(cacheOptions), m_isKernelOffloadEnabled(false), m_isInsecureSkipVerify(false), m_isValid(false)
+	{
+		TlsContextState& state = *m_state;
+		mbedtls_ssl_config_init(&state.config);
+		mbedtls_entropy_init(&state.entropy);
+		mbedtls_ctr_drbg_init(&state.ctrDrbg);
+		mbedtls_x509_crt_init(&state.certificateChain);
+		mbedtls_pk_init(&state.privateKey);
+		mbedtls_x509_crt_init(&state.trustedCertificates);
+		mbedtls_ssl_cache_init(&state.sessionCache);
+		mbedtls_ssl_ticket_init(&state.ticketContext);
+		if(!InitializePsaCrypto())
+			return;
+
+		static constexpr std::string_view personalization = "netsocket";
+		int result = mbedtls_ctr_drbg_seed(&state.ctrDrbg, mbedtls_entropy_func, &state.entropy, reinterpret_cast<const unsigned char*>(personalization.data()), personalization.size());
+		if(result != 0)
+		{
+			spdlog::error("mbedtls_ctr_drbg_seed failed, error: {}", GetTlsErrorString(result));
+			return;
+		}
+		result = mbedtls_ssl_config_defaults(&state.config, (role == TlsRole::Server) ? MBEDTLS_SSL_IS_SERVER : MBEDTLS_SSL_IS_CLIENT,
+												MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+		if(result != 0)
+		{
+			spdlog::error("mbedtls_ssl_config_defaults failed, error: {}", GetTlsErrorString(result));
+			return;
+		}
+		mbedtls_ssl_conf_rng(&state.config, GenerateRandom, &state);
+		// A client always verifies the server, a server only asks for client certificates once trusted certificates are set
+		mbedtls_ssl_conf_authmode(&state.config, (role == TlsRole::Client) ? MBEDTLS_SSL_VERIFY_REQUIRED : MBEDTLS_SSL_VERIFY_NONE);
+
+		if(role == TlsRole::Server)
+		{
+			if(cacheOptions.maxEntries > 0)
+			{
+				mbedtls_ssl_cache_set_max_entries(&state.sessionCache, static_cast<int>(cacheOptions.maxEntries));
+				mbedtls_ssl_cache_set_timeout(&state.sessionCache, static_cast<int>(cacheOptions.timeout));
+				mbedtls_ssl_conf_session_cache(&state.config, &state, GetCachedSession, SetCachedSession);
+			}
+			if(cacheOptions.isTicketsEnabled)
+			{
+				result = mbedtls_ssl_ticket_setup(&state.ticketContext, GenerateRandom, &state, MBEDTLS_CIPHER_AES_256_GCM, cacheOptions.timeout);
+				if(result != 0)
+				{
+					spdlog::error("mbedtls_ssl_ticket_setup failed, error: {}", GetTlsErrorString(result));
+					return;
+				}
+				mbedtls_ssl_conf_session_tickets_cb(&state.config, WriteSessionTicket, ParseSessionTicket, &state);
+			}
+		}
+		else
+			mbedtls_ssl_conf_session_tickets(&state.config, cacheOptions.isTicketsEnabled ? MBEDTLS_SSL_SESSION_TICKETS_ENABLED : MBEDTLS_SSL_SESSION_TICKETS_DISABLED);
+		m_isValid = true;
+	}
+
+	TlsContext::~TlsContext()
+	{
+		TlsContextState& state = *m_state;
+		state.clientSessions.clear();
+		mbedtls_ssl_ticket_free(&state.ticketContext);
+		mbedtls_ssl_cache_free(&state.sessionCache);
+		mbedtls_x509_crt_free(&state.trustedCertificates);
+		mbedtls_pk_free(&state.privateKey);
+		mbedtls_x509_crt_free(&state.certificateChain);
+		mbedtls_ctr_drbg_free(&state.ctrDrbg);
+		mbedtls_entropy_free(&state.entropy);
+		mbedtls_ssl_config_free(&state.config);
+	}
+
+	Result TlsContext::setCertificate(std::string_view certificateChain, std::string_view privateKey, std::string_view privateKeyPassword)
+	{
+		std::size_t size;
+		std::string str = GetParsableData(certificateChain, size);
+		int result = mbedtls_x509_crt_parse(&m_state->certificateChain, reinterpret_cast<const unsigned char*>(str.c_str()), size);
+		if(result != 0)
+		{
+			spdlog::error("Failed to parse the certificate chain, error: {}", GetTlsErrorString(result));
+			return Result::Failed;
+		}
+		result = ParsePrivateKey(&m_state->privateKey, privateKey, privateKeyPassword, m_state.get());
+		if(result != 0)
+		{
+			spdlog::error("Failed to parse the private key, error: {}", GetTlsErrorString(result));
+			return Result::Failed;
+		}
+		result = mbedtls_ssl_conf_own_cert(&m_state->config, &m_state->certificateChain, &m_state->privateKey);
+		return (result == 0) ? Result::Success : Result::Failed;
+	}
+
+	Result TlsContext::loadCertificate(const std::string& certificateChainPath, const std::string& privateKeyPath, const std::string& privateKeyPassword)
+	{
+		int result = mbedtls_x509_crt_parse_file(&m_state->certificateChain, certificateChainPath.c_str());
+		if(result != 0)
+		{
+			spdlog::error("Failed to load the certificate chain {}, error: {}", certificateChainPath, GetTlsErrorString(result));
+			return Result::Failed;
+		}
+		const char* password = privateKeyPassword.empty() ? NULL : privateKeyPassword.c_str();
+#if MBEDTLS_VERSION_MAJOR >= 3
+		result = mbedtls_pk_parse_keyfile(&m_state->privateKey, privateKeyPath.c_str(), password, GenerateRandom, m_state.get());
+#else
+		result = mbedtls_pk_parse_keyfile(&m_state->privateKey, privateKeyPath.c_str(), password);
+#endif
+		if(result != 0)
+		{
+			spdlog::error("Failed to load the private key {}, error: {}", privateKeyPath, GetTlsErrorString(result));
+			return Result::Failed;
+		}
+		result = mbedtls_ssl_conf_own_cert(&m_state->config, &m_state->certificateChain, &m_state->privateKey);
+		return (result == 0) ? Result::Success : Result::Failed;
+	}
+
+	// The certificates being set replace the system's CA bundle
+	static void ReplaceSystemTrust(TlsContextState& state)
+	{
+		std::lock_guard<std::mutex> lock(state.trustMutex);
+		if(state.isSystemTrust)
+		{
+			mbedtls_x509_crt_free(&state.trustedCertificates);
+			mbedtls_x509_crt_init(&state.trustedCertificates);
+			state.isSystemTrust = false;
+		}
+		state.isTrustedCertificatesSet = true;
+	}
+
+	void TlsContext::loadDefaultTrustedCertificates()
+	{
+		TlsContextState& state = *m_state;
+		std::lock_guard<std::mutex> lock(state.trustMutex);
+		if(state.isTrustedCertificatesSet || m_isInsecureSkipVerify)
+			return;
+		state.isTrustedCertificatesSet = true;
+		// Debian/Ubuntu, Fedora/RHEL, OpenSUSE, Alpine/macOS
+		const char* paths[] = { std::getenv("SSL_CERT_FILE"), "/etc/ssl/certs/ca-certificates.crt", "/etc/pki/tls/certs/ca-bundle.crt",
+								"/etc/ssl/ca-bundle.pem", "/etc/ssl/cert.pem" };
+		for(const char* path : paths)
+		{
+			// A bundle with a few unparsable certificates is still usable (a positive result is the number of those), it fails if none parses
+			if((path != NULL) && (mbedtls_x509_crt_parse_file(&state.trustedCertificates, path) >= 0))
+			{
+				mbedtls_ssl_conf_ca_chain(&state.config, &state.trustedCertificates, NULL);
+				state.isSystemTrust = true;
+				return;
+			}
+		}
+		spdlog::warn("No CA bundle found, servers can't be verified until trusted certificates are set");
+	}
+
+	void TlsContext::setInsecureSkipVerify(bool isSkipped)
+	{
+		m_isInsecureSkipVerify = isSkipped;
+		if(m_role == TlsRole::Client)
+			mbedtls_ssl_conf_authmode(&m_state->config, isSkipped ? MBEDTLS_SSL_VERIFY_NONE : MBEDTLS_SSL_VERIFY_REQUIRED);
+	}
+
+	Result TlsContext::setTrustedCertificates(std::string_view certificates)
+	{
+		ReplaceSystemTrust(*m_state);
+		std::size_t size;
+		std::string str = GetParsableData(certificates, size);
+		int result = mbedtls_x509_crt_parse(&m_state->trustedCertificates, reinterpret_cast<const unsigned char*>(str.c_str()), size);
+		if(result != 0)
+		{
+			spdlog::error("Failed to parse the trusted certificates, error: {}", GetTlsErrorString(result));
+			return Result::Failed;
+		}
+		mbedtls_ssl_conf_ca_chain(&m_state->config, &m_state->trustedCertificates, NULL);
+		if(!m_isInsecureSkipVerify)
+			mbedtls_ssl_conf_authmode(&m_state->config, MBEDTLS_SSL_VERIFY_REQUIRED);
+		return Result::Success;
+	}
+
+	Result TlsContext::loadTrustedCertificates(const std::string& path)
+	{
+		ReplaceSystemTrust(*m_state);
+		int result = mbedtls_x509_crt_parse_file(&m_state->trustedCertificates, path.c_str());
+		if(result != 0)
+		{
+			spdlog::error("Failed to load the trusted certificates {}, error: {}", path, GetTlsErrorString(result));
+			return Result::Failed;
+		}
+		mbedtls_ssl_conf_ca_chain(&m_state->config, &m_state->trustedCertificates, NULL);
+		if(!m_isInsecureSkipVerify)
+			mbedtls_ssl_conf_authmode(&m_state->config, MBEDTLS_SSL_VERIFY_REQUIRED);
+		return Result::Success;
+	}
+
+	Result TlsContext::setCipherSuites(std::string_view names)
+	{
+		std::vector<int> cipherSuites;
+		while(!names.empty())
+		{
+			const std::size_t end = std::min(names.find_first_of(":, "), names.size());
+			if(end > 0)
+			{
+				std::string name { names.substr(0, end) };
+				const int id = mbedtls_ssl_get_ciphersuite_id(name.c_str());
+				if(id == 0)
+				{
+					spdlog::error("Unknown (or not compiled in) cipher suite: {}", name);
+					return Result::Failed;
+				}
+				cipherSuites.push_back(id);
+			}
+			names.remove_prefix(std::min(end + 1, names.size()));
+		}
+		if(cipherSuites.empty())
+			return Result::Failed;
+		cipherSuites.push_back(0);
+		m_state->cipherSuites = std::move(cipherSuites);
+		mbedtls_ssl_conf_ciphersuites(&m_state->config, m_state->cipherSuites.data());
+		return Result::Success;
+	}
+
+	void TlsContext::clearSessionCache()
+	{
+		std::lock_guard<std::mutex> lock(m_state->sessionCacheMutex);
+		m_state->clientSessions.clear();
+		m_state->clientSessionOrder.clear();
+		if((m_role == TlsRole::Server) && (m_cacheOptions.maxEntries > 0))
+		{
+			mbedtls_ssl_cache_free(&m_state->sessionCache);
+			mbedtls_ssl_cache_init(&m_state->sessionCache);
+			mbedtls_ssl_cache_set_max_entries(&m_state->sessionCache, static_cast<int>(m_cacheOptions.maxEntries));
+			mbedtls_ssl_cache_set_timeout(&m_state->sessionCache, static_cast<int>(m_cacheOptions.timeout));
+		}
+	}
+
+	Result TlsContext::setKernelOffload(bool isEnabled)
+	{
+#ifdef NETSOCKET_KERNEL_TLS
+#	if MBEDTLS_VERSION_MAJOR < 3
+		mbedtls_ssl_conf_export_keys_ext_cb(&m_state->config, isEnabled ? ExportKeys : NULL, NULL);
+#	elif defined(MBEDTLS_SSL_PROTO_TLS1_3)
+		// The kernel only takes TLS 1.2 keys, and peers which support TLS 1.3 would always negotiate it
+		mbedtls_ssl_conf_max_tls_version(&m_state->config, isEnabled ? MBEDTLS_SSL_VERSION_TLS1_2 : MBEDTLS_SSL_VERSION_TLS1_3);
+#	endif
+		m_isKernelOffloadEnabled = isEnabled;
+		return Result::Success;
+#else
+		if(isEnabled)
+		{
+			spdlog::warn("Kernel TLS offload isn't supported on this platform (or by this build of mbedtls)");
+			return Result::Failed;
+		}
+		return Result::Success;
+#endif
+	}
+
+	std::shared_ptr<mbedtls_ssl_session> TlsContext::findSession(const std::string& key)
+	{
+		std::lock_guard<std::mutex> lock(m_state->sessionCacheMutex);
+		auto it = m_state->clientSessions.find(key);
+		if(it == m_state->clientSessions.end())
+			return { };
+		return it->second.session;
+	}
+
+	void TlsContext::rememberSession(const std::string& key, std::shared_ptr<mbedtls_ssl_session> session)
+	{
+		std::lock_guard<std::mutex> lock(m_state->sessionCacheMutex);
+		auto it = m_state->clientSessions.find(key);
+		if(it != m_state->clientSessions.end())
+		{
+			it->second.session = std::move(session);
+			return;
+		}
+		while(!m_state->clientSessionOrder.empty() && (m_state->clientSessions.size() >= m_cacheOptions.maxEntries))
+		{
+			m_state->clientSessions.erase(m_state->clientSessionOrder.front());
+			m_state->clientSessionOrder.pop_front();
+		}
+		m_state->clientSessionOrder.push_back(key);
+		m_state->clientSessions.insert({ key, { std::move(session), std::prev(m_state->clientSessionOrder.end()) } });
+	}
+
+	void TlsContext::forgetSession(const std::string& key)
+	{
+		std::lock_guard<std::mutex> lock(m_state->sessionCacheMutex);
+		auto it = m_state->clientSessions.find(key);
+		if(it == m_state->clientSessions.end())
+			return;
+		m_state->clientSessionOrder.erase(it->second.orderIt);
+		m_state->clientSessions.erase(it);
+	}
+
+	TlsConnection::TlsConnection(const std::shared_ptr<TlsContext>& context, SocketHandle socket, std::string_view serverName) :
+																								m_context(context),
+																								m_ssl(std::make_unique<mbedtls_ssl_context>()),
+																								m_socket(socket),
+																								m_isHandshakeDone(false),
+																								m_isSessionResumed(false),
+																								m_isKernelTx(false),
+																								m_isKernelRx(false),
+																								m_isValid(false)
+	{
+		netsocket_assert(context && context->isValid());
+		if(context->getRole() == TlsRole::Client)
+			context->loadDefaultTrustedCertificates();
+		mbedtls_ssl_init(m_ssl.get());
+		int result = mbedtls_ssl_setup(m_ssl.get(), &context->m_state->config);
+		if(result != 0)
+		{
+			spdlog::error("mbedtls_ssl_setup failed, error: {}", GetTlsErrorString(result));
+			return;
+		}
+		mbedtls_ssl_set_bio(m_ssl.get(), &m_socket, SendCallback, ReceiveCallback, NULL);
+		if(context->isKernelOffloadEnabled())
+		{
+			m_keyMaterial = std::make_unique<TlsKeyMaterial>();
+#if defined(NETSOCKET_KERNEL_TLS) && (MBEDTLS_VERSION_MAJOR >= 3)
+			mbedtls_ssl_set_export_keys_cb(m_ssl.get(), ExportKeys, m_keyMaterial.get());
+#endif
+		}
+
+		if(context->getRole() == TlsRole::Client)
+		{
+			if(!serverName.empty())
+			{
+				std::string name { serverName };
+				result = mbedtls_ssl_set_hostname(m_ssl.get(), name.c_str());
+				if(result != 0)
+				{
+					spdlog::error("mbedtls_ssl_set_hostname failed, error: {}", GetTlsErrorString(result));
+					return;
+				}
+			}
+			if(context->getSessionCacheOptions().maxEntries > 0)
+			{
+				m_sessionKey = GetSessionKey(socket, serverName);
+				if(!m_sessionKey.empty())
+					m_offeredSession = context->findSession(m_sessionKey);
+				// A session the library refuses (e.g. expired) just means a full handshake
+				if(m_offeredSession && (mbedtls_ssl_set_session(m_ssl.get(), m_offeredSession.get()) != 0))
+					m_offeredSession.reset();
+			}
+		}
+		m_isValid = true;
+	}
+
+	TlsConnection::~TlsConnection()
+	{
+		mbedtls_ssl_free(m_ssl.get());
+	}
+
+	int TlsConnection::handshake()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		tIsSessionResumed = &m_isSessionResumed;
+#if defined(NETSOCKET_KERNEL_TLS) && (MBEDTLS_VERSION_MAJOR < 3)
+		tKeyMaterial = m_keyMaterial.get();
+#endif
+		int result = mbedtls_ssl_handshake(m_ssl.get());
+		tIsSessionResumed = NULL;
+#if defined(NETSOCKET_KERNEL_TLS) && (MBEDTLS_VERSION_MAJOR < 3)
+		tKeyMaterial = NULL;
+#endif
+		if(result == MBEDTLS_ERR_SSL_WANT_READ)
+			return WantRead;
+		if(result == MBEDTLS_ERR_SSL_WANT_WRITE)
+			return WantWrite;
+		if(result != 0)
+		{
+			spdlog::error("TLS handshake failed, error: {}", GetTlsErrorString(result));
+			// Don't offer a session which may be what the server is choking on
+			if(m_offeredSession)
+				m_context->forgetSession(m_sessionKey);
+			return -1;
+		}
+		m_isHandshakeDone = true;
+
+		if(!m_sessionKey.empty())
+		{
+			if(m_offeredSession)
+				m_isSessionResumed = IsSameMasterSecret(mbedtls_ssl_get_session_pointer(m_ssl.get()), m_offeredSession.get());
+			// Remember the session (and the ticket that came with it) for the next connection to this server
+			std::shared_ptr<mbedtls_ssl_session> session(new mbedtls_ssl_session, [](mbedtls_ssl_session* session)
+			{
+				mbedtls_ssl_session_free(session);
+				delete session;
+			});
+			mbedtls_ssl_session_init(session.get());
+			if(mbedtls_ssl_get_session(m_ssl.get(), session.get()) == 0)
+				m_context->rememberSession(m_sessionKey, std::move(session));
+		}
+
+		if(m_keyMaterial)
+		{
+			enableKernelOffload();
+			m_keyMaterial.reset();
+		}
+		return 0;
+	}
+
+	void TlsConnection::enableKernelOffload()
+	{
+#ifdef NETSOCKET_KERNEL_TLS
+		const KernelCipher* cipher = FindKernelCipher(getCipherSuite());
+		if(!m_keyMaterial->isSet || (getVersion() != "TLSv1.2") || (cipher == NULL))
+		{
+			spdlog::debug("Kernel TLS offload not possible with {} {}", getVersion(), getCipherSuite());
+			return;
+		}
+		// mbedtls reads one record at a time, so nothing past the Finished message should be buffered, but if something is, the kernel would never see it
+		if(mbedtls_ssl_check_pending(m_ssl.get()) != 0)
+			return;
+
+		// key_block = PRF(master_secret, "key expansion", server_random + client_random), then split into
+		// client_write_key, server_write_key, client_write_IV and server_write_IV (RFC 5246, section 6.3)
+		unsigned char keyBlock[2 * 32 + 2 * 12];
+		const u32 keyBlockSize = 2 * (cipher->keySize + cipher->fixedIVSize);
+		netsocket_assert(keyBlockSize <= sizeof(keyBlock));
+		if(mbedtls_ssl_tls_prf(m_keyMaterial->prfType, m_keyMaterial->masterSecret, sizeof(m_keyMaterial->masterSecret), "key expansion",
+								m_keyMaterial->randoms, sizeof(m_keyMaterial->randoms), keyBlock, keyBlockSize) != 0)
+			return;
+		const unsigned char* clientKey = keyBlock;
+		const unsigned char* serverKey = clientKey + cipher->keySize;
+		const unsigned char* clientIV = serverKey + cipher->keySize;
+		const unsigned char* serverIV = clientIV + cipher->fixedIVSize;
+		const bool isClient = m_context->getRole() == TlsRole::Client;
+
+		// Each side has protected exactly one record with the new keys, its Finished message
+		static constexpr u64 sequenceNumber = 1;
+		if(setsockopt(m_socket, SOL_TCP, TCP_ULP, "tls", sizeof("tls")) != 0)
+			spdlog::debug("Kernel TLS is not available (the tls module isn't loaded?), errno: {}", errno);
+		// Receive side first: if it can't be offloaded, mbedtls must keep both, as reading can make it write (e.g. an alert)
+		else if(SetKernelKeys(m_socket, TLS_RX, *cipher, isClient ? serverKey : clientKey, isClient ? serverIV : clientIV, sequenceNumber))
+		{
+			m_isKernelRx = true;
+			m_isKernelTx = SetKernelKeys(m_socket, TLS_TX, *cipher, isClient ? clientKey : serverKey, isClient ? clientIV : serverIV, sequenceNumber);
+		}
+		mbedtls_platform_zeroize(keyBlock, sizeof(keyBlock));
+#endif
+	}
+
+	int TlsConnection::send(const u8* bytes, u32 size)
+	{
+#ifdef NETSOCKET_KERNEL_TLS
+		if(m_isKernelTx)
+		{
+			int result = ::send(m_socket, reinterpret_cast<const char*>(bytes), static_cast<int>(size), gSendFlags);
+			if(result >= 0)
+				return result;
+			return IsSocketWouldBlockError() ? WantWrite : -1;
+		}
+#endif
+		std::lock_guard<std::mutex> lock(m_mutex);
+		int result = mbedtls_ssl_write(m_ssl.get(), bytes, size);
+		if(result >= 0)
+			return result;
+		if(result == MBEDTLS_ERR_SSL_WANT_READ)
+			return WantRead;
+		if(result == MBEDTLS_ERR_SSL_WANT_WRITE)
+			return WantWrite;
+		spdlog::error("mbedtls_ssl_write failed, error: {}", GetTlsErrorString(result));
+		return -1;
+	}
+
+	int TlsConnection::receive(u8* bytes, u32 size)
+	{
+#ifdef NETSOCKET_KERNEL_TLS
+		if(m_isKernelRx)
+			return ReceiveKernel(m_socket, bytes, size);
+#endif
+		std::lock_guard<std::mutex> lock(m_mutex);
+		int result = mbedtls_ssl_read(m_ssl.get(), bytes, size);
+		if(result >= 0)
+			return result;
+		switch(result)
+		{
+			case MBEDTLS_ERR_SSL_WANT_READ: return WantRead;
+			case MBEDTLS_ERR_SSL_WANT_WRITE: return WantWrite;
+			// The peer closed the connection, cleanly or not
+			case MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY:
+			case MBEDTLS_ERR_SSL_CONN_EOF: return 0;
+			default:
+			{
+				spdlog::error("mbedtls_ssl_read failed, error: {}", GetTlsErrorString(result));
+				return -1;
+			}
+		}
+	}
+
+	u32 TlsConnection::getPendingSize()
+	{
+		// The kernel only reports the socket readable once it has a whole record to decrypt
+		if(m_isKernelRx)
+			return 0;
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return static_cast<u32>(mbedtls_ssl_get_bytes_avail(m_ssl.get()));
+	}
+
+	void TlsConnection::closeNotify()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+#ifdef NETSOCKET_KERNEL_TLS
+		if(m_isKernelTx)
+		{
+			SendKernelCloseNotify(m_socket);
+			return;
+		}
+#endif
+		if(m_isHandshakeDone)
+			mbedtls_ssl_close_notify(m_ssl.get());
+	}
+
+	std::string_view TlsConnection::getVersion() const
+	{
+		return { mbedtls_ssl_get_version(m_ssl.get()) };
+	}
+
+	std::string_view TlsConnection::getCipherSuite() const
+	{
+		const char* name = mbedtls_ssl_get_ciphersuite(m_ssl.get());
+		return (name == NULL) ? std::string_view { } : std::string_view { name };
+	}
+}
@@ -0,0 +1,107 @@
+#include <netsocket/tokenbucket.hpp>
+
+#include <algorithm> // for std::min, std::max
+
+namespace netsocket
+{
+	// Smallest burst, one packet
+	static constexpr u64 gMinBurstSize = 1500;
+
+	static u64 GetBurstSize(const RateLimit& limit) noexcept
+	{
+		if(limit.burstSize > 0)
+			return limit.burstSize;
+		return std::max(limit.rate / 100, gMinBurstSize);
+	}
+
+	TokenBucket::TokenBucket(const RateLimit& limit) : m_rate(limit.rate),
+														m_burstSize(GetBurstSize(limit)),
+														m_tokens(static_cast<double>(m_burstSize)),
+														m_refillTime(std::chrono::steady_clock::now())
+	{
+	}
+
+	void TokenBucket::refill(std::chrono::steady_clock::time_point now) noexcept
+	{
+		const double elapsed = std::chrono::duration<double>(now - m_refillTime).count();
+		m_tokens = std::min(m_tokens + elapsed * static_cast<double>(m_rate), static_cast<double>(m_burstSize));
+		m_refillTime = now;
+	}
+
+	bool TokenBucket::waitFor(std::unique_lock<std::mutex>& lock, u64 size)
+	{
+		while(m_rate > 0)
+		{
+			const auto now = std::chrono::steady_clock::now();
+			refill(now);
+			// Capped at each turn, the limit may have changed meanwhile
+			const double missingTokens = static_cast<double>(std::min(size, m_burstSize)) - m_tokens;
+			if(missingTokens <= 0)
+				return true;
+			const auto waitTime = std::chrono::duration<double>(missingTokens / static_cast<double>(m_rate));
+			m_limitCV.wait_until(lock, now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(waitTime));
+		}
+		return false;
+	}
+
+	void TokenBucket::setLimit(const RateLimit& limit)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			const auto now = std::chrono::steady_clock::now();
+			// Tokens earned at the previous rate are kept, up to the new burst size. From unlimited, the bucket starts full
+			if(m_rate > 0)
+				refill(now);
+			else
+				m_tokens = static_cast<double>(GetBurstSize(limit));
+			m_rate = limit.rate;
+			m_burstSize = GetBurstSize(limit);
+			m_tokens = std::min(m_tokens, static_cast<double>(m_burstSize));
+			m_refillTime = now;
+		}
+		m_limitCV.notify_all();
+	}
+
+	RateLimit TokenBucket::getLimit()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return { m_rate, m_burstSize };
+	}
+
+	bool TokenBucket::isLimited()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_rate > 0;
+	}
+
+	u64 TokenBucket::acquire(u64 size)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if(m_rate == 0)
+			return size;
+		// The whole burst at most, so that a large send goes out at the rate rather than at once
+		size = std::min(size, m_burstSize);
+		if(waitFor(lock, size))
+			m_tokens -= static_cast<double>(size);
+		return size;
+	}
+
+	void TokenBucket::acquireAll(u64 size)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if(waitFor(lock, size))
+			m_tokens -= static_cast<double>(size);
+	}
+
+	bool TokenBucket::tryAcquireAll(u64 size)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if(m_rate == 0)
+			return true;
+		refill(std::chrono::steady_clock::now());
+		if(m_tokens < static_cast<double>(std::min(size, m_burstSize)))
+			return false;
+		m_tokens -= static_cast<double>(size);
+		return true;
+	}
+}
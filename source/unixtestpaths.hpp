@@ -0,0 +1,17 @@
+#pragma once
+
+#include <common/defines.hpp>
+
+#include <string>
+#include <string_view>
+#include <filesystem>
+
+// Addresses of the Unix domain socket demos: a socket file for the stream socket, an abstract name (Linux) for the datagram socket
+static std::string GetUnixStreamTestPath()
+{
+	return (std::filesystem::temp_directory_path() / "netsocket_unix_test.sock").string();
+}
+
+static constexpr std::string_view gUnixDatagramTestName = "@netsocket_unix_test_datagram";
+// Sizes of the datagrams the client sends, the server receives them one at a time with their boundaries intact
+static constexpr u32 gUnixDatagramSizes[] = { 1, 100, 1000 };
@@ -6,6 +6,9 @@
 #include <ixwebsocket/IXUserAgent.h>
 
 #include <cstring> // for std::memcpy
+#include <thread> // for std::this_thread::sleep_for
+#include <algorithm> // for std::min, std::sort, std::binary_search
+#include <optional>
 
 #include <iostream>
 
@@ -21,14 +24,28 @@ static DESTRUCTOR_FUNCTION void DeinitializeWebSocket()
 
 namespace netsocket
 {
+	struct WebSocket::ClientRegistry
+	{
+		std::mutex mutex;
+		std::vector<WebSocket*> clients;
+	};
+
 	template<typename T>
 	static void NoDeleter(T*) { }
 
+	static constexpr u32 gDefaultMaxReceiveQueueSize = 256;
+	// Policy violation, sent when the peer outpaces the application
+	static constexpr u16 gReceiveQueueFullCloseCode = 1008;
+
 	WebSocket::WebSocket() : m_serverSocket(nullptr, NoDeleter<ix::WebSocketServer>),
 							m_clientSocket(nullptr, NoDeleter<ix::WebSocket>),
 							m_isConnected(false),
 							m_isError(false),
-							m_hasReceiveData(false),
+							m_receiveOffset(0),
+							m_maxReceiveQueueSize(gDefaultMaxReceiveQueueSize),
+							m_isTls(false),
+							m_sendHighWatermark(0),
+							m_sendLowWatermark(0),
 							m_isServerOwnedClient(false)
 							
 	{
@@ -55,13 +72,133 @@ namespace netsocket
 	std::unique_ptr<WebSocket> WebSocket::accept()
 	{
 		netsocket_assert(m_serverSocket && "WebSocket is not usable as server");
-		return m_acceptedSockets->pop();
+		std::unique_lock<std::mutex> lock(m_acceptMutex);
+		m_acceptCV.wait(lock, [this] { return !m_acceptedSockets.empty(); });
+		std::unique_ptr<WebSocket> socket = std::move(m_acceptedSockets.front());
+		m_acceptedSockets.pop_front();
+		return socket;
+	}
+
+	std::unique_ptr<WebSocket> WebSocket::tryAccept()
+	{
+		netsocket_assert(m_serverSocket && "WebSocket is not usable as server");
+		std::lock_guard<std::mutex> lock(m_acceptMutex);
+		if(m_acceptedSockets.empty())
+			return { };
+		std::unique_ptr<WebSocket> socket = std::move(m_acceptedSockets.front());
+		m_acceptedSockets.pop_front();
+		return socket;
+	}
+
+	void WebSocket::setOnAccept(const OnAcceptCallback& callback, const TaskExecutor& executor)
+	{
+		netsocket_assert(m_serverSocket && "WebSocket is not usable as server");
+		std::deque<std::unique_ptr<WebSocket>> acceptedSockets;
+		{
+			std::lock_guard<std::mutex> lock(m_acceptMutex);
+			m_onAcceptCallback = callback;
+			m_acceptExecutor = executor;
+			if(callback)
+				std::swap(acceptedSockets, m_acceptedSockets);
+		}
+		for(auto& socket : acceptedSockets)
+			DeliverAcceptedSocket(std::move(socket), callback, executor);
+	}
+
+	void WebSocket::DeliverAcceptedSocket(std::unique_ptr<WebSocket> socket, const OnAcceptCallback& callback, const TaskExecutor& executor)
+	{
+		if(!executor)
+		{
+			callback(std::move(socket));
+			return;
+		}
+		// std::function must be copyable, so the socket is carried in a shared_ptr
+		auto sharedSocket = std::make_shared<std::unique_ptr<WebSocket>>(std::move(socket));
+		executor([callback, sharedSocket]()
+		{
+			callback(std::move(*sharedSocket));
+		});
 	}
 
-	Result WebSocket::bind(const std::string_view ipAddress, const std::string_view portNumber)
+	void WebSocket::onAccepted(std::unique_ptr<WebSocket> socket)
 	{
+		std::unique_lock<std::mutex> lock(m_acceptMutex);
+		if(m_onAcceptCallback)
+		{
+			// Copies, so that the callback can call setOnAccept() again
+			OnAcceptCallback callback = m_onAcceptCallback;
+			TaskExecutor executor = m_acceptExecutor;
+			lock.unlock();
+			DeliverAcceptedSocket(std::move(socket), callback, executor);
+			return;
+		}
+		m_acceptedSockets.push_back(std::move(socket));
+		lock.unlock();
+		m_acceptCV.notify_one();
+	}
+
+	static ix::WebSocketPerMessageDeflateOptions GetIXPerMessageDeflateOptions(const WebSocketCompressionOptions& options)
+	{
+		netsocket_assert((options.windowBits >= 8) && (options.windowBits <= 15));
+		netsocket_assert((options.level >= -1) && (options.level <= 9));
+		return ix::WebSocketPerMessageDeflateOptions(options.isEnabled,
+													/* clientNoContextTakeover */ !options.isContextTakeover,
+													/* serverNoContextTakeover */ !options.isContextTakeover,
+													/* clientMaxWindowBits */ options.windowBits,
+													/* serverMaxWindowBits */ options.windowBits);
+	}
+
+	static std::optional<ix::SocketTLSOptions> GetIXTLSOptions(const WebSocketTlsOptions& options, bool isServer)
+	{
+		if(options.context || !options.serverName.empty())
+		{
+			std::cerr << "ixwebsocket doesn't support WebSocketTlsOptions::context and serverName, use NativeWebSocket" << std::endl;
+			return { };
+		}
+		ix::SocketTLSOptions tlsOptions;
+		tlsOptions.tls = true;
+		tlsOptions.certFile = options.certificateFile;
+		tlsOptions.keyFile = options.privateKeyFile;
+		// "NONE" disables the verification of the peer: a server only verifies clients against the given CA file,
+		// a client keeps ixwebsocket's default ("SYSTEM", the system's CA bundle) unless told otherwise
+		if(!options.caFile.empty())
+			tlsOptions.caFile = options.caFile;
+		else if(isServer)
+			tlsOptions.caFile = "NONE";
+		if(!isServer && options.isInsecureSkipVerify)
+		{
+			tlsOptions.caFile = "NONE";
+			tlsOptions.disable_hostname_validation = true;
+		}
+		if(!options.cipherSuites.empty())
+			tlsOptions.ciphers = options.cipherSuites;
+		if(!tlsOptions.isValid())
+		{
+			std::cerr << "Invalid TLS options" << std::endl;
+			return { };
+		}
+		return tlsOptions;
+	}
+
+	Result WebSocket::bind(const std::string_view ipAddress, const std::string_view portNumber, const WebSocketCompressionOptions& compressionOptions,
+							const WebSocketTlsOptions& tlsOptions)
+	{
+		std::optional<ix::SocketTLSOptions> ixTLSOptions;
+		if(tlsOptions.isEnabled)
+		{
+			ixTLSOptions = GetIXTLSOptions(tlsOptions, true);
+			if(!ixTLSOptions)
+				return Result::Failed;
+		}
 		auto iPortNumber = std::stoul(std::string { portNumber });
 		m_serverSocket = MakeUnique<ix::WebSocketServer>(iPortNumber, std::string { ipAddress });
+		m_compressionOptions = compressionOptions;
+		m_isTls = tlsOptions.isEnabled;
+		if(ixTLSOptions)
+			m_serverSocket->setTLSOptions(*ixTLSOptions);
+		// ix::WebSocketServer accepts whatever the client offers, it can only be told to not negotiate the extension at all
+		if(!compressionOptions.isEnabled)
+			m_serverSocket->disablePerMessageDeflate();
 
 		m_serverSocket->setOnClientMessageCallback([this](std::shared_ptr<ix::ConnectionState> connectionState, ix::WebSocket & webSocket, const ix::WebSocketMessagePtr & msg) {
     		// The ConnectionState object contains information about the connection,
@@ -73,7 +210,14 @@ namespace netsocket
     		    std::cout << "New connection" << std::endl;
 
     		    auto acceptedSocket = CreateAcceptedSocket(webSocket);
-    		    m_acceptedSockets->push(std::move(acceptedSocket));
+    		    acceptedSocket->m_compressionOptions = m_compressionOptions;
+    		    acceptedSocket->m_isTls = m_isTls;
+    		    acceptedSocket->m_clientRegistry = m_clientRegistry;
+    		    {
+    		    	std::lock_guard<std::mutex> lock(m_clientRegistry->mutex);
+    		    	m_clientRegistry->clients.push_back(acceptedSocket.get());
+    		    }
+    		    onAccepted(std::move(acceptedSocket));
 
         		// A connection state object is available, and has a default id
         		// You can subclass ConnectionState and pass an alternate factory
@@ -92,15 +236,40 @@ namespace netsocket
     		}
 		});
 
-		m_acceptedSockets = std::make_unique<com::ProducerConsumerBuffer<std::unique_ptr<WebSocket>>>();
+		{
+			std::lock_guard<std::mutex> lock(m_acceptMutex);
+			m_acceptedSockets.clear();
+		}
+		m_clientRegistry = std::make_shared<ClientRegistry>();
 
 		return Result::Success;
 	}
-	Result WebSocket::connect(const std::string_view ipAddress, const std::string_view port)
+	Result WebSocket::connect(const std::string_view ipAddress, const std::string_view port, const WebSocketCompressionOptions& compressionOptions,
+								const WebSocketTlsOptions& tlsOptions)
 	{
+		std::optional<ix::SocketTLSOptions> ixTLSOptions;
+		if(tlsOptions.isEnabled)
+		{
+			ixTLSOptions = GetIXTLSOptions(tlsOptions, false);
+			if(!ixTLSOptions)
+				return Result::Failed;
+		}
 		m_clientSocket = MakeUnique<ix::WebSocket>();
-    	std::string url(std::format("ws://{}:{}", ipAddress, port));
+		{
+			std::lock_guard<std::mutex> lock(m_receiveMutex);
+			m_receiveQueue.clear();
+			m_receiveOffset = 0;
+		}
+		m_isTls = tlsOptions.isEnabled;
+    	std::string url(std::format("{}://{}:{}", m_isTls ? "wss" : "ws", ipAddress, port));
     	m_clientSocket->setUrl(url);
+    	if(ixTLSOptions)
+    		m_clientSocket->setTLSOptions(*ixTLSOptions);
+    	m_compressionOptions = compressionOptions;
+    	if(compressionOptions.isEnabled)
+    		m_clientSocket->setPerMessageDeflateOptions(GetIXPerMessageDeflateOptions(compressionOptions));
+    	else
+    		m_clientSocket->disablePerMessageDeflate();
 
     	m_clientSocket->setOnMessageCallback([this](const ix::WebSocketMessagePtr& msg)
     	{
@@ -123,6 +292,8 @@ namespace netsocket
 	{
 		if(m_clientSocket)
 		{
+			// Unregister first, so that an in-progress broadcast() is done with this socket before it is torn down
+			unregisterFromServer();
 			std::unique_lock<std::mutex> lock(m_receiveMutex);
 			// It is possible that the remote client has closed the connection
 			// And the server thread destroyes the websocket instance associated the remote client connection
@@ -147,6 +318,8 @@ namespace netsocket
 			// Calling wait() blocks the calling thread forever, I checked the implementation of wait(), it just waits for nothing.
 			// m_serverSocket->wait();
 			m_serverSocket.reset();
+			// The accepted sockets still hold a reference to the registry, they unregister from it when they are closed
+			m_clientRegistry.reset();
 		}
 
 		return Result::Success;
@@ -157,7 +330,15 @@ namespace netsocket
 		if(!isConnected())
 			return Result::SocketError;
 		netsocket_debug_assert(m_clientSocket.get() != nullptr);
+		Result result = applyBackpressure(size);
+		if(result != Result::Success)
+			return result;
 		ix::IXWebSocketSendData data(reinterpret_cast<const char*>(bytes), static_cast<size_t>(size));
+		return sendData(data);
+	}
+
+	Result WebSocket::sendData(const ix::IXWebSocketSendData& data)
+	{
 		ix::WebSocketSendInfo result = m_clientSocket->sendBinary(data);
 		if(result.success)
 			return Result::Success;
@@ -165,30 +346,231 @@ namespace netsocket
 			return Result::Failed;
 	}
 
+	Result WebSocket::checkSendHighWatermark(u32 size, u64& bufferedAmount) const
+	{
+		if(m_sendHighWatermark == 0)
+			return Result::Success;
+		bufferedAmount = getBufferedAmount();
+		return ((bufferedAmount + size) <= m_sendHighWatermark) ? Result::Success : Result::Failed;
+	}
+
+	void WebSocket::callOnSendBufferHigh(u64 bufferedAmount)
+	{
+		if(m_onSendBufferHighCallback)
+			m_onSendBufferHighCallback(*this, bufferedAmount);
+	}
+
+	Result WebSocket::applyBackpressure(u32 size)
+	{
+		u64 bufferedAmount = 0;
+		if(checkSendHighWatermark(size, bufferedAmount) == Result::Success)
+			return Result::Success;
+		callOnSendBufferHigh(bufferedAmount);
+		Result result = waitForBufferedAmount(m_sendLowWatermark, std::chrono::milliseconds::max());
+		if(result != Result::Success)
+			return result;
+		if(m_onSendBufferDrainCallback)
+			m_onSendBufferDrainCallback(*this);
+		return Result::Success;
+	}
+
+	WebSocketBroadcastResult WebSocket::broadcast(const u8* bytes, u32 size)
+	{
+		netsocket_assert(m_serverSocket && "WebSocket is not usable as server");
+		std::vector<std::pair<WebSocket*, u64>> highClients;
+		WebSocketBroadcastResult broadcastResult;
+		{
+			std::lock_guard<std::mutex> lock(m_clientRegistry->mutex);
+			broadcastResult = broadcastLocked(bytes, size, m_clientRegistry->clients, highClients);
+		}
+		for(const auto& [client, bufferedAmount] : highClients)
+			client->callOnSendBufferHigh(bufferedAmount);
+		return broadcastResult;
+	}
+
+	WebSocketBroadcastResult WebSocket::broadcast(const u8* bytes, u32 size, std::span<WebSocket* const> clients)
+	{
+		netsocket_assert(m_serverSocket && "WebSocket is not usable as server");
+		std::vector<std::pair<WebSocket*, u64>> highClients;
+		WebSocketBroadcastResult broadcastResult;
+		{
+			std::lock_guard<std::mutex> lock(m_clientRegistry->mutex);
+			// Only the registered clients are kept alive by the lock, the others (e.g. closed ones) are reported without being touched
+			std::vector<WebSocket*> registeredClients(m_clientRegistry->clients);
+			std::sort(registeredClients.begin(), registeredClients.end());
+			std::vector<WebSocket*> members;
+			std::vector<std::pair<WebSocket*, Result>> failures;
+			for(WebSocket* client : clients)
+			{
+				if(std::binary_search(registeredClients.begin(), registeredClients.end(), client))
+					members.push_back(client);
+				else
+					failures.push_back({ client, Result::SocketError });
+			}
+			broadcastResult = broadcastLocked(bytes, size, members, highClients);
+			broadcastResult.failures.insert(broadcastResult.failures.end(), failures.begin(), failures.end());
+		}
+		for(const auto& [client, bufferedAmount] : highClients)
+			client->callOnSendBufferHigh(bufferedAmount);
+		return broadcastResult;
+	}
+
+	WebSocketBroadcastResult WebSocket::broadcastLocked(const u8* bytes, u32 size, std::span<WebSocket* const> clients,
+															std::vector<std::pair<WebSocket*, u64>>& highClients)
+	{
+		WebSocketBroadcastResult broadcastResult;
+		// ixwebsocket frames (and compresses) per connection, what we can share is the payload:
+		// a single non-owning IXWebSocketSendData view over the caller's bytes
+		ix::IXWebSocketSendData data(reinterpret_cast<const char*>(bytes), static_cast<size_t>(size));
+		for(WebSocket* client : clients)
+		{
+			Result result = Result::SocketError;
+			if(client->isConnected())
+			{
+				u64 bufferedAmount = 0;
+				result = client->checkSendHighWatermark(size, bufferedAmount);
+				if(result == Result::Success)
+					result = client->sendData(data);
+				else
+					highClients.push_back({ client, bufferedAmount });
+			}
+			if(result == Result::Success)
+				++broadcastResult.deliveredCount;
+			else
+				broadcastResult.failures.push_back({ client, result });
+		}
+		return broadcastResult;
+	}
+
+	u32 WebSocket::getClientCount() const
+	{
+		if(!m_clientRegistry)
+			return 0;
+		std::lock_guard<std::mutex> lock(m_clientRegistry->mutex);
+		return static_cast<u32>(m_clientRegistry->clients.size());
+	}
+
+	void WebSocket::unregisterFromServer()
+	{
+		if(!m_clientRegistry)
+			return;
+		{
+			std::lock_guard<std::mutex> lock(m_clientRegistry->mutex);
+			auto& clients = m_clientRegistry->clients;
+			clients.erase(std::remove(clients.begin(), clients.end(), this), clients.end());
+		}
+		m_clientRegistry.reset();
+	}
+
 	Result WebSocket::receive(u8* bytes, u32 size)
 	{
 		if(!isConnected())
 			return Result::SocketError;
 		netsocket_debug_assert(m_clientSocket.get() != nullptr);
 		std::unique_lock<std::mutex> lock(m_receiveMutex);
-		m_receiveCV.wait(lock, [this] { return this->m_hasReceiveData; });
+		m_receiveCV.wait(lock, [this] { return !this->m_receiveQueue.empty() || !this->m_isConnected; });
 		if(!isConnected())
 			return Result::SocketError;
-		if(m_receiveBuffer.size() != size)
-		{
-			m_receiveCV.notify_one();			
+		netsocket_assert((m_receiveOffset == 0) && "A message is being read with receiveChunk(), finish it first");
+		const std::vector<u8>& message = m_receiveQueue.front();
+		if(message.size() != size)
 			return Result::Failed;
+		std::memcpy(bytes, message.data(), size);
+		m_receiveQueue.pop_front();
+		return Result::Success;
+	}
+
+	std::optional<WebSocketChunk> WebSocket::receiveChunk(u8* bytes, u32 size)
+	{
+		netsocket_assert(size > 0);
+		if(!isConnected())
+			return { };
+		netsocket_debug_assert(m_clientSocket.get() != nullptr);
+		std::unique_lock<std::mutex> lock(m_receiveMutex);
+		m_receiveCV.wait(lock, [this] { return !this->m_receiveQueue.empty() || !this->m_isConnected; });
+		if(!isConnected())
+			return { };
+		const std::vector<u8>& message = m_receiveQueue.front();
+		const u32 messageSize = static_cast<u32>(message.size());
+		const u32 chunkSize = std::min(messageSize - m_receiveOffset, size);
+		std::memcpy(bytes, message.data() + m_receiveOffset, chunkSize);
+		m_receiveOffset += chunkSize;
+		const bool isFinal = m_receiveOffset == messageSize;
+		if(isFinal)
+		{
+			m_receiveQueue.pop_front();
+			m_receiveOffset = 0;
+		}
+		return { WebSocketChunk { chunkSize, isFinal } };
+	}
+
+	Result WebSocket::sendChunk(const u8* bytes, u32 size, bool isFinal)
+	{
+		if(!isConnected())
+			return Result::SocketError;
+		m_sendChunkBuffer.insert(m_sendChunkBuffer.end(), bytes, bytes + size);
+		if(!isFinal)
+			return Result::Success;
+		std::vector<u8> message = std::move(m_sendChunkBuffer);
+		m_sendChunkBuffer.clear();
+		return send(message.data(), static_cast<u32>(message.size()));
+	}
+
+	Result WebSocket::finish(std::chrono::milliseconds timeout)
+	{
+		if(!isConnected())
+			return Result::SocketError;
+		return waitForBufferedAmount(0, timeout);
+	}
+
+	u64 WebSocket::getBufferedAmount() const
+	{
+		if(!m_clientSocket)
+			return 0;
+		return static_cast<u64>(m_clientSocket->bufferedAmount());
+	}
+
+	Result WebSocket::waitForBufferedAmount(u64 threshold, std::chrono::milliseconds timeout)
+	{
+		// ix::WebSocket doesn't notify when its send buffer drains (it is flushed by its own thread),
+		// so poll it with an exponential backoff capped at 1 millisecond
+		const bool isInfinite = timeout == std::chrono::milliseconds::max();
+		const auto deadline = isInfinite ? std::chrono::steady_clock::time_point::max() : (std::chrono::steady_clock::now() + timeout);
+		std::chrono::microseconds backoff { 10 };
+		while(getBufferedAmount() > threshold)
+		{
+			if(!isConnected())
+				return Result::SocketError;
+			if(!isInfinite && (std::chrono::steady_clock::now() >= deadline))
+				return Result::Failed;
+			std::this_thread::sleep_for(backoff);
+			backoff = std::min<std::chrono::microseconds>(backoff * 2, std::chrono::milliseconds(1));
 		}
-		std::memcpy(bytes, m_receiveBuffer.data(), size);
-		m_hasReceiveData = false;
-		m_receiveCV.notify_one();
 		return Result::Success;
 	}
 
-	Result WebSocket::finish()
+	void WebSocket::setSendBufferWatermarks(u64 highWatermark, u64 lowWatermark)
+	{
+		netsocket_assert((highWatermark == 0) || (lowWatermark <= highWatermark));
+		m_sendHighWatermark = highWatermark;
+		m_sendLowWatermark = lowWatermark;
+	}
+
+	void WebSocket::setMaxReceiveQueueSize(u32 maxMessageCount)
+	{
+		netsocket_assert(maxMessageCount > 0);
+		std::lock_guard<std::mutex> lock(m_receiveMutex);
+		m_maxReceiveQueueSize = maxMessageCount;
+	}
+
+	void WebSocket::setOnSendBufferHigh(const OnSendBufferHighCallback& callback)
+	{
+		m_onSendBufferHighCallback = callback;
+	}
+
+	void WebSocket::setOnSendBufferDrain(const OnSendBufferDrainCallback& callback)
 	{
-		// TODO
-		return netsocket::Result::Success;
+		m_onSendBufferDrainCallback = callback;
 	}
 
 	void WebSocket::callOnDisconnect()
@@ -219,12 +601,18 @@ namespace netsocket
 
 	void WebSocket::postMessageInReceiveBuffer(const u8* const data, const u32 size)
 	{
-		std::unique_lock<std::mutex> lock(m_receiveMutex);
-		m_receiveCV.wait(lock, [this] { return !m_hasReceiveData; });
-		m_receiveBuffer.resize(size);
-		std::memcpy(m_receiveBuffer.data(), data, size);
-		m_hasReceiveData = true;
-		m_receiveCV.notify_one();
+		// Runs on the ixwebsocket thread, which also handles the sends and pings of this connection: it must not wait for the application.
+		// 'data' is owned by ixwebsocket and only valid during this call, so it is copied.
+		std::lock_guard<std::mutex> lock(m_receiveMutex);
+		if(m_receiveQueue.size() >= m_maxReceiveQueueSize)
+		{
+			std::cout << std::format("Receive queue is full ({} messages), closing the connection\n", m_receiveQueue.size());
+			if(m_clientSocket)
+				m_clientSocket->close(gReceiveQueueFullCloseCode, "Receive queue is full");
+			return;
+		}
+		m_receiveQueue.emplace_back(data, data + size);
+		m_receiveCV.notify_all();
 	}
 
 	void WebSocket::processMessage(const ix::WebSocketMessagePtr& msg)
@@ -237,23 +625,23 @@ namespace netsocket
 		else if (msg->type == ix::WebSocketMessageType::Open)
 		{
 		    m_isConnected = true;
-		    m_receiveCV.notify_one();			
+		    m_receiveCV.notify_all();
 		}
 		else if (msg->type == ix::WebSocketMessageType::Error)
 		{
 			m_isError = true;
-			m_receiveCV.notify_one();
+			m_receiveCV.notify_all();
 		}
 		else if (msg->type == ix::WebSocketMessageType::Close)
 		{
 			// NOTE: Race condition:
 			// Given that close() has been called (from destructor) and waiting over m_isConnected to become false,
-			// It is possible that m_receiveCV would be destroyed as soon as m_isConnected is set to false and m_receiveCV.notify_one() would become garbage.
-			// So, it is important here to keep the mutex locked until notify_one is called and then let the close() proceed further.
+			// It is possible that m_receiveCV would be destroyed as soon as m_isConnected is set to false and m_receiveCV.notify_all() would become garbage.
+			// So, it is important here to keep the mutex locked until notify_all is called and then let the close() proceed further.
 			std::lock_guard<std::mutex> lock(m_receiveMutex);
 		    m_isConnected = false;
 		    callOnDisconnect();
-		    m_receiveCV.notify_one();
+		    m_receiveCV.notify_all();
 		}
 	}
 }
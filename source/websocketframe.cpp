@@ -0,0 +1,183 @@
+#include <netsocket/websocketframe.hpp>
+
+#include <cstring> // for std::memcpy
+
+#if defined(__x86_64__) || defined(__i386__)
+#	include <immintrin.h>
+#	if defined(__GNUC__)
+#		define NETSOCKET_MASK_AVX2
+#	endif
+#	if defined(__SSE2__)
+#		define NETSOCKET_MASK_SSE2
+#	endif
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#	include <arm_neon.h>
+#	define NETSOCKET_MASK_NEON
+#endif
+
+namespace netsocket
+{
+	u32 WebSocketFrameHeader::encode(u8* bytes) const noexcept
+	{
+		bytes[0] = (isFinal ? 0x80 : 0x00) | (isCompressed ? 0x40 : 0x00) | static_cast<u8>(opcode);
+		const u8 maskBit = isMasked ? 0x80 : 0x00;
+		u32 size = 2;
+		if(payloadLength < 126)
+			bytes[1] = maskBit | static_cast<u8>(payloadLength);
+		else if(payloadLength <= 0xFFFF)
+		{
+			bytes[1] = maskBit | 126;
+			bytes[2] = static_cast<u8>(payloadLength >> 8);
+			bytes[3] = static_cast<u8>(payloadLength);
+			size = 4;
+		}
+		else
+		{
+			bytes[1] = maskBit | 127;
+			for(u32 i = 0; i < 8; ++i)
+				bytes[2 + i] = static_cast<u8>(payloadLength >> (56 - 8 * i));
+			size = 10;
+		}
+		if(isMasked)
+		{
+			std::memcpy(bytes + size, &maskKey, sizeof(maskKey));
+			size += 4;
+		}
+		return size;
+	}
+
+	std::optional<u32> WebSocketFrameHeader::decode(const u8* bytes, u32 size) noexcept
+	{
+		if(size < 2)
+			return { 0 };
+
+		// RSV2 and RSV3 are not used by any extension we negotiate
+		if((bytes[0] & 0x30) != 0)
+			return { };
+		const u8 opcodeValue = bytes[0] & 0x0F;
+		switch(opcodeValue)
+		{
+			case 0x0: case 0x1: case 0x2: case 0x8: case 0x9: case 0xA: break;
+			default: return { };
+		}
+
+		const u8 length7 = bytes[1] & 0x7F;
+		const bool isMaskBitSet = (bytes[1] & 0x80) != 0;
+		const u32 lengthSize = (length7 == 126) ? 2 : ((length7 == 127) ? 8 : 0);
+		const u32 headerSize = GetEncodedSize(bytes[1]);
+		if(size < headerSize)
+			return { 0 };
+
+		isFinal = (bytes[0] & 0x80) != 0;
+		isCompressed = (bytes[0] & 0x40) != 0;
+		opcode = static_cast<WebSocketOpcode>(opcodeValue);
+		isMasked = isMaskBitSet;
+		if(lengthSize == 0)
+			payloadLength = length7;
+		else
+		{
+			payloadLength = 0;
+			for(u32 i = 0; i < lengthSize; ++i)
+				payloadLength = (payloadLength << 8) | bytes[2 + i];
+			// The most significant bit of a 64-bit length must be 0
+			if((lengthSize == 8) && ((payloadLength >> 63) != 0))
+				return { };
+		}
+		if(isMasked)
+			std::memcpy(&maskKey, bytes + 2 + lengthSize, sizeof(maskKey));
+		else
+			maskKey = 0;
+
+		// Control frames must not be fragmented and their payload is limited to 125 bytes
+		if(IsWebSocketControlOpcode(opcode) && (!isFinal || (payloadLength > MaxControlPayloadSize)))
+			return { };
+		return { headerSize };
+	}
+
+	// Each of the vectorized variants processes as many whole vectors as fit in 'size' and returns the number of bytes processed,
+	// 'key' is the masking key already rotated to start at source[0]
+	typedef u64 (*MaskFunction)(u8* destination, const u8* source, u64 size, u32 key);
+
+#ifdef NETSOCKET_MASK_AVX2
+	__attribute__((target("avx2"))) static u64 MaskAVX2(u8* destination, const u8* source, u64 size, u32 key)
+	{
+		const __m256i keyVector = _mm256_set1_epi32(static_cast<int>(key));
+		u64 i = 0;
+		for(; (i + 32) <= size; i += 32)
+		{
+			__m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), _mm256_xor_si256(data, keyVector));
+		}
+		return i;
+	}
+#endif // NETSOCKET_MASK_AVX2
+
+#ifdef NETSOCKET_MASK_SSE2
+	static u64 MaskSSE2(u8* destination, const u8* source, u64 size, u32 key)
+	{
+		const __m128i keyVector = _mm_set1_epi32(static_cast<int>(key));
+		u64 i = 0;
+		for(; (i + 16) <= size; i += 16)
+		{
+			__m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_xor_si128(data, keyVector));
+		}
+		return i;
+	}
+#endif // NETSOCKET_MASK_SSE2
+
+#ifdef NETSOCKET_MASK_NEON
+	static u64 MaskNEON(u8* destination, const u8* source, u64 size, u32 key)
+	{
+		const uint8x16_t keyVector = vreinterpretq_u8_u32(vdupq_n_u32(key));
+		u64 i = 0;
+		for(; (i + 16) <= size; i += 16)
+			vst1q_u8(destination + i, veorq_u8(vld1q_u8(source + i), keyVector));
+		return i;
+	}
+#endif // NETSOCKET_MASK_NEON
+
+	static MaskFunction SelectMaskFunction()
+	{
+#ifdef NETSOCKET_MASK_AVX2
+		if(__builtin_cpu_supports("avx2"))
+			return MaskAVX2;
+#endif
+#ifdef NETSOCKET_MASK_SSE2
+		return MaskSSE2;
+#elif defined(NETSOCKET_MASK_NEON)
+		return MaskNEON;
+#else
+		return NULL;
+#endif
+	}
+
+	NETSOCKET_API void MaskWebSocketPayload(u8* destination, const u8* source, u64 size, u32 maskKey, u64 offset) noexcept
+	{
+		static const MaskFunction maskFunction = SelectMaskFunction();
+
+		// Rotate the key so that its first byte applies to source[0]
+		u8 keyBytes[4];
+		std::memcpy(keyBytes, &maskKey, sizeof(keyBytes));
+		u8 rotatedKeyBytes[4];
+		for(u32 i = 0; i < 4; ++i)
+			rotatedKeyBytes[i] = keyBytes[(offset + i) & 3];
+		u32 key;
+		std::memcpy(&key, rotatedKeyBytes, sizeof(key));
+
+		// Vectors are multiples of 4 bytes, so the key stays aligned for the remainder
+		u64 i = (maskFunction != NULL) ? maskFunction(destination, source, size, key) : 0;
+
+		// Same 4 bytes in both halves, whatever the endianness
+		const u64 wideKey = (static_cast<u64>(key) << 32) | key;
+		for(; (i + 8) <= size; i += 8)
+		{
+			u64 data;
+			std::memcpy(&data, source + i, sizeof(data));
+			data ^= wideKey;
+			std::memcpy(destination + i, &data, sizeof(data));
+		}
+		for(; i < size; ++i)
+			destination[i] = source[i] ^ rotatedKeyBytes[i & 3];
+	}
+}
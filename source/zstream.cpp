@@ -0,0 +1,204 @@
+#include <netsocket/zstream.hpp>
+#include <netsocket/assert.hpp>
+
+#undef _ASSERT
+#include <spdlog/spdlog.h>
+
+#include <zlib.h>
+
+#include <algorithm> // for std::max
+
+namespace netsocket
+{
+	static int GetZlibFlush(DeflateStream::Flush flush)
+	{
+		switch(flush)
+		{
+			case DeflateStream::Flush::None: return Z_NO_FLUSH;
+			case DeflateStream::Flush::Sync: return Z_SYNC_FLUSH;
+			case DeflateStream::Flush::Full: return Z_FULL_FLUSH;
+			case DeflateStream::Flush::Finish: return Z_FINISH;
+			default: netsocket_assert(false && "Unrecognized DeflateStream::Flush"); return Z_SYNC_FLUSH;
+		}
+	}
+
+	DeflateStream::DeflateStream(s32 level, s32 windowBits, bool isRaw, s32 memLevel) : m_stream(std::make_unique<z_stream_s>()), m_isValid(false)
+	{
+		// zlib refuses a window of 256 bytes (8 bits) for raw deflate streams
+		netsocket_assert((windowBits >= 9) && (windowBits <= 15));
+		m_stream->zalloc = Z_NULL;
+		m_stream->zfree = Z_NULL;
+		m_stream->opaque = Z_NULL;
+		int result = deflateInit2(m_stream.get(), level, Z_DEFLATED, isRaw ? -windowBits : windowBits, memLevel, Z_DEFAULT_STRATEGY);
+		if(result != Z_OK)
+		{
+			spdlog::error("deflateInit2 failed, error: {}", result);
+			return;
+		}
+		m_isValid = true;
+	}
+
+	DeflateStream::DeflateStream(DeflateStream&& stream) : m_stream(std::move(stream.m_stream)), m_dictionary(std::move(stream.m_dictionary)), m_isValid(stream.m_isValid)
+	{
+		stream.m_isValid = false;
+	}
+
+	DeflateStream::~DeflateStream()
+	{
+		if(!m_isValid)
+			return;
+		deflateEnd(m_stream.get());
+		m_isValid = false;
+	}
+
+	bool DeflateStream::compress(const u8* bytes, u32 size, Flush flush, std::vector<u8>& output)
+	{
+		netsocket_debug_assert(m_isValid);
+		const int zflush = GetZlibFlush(flush);
+		m_stream->next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(bytes));
+		m_stream->avail_in = size;
+		do
+		{
+			// deflateBound() is for one-shot compression, a few more bytes are needed for the flush marker
+			const std::size_t offset = output.size();
+			const std::size_t chunkSize = std::max<std::size_t>(deflateBound(m_stream.get(), m_stream->avail_in) + 16, 256);
+			output.resize(offset + chunkSize);
+			m_stream->next_out = reinterpret_cast<Bytef*>(output.data() + offset);
+			m_stream->avail_out = static_cast<uInt>(chunkSize);
+			int result = deflate(m_stream.get(), zflush);
+			output.resize(offset + chunkSize - m_stream->avail_out);
+			if((result == Z_STREAM_ERROR) || ((result == Z_BUF_ERROR) && (m_stream->avail_in != 0)))
+			{
+				spdlog::error("deflate failed, error: {}", result);
+				return false;
+			}
+		} while(m_stream->avail_out == 0);
+		netsocket_debug_assert(m_stream->avail_in == 0);
+		return true;
+	}
+
+	bool DeflateStream::setDictionary(const u8* bytes, u32 size)
+	{
+		m_dictionary.assign(bytes, bytes + size);
+		return deflateSetDictionary(m_stream.get(), reinterpret_cast<const Bytef*>(bytes), size) == Z_OK;
+	}
+
+	void DeflateStream::reset()
+	{
+		deflateReset(m_stream.get());
+		if(!m_dictionary.empty())
+			deflateSetDictionary(m_stream.get(), reinterpret_cast<const Bytef*>(m_dictionary.data()), static_cast<uInt>(m_dictionary.size()));
+	}
+
+	InflateStream::InflateStream(s32 windowBits, bool isRaw) : m_stream(std::make_unique<z_stream_s>()), m_isRaw(isRaw), m_isValid(false)
+	{
+		netsocket_assert((windowBits >= 8) && (windowBits <= 15));
+		m_stream->zalloc = Z_NULL;
+		m_stream->zfree = Z_NULL;
+		m_stream->opaque = Z_NULL;
+		m_stream->next_in = Z_NULL;
+		m_stream->avail_in = 0;
+		int result = inflateInit2(m_stream.get(), isRaw ? -windowBits : windowBits);
+		if(result != Z_OK)
+		{
+			spdlog::error("inflateInit2 failed, error: {}", result);
+			return;
+		}
+		m_isValid = true;
+	}
+
+	InflateStream::InflateStream(InflateStream&& stream) : m_stream(std::move(stream.m_stream)), m_dictionary(std::move(stream.m_dictionary)), m_isRaw(stream.m_isRaw), m_isValid(stream.m_isValid)
+	{
+		stream.m_isValid = false;
+	}
+
+	InflateStream::~InflateStream()
+	{
+		if(!m_isValid)
+			return;
+		inflateEnd(m_stream.get());
+		m_isValid = false;
+	}
+
+	bool InflateStream::decompress(const u8* bytes, u32 size, std::vector<u8>& output, u64 maxOutputSize)
+	{
+		netsocket_debug_assert(m_isValid);
+		const std::size_t startSize = output.size();
+		m_stream->next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(bytes));
+		m_stream->avail_in = size;
+		do
+		{
+			const std::size_t offset = output.size();
+			const std::size_t chunkSize = std::max<std::size_t>(static_cast<std::size_t>(m_stream->avail_in) * 4, 4096);
+			output.resize(offset + chunkSize);
+			m_stream->next_out = reinterpret_cast<Bytef*>(output.data() + offset);
+			m_stream->avail_out = static_cast<uInt>(chunkSize);
+			int result = inflate(m_stream.get(), Z_SYNC_FLUSH);
+			if((result == Z_NEED_DICT) && !m_dictionary.empty())
+				result = inflateSetDictionary(m_stream.get(), reinterpret_cast<const Bytef*>(m_dictionary.data()), static_cast<uInt>(m_dictionary.size()));
+			output.resize(offset + chunkSize - m_stream->avail_out);
+			if(result == Z_STREAM_END)
+			{
+				// A complete zlib stream (the peer used Flush::Finish), be ready for the next one
+				inflateReset(m_stream.get());
+				if(m_isRaw && !m_dictionary.empty())
+					inflateSetDictionary(m_stream.get(), reinterpret_cast<const Bytef*>(m_dictionary.data()), static_cast<uInt>(m_dictionary.size()));
+			}
+			else if((result != Z_OK) && (result != Z_BUF_ERROR))
+			{
+				spdlog::error("inflate failed, error: {}", result);
+				return false;
+			}
+			if((output.size() - startSize) > maxOutputSize)
+			{
+				spdlog::error("inflate output exceeds the limit of {} bytes", maxOutputSize);
+				return false;
+			}
+			// Z_BUF_ERROR with free output space means no progress is possible, i.e. all the input has been consumed
+			if((result == Z_BUF_ERROR) && (m_stream->avail_out != 0))
+				break;
+		} while((m_stream->avail_out == 0) || (m_stream->avail_in != 0));
+		return true;
+	}
+
+	std::optional<std::pair<u32, u32>> InflateStream::decompressPartial(const u8* bytes, u32 size, u8* output, u32 outputSize)
+	{
+		netsocket_debug_assert(m_isValid);
+		m_stream->next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(bytes));
+		m_stream->avail_in = size;
+		m_stream->next_out = reinterpret_cast<Bytef*>(output);
+		m_stream->avail_out = outputSize;
+		int result = inflate(m_stream.get(), Z_SYNC_FLUSH);
+		if((result == Z_NEED_DICT) && !m_dictionary.empty())
+		{
+			result = inflateSetDictionary(m_stream.get(), reinterpret_cast<const Bytef*>(m_dictionary.data()), static_cast<uInt>(m_dictionary.size()));
+			if(result == Z_OK)
+				result = inflate(m_stream.get(), Z_SYNC_FLUSH);
+		}
+		const std::pair<u32, u32> progress { size - m_stream->avail_in, outputSize - m_stream->avail_out };
+		if(result == Z_STREAM_END)
+			reset();
+		else if((result != Z_OK) && (result != Z_BUF_ERROR))
+		{
+			spdlog::error("inflate failed, error: {}", result);
+			return { };
+		}
+		return { progress };
+	}
+
+	bool InflateStream::setDictionary(const u8* bytes, u32 size)
+	{
+		m_dictionary.assign(bytes, bytes + size);
+		// zlib wrapped streams ask for the dictionary (Z_NEED_DICT), raw streams must be given it upfront
+		if(m_isRaw)
+			return inflateSetDictionary(m_stream.get(), reinterpret_cast<const Bytef*>(bytes), size) == Z_OK;
+		return true;
+	}
+
+	void InflateStream::reset()
+	{
+		inflateReset(m_stream.get());
+		if(m_isRaw && !m_dictionary.empty())
+			inflateSetDictionary(m_stream.get(), reinterpret_cast<const Bytef*>(m_dictionary.data()), static_cast<uInt>(m_dictionary.size()));
+	}
+}